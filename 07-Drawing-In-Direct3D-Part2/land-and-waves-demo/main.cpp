@@ -462,7 +462,10 @@ void ApplicationInstance::BuildMeshGeometry()
 
 	// land
 	{
-		GeometryGenerator::MeshData grid = generator.CreateGrid(160.0f, 160.0f, 50, 50);
+		GeometryGenerator::MeshData grid = generator.CreateGrid(160.0f, 160.0f, 50, 50, [this](GeometryGenerator::VertexData& vertex)
+		{
+			vertex.position.y = GetHillHeight(vertex.position.x, vertex.position.z);
+		});
 
 		std::vector<Vertex> vertices(grid.vertices.size());
 		std::vector<uint16_t> indices = grid.GetIndices16();
@@ -472,7 +475,6 @@ void ApplicationInstance::BuildMeshGeometry()
 			Vertex& vertex = vertices[i];
 
 			vertex.position = grid.vertices[i].position;
-			vertex.position.y = GetHillHeight(vertex.position.x, vertex.position.z);
 
 			if (vertex.position.y < -10.0f)
 			{
@@ -1,6 +1,7 @@
 #include "ApplicationFramework.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
+#include "MeshOptimizer.h"
 
 const int gFrameResourcesCount = 3;
 
@@ -478,79 +479,65 @@ void ApplicationInstance::BuildMeshGeometry()
 {
 	GeometryGenerator generator;
 
-	GeometryGenerator::MeshData box = generator.CreateBox(1.5f, 0.5f, 1.5f, 3);
-	GeometryGenerator::MeshData grid = generator.CreateGrid(20.0f, 30.0f, 60, 40);
-	GeometryGenerator::MeshData cylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
-	GeometryGenerator::MeshData sphere = generator.CreateSphere(0.5f, 20, 20);
+	GeometryGenerator::MeshSize BoxSize = GeometryGenerator::BoxSize();
+	GeometryGenerator::MeshSize GridSize = GeometryGenerator::GridSize(60, 40);
+	GeometryGenerator::MeshSize CylinderSize = GeometryGenerator::CylinderSize(20, 20);
+	GeometryGenerator::MeshSize SphereSize = GeometryGenerator::SphereSize(20, 20);
 
-	UINT BoxVertexOffset = 0;
-	UINT GridVertexOffset = box.vertices.size();
-	UINT CylinderVertexOffset = GridVertexOffset + grid.vertices.size();
-	UINT SphereVertexOffset = CylinderVertexOffset + cylinder.vertices.size();
-	
-	UINT BoxIndexOffset = 0;
-	UINT GridIndexOffset = box.indices32.size();
-	UINT CylinderIndexOffset = GridIndexOffset + grid.indices32.size();
-	UINT SphereIndexOffset = CylinderIndexOffset + cylinder.indices32.size();
-
-	SubMeshGeometry BoxSubMesh;
-	BoxSubMesh.IndexCount = box.indices32.size();
-	BoxSubMesh.StartIndexLocation = BoxIndexOffset;
-	BoxSubMesh.BaseVertexLocation = BoxVertexOffset;
-
-	SubMeshGeometry GridSubMesh;
-	GridSubMesh.IndexCount = grid.indices32.size();
-	GridSubMesh.StartIndexLocation = GridIndexOffset;
-	GridSubMesh.BaseVertexLocation = GridVertexOffset;
-
-	SubMeshGeometry CylinderSubMesh;
-	CylinderSubMesh.IndexCount = cylinder.indices32.size();
-	CylinderSubMesh.StartIndexLocation = CylinderIndexOffset;
-	CylinderSubMesh.BaseVertexLocation = CylinderVertexOffset;
-
-	SubMeshGeometry SphereSubMesh;
-	SphereSubMesh.IndexCount = sphere.indices32.size();
-	SphereSubMesh.StartIndexLocation = SphereIndexOffset;
-	SphereSubMesh.BaseVertexLocation = SphereVertexOffset;
-
-	size_t VertexCount = box.vertices.size() + grid.vertices.size() + cylinder.vertices.size() + sphere.vertices.size();
-	std::vector<Vertex> vertices(VertexCount);
-	auto i = vertices.begin();
+	GeometryGenerator::MeshSize TotalSize;
+	TotalSize += BoxSize;
+	TotalSize += GridSize;
+	TotalSize += CylinderSize;
+	TotalSize += SphereSize;
 
-	for (auto vertex : box.vertices)
-	{
-		i->position = vertex.position;
-		i->color = XMFLOAT4(DirectX::Colors::DarkGreen);
-		i++;
-	}
+	// every shape is written in place with 16-bit indices, so building the library allocates once
+	GeometryGenerator::MeshArena<uint16_t> arena(TotalSize);
 
-	for (auto vertex : grid.vertices)
+	auto box = arena.allocate(BoxSize);
+	auto grid = arena.allocate(GridSize);
+	auto cylinder = arena.allocate(CylinderSize);
+	auto sphere = arena.allocate(SphereSize);
+
+	generator.CreateBox(1.5f, 0.5f, 1.5f, box);
+	generator.CreateGrid(20.0f, 30.0f, 60, 40, grid);
+	generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20, cylinder);
+	generator.CreateSphere(0.5f, 20, 20, sphere);
+
+	// reorder each shape for the vertex cache and overdraw, its indices stay relative to its own vertices
+	for (const GeometryGenerator::MeshSpans<uint16_t>& shape : { box, grid, cylinder, sphere })
 	{
-		i->position = vertex.position;
-		i->color = XMFLOAT4(DirectX::Colors::ForestGreen);
-		i++;
+		MeshOptimizer::Optimize(shape.indices, shape.vertices, &GeometryGenerator::VertexData::position);
 	}
 
-	for (auto vertex : cylinder.vertices)
+	auto SubMesh = [](const GeometryGenerator::MeshSpans<uint16_t>& shape)
 	{
-		i->position = vertex.position;
-		i->color = XMFLOAT4(DirectX::Colors::Crimson);
-		i++;
-	}
+		SubMeshGeometry submesh;
+		submesh.IndexCount = shape.indices.size();
+		submesh.StartIndexLocation = shape.StartIndex;
+		submesh.BaseVertexLocation = shape.BaseVertex;
 
-	for (auto vertex : sphere.vertices)
+		return submesh;
+	};
+
+	std::vector<Vertex> vertices(TotalSize.VertexCount);
+	auto i = vertices.begin();
+
+	auto AddVertices = [&i](const GeometryGenerator::MeshSpans<uint16_t>& shape, XMVECTORF32 color)
 	{
-		i->position = vertex.position;
-		i->color = XMFLOAT4(DirectX::Colors::SteelBlue);
-		i++;
-	}
+		for (const GeometryGenerator::VertexData& vertex : shape.vertices)
+		{
+			i->position = vertex.position;
+			i->color = XMFLOAT4(color);
+			i++;
+		}
+	};
 
-	std::vector<uint16_t> indices;
+	AddVertices(box, DirectX::Colors::DarkGreen);
+	AddVertices(grid, DirectX::Colors::ForestGreen);
+	AddVertices(cylinder, DirectX::Colors::Crimson);
+	AddVertices(sphere, DirectX::Colors::SteelBlue);
 
-	indices.insert(indices.end(), box.GetIndices16().begin(), box.GetIndices16().end());
-	indices.insert(indices.end(), grid.GetIndices16().begin(), grid.GetIndices16().end());
-	indices.insert(indices.end(), cylinder.GetIndices16().begin(), cylinder.GetIndices16().end());
-	indices.insert(indices.end(), sphere.GetIndices16().begin(), sphere.GetIndices16().end());
+	std::span<const uint16_t> indices = arena.indices();
 
 	UINT VertexBufferByteSize = vertices.size() * sizeof(Vertex);
 	UINT IndexBufferByteSize = indices.size() * sizeof(uint16_t);
@@ -573,10 +560,10 @@ void ApplicationInstance::BuildMeshGeometry()
 	geometry->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geometry->IndexBufferByteSize = IndexBufferByteSize;
 
-	geometry->DrawArgs["box"] = BoxSubMesh;
-	geometry->DrawArgs["grid"] = GridSubMesh;
-	geometry->DrawArgs["cylinder"] = CylinderSubMesh;
-	geometry->DrawArgs["sphere"] = SphereSubMesh;
+	geometry->DrawArgs["box"] = SubMesh(box);
+	geometry->DrawArgs["grid"] = SubMesh(grid);
+	geometry->DrawArgs["cylinder"] = SubMesh(cylinder);
+	geometry->DrawArgs["sphere"] = SubMesh(sphere);
 
 	mMeshGeometries[geometry->name] = std::move(geometry);
 }
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <functional>
+#include <span>
 #include <vector>
 
 #include <DirectXMath.h>
 using namespace DirectX;
 
+class ThreadPool;
+
 class Waves
 {
 	int mRowCount = 0;
@@ -20,12 +24,84 @@ class Waves
 	float mTimeStep = 0.0f;
 	float mSpaceStep = 0.0f;
 
-	std::vector<XMFLOAT3> mPrevData;
-	std::vector<XMFLOAT3> mCurrData;
-	
-	std::vector<XMFLOAT3> mNormals;
+	// simulated time not yet consumed by a fixed step, owned by each instance
+	float mAccumulator = 0.0f;
+	int mMaxSubSteps = 4;
+
+	float mHalfWidth = 0.0f;
+	float mHalfDepth = 0.0f;
+
+	// only the heights are simulated, x/z are derived from the grid on demand;
+	// depending on the storage mode either the float fields or the 16-bit units (height = units * mHeightScale) are in use
+	std::vector<float> mPrevHeights;
+	std::vector<float> mCurrHeights;
+	std::vector<short> mPrevUnits;
+	std::vector<short> mCurrUnits;
+	float mHeightScale = 1.0f;
+	float mInvHeightScale = 1.0f;
+
+	// activity tracking: the field is split into square tiles and a tile is only simulated while it is awake,
+	// disturb wakes tiles, a tile wakes its neighbours when its edge moves and sleeps once it is flat again
+	int mTileSize = 0; // 0 simulates every cell on every step
+	int mTileRows = 0;
+	int mTileCols = 0;
+	float mSleepThreshold = 0.0f;
+
+	std::vector<unsigned char> mTileAwake;
+	std::vector<unsigned char> mTileMask;
+	std::vector<int> mAwakeTiles;
+	std::vector<unsigned char> mTileResults;
+	int mActiveTileCount = 0;
+
+	// cells a step touches, as column runs [ColBegin, ColEnd) grouped by row,
+	// the runs of row i are mHeightSpans[mHeightSpanRows[i]] .. mHeightSpans[mHeightSpanRows[i + 1] - 1]
+	struct Span
+	{
+		int ColBegin;
+		int ColEnd;
+	};
+
+	std::vector<Span> mHeightSpans;
+	std::vector<int> mHeightSpanRows;
+
+	// optional pool the row bands of each pass are spread across
+	ThreadPool* mThreadPool = nullptr;
+	int mBandRows = 0;
+
+	// one fixed step of whichever fields are in use
+	template<typename T>
+	void Step(std::vector<T>& prev, std::vector<T>& curr);
+
+	// update the spans of rows [RowBegin, RowEnd), adding the batched impulses of the rows inside the band
+	// just before the stencil first reads them
+	template<typename T>
+	void UpdateHeights(T* prev, T* curr, int RowBegin, int RowEnd);
+
+	// fill mImpulseRows and mImpulseRowList from mImpulses
+	void BucketImpulses();
+
+	// add the batched impulses of row i to heights
+	template<typename T>
+	void AddRowImpulses(T* heights, int i) const;
+
+	// add every batched impulse right away, for the callers that look at the field before the next step
+	void FlushImpulses();
+
+	// cover the given tiles grown by a halo of cells, or the whole interior when tracking is off
+	void BuildSpans(const std::vector<unsigned char>& tiles, int halo, std::vector<Span>& spans, std::vector<int>& rows);
+
+	// put flat tiles to sleep and wake the neighbours of tiles whose edges moved
+	template<typename T>
+	void UpdateActivity(T* prev, T* curr);
+
+	// run pass(RowBegin, RowEnd) over rows [first, last), split into row bands when a thread pool is set
+	void ForEachBand(int first, int last, const std::function<void(int, int)>& pass) const;
+
+	// the height of the bands ForEachBand splits [first, last) into
+	int BandHeight(int first, int last) const;
 
 public:
+	// dt is the fixed step of the simulation and must be positive
 	Waves(int rows, int cols, float dt, float dx, float speed, float damping);
 	~Waves();
 
@@ -36,10 +112,122 @@ public:
 	float GetWidth() const;
 	float GetDepth() const;
 
-	const XMFLOAT3& GetPosition(int i) const;
-	const XMFLOAT3& GetNormal(int i) const;
+	float GetHeight(int i) const;
+	XMFLOAT3 GetPosition(int i) const;
+	XMFLOAT3 GetNormal(int i) const;
+	XMFLOAT3 GetTangent(int i) const;
+
+	// byte offsets of the attributes inside the caller's vertex, -1 for the ones it does not have
+	struct VertexLayout
+	{
+		int stride = 0;
+		int position = -1;
+		int normal = -1;
+		int tangent = -1; // XMFLOAT3
+		int TexCoord = -1;
+	};
+
+	// one fused pass that derives position, normal, tangent and texture coordinates from the heights
+	// and writes VertexCount() interleaved vertices straight into destination (e.g. a mapped upload buffer).
+	// every vertex is written whether or not its tile is awake: the demos cycle through one upload buffer per
+	// frame resource, so destination holds nothing from the previous call that could be kept
+	void WriteVertices(void* destination, const VertexLayout& layout) const;
 
-	void update(float dt);
+	// how the previous and current height fields are kept in memory
+	enum class HeightStorage
+	{
+		Float32,
+		Fixed16, // 16-bit fixed point, half the memory traffic of Float32
+	};
+
+	// switch storage and convert the current field; Fixed16 rounds heights to multiples of scale
+	// and saturates them at +-32767 * scale, so pick scale from the tallest expected wave.
+	// normals, tangents and positions are still computed and returned as float
+	void SetHeightStorage(HeightStorage storage, float scale = 1.0f / 4096.0f);
+	HeightStorage GetHeightStorage() const;
+	float GetHeightScale() const;
+
+	// every cell is computed by the same kernel whatever band it falls in,
+	// so the parallel result matches the serial one bit for bit;
+	// BandRows = 0 picks a band height from the pool size, at least 8 rows, while any other height is used as given;
+	// a null pool goes back to serial
+	void SetThreadPool(ThreadPool* pool, int BandRows = 0);
+
+	// TileSize = 0 turns tracking off and simulates the whole field, which is the default,
+	// otherwise a tile sleeps once every height in it is below threshold (and is then flattened).
+	// tracking is approximate: a sleeping tile's edge cells stay frozen, so ripples can stop at tile edges
+	// and heights drift from the dense simulation (about 2.6e-4 on a 1024x1024 splash), a demo opts in knowingly
+	void SetTileTracking(int TileSize, float threshold);
+	int GetTileCount() const;
+	int GetActiveTileCount() const; // tiles simulated by the last step
+
+	// upper bound on the catch-up steps a single update may run,
+	// time beyond the cap is dropped so a long frame cannot snowball into longer ones
+	void SetMaxSubSteps(int count);
+	int GetMaxSubSteps() const;
+
+	// advance by dt in fixed steps and return how many steps were taken
+	int update(float dt);
+
+	// a splash centred on cell (i, j), a cell d cells away rises by magnitude * (1 - d^2 / (2 * radius^2)),
+	// so radius 1 (also the smallest) is the classic 5-point splash
+	struct Impulse
+	{
+		int i;
+		int j;
+		float magnitude;
+		float radius;
+	};
+
+	// centres outside the interior are clamped onto it and kernels are clipped at the edges
 	void disturb(int i, int j, float magnitude);
-};
 
+	// queue a batch of impulses for the next step, which adds each row's impulses in the same pass that steps the
+	// rows next to it, instead of a cache miss per splash; after the next update the heights come out bit for bit
+	// as if disturb had been called for each of them in order (an update that takes no step adds them as it returns).
+	// tiles they reach wake right away
+	void disturb(std::span<const Impulse> impulses);
+
+private:
+	// an impulse clamped onto the interior, with what every row of it needs worked out once
+	struct Kernel
+	{
+		Impulse impulse;
+		int extent; // rows and columns further from the centre get nothing
+		float InvTwoRadius2;
+	};
+
+	// the cells of row i a kernel adds to, ready to add without looking at the kernel again
+	struct KernelRow
+	{
+		int offset; // of the first cell in the field
+		int count;
+		int dj; // column distance of the first cell from the centre
+		int di2;
+		float magnitude;
+		float InvTwoRadius2;
+	};
+
+	Kernel MakeKernel(const Impulse& impulse) const;
+	KernelRow GetKernelRow(const Kernel& kernel, int i) const;
+
+	template<typename T>
+	void AddKernelRow(T* heights, const KernelRow& row) const;
+
+	// add kernel to the interior cells of every row it reaches
+	template<typename T>
+	void AddKernel(T* heights, const Kernel& kernel) const;
+
+	void WakeTiles(const Kernel& kernel);
+
+	// impulses batched by disturb since the last step, and their rows bucketed by field row,
+	// the ones of row i are mImpulseRowList[mImpulseRows[i]] .. mImpulseRowList[mImpulseRows[i + 1] - 1] in the order given
+	std::vector<Kernel> mImpulses;
+	std::vector<int> mImpulseRows;
+	std::vector<KernelRow> mImpulseRowList;
+
+	HeightStorage mStorage = HeightStorage::Float32;
+
+	template<typename T>
+	void WriteVertices(const T* field, void* destination, const VertexLayout& layout) const;
+};
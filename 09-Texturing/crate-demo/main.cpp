@@ -551,7 +551,7 @@ void ApplicationInstance::BuildMeshGeometry()
 
 	// box
 	{
-		GeometryGenerator::MeshData mesh = generator.CreateBox(1.0f, 1.0f, 1.0f, 3);
+		GeometryGenerator::MeshData mesh = generator.CreateBox(1.0f, 1.0f, 1.0f);
 
 		SubMeshGeometry SubMesh;
 		SubMesh.IndexCount = mesh.indices32.size();
@@ -500,18 +500,14 @@ void ApplicationInstance::UpdateWaves(const GameTimer& timer)
 
 	auto WavesVB = mCurrentFrameResource->WavesVB.get();
 
-	for (int i = 0; i < mWaves->VertexCount(); ++i)
-	{
-		Vertex vertex;
-
-		vertex.position = mWaves->GetPosition(i);
-		vertex.normal = mWaves->GetNormal(i);
+	Waves::VertexLayout layout;
+	layout.stride = sizeof(Vertex);
+	layout.position = offsetof(Vertex, position);
+	layout.normal = offsetof(Vertex, normal);
+	layout.TexCoord = offsetof(Vertex, TexCoord);
 
-		vertex.TexCoord.x = 0.5f + vertex.position.x / mWaves->GetWidth();
-		vertex.TexCoord.y = 0.5f - vertex.position.z / mWaves->GetDepth();
-
-		WavesVB->CopyData(i, vertex);
-	}
+	// write the vertices straight into the mapped upload buffer
+	mWaves->WriteVertices(WavesVB->GetMappedData(), layout);
 
 	mWavesRenderItem->geometry->VertexBufferGPU = WavesVB->GetResource();
 }
@@ -700,7 +696,11 @@ void ApplicationInstance::BuildMeshGeometry()
 
 	// land
 	{
-		GeometryGenerator::MeshData grid = generator.CreateGrid(160.0f, 160.0f, 50, 50);
+		GeometryGenerator::MeshData grid = generator.CreateGrid(160.0f, 160.0f, 50, 50, [this](GeometryGenerator::VertexData& vertex)
+		{
+			vertex.position.y = GetHillHeight(vertex.position.x, vertex.position.z);
+			vertex.normal = GetHillNormal(vertex.position.x, vertex.position.z);
+		});
 
 		std::vector<Vertex> vertices(grid.vertices.size());
 		std::vector<uint16_t> indices = grid.GetIndices16();
@@ -710,8 +710,7 @@ void ApplicationInstance::BuildMeshGeometry()
 			Vertex& vertex = vertices[i];
 
 			vertex.position = grid.vertices[i].position;
-			vertex.position.y = GetHillHeight(vertex.position.x, vertex.position.z);
-			vertex.normal = GetHillNormal(vertex.position.x, vertex.position.z);
+			vertex.normal = grid.vertices[i].normal;
 			vertex.TexCoord = grid.vertices[i].TexCoord;
 		}
 
@@ -802,7 +801,7 @@ void ApplicationInstance::BuildMeshGeometry()
 
 	// box
 	{
-		GeometryGenerator::MeshData mesh = generator.CreateBox(8.0f, 8.0f, 8.0f, 3);
+		GeometryGenerator::MeshData mesh = generator.CreateBox(8.0f, 8.0f, 8.0f);
 
 		SubMeshGeometry SubMesh;
 		SubMesh.IndexCount = mesh.indices32.size();
@@ -1,4 +1,304 @@
 #include "waves.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// the stencil kernels use the widest float SIMD the target is compiled for (/arch:AVX2 or /arch:AVX),
+// fall back to SSE2 (always available on x64) and then to plain scalar code
+#if defined(__AVX__)
+#include <immintrin.h>
+#define WAVES_AVX
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WAVES_SSE
+#endif
+
+namespace
+{
+	// a field is stored either as float heights or as 16-bit fixed point units of the height scale,
+	// the stencil is linear so it runs on units directly and only normals and positions apply the scale;
+	// units are rounded to nearest and saturated, the same way by the SIMD and the scalar code
+	float ToFloat(float h)
+	{
+		return h;
+	}
+
+	float ToFloat(short h)
+	{
+		return static_cast<float>(h);
+	}
+
+	void FromFloat(float& h, float value)
+	{
+		h = value;
+	}
+
+	void FromFloat(short& h, float value)
+	{
+		h = static_cast<short>(std::nearbyint(std::clamp(value, -32768.0f, 32767.0f)));
+	}
+
+	template<typename T>
+	float Height(const T* h, float scale)
+	{
+		if constexpr (std::is_same_v<T, short>)
+		{
+			return ToFloat(*h) * scale;
+		}
+		else
+		{
+			return *h;
+		}
+	}
+
+#if defined(WAVES_AVX)
+	__m256 Load8(const float* h)
+	{
+		return _mm256_loadu_ps(h);
+	}
+
+	__m256 Load8(const short* h)
+	{
+		const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h));
+
+		const __m128 lo = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(units));
+		const __m128 hi = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(units, 8)));
+
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+
+	void Store8(float* h, __m256 value)
+	{
+		_mm256_storeu_ps(h, value);
+	}
+
+	void Store8(short* h, __m256 value)
+	{
+		value = _mm256_max_ps(_mm256_min_ps(value, _mm256_set1_ps(32767.0f)), _mm256_set1_ps(-32768.0f));
+
+		const __m256i units = _mm256_cvtps_epi32(value);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(h),
+						 _mm_packs_epi32(_mm256_castsi256_si128(units), _mm256_extractf128_si256(units, 1)));
+	}
+
+	template<typename T>
+	__m256 Height8(const T* h, __m256 scale)
+	{
+		if constexpr (std::is_same_v<T, short>)
+		{
+			return _mm256_mul_ps(Load8(h), scale);
+		}
+		else
+		{
+			return Load8(h);
+		}
+	}
+#elif defined(WAVES_SSE)
+	__m128 Load4(const float* h)
+	{
+		return _mm_loadu_ps(h);
+	}
+
+	__m128 Load4(const short* h)
+	{
+		const __m128i units = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(h));
+
+		// sign extend the 16-bit units to 32 bits
+		return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(units, units), 16));
+	}
+
+	void Store4(float* h, __m128 value)
+	{
+		_mm_storeu_ps(h, value);
+	}
+
+	void Store4(short* h, __m128 value)
+	{
+		value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(32767.0f)), _mm_set1_ps(-32768.0f));
+
+		const __m128i units = _mm_cvtps_epi32(value);
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(h), _mm_packs_epi32(units, units));
+	}
+
+	template<typename T>
+	__m128 Height4(const T* h, __m128 scale)
+	{
+		if constexpr (std::is_same_v<T, short>)
+		{
+			return _mm_mul_ps(Load4(h), scale);
+		}
+		else
+		{
+			return Load4(h);
+		}
+	}
+#endif
+
+	// prev = k1 * prev + k2 * curr + k3 * (down + up + right + left) for the cells [ColBegin, ColEnd) of a row,
+	// the SIMD paths use the same operation order as the scalar tail so all of them produce the same bits
+	template<typename T>
+	void StepRow(T* prev, const T* curr, int cols, int ColBegin, int ColEnd, float k1, float k2, float k3)
+	{
+		const T* up = curr - cols;
+		const T* down = curr + cols;
+
+		int j = ColBegin;
+
+#if defined(WAVES_AVX)
+		const __m256 K1 = _mm256_set1_ps(k1);
+		const __m256 K2 = _mm256_set1_ps(k2);
+		const __m256 K3 = _mm256_set1_ps(k3);
+
+		for (; j + 8 <= ColEnd; j += 8)
+		{
+			__m256 sum = _mm256_add_ps(Load8(down + j), Load8(up + j));
+			sum = _mm256_add_ps(sum, Load8(curr + j + 1));
+			sum = _mm256_add_ps(sum, Load8(curr + j - 1));
+
+			__m256 h = _mm256_add_ps(_mm256_mul_ps(K1, Load8(prev + j)),
+									 _mm256_mul_ps(K2, Load8(curr + j)));
+			h = _mm256_add_ps(h, _mm256_mul_ps(K3, sum));
+
+			Store8(prev + j, h);
+		}
+#elif defined(WAVES_SSE)
+		const __m128 K1 = _mm_set1_ps(k1);
+		const __m128 K2 = _mm_set1_ps(k2);
+		const __m128 K3 = _mm_set1_ps(k3);
+
+		for (; j + 4 <= ColEnd; j += 4)
+		{
+			__m128 sum = _mm_add_ps(Load4(down + j), Load4(up + j));
+			sum = _mm_add_ps(sum, Load4(curr + j + 1));
+			sum = _mm_add_ps(sum, Load4(curr + j - 1));
+
+			__m128 h = _mm_add_ps(_mm_mul_ps(K1, Load4(prev + j)),
+								  _mm_mul_ps(K2, Load4(curr + j)));
+			h = _mm_add_ps(h, _mm_mul_ps(K3, sum));
+
+			Store4(prev + j, h);
+		}
+#endif
+
+		for (; j < ColEnd; ++j)
+		{
+			FromFloat(prev[j], k1 * ToFloat(prev[j]) + k2 * ToFloat(curr[j]) +
+							   k3 * (ToFloat(down[j]) + ToFloat(up[j]) + ToFloat(curr[j + 1]) + ToFloat(curr[j - 1])));
+		}
+	}
+
+	// normal = normalize(left - right, 2 * dx, bottom - top) and tangent = normalize(2 * dx, right - left, 0)
+	// for the cells [ColBegin, ColBegin + count) of an interior row, count <= kFrameBlock,
+	// results land in small SoA blocks indexed from 0 that the caller interleaves into its vertices
+	const int kFrameBlock = 64;
+
+	struct FrameBlock
+	{
+		alignas(32) float nx[kFrameBlock];
+		alignas(32) float ny[kFrameBlock];
+		alignas(32) float nz[kFrameBlock];
+		alignas(32) float tx[kFrameBlock];
+		alignas(32) float ty[kFrameBlock];
+	};
+
+	template<typename T>
+	void FrameRow(FrameBlock& block, const T* curr, int cols, int ColBegin, int count, float dx, float scale)
+	{
+		const T* up = curr - cols;
+		const T* down = curr + cols;
+
+		const float dy = 2.0f * dx;
+
+		int k = 0;
+
+#if defined(WAVES_AVX)
+		const __m256 DY = _mm256_set1_ps(dy);
+		const __m256 DY2 = _mm256_mul_ps(DY, DY);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 SCALE = _mm256_set1_ps(scale);
+
+		for (; k + 8 <= count; k += 8)
+		{
+			const int j = ColBegin + k;
+
+			const __m256 nx = _mm256_sub_ps(Height8(curr + j - 1, SCALE), Height8(curr + j + 1, SCALE));
+			const __m256 nz = _mm256_sub_ps(Height8(down + j, SCALE), Height8(up + j, SCALE));
+
+			const __m256 nx2 = _mm256_mul_ps(nx, nx);
+			const __m256 length = _mm256_add_ps(_mm256_add_ps(nx2, DY2), _mm256_mul_ps(nz, nz));
+
+			const __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(length));
+			const __m256 TangentInv = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(DY2, nx2)));
+
+			_mm256_store_ps(block.nx + k, _mm256_mul_ps(nx, inv));
+			_mm256_store_ps(block.ny + k, _mm256_mul_ps(DY, inv));
+			_mm256_store_ps(block.nz + k, _mm256_mul_ps(nz, inv));
+			_mm256_store_ps(block.tx + k, _mm256_mul_ps(DY, TangentInv));
+			_mm256_store_ps(block.ty + k, _mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), nx), TangentInv));
+		}
+#elif defined(WAVES_SSE)
+		const __m128 DY = _mm_set1_ps(dy);
+		const __m128 DY2 = _mm_mul_ps(DY, DY);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 SCALE = _mm_set1_ps(scale);
+
+		for (; k + 4 <= count; k += 4)
+		{
+			const int j = ColBegin + k;
+
+			const __m128 nx = _mm_sub_ps(Height4(curr + j - 1, SCALE), Height4(curr + j + 1, SCALE));
+			const __m128 nz = _mm_sub_ps(Height4(down + j, SCALE), Height4(up + j, SCALE));
+
+			const __m128 nx2 = _mm_mul_ps(nx, nx);
+			const __m128 length = _mm_add_ps(_mm_add_ps(nx2, DY2), _mm_mul_ps(nz, nz));
+
+			const __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(length));
+			const __m128 TangentInv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(DY2, nx2)));
+
+			_mm_store_ps(block.nx + k, _mm_mul_ps(nx, inv));
+			_mm_store_ps(block.ny + k, _mm_mul_ps(DY, inv));
+			_mm_store_ps(block.nz + k, _mm_mul_ps(nz, inv));
+			_mm_store_ps(block.tx + k, _mm_mul_ps(DY, TangentInv));
+			_mm_store_ps(block.ty + k, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), nx), TangentInv));
+		}
+#endif
+
+		for (; k < count; ++k)
+		{
+			const int j = ColBegin + k;
+
+			const float nx = Height(curr + j - 1, scale) - Height(curr + j + 1, scale);
+			const float nz = Height(down + j, scale) - Height(up + j, scale);
+
+			const float nx2 = nx * nx;
+
+			const float inv = 1.0f / std::sqrt(nx2 + dy * dy + nz * nz);
+			const float TangentInv = 1.0f / std::sqrt(dy * dy + nx2);
+
+			block.nx[k] = nx * inv;
+			block.ny[k] = dy * inv;
+			block.nz[k] = nz * inv;
+			block.tx[k] = dy * TangentInv;
+			block.ty[k] = (0.0f - nx) * TangentInv;
+		}
+	}
+
+	void StoreVertex(unsigned char* vertex, const Waves::VertexLayout& layout,
+					 const XMFLOAT3& position, const XMFLOAT3& normal, const XMFLOAT3& tangent, const XMFLOAT2& TexCoord)
+	{
+		if (layout.position >= 0) std::memcpy(vertex + layout.position, &position, sizeof(XMFLOAT3));
+		if (layout.normal >= 0) std::memcpy(vertex + layout.normal, &normal, sizeof(XMFLOAT3));
+		if (layout.tangent >= 0) std::memcpy(vertex + layout.tangent, &tangent, sizeof(XMFLOAT3));
+		if (layout.TexCoord >= 0) std::memcpy(vertex + layout.TexCoord, &TexCoord, sizeof(XMFLOAT2));
+	}
+}
 
 Waves::Waves(int rows, int cols, float dt, float dx, float speed, float damping) :
 	mRowCount(rows),
@@ -6,36 +306,22 @@ Waves::Waves(int rows, int cols, float dt, float dx, float speed, float damping)
 	mVertexCount(rows*cols),
 	mTriangleCount((rows-1)*(cols-1)*2),
 	mTimeStep(dt),
-	mSpaceStep(dx)
+	mSpaceStep(dx),
+	mHalfWidth((cols - 1) * dx * 0.5f),
+	mHalfDepth((rows - 1) * dx * 0.5f)
 {
+	assert(dt > 0.0f && "the time step must be positive");
+
 	float d = damping * dt + 2.0f;
 	float e = (speed * speed) * (dt * dt) / (dx * dx);
 	mK1 = (damping * dt - 2.0f) / d;
 	mK2 = (4.0f - 8.0f * e) / d;
 	mK3 = (2.0f * e) / d;
 
-	mPrevData.resize(mVertexCount);
-	mCurrData.resize(mVertexCount);
-
-	mNormals.resize(mVertexCount);
+	mPrevHeights.assign(mVertexCount, 0.0f);
+	mCurrHeights.assign(mVertexCount, 0.0f);
 
-	float HalfWidth = (cols - 1) * dx * 0.5f;
-	float HalfDepth = (rows - 1) * dx * 0.5f;
-
-	for (int i = 0; i < rows; ++i)
-	{
-		float z = HalfDepth - i * dx;
-
-		for (int j = 0; j < cols; ++j)
-		{
-			float x = j * dx - HalfWidth;
-
-			mPrevData[i * cols + j] = XMFLOAT3(x, 0.0f, z);
-			mCurrData[i * cols + j] = XMFLOAT3(x, 0.0f, z);
-
-			mNormals[i * cols + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
-		}
-	}
+	SetTileTracking(0, 0.0f);
 }
 
 Waves::~Waves()
@@ -71,74 +357,732 @@ float Waves::GetDepth() const
 	return mRowCount * mSpaceStep;
 }
 
-const XMFLOAT3& Waves::GetPosition(int i) const
+float Waves::GetHeight(int i) const
+{
+	return mStorage == HeightStorage::Fixed16 ? Height(&mCurrUnits[i], mHeightScale) : mCurrHeights[i];
+}
+
+XMFLOAT3 Waves::GetPosition(int i) const
+{
+	const int row = i / mColCount;
+	const int col = i % mColCount;
+
+	return XMFLOAT3(col * mSpaceStep - mHalfWidth, GetHeight(i), mHalfDepth - row * mSpaceStep);
+}
+
+XMFLOAT3 Waves::GetNormal(int i) const
+{
+	const int row = i / mColCount;
+	const int col = i % mColCount;
+
+	// the boundary never moves
+	if (row < 1 || row >= mRowCount - 1 || col < 1 || col >= mColCount - 1)
+	{
+		return XMFLOAT3(0.0f, 1.0f, 0.0f);
+	}
+
+	const float nx = GetHeight(i - 1) - GetHeight(i + 1);
+	const float ny = 2.0f * mSpaceStep;
+	const float nz = GetHeight(i + mColCount) - GetHeight(i - mColCount);
+
+	const float inv = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+
+	return XMFLOAT3(nx * inv, ny * inv, nz * inv);
+}
+
+XMFLOAT3 Waves::GetTangent(int i) const
+{
+	const int row = i / mColCount;
+	const int col = i % mColCount;
+
+	if (row < 1 || row >= mRowCount - 1 || col < 1 || col >= mColCount - 1)
+	{
+		return XMFLOAT3(1.0f, 0.0f, 0.0f);
+	}
+
+	const float tx = 2.0f * mSpaceStep;
+	const float ty = GetHeight(i + 1) - GetHeight(i - 1);
+
+	const float inv = 1.0f / std::sqrt(tx * tx + ty * ty);
+
+	return XMFLOAT3(tx * inv, ty * inv, 0.0f);
+}
+
+void Waves::WriteVertices(void* destination, const VertexLayout& layout) const
+{
+	assert(layout.stride > 0);
+
+	if (mStorage == HeightStorage::Fixed16)
+	{
+		WriteVertices(mCurrUnits.data(), destination, layout);
+	}
+	else
+	{
+		WriteVertices(mCurrHeights.data(), destination, layout);
+	}
+}
+
+template<typename T>
+void Waves::WriteVertices(const T* field, void* destination, const VertexLayout& layout) const
+{
+	unsigned char* vertices = static_cast<unsigned char*>(destination);
+
+	const XMFLOAT3 up(0.0f, 1.0f, 0.0f);
+	const XMFLOAT3 right(1.0f, 0.0f, 0.0f);
+
+	const float width = GetWidth();
+	const float depth = GetDepth();
+
+	ForEachBand(0, mRowCount, [&](int RowBegin, int RowEnd)
+	{
+		FrameBlock block;
+
+		for (int i = RowBegin; i < RowEnd; ++i)
+		{
+			const T* heights = field + i * mColCount;
+			unsigned char* row = vertices + static_cast<size_t>(i) * mColCount * layout.stride;
+
+			const float z = mHalfDepth - i * mSpaceStep;
+			const float v = 0.5f - z / depth;
+
+			auto StoreFlat = [&](int j)
+			{
+				const float x = j * mSpaceStep - mHalfWidth;
+				StoreVertex(row + j * layout.stride, layout, XMFLOAT3(x, Height(heights + j, mHeightScale), z), up, right, XMFLOAT2(0.5f + x / width, v));
+			};
+
+			if (i < 1 || i >= mRowCount - 1)
+			{
+				for (int j = 0; j < mColCount; ++j)
+				{
+					StoreFlat(j);
+				}
+
+				continue;
+			}
+
+			StoreFlat(0);
+
+			for (int ColBegin = 1; ColBegin < mColCount - 1; ColBegin += kFrameBlock)
+			{
+				const int count = std::min(kFrameBlock, mColCount - 1 - ColBegin);
+
+				FrameRow(block, heights, mColCount, ColBegin, count, mSpaceStep, mHeightScale);
+
+				for (int k = 0; k < count; ++k)
+				{
+					const int j = ColBegin + k;
+					const float x = j * mSpaceStep - mHalfWidth;
+
+					StoreVertex(row + j * layout.stride, layout,
+								XMFLOAT3(x, Height(heights + j, mHeightScale), z),
+								XMFLOAT3(block.nx[k], block.ny[k], block.nz[k]),
+								XMFLOAT3(block.tx[k], block.ty[k], 0.0f),
+								XMFLOAT2(0.5f + x / width, v));
+				}
+			}
+
+			StoreFlat(mColCount - 1);
+		}
+	});
+}
+
+void Waves::SetThreadPool(ThreadPool* pool, int BandRows)
+{
+	mThreadPool = pool;
+
+	if (pool != nullptr && BandRows <= 0)
+	{
+		// a few bands per thread to even out the load, but not so thin that the dispatch costs more than the rows
+		BandRows = std::max((mRowCount - 2) / (4 * pool->GetThreadCount()), 8);
+	}
+
+	mBandRows = std::max(BandRows, 1);
+}
+
+void Waves::SetTileTracking(int TileSize, float threshold)
+{
+	mTileSize = std::max(TileSize, 0);
+	mSleepThreshold = threshold;
+
+	mTileRows = mTileSize > 0 ? (mRowCount + mTileSize - 1) / mTileSize : 0;
+	mTileCols = mTileSize > 0 ? (mColCount + mTileSize - 1) / mTileSize : 0;
+
+	// tiles start awake so whatever the field holds right now settles before anything sleeps
+	mTileAwake.assign(mTileRows * mTileCols, 1);
+	mTileResults.assign(mTileRows * mTileCols, 0);
+	mTileMask.assign(mTileCols, 0);
+	mAwakeTiles.clear();
+	mAwakeTiles.reserve(mTileRows * mTileCols);
+
+	BuildSpans(mTileAwake, 1, mHeightSpans, mHeightSpanRows);
+
+	mActiveTileCount = mTileSize > 0 ? mTileRows * mTileCols : 0;
+}
+
+void Waves::SetHeightStorage(HeightStorage storage, float scale)
+{
+	// queued impulses go into the field they were meant for
+	FlushImpulses();
+
+	// back to float first, so a new scale requantizes from the old units
+	if (mStorage == HeightStorage::Fixed16)
+	{
+		mPrevHeights.resize(mVertexCount);
+		mCurrHeights.resize(mVertexCount);
+
+		for (int i = 0; i < mVertexCount; ++i)
+		{
+			mPrevHeights[i] = Height(&mPrevUnits[i], mHeightScale);
+			mCurrHeights[i] = Height(&mCurrUnits[i], mHeightScale);
+		}
+
+		mPrevUnits.clear();
+		mCurrUnits.clear();
+		mPrevUnits.shrink_to_fit();
+		mCurrUnits.shrink_to_fit();
+	}
+
+	mStorage = storage;
+	mHeightScale = storage == HeightStorage::Fixed16 ? scale : 1.0f;
+	mInvHeightScale = 1.0f / mHeightScale;
+
+	if (mStorage == HeightStorage::Fixed16)
+	{
+		mPrevUnits.resize(mVertexCount);
+		mCurrUnits.resize(mVertexCount);
+
+		for (int i = 0; i < mVertexCount; ++i)
+		{
+			FromFloat(mPrevUnits[i], mPrevHeights[i] * mInvHeightScale);
+			FromFloat(mCurrUnits[i], mCurrHeights[i] * mInvHeightScale);
+		}
+
+		mPrevHeights.clear();
+		mCurrHeights.clear();
+		mPrevHeights.shrink_to_fit();
+		mCurrHeights.shrink_to_fit();
+	}
+}
+
+Waves::HeightStorage Waves::GetHeightStorage() const
+{
+	return mStorage;
+}
+
+float Waves::GetHeightScale() const
+{
+	return mHeightScale;
+}
+
+int Waves::GetTileCount() const
+{
+	return mTileRows * mTileCols;
+}
+
+int Waves::GetActiveTileCount() const
 {
-	return mCurrData[i];
+	return mActiveTileCount;
 }
 
-const XMFLOAT3& Waves::GetNormal(int i) const
+void Waves::SetMaxSubSteps(int count)
 {
-	return mNormals[i];
+	mMaxSubSteps = std::max(count, 1);
 }
 
-void Waves::update(float dt)
+int Waves::GetMaxSubSteps() const
 {
-	static float t = 0;
+	return mMaxSubSteps;
+}
 
-	t += dt;
+template<typename T>
+void Waves::UpdateHeights(T* prev, T* curr, int RowBegin, int RowEnd)
+{
+	const bool impulses = !mImpulses.empty();
 
-	if (t >= mTimeStep)
+	for (int i = RowBegin; i < RowEnd; ++i)
 	{
-		for (int i = 1; i < mRowCount - 1; ++i)
+		// row i + 1 is about to be read for the first time, the first and last rows of the band already have theirs
+		if (impulses && i + 1 < RowEnd - 1)
 		{
-			for (int j = 1; j < mColCount - 1; ++j)
+			AddRowImpulses(curr, i + 1);
+		}
+
+		for (int s = mHeightSpanRows[i]; s < mHeightSpanRows[i + 1]; ++s)
+		{
+			StepRow(prev + i * mColCount, curr + i * mColCount, mColCount,
+					mHeightSpans[s].ColBegin, mHeightSpans[s].ColEnd, mK1, mK2, mK3);
+		}
+	}
+}
+
+void Waves::BuildSpans(const std::vector<unsigned char>& tiles, int halo, std::vector<Span>& spans, std::vector<int>& rows)
+{
+	spans.clear();
+	rows.assign(mRowCount + 1, 0);
+
+	for (int i = 0; i < mRowCount; ++i)
+	{
+		rows[i] = static_cast<int>(spans.size());
+
+		// the boundary rows never move
+		if (i < 1 || i >= mRowCount - 1)
+		{
+			continue;
+		}
+
+		if (mTileSize == 0)
+		{
+			spans.push_back({ 1, mColCount - 1 });
+			continue;
+		}
+
+		// tile columns with a selected tile whose grown rows reach row i
+		const int TileRowBegin = std::max((i - halo) / mTileSize, 0);
+		const int TileRowEnd = std::min((i + halo) / mTileSize + 1, mTileRows);
+
+		std::fill(mTileMask.begin(), mTileMask.end(), 0);
+
+		for (int r = TileRowBegin; r < TileRowEnd; ++r)
+		{
+			for (int c = 0; c < mTileCols; ++c)
 			{
-				mPrevData[i * mColCount + j].y =
-					mK1 * mPrevData[i * mColCount + j].y +
-					mK2 * mCurrData[i * mColCount + j].y +
-					mK3 * (mCurrData[(i + 1) * mColCount + (j + 0)].y +
-						   mCurrData[(i - 1) * mColCount + (j + 0)].y +
-						   mCurrData[(i + 0) * mColCount + (j + 1)].y +
-						   mCurrData[(i + 0) * mColCount + (j - 1)].y);
+				mTileMask[c] |= tiles[r * mTileCols + c];
 			}
 		}
 
-		std::swap(mPrevData, mCurrData);
+		// merge the grown column ranges into disjoint runs so no cell is stepped twice
+		for (int c = 0; c < mTileCols; ++c)
+		{
+			if (!mTileMask[c])
+			{
+				continue;
+			}
 
-		t = 0.0f;
+			const int ColBegin = std::max(c * mTileSize - halo, 1);
+			const int ColEnd = std::min((c + 1) * mTileSize + halo, mColCount - 1);
 
-		// compute normals and tangents
-		for (int i = 1; i < mRowCount - 1; ++i)
+			if (spans.size() > static_cast<size_t>(rows[i]) && spans.back().ColEnd >= ColBegin)
+			{
+				spans.back().ColEnd = std::max(spans.back().ColEnd, ColEnd);
+			}
+			else
+			{
+				spans.push_back({ ColBegin, ColEnd });
+			}
+		}
+	}
+
+	rows[mRowCount] = static_cast<int>(spans.size());
+}
+
+template<typename T>
+void Waves::UpdateActivity(T* prev, T* curr)
+{
+	enum
+	{
+		kSleep = 1 << 0,
+		kWakeTop = 1 << 1,
+		kWakeBottom = 1 << 2,
+		kWakeLeft = 1 << 3,
+		kWakeRight = 1 << 4,
+	};
+
+	// classify every awake tile, a task only writes the cells and the result of its own tile
+	auto classify = [=, this](int k)
+	{
+		const int tile = mAwakeTiles[k];
+
+		const int RowBegin = (tile / mTileCols) * mTileSize;
+		const int ColBegin = (tile % mTileCols) * mTileSize;
+		const int RowEnd = std::min(RowBegin + mTileSize, mRowCount);
+		const int ColEnd = std::min(ColBegin + mTileSize, mColCount);
+
+		float amplitude = 0.0f;
+		float top = 0.0f;
+		float bottom = 0.0f;
+		float left = 0.0f;
+		float right = 0.0f;
+
+		for (int i = RowBegin; i < RowEnd; ++i)
 		{
-			for (int j = 1; j < mColCount - 1; ++j)
+			for (int j = ColBegin; j < ColEnd; ++j)
 			{
-				float l = mCurrData[(i + 0) * mColCount + (j - 1)].y;
-				float r = mCurrData[(i + 0) * mColCount + (j + 1)].y;
-				float t = mCurrData[(i - 1) * mColCount + (j + 0)].y;
-				float b = mCurrData[(i + 1) * mColCount + (j + 0)].y;
-				
-				mNormals[i * mColCount + j].x = l - r;
-				mNormals[i * mColCount + j].y = 2.0f * mSpaceStep;
-				mNormals[i * mColCount + j].z = b - t;
-
-				XMStoreFloat3(&mNormals[i * mColCount + j], XMVector3Normalize(XMLoadFloat3(&mNormals[i * mColCount + j])));
-
-				// compute tangent
+				const float h = std::fabs(ToFloat(curr[i * mColCount + j]));
+
+				// the scheme is second order, a tile is only at rest if the previous step was flat too
+				amplitude = std::max(amplitude, std::max(h, std::fabs(ToFloat(prev[i * mColCount + j]))));
+
+				if (i == RowBegin) top = std::max(top, h);
+				if (i == RowEnd - 1) bottom = std::max(bottom, h);
+				if (j == ColBegin) left = std::max(left, h);
+				if (j == ColEnd - 1) right = std::max(right, h);
+			}
+		}
+
+		unsigned char result = 0;
+
+		// the threshold in the units the field is stored in
+		const float threshold = mSleepThreshold * mInvHeightScale;
+
+		if (amplitude < threshold)
+		{
+			for (int i = RowBegin; i < RowEnd; ++i)
+			{
+				std::fill(curr + i * mColCount + ColBegin, curr + i * mColCount + ColEnd, T(0));
+				std::fill(prev + i * mColCount + ColBegin, prev + i * mColCount + ColEnd, T(0));
 			}
+
+			result |= kSleep;
 		}
+		else
+		{
+			if (top >= threshold) result |= kWakeTop;
+			if (bottom >= threshold) result |= kWakeBottom;
+			if (left >= threshold) result |= kWakeLeft;
+			if (right >= threshold) result |= kWakeRight;
+		}
+
+		mTileResults[k] = result;
+	};
+
+	if (mThreadPool != nullptr)
+	{
+		mThreadPool->ParallelFor(static_cast<int>(mAwakeTiles.size()), classify);
+	}
+	else
+	{
+		for (int k = 0; k < static_cast<int>(mAwakeTiles.size()); ++k)
+		{
+			classify(k);
+		}
+	}
+
+	// apply sleeps first so a tile woken by a neighbour in the same step stays awake
+	for (size_t k = 0; k < mAwakeTiles.size(); ++k)
+	{
+		if (mTileResults[k] & kSleep)
+		{
+			mTileAwake[mAwakeTiles[k]] = 0;
+		}
+	}
+
+	for (size_t k = 0; k < mAwakeTiles.size(); ++k)
+	{
+		const int r = mAwakeTiles[k] / mTileCols;
+		const int c = mAwakeTiles[k] % mTileCols;
+
+		if ((mTileResults[k] & kWakeTop) && r > 0) mTileAwake[(r - 1) * mTileCols + c] = 1;
+		if ((mTileResults[k] & kWakeBottom) && r < mTileRows - 1) mTileAwake[(r + 1) * mTileCols + c] = 1;
+		if ((mTileResults[k] & kWakeLeft) && c > 0) mTileAwake[r * mTileCols + c - 1] = 1;
+		if ((mTileResults[k] & kWakeRight) && c < mTileCols - 1) mTileAwake[r * mTileCols + c + 1] = 1;
+	}
+}
+
+Waves::Kernel Waves::MakeKernel(const Impulse& impulse) const
+{
+	Kernel kernel;
+
+	// move the centre onto the interior and raise the radius to at least one cell
+	kernel.impulse = impulse;
+	kernel.impulse.i = std::clamp(impulse.i, 1, mRowCount - 2);
+	kernel.impulse.j = std::clamp(impulse.j, 1, mColCount - 2);
+	kernel.impulse.radius = std::max(impulse.radius, 1.0f);
+
+	kernel.InvTwoRadius2 = 1.0f / (2.0f * kernel.impulse.radius * kernel.impulse.radius);
+
+	// the last distance along an axis whose weight, computed as AddKernelRow computes it, is still positive
+	kernel.extent = static_cast<int>(std::ceil(kernel.impulse.radius * 1.41421356f));
+
+	while (kernel.extent > 0 && 1.0f - static_cast<float>(kernel.extent * kernel.extent) * kernel.InvTwoRadius2 <= 0.0f)
+	{
+		--kernel.extent;
+	}
+
+	return kernel;
+}
+
+Waves::KernelRow Waves::GetKernelRow(const Kernel& kernel, int i) const
+{
+	const int di = i - kernel.impulse.i;
+
+	// the weight only falls with the distance, so the cells of a row that get something are one run around the centre
+	int reach = kernel.extent;
+
+	while (reach >= 0 && 1.0f - static_cast<float>(di * di + reach * reach) * kernel.InvTwoRadius2 <= 0.0f)
+	{
+		--reach;
+	}
+
+	const int FirstCol = std::max(kernel.impulse.j - reach, 1);
+	const int LastCol = std::min(kernel.impulse.j + reach, mColCount - 2);
+
+	return { i * mColCount + FirstCol, std::max(LastCol - FirstCol + 1, 0), FirstCol - kernel.impulse.j, di * di,
+			 kernel.impulse.magnitude, kernel.InvTwoRadius2 };
+}
+
+template<typename T>
+void Waves::AddKernelRow(T* heights, const KernelRow& row) const
+{
+	T* cells = heights + row.offset;
+
+	for (int k = 0; k < row.count; ++k)
+	{
+		const int dj = row.dj + k;
+		const float weight = 1.0f - static_cast<float>(row.di2 + dj * dj) * row.InvTwoRadius2;
+
+		if constexpr (std::is_same_v<T, short>)
+		{
+			FromFloat(cells[k], ToFloat(cells[k]) + row.magnitude * weight * mInvHeightScale);
+		}
+		else
+		{
+			cells[k] += row.magnitude * weight;
+		}
+	}
+}
+
+template<typename T>
+void Waves::AddKernel(T* heights, const Kernel& kernel) const
+{
+	const int FirstRow = std::max(kernel.impulse.i - kernel.extent, 1);
+	const int LastRow = std::min(kernel.impulse.i + kernel.extent, mRowCount - 2);
+
+	for (int i = FirstRow; i <= LastRow; ++i)
+	{
+		AddKernelRow(heights, GetKernelRow(kernel, i));
 	}
 }
 
+void Waves::WakeTiles(const Kernel& kernel)
+{
+	if (mTileSize == 0)
+	{
+		return;
+	}
+
+	const Impulse& impulse = kernel.impulse;
+	const int extent = kernel.extent;
+
+	const int TileRowBegin = std::max(impulse.i - extent, 1) / mTileSize;
+	const int TileRowEnd = std::min(impulse.i + extent, mRowCount - 2) / mTileSize;
+	const int TileColBegin = std::max(impulse.j - extent, 1) / mTileSize;
+	const int TileColEnd = std::min(impulse.j + extent, mColCount - 2) / mTileSize;
+
+	for (int r = TileRowBegin; r <= TileRowEnd; ++r)
+	{
+		for (int c = TileColBegin; c <= TileColEnd; ++c)
+		{
+			mTileAwake[r * mTileCols + c] = 1;
+		}
+	}
+}
+
+int Waves::BandHeight(int first, int last) const
+{
+	return mThreadPool != nullptr ? mBandRows : last - first;
+}
+
+void Waves::ForEachBand(int first, int last, const std::function<void(int, int)>& pass) const
+{
+	if (mThreadPool == nullptr)
+	{
+		pass(first, last);
+		return;
+	}
+
+	const int BandRows = BandHeight(first, last);
+	const int BandCount = (last - first + BandRows - 1) / BandRows;
+
+	mThreadPool->ParallelFor(BandCount, [&](int band)
+	{
+		const int RowBegin = first + band * BandRows;
+		const int RowEnd = std::min(RowBegin + BandRows, last);
+
+		pass(RowBegin, RowEnd);
+	});
+}
+
+void Waves::BucketImpulses()
+{
+	mImpulseRows.assign(mRowCount + 1, 0);
+
+	for (const Kernel& kernel : mImpulses)
+	{
+		for (int i = std::max(kernel.impulse.i - kernel.extent, 1); i <= std::min(kernel.impulse.i + kernel.extent, mRowCount - 2); ++i)
+		{
+			++mImpulseRows[i + 1];
+		}
+	}
+
+	for (int i = 0; i < mRowCount; ++i)
+	{
+		mImpulseRows[i + 1] += mImpulseRows[i];
+	}
+
+	mImpulseRowList.resize(mImpulseRows[mRowCount]);
+
+	// filling a row moves its start on to the next row's, so the starts are shifted back afterwards
+	for (const Kernel& kernel : mImpulses)
+	{
+		for (int i = std::max(kernel.impulse.i - kernel.extent, 1); i <= std::min(kernel.impulse.i + kernel.extent, mRowCount - 2); ++i)
+		{
+			mImpulseRowList[mImpulseRows[i]++] = GetKernelRow(kernel, i);
+		}
+	}
+
+	for (int i = mRowCount; i > 0; --i)
+	{
+		mImpulseRows[i] = mImpulseRows[i - 1];
+	}
+
+	mImpulseRows[0] = 0;
+}
+
+template<typename T>
+void Waves::AddRowImpulses(T* heights, int i) const
+{
+	for (int k = mImpulseRows[i]; k < mImpulseRows[i + 1]; ++k)
+	{
+		AddKernelRow(heights, mImpulseRowList[k]);
+	}
+}
+
+void Waves::FlushImpulses()
+{
+	for (const Kernel& kernel : mImpulses)
+	{
+		if (mStorage == HeightStorage::Fixed16)
+		{
+			AddKernel(mCurrUnits.data(), kernel);
+		}
+		else
+		{
+			AddKernel(mCurrHeights.data(), kernel);
+		}
+	}
+
+	mImpulses.clear();
+}
+
+template<typename T>
+void Waves::Step(std::vector<T>& prev, std::vector<T>& curr)
+{
+	if (!mImpulses.empty())
+	{
+		BucketImpulses();
+
+		// a band adds the impulses of its inner rows as it goes, but its first and last rows are read by the
+		// neighbouring bands too, so those get theirs before any band starts
+		const int BandRows = BandHeight(1, mRowCount - 1);
+
+		for (int RowBegin = 1; RowBegin < mRowCount - 1; RowBegin += BandRows)
+		{
+			const int RowEnd = std::min(RowBegin + BandRows, mRowCount - 1);
+
+			AddRowImpulses(curr.data(), RowBegin);
+
+			if (RowEnd - 1 > RowBegin)
+			{
+				AddRowImpulses(curr.data(), RowEnd - 1);
+			}
+		}
+	}
+
+	ForEachBand(1, mRowCount - 1, [&](int RowBegin, int RowEnd) { UpdateHeights(prev.data(), curr.data(), RowBegin, RowEnd); });
+
+	mImpulses.clear();
+
+	std::swap(prev, curr);
+
+	if (mTileSize > 0)
+	{
+		UpdateActivity(prev.data(), curr.data());
+	}
+}
+
+int Waves::update(float dt)
+{
+	// a field built without a positive time step never advances, and fmod by it would make the accumulator NaN for good
+	if (!(mTimeStep > 0.0f))
+	{
+		FlushImpulses();
+		return 0;
+	}
+
+	mAccumulator += dt;
+
+	int steps = 0;
+
+	while (mAccumulator >= mTimeStep && steps < mMaxSubSteps)
+	{
+		if (mTileSize > 0)
+		{
+			mAwakeTiles.clear();
+
+			for (int t = 0; t < mTileRows * mTileCols; ++t)
+			{
+				if (mTileAwake[t])
+				{
+					mAwakeTiles.push_back(t);
+				}
+			}
+
+			mActiveTileCount = static_cast<int>(mAwakeTiles.size());
+
+			// a sleeping tile is flat, so only its cells next to an awake tile can change
+			BuildSpans(mTileAwake, 1, mHeightSpans, mHeightSpanRows);
+		}
+
+		if (mStorage == HeightStorage::Fixed16)
+		{
+			Step(mPrevUnits, mCurrUnits);
+		}
+		else
+		{
+			Step(mPrevHeights, mCurrHeights);
+		}
+
+		mAccumulator -= mTimeStep;
+		++steps;
+	}
+
+	if (mAccumulator >= mTimeStep)
+	{
+		// too far behind, keep only the fraction of a step
+		mAccumulator = std::fmod(mAccumulator, mTimeStep);
+	}
+
+	// impulses queued for a step that did not come go in now
+	FlushImpulses();
+
+	return steps;
+}
+
 void Waves::disturb(int i, int j, float magnitude)
 {
-	assert(i > 1 && i < mRowCount - 2);
-	assert(j > 1 && j < mColCount - 2);
+	// impulses queued before this one go in first
+	FlushImpulses();
+
+	const Kernel kernel = MakeKernel({ i, j, magnitude, 1.0f });
+
+	if (mStorage == HeightStorage::Fixed16)
+	{
+		AddKernel(mCurrUnits.data(), kernel);
+	}
+	else
+	{
+		AddKernel(mCurrHeights.data(), kernel);
+	}
 
-	float HalfMagnitude = magnitude * 0.5f;
+	WakeTiles(kernel);
+}
 
-	mCurrData[(i + 0) * mColCount + (j + 0)].y += magnitude;
-	mCurrData[(i + 0) * mColCount + (j + 1)].y += HalfMagnitude;
-	mCurrData[(i + 0) * mColCount + (j - 1)].y += HalfMagnitude;
-	mCurrData[(i + 1) * mColCount + (j + 0)].y += HalfMagnitude;
-	mCurrData[(i - 1) * mColCount + (j + 0)].y += HalfMagnitude;
-}
\ No newline at end of file
+void Waves::disturb(std::span<const Impulse> impulses)
+{
+	for (const Impulse& impulse : impulses)
+	{
+		mImpulses.push_back(MakeKernel(impulse));
+		WakeTiles(mImpulses.back());
+	}
+}
@@ -1,6 +1,7 @@
 #include "ApplicationFramework.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
+#include "TextModelLoader.h"
 
 #include <fstream>
 #include <map>
@@ -827,49 +828,31 @@ void ApplicationInstance::BuildRoomGeometry()
 void ApplicationInstance::BuildSkullGeometry()
 {
 #if RENDERDOC_BUILD
-	std::ifstream stream("../../../models/skull.txt");
+	const char* filename = "../../../models/skull.txt";
 #else // RENDERDOC_BUILD
-	std::ifstream stream("../models/skull.txt");
+	const char* filename = "../models/skull.txt";
 #endif // RENDERDOC_BUILD
 
-	if (!stream)
+	TextModelLoader::CachedModel model;
+
+	if (!TextModelLoader::LoadCached(filename, model))
 	{
 		MessageBox(0, L"models/skull.txt not found.", 0, 0);
 		return;
 	}
 
-	UINT VertexCount = 0;
-	UINT IndexCount = 0;
-
-	std::string ignore;
-
-	stream >> ignore >> VertexCount;
-	stream >> ignore >> IndexCount;
-	stream >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(VertexCount);
+	std::vector<Vertex> vertices(model.vertices.size());
 
-	for (size_t i = 0; i < VertexCount; ++i)
+	for (size_t i = 0; i < vertices.size(); ++i)
 	{
-		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
-		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
+		vertices[i].position = model.vertices[i].position;
+		vertices[i].normal = model.vertices[i].normal;
 
 		// model does not have texture coordinates, so just zero them out.
 		vertices[i].TexCoord = { 0.0f, 0.0f };
 	}
 
-	stream >> ignore;
-	stream >> ignore;
-	stream >> ignore;
-
-	std::vector<std::int32_t> indices(3 * IndexCount);
-
-	for (size_t i = 0; i < IndexCount; ++i)
-	{
-		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	stream.close();
+	const std::span<const std::int32_t> indices = model.indices;
 
 	const UINT VertexBufferByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT IndexBufferByteSize = (UINT)indices.size() * sizeof(std::int32_t);
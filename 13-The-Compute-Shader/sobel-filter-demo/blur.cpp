@@ -206,32 +206,9 @@ void Blur::execute(ID3D12GraphicsCommandList* CommandList,
 
 std::vector<float> Blur::CalcGaussWeights(float sigma)
 {
-	float TwoSigmaSquare = 2.0f * sigma*sigma;
+	assert(std::ceil(2.0f * sigma) <= 5.0f); // max radius
 
-	INT radius = std::ceil(2.0f * sigma);
-
-	assert(radius <= 5); // max radius
-
-	std::vector<float> weights;
-	weights.resize(2 * radius + 1);
-
-	float sum = 0.0f;
-
-	for (INT i = -radius; i <= +radius; ++i)
-	{
-		float x = i;
-
-		weights[i + radius] = expf(-x*x / TwoSigmaSquare);
-
-		sum += weights[i + radius];
-	}
-
-	for (UINT i = 0; i < weights.size(); ++i)
-	{
-		weights[i] /= sum;
-	}
-
-	return weights;
+	return MathHelper::GaussWeights(sigma);
 }
 
 ID3D12Resource* Blur::output()
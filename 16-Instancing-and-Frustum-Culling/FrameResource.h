@@ -12,6 +12,15 @@ struct Vertex
 	XMFLOAT2 TexCoord;
 };
 
+// what the vertex buffer holds, see VertexCompression: the position in units of the mesh bounds (w unused),
+// the normal folded onto an octahedron and half float texture coordinates, 16 bytes instead of 32
+struct PackedVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t TexCoord[2];
+};
+
 struct InstanceData
 {
 	XMFLOAT4X4 world = MathHelper::Identity4x4();
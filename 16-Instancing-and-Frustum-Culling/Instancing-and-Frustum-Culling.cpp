@@ -2,7 +2,11 @@
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
 #include "MathHelper.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "VertexCompression.h"
 #include "camera.h"
+#include "TextModelLoader.h"
 
 #include <numeric>
 #include <sstream>
@@ -19,6 +23,9 @@ struct RenderItem
 	XMFLOAT4X4 world = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexCoordTransform = MathHelper::Identity4x4();
 
+	// maps the packed vertex positions to object space, applied before each instance's world matrix
+	XMFLOAT4X4 dequantization = MathHelper::Identity4x4();
+
 	int DirtyFramesCount = gFrameResourcesCount;
 
 	UINT ConstantBufferIndex = -1;
@@ -35,6 +42,24 @@ struct RenderItem
 	UINT InstanceCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
+
+	// levels of detail finest first, empty to always draw the whole submesh;
+	// visible instances are written to the instance buffer grouped by level, LodInstanceCounts[l] of them using level l
+	std::vector<MeshSimplifier::Lod> lods;
+	std::vector<UINT> LodInstanceCounts;
+
+	// clusters of level 0, stored in meshlet order so meshlet m is the index range of its triangles;
+	// with cluster culling the level 0 instances are drawn one index range of visible clusters at a time
+	const MeshletBuilder::MeshletData* meshlets = nullptr;
+
+	struct ClusterDraw
+	{
+		UINT instance = 0; // slot in the instance buffer
+		UINT StartIndexLocation = 0;
+		UINT IndexCount = 0;
+	};
+
+	std::vector<ClusterDraw> ClusterDraws;
 };
 
 enum class RenderLayer : int
@@ -74,6 +99,12 @@ class ApplicationInstance : public ApplicationFramework
 	Camera mCamera;
 	BoundingFrustum mCameraFrustum;
 	bool mIsFrustumCullingEnabled = true;
+	bool mIsLodEnabled = true;
+	bool mIsClusterCullingEnabled = true;
+
+	std::vector<MeshSimplifier::Lod> mSkullLods;
+	MeshletBuilder::MeshletData mSkullMeshlets;
+	VertexCompression::PositionBounds mSkullPositionBounds;
 
 	bool mIsWireFrameEnabled = false;
 
@@ -388,6 +419,26 @@ void ApplicationInstance::OnKeyboardEvent(const GameTimer& timer)
 		mIsFrustumCullingEnabled = false;
 	}
 
+	if (GetAsyncKeyState('3') & 0x8000)
+	{
+		mIsLodEnabled = true;
+	}
+
+	if (GetAsyncKeyState('4') & 0x8000)
+	{
+		mIsLodEnabled = false;
+	}
+
+	if (GetAsyncKeyState('5') & 0x8000)
+	{
+		mIsClusterCullingEnabled = true;
+	}
+
+	if (GetAsyncKeyState('6') & 0x8000)
+	{
+		mIsClusterCullingEnabled = false;
+	}
+
 	mCamera.UpdateViewMatrix();
 }
 
@@ -403,14 +454,26 @@ void ApplicationInstance::UpdateInstanceData(const GameTimer& timer)
 
 	auto CurrentInstanceBuffer = mCurrentFrameResource->InstanceBuffer.get();
 
+	// size in pixels of one unit at distance 1 from the camera, what a level's error is measured against
+	const float PixelsPerUnit = static_cast<float>(mMainWindowHeight) / (2.0f * std::tan(0.5f * mCamera.GetFovY()));
+	const XMVECTOR EyePosition = mCamera.GetPositionV();
+
 	for (auto& object : mRenderItems)
 	{
-		UINT VisibleInstanceCount = 0;
+		const size_t LodCount = std::max<size_t>(object->lods.size(), 1);
+
+		// the level of every instance, LodCount for the culled ones
+		std::vector<UINT> levels(object->instances.size(), static_cast<UINT>(LodCount));
+		object->LodInstanceCounts.assign(LodCount, 0);
+		object->ClusterDraws.clear();
 
-		for (const InstanceData& instance : object->instances)
+		const bool IsClusterCulled = object->meshlets != nullptr && mIsClusterCullingEnabled;
+		size_t ClusterCount = 0;
+		size_t VisibleClusterCount = 0;
+
+		for (size_t i = 0; i < object->instances.size(); ++i)
 		{
-			const XMMATRIX world = XMLoadFloat4x4(&instance.world);
-			const XMMATRIX TexCoordTransform = XMLoadFloat4x4(&instance.TexCoordTransform);
+			const XMMATRIX world = XMLoadFloat4x4(&object->instances[i].world);
 
 			XMVECTOR determinant = XMMatrixDeterminant(world);
 			const XMMATRIX WorldInverse = XMMatrixInverse(&determinant, world);
@@ -425,23 +488,123 @@ void ApplicationInstance::UpdateInstanceData(const GameTimer& timer)
 			// box-frustum intersection test in local space
 			if ((LocalSpaceFrustum.Contains(object->bounds) != DirectX::DISJOINT) || (mIsFrustumCullingEnabled == false))
 			{
-				InstanceData data;
-				XMStoreFloat4x4(&data.world, XMMatrixTranspose(world));
-				XMStoreFloat4x4(&data.TexCoordTransform, XMMatrixTranspose(TexCoordTransform));
-				data.MaterialIndex = instance.MaterialIndex;
+				UINT level = 0;
+
+				if (!object->lods.empty() && mIsLodEnabled)
+				{
+					// the closest the bounds can get to the camera, in world units
+					const float scale = std::max({ XMVectorGetX(XMVector3Length(world.r[0])),
+												   XMVectorGetX(XMVector3Length(world.r[1])),
+												   XMVectorGetX(XMVector3Length(world.r[2])) });
+
+					const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&object->bounds.Center), world);
+					const float radius = scale * XMVectorGetX(XMVector3Length(XMLoadFloat3(&object->bounds.Extents)));
+					const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, EyePosition))) - radius;
+
+					level = static_cast<UINT>(MeshSimplifier::SelectLod(object->lods, distance, PixelsPerUnit, scale));
+				}
+
+				levels[i] = level;
+				object->LodInstanceCounts[level]++;
+
+				// clusters outside the frustum or facing away from the camera, both tested in local space
+				if (level == 0 && IsClusterCulled)
+				{
+					const MeshletBuilder::MeshletData& meshlets = *object->meshlets;
+
+					XMFLOAT3 LocalEyePosition;
+					XMStoreFloat3(&LocalEyePosition, XMVector3Transform(EyePosition, WorldInverse));
+
+					for (size_t m = 0; m < meshlets.meshlets.size(); ++m)
+					{
+						const MeshletBuilder::Bounds& bounds = meshlets.bounds[m];
+
+						if (LocalSpaceFrustum.Contains(BoundingSphere(bounds.center, bounds.radius)) == DirectX::DISJOINT ||
+							MeshletBuilder::IsBackfacing(bounds, LocalEyePosition))
+						{
+							continue;
+						}
+
+						const UINT StartIndexLocation = 3 * meshlets.meshlets[m].TriangleOffset;
+						const UINT IndexCount = 3 * meshlets.meshlets[m].TriangleCount;
+
+						// neighbouring visible clusters merge into one draw
+						if (!object->ClusterDraws.empty() && object->ClusterDraws.back().instance == i &&
+							object->ClusterDraws.back().StartIndexLocation + object->ClusterDraws.back().IndexCount == StartIndexLocation)
+						{
+							object->ClusterDraws.back().IndexCount += IndexCount;
+						}
+						else
+						{
+							object->ClusterDraws.push_back({ static_cast<UINT>(i), StartIndexLocation, IndexCount });
+						}
+
+						VisibleClusterCount++;
+					}
+
+					ClusterCount += meshlets.meshlets.size();
+				}
+			}
+		}
 
-				// write the instance data to structured buffer for the visible objects
-				CurrentInstanceBuffer->CopyData(VisibleInstanceCount++, data);
+		// the instances of each level are contiguous so a level is one instanced draw
+		std::vector<UINT> offsets(LodCount, 0);
+
+		for (size_t l = 1; l < LodCount; ++l)
+		{
+			offsets[l] = offsets[l - 1] + object->LodInstanceCounts[l - 1];
+		}
+
+		for (size_t i = 0; i < object->instances.size(); ++i)
+		{
+			if (levels[i] == LodCount)
+			{
+				continue;
 			}
+
+			const InstanceData& instance = object->instances[i];
+
+			InstanceData data;
+			XMStoreFloat4x4(&data.world, XMMatrixTranspose(XMLoadFloat4x4(&object->dequantization) * XMLoadFloat4x4(&instance.world)));
+			XMStoreFloat4x4(&data.TexCoordTransform, XMMatrixTranspose(XMLoadFloat4x4(&instance.TexCoordTransform)));
+			data.MaterialIndex = instance.MaterialIndex;
+
+			// write the instance data to structured buffer for the visible objects
+			const UINT slot = offsets[levels[i]]++;
+			CurrentInstanceBuffer->CopyData(slot, data);
+
+			levels[i] = slot;
+		}
+
+		// the cluster draws were recorded per instance, they need the slot it was written to
+		for (RenderItem::ClusterDraw& draw : object->ClusterDraws)
+		{
+			draw.instance = levels[draw.instance];
 		}
 
-		object->InstanceCount = VisibleInstanceCount;
+		object->InstanceCount = std::accumulate(object->LodInstanceCounts.begin(), object->LodInstanceCounts.end(), 0u);
 
 		std::wostringstream stream;
 		stream.precision(6);
 		stream <<	L"Instancing and Frustum Culling" <<
 					L"    " << object->InstanceCount <<
 					L" objects visible out of " << object->instances.size();
+
+		if (!object->lods.empty())
+		{
+			stream << L"    per LOD:";
+
+			for (UINT count : object->LodInstanceCounts)
+			{
+				stream << L" " << count;
+			}
+		}
+
+		if (IsClusterCulled && ClusterCount > 0)
+		{
+			stream << L"    clusters drawn: " << VisibleClusterCount << L"/" << ClusterCount;
+		}
+
 		mMainWindowTitle = stream.str();
 	}
 }
@@ -654,100 +817,65 @@ void ApplicationInstance::BuildShadersAndInputLayout()
 
 	mInputLayout =
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0,  8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 }
 
 void ApplicationInstance::BuildSkullGeometry()
 {
-	std::ifstream stream("../models/skull.txt");
+	TextModelLoader::CachedModel model;
 
-	if (!stream)
+	if (!TextModelLoader::LoadCached("../models/skull.txt", model))
 	{
 		MessageBox(0, L"models/skull.txt not found", 0, 0);
 		return;
 	}
 
-	UINT VertexCount = 0;
-	UINT TriangleCount = 0;
-	std::string ignore;
-
-	stream >> ignore >> VertexCount;
-	stream >> ignore >> TriangleCount;
-	stream >> ignore >> ignore >> ignore >> ignore;
+	std::vector<Vertex> vertices(model.vertices.size());
 
-	const XMFLOAT3 vMinf3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity);
-	const XMFLOAT3 vMaxf3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-	std::vector<Vertex> vertices(VertexCount);
-
-	for (UINT i = 0; i < VertexCount; ++i)
+	for (size_t i = 0; i < vertices.size(); ++i)
 	{
-		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
-		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
-
-		const XMVECTOR P = XMLoadFloat3(&vertices[i].position);
-
-		// project point onto unit sphere and generate spherical texture coordinates
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-
-		// put in [0, 2pi]
-		if (theta < 0.0f)
-		{
-			theta += XM_2PI;
-		}
-
-		const float phi = acosf(spherePos.y);
-
-		const float u = theta / (2.0f * XM_PI);
-		const float v = phi / XM_PI;
-
-		vertices[i].TexCoord = { u, v };
-
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
+		vertices[i].position = model.vertices[i].position;
+		vertices[i].normal = model.vertices[i].normal;
+		vertices[i].TexCoord = model.vertices[i].TexCoord;
 	}
 
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
+	std::vector<std::int32_t> indices(model.indices.begin(), model.indices.end());
 
-	stream >> ignore;
-	stream >> ignore;
-	stream >> ignore;
+	const BoundingBox bounds(model.center, model.extents);
 
-	std::vector<std::int32_t> indices(3 * TriangleCount);
+	// the full skull in meshlet order, so every cluster is one index range
+	mSkullMeshlets = MeshletBuilder::Build(std::span<const Vertex>(vertices), &Vertex::position, std::span<const std::int32_t>(indices));
+	indices = MeshletBuilder::Unpack<std::int32_t>(mSkullMeshlets);
 
-	for (UINT i = 0; i < TriangleCount; ++i)
-	{
-		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
+	// coarser levels are appended after the full skull and drawn from the same vertices
+	mSkullLods = MeshSimplifier::BuildLodChain(std::span<const Vertex>(vertices), &Vertex::position, indices);
+
+	// the GPU only sees the packed vertices, the render item folds the dequantization into the world matrices
+	std::vector<PackedVertex> packed(vertices.size());
 
-	stream.close();
+	mSkullPositionBounds = VertexCompression::ComputeBounds(&vertices[0].position, sizeof(Vertex), vertices.size());
+	VertexCompression::EncodePositions(&vertices[0].position, sizeof(Vertex), vertices.size(), mSkullPositionBounds, packed[0].position, sizeof(PackedVertex));
+	VertexCompression::EncodeDirections(&vertices[0].normal, sizeof(Vertex), vertices.size(), packed[0].normal, sizeof(PackedVertex));
+	VertexCompression::EncodeTexCoords(&vertices[0].TexCoord, sizeof(Vertex), vertices.size(), packed[0].TexCoord, sizeof(PackedVertex));
 
-	const UINT VertexBufferByteSize = vertices.size() * sizeof(Vertex);
+	const UINT VertexBufferByteSize = packed.size() * sizeof(PackedVertex);
 	const UINT IndexBufferByteSize = indices.size() * sizeof(uint32_t);
 
 	auto geometry = std::make_unique<MeshGeometry>();
 	geometry->name = "skull";
 
 	ThrowIfFailed(D3DCreateBlob(VertexBufferByteSize, &geometry->VertexBufferCPU));
-	CopyMemory(geometry->VertexBufferCPU->GetBufferPointer(), vertices.data(), VertexBufferByteSize);
+	CopyMemory(geometry->VertexBufferCPU->GetBufferPointer(), packed.data(), VertexBufferByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(IndexBufferByteSize, &geometry->IndexBufferCPU));
 	CopyMemory(geometry->IndexBufferCPU->GetBufferPointer(), indices.data(), IndexBufferByteSize);
 
 	geometry->VertexBufferGPU = Utils::CreateDefaultBuffer(mDevice.Get(),
 														   mCommandList.Get(),
-														   vertices.data(),
+														   packed.data(),
 														   VertexBufferByteSize,
 														   geometry->VertexBufferUploader);
 
@@ -757,19 +885,27 @@ void ApplicationInstance::BuildSkullGeometry()
 														  IndexBufferByteSize,
 														  geometry->IndexBufferUploader);
 
-	geometry->VertexByteStride = sizeof(Vertex);
+	geometry->VertexByteStride = sizeof(PackedVertex);
 	geometry->VertexBufferByteSize = VertexBufferByteSize;
 	geometry->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geometry->IndexBufferByteSize = IndexBufferByteSize;
 
 	SubMeshGeometry SubMesh;
-	SubMesh.IndexCount = indices.size();
+	SubMesh.IndexCount = mSkullLods[0].IndexCount;
 	SubMesh.StartIndexLocation = 0;
 	SubMesh.BaseVertexLocation = 0;
 	SubMesh.BoundingBox = bounds;
 
 	geometry->DrawArgs[geometry->name] = SubMesh;
 
+	for (size_t l = 1; l < mSkullLods.size(); ++l)
+	{
+		SubMesh.IndexCount = mSkullLods[l].IndexCount;
+		SubMesh.StartIndexLocation = mSkullLods[l].StartIndex;
+
+		geometry->DrawArgs[geometry->name + "_lod" + std::to_string(l)] = SubMesh;
+	}
+
 	mMeshGeometries[geometry->name] = std::move(geometry);
 }
 
@@ -871,6 +1007,9 @@ void ApplicationInstance::BuildRenderItems()
 	item->StartIndexLocation = item->geometry->DrawArgs["skull"].StartIndexLocation;
 	item->BaseVertexLocation = item->geometry->DrawArgs["skull"].BaseVertexLocation;
 	item->bounds = item->geometry->DrawArgs["skull"].BoundingBox;
+	item->lods = mSkullLods;
+	item->meshlets = &mSkullMeshlets;
+	XMStoreFloat4x4(&item->dequantization, mSkullPositionBounds.Dequantization());
 
 	const UINT n = 5;
 	mInstanceCount = n * n * n;
@@ -918,13 +1057,53 @@ void ApplicationInstance::DrawRenderItems(ID3D12GraphicsCommandList* CommandList
 
 		// bind instance buffer
 		const auto InstanceBuffer = mCurrentFrameResource->InstanceBuffer->GetResource();
-		CommandList->SetGraphicsRootShaderResourceView(0, InstanceBuffer->GetGPUVirtualAddress());
 
-		CommandList->DrawIndexedInstanced(item->IndexCount,
-										  item->InstanceCount,
-										  item->StartIndexLocation,
-										  item->BaseVertexLocation,
-										  0);
+		if (item->lods.empty())
+		{
+			CommandList->SetGraphicsRootShaderResourceView(0, InstanceBuffer->GetGPUVirtualAddress());
+
+			CommandList->DrawIndexedInstanced(item->IndexCount,
+											  item->InstanceCount,
+											  item->StartIndexLocation,
+											  item->BaseVertexLocation,
+											  0);
+			continue;
+		}
+
+		// SV_InstanceID does not include StartInstanceLocation, so each level binds the instance buffer at its first instance
+		UINT FirstInstance = 0;
+
+		for (size_t l = 0; l < item->lods.size(); ++l)
+		{
+			const UINT count = item->LodInstanceCounts[l];
+
+			if (count == 0)
+			{
+				continue;
+			}
+
+			if (l == 0 && item->meshlets != nullptr && mIsClusterCullingEnabled)
+			{
+				for (const RenderItem::ClusterDraw& cluster : item->ClusterDraws)
+				{
+					CommandList->SetGraphicsRootShaderResourceView(0, InstanceBuffer->GetGPUVirtualAddress() + cluster.instance * sizeof(InstanceData));
+					CommandList->DrawIndexedInstanced(cluster.IndexCount, 1, cluster.StartIndexLocation, item->BaseVertexLocation, 0);
+				}
+
+				FirstInstance += count;
+				continue;
+			}
+
+			CommandList->SetGraphicsRootShaderResourceView(0, InstanceBuffer->GetGPUVirtualAddress() + FirstInstance * sizeof(InstanceData));
+
+			CommandList->DrawIndexedInstanced(item->lods[l].IndexCount,
+											  count,
+											  item->lods[l].StartIndex,
+											  item->BaseVertexLocation,
+											  0);
+
+			FirstInstance += count;
+		}
 	}
 }
 
@@ -56,10 +56,12 @@ cbuffer MainPassCB : register(b0)
 	Light gLights[LIGHT_MAX_COUNT];
 };
 
+// the packed vertex: the input assembler expands the unorm position and the half uvs by itself,
+// the world matrix of each instance already includes the dequantization of the position
 struct VertexIn
 {
 	float3 PositionL : POSITION;
-	float3 NormalL : NORMAL;
+	float2 NormalL : NORMAL; // octahedral
 	float2 TexCoord : TEXCOORD;
 };
 
@@ -73,6 +75,16 @@ struct VertexOut
 	nointerpolation uint MaterialIndex : MATERIAL_INDEX;
 };
 
+// unfolds a unit vector from its octahedral encoding, the inverse of VertexCompression::EncodeDirections
+float3 DecodeOctahedral(const float2 encoded)
+{
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	const float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+
+	return normalize(n);
+}
+
 VertexOut VS(const VertexIn vin, const uint InstanceID : SV_InstanceID)
 {
 	VertexOut vout;
@@ -84,7 +96,7 @@ VertexOut VS(const VertexIn vin, const uint InstanceID : SV_InstanceID)
 	vout.PositionW = PositionW.xyz;
 	vout.PositionH = mul(PositionW, gViewProj);
 
-	vout.NormalW = mul(vin.NormalL, (float3x3)(instance.world));
+	vout.NormalW = mul(DecodeOctahedral(vin.NormalL), (float3x3)(instance.world));
 
 	const float4 TexCoord = mul(float4(vin.TexCoord, 0.0f, 1.0f), instance.TexCoordTransform);
 	vout.TexCoord = mul(TexCoord, material.transform).xy;
@@ -3,6 +3,7 @@
 #include "GeometryGenerator.h"
 #include "MathHelper.h"
 #include "camera.h"
+#include "TextModelLoader.h"
 
 //#include <numeric>
 #include <sstream>
@@ -689,76 +690,26 @@ void ApplicationInstance::BuildShadersAndInputLayout()
 
 void ApplicationInstance::BuildGeometry()
 {
-	std::ifstream stream("../models/car.txt");
+	TextModelLoader::CachedModel model;
 
-	if (!stream)
+	if (!TextModelLoader::LoadCached("../models/car.txt", model))
 	{
 		MessageBox(0, L"models/car.txt not found", 0, 0);
 		return;
 	}
 
-	UINT VertexCount = 0;
-	UINT TriangleCount = 0;
-	std::string ignore;
+	std::vector<Vertex> vertices(model.vertices.size());
 
-	stream >> ignore >> VertexCount;
-	stream >> ignore >> TriangleCount;
-	stream >> ignore >> ignore >> ignore >> ignore;
-
-	const XMFLOAT3 vMinf3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity);
-	const XMFLOAT3 vMaxf3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-	std::vector<Vertex> vertices(VertexCount);
-
-	for (UINT i = 0; i < VertexCount; ++i)
+	for (size_t i = 0; i < vertices.size(); ++i)
 	{
-		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
-		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
-
-		const XMVECTOR P = XMLoadFloat3(&vertices[i].position);
-
-		// project point onto unit sphere and generate spherical texture coordinates
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-
-		// put in [0, 2pi]
-		if (theta < 0.0f)
-		{
-			theta += XM_2PI;
-		}
-
-		const float phi = acosf(spherePos.y);
-
-		const float u = theta / (2.0f * XM_PI);
-		const float v = phi / XM_PI;
-
-		vertices[i].TexCoord = { u, v };
-
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
+		vertices[i].position = model.vertices[i].position;
+		vertices[i].normal = model.vertices[i].normal;
+		vertices[i].TexCoord = model.vertices[i].TexCoord;
 	}
 
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
-
-	stream >> ignore;
-	stream >> ignore;
-	stream >> ignore;
-
-	std::vector<std::int32_t> indices(3 * TriangleCount);
-
-	for (UINT i = 0; i < TriangleCount; ++i)
-	{
-		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
+	const std::span<const std::int32_t> indices = model.indices;
 
-	stream.close();
+	const BoundingBox bounds(model.center, model.extents);
 
 	const UINT VertexBufferByteSize = vertices.size() * sizeof(Vertex);
 	const UINT IndexBufferByteSize = indices.size() * sizeof(uint32_t);
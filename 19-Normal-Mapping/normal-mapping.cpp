@@ -743,7 +743,7 @@ void ApplicationInstance::BuildSceneGeometry()
 
 	std::array<NamedMesh, 4> meshes =
 	{
-		NamedMesh("box", generator.CreateBox(1.0f, 1.0f, 1.0f, 3)),
+		NamedMesh("box", generator.CreateBox(1.0f, 1.0f, 1.0f)),
 		NamedMesh("grid", generator.CreateGrid(20.0f, 30.0f, 60, 40)),
 		NamedMesh("sphere", generator.CreateSphere(0.5f, 20, 20)),
 		NamedMesh("cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20))
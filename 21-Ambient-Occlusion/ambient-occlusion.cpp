@@ -3,6 +3,7 @@
 #include "GeometryGenerator.h"
 #include "MathHelper.h"
 #include "camera.h"
+#include "TextModelLoader.h"
 #include "ShadowMap.h"
 #include "SSAO.h"
 
@@ -1133,7 +1134,7 @@ void ApplicationInstance::BuildSceneGeometry()
 
 	std::array<NamedMesh, 5> meshes =
 	{
-		NamedMesh("box",      generator.CreateBox(1.0f, 1.0f, 1.0f, 3)),
+		NamedMesh("box",      generator.CreateBox(1.0f, 1.0f, 1.0f)),
 		NamedMesh("grid",     generator.CreateGrid(20.0f, 30.0f, 60, 40)),
 		NamedMesh("sphere",   generator.CreateSphere(0.5f, 20, 20)),
 		NamedMesh("cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20)),
@@ -1225,92 +1226,21 @@ void ApplicationInstance::BuildSceneGeometry()
 
 void ApplicationInstance::BuildSkullGeometry()
 {
-	std::ifstream stream(PREFIX(L"../models/skull.txt"));
-	//std::ifstream stream("../../../models/skull.txt");
+	TextModelLoader::CachedModel model;
 
-	if (!stream)
+	if (!TextModelLoader::LoadCached(PREFIX(L"../models/skull.txt"), model))
 	{
 		MessageBox(0, L"models/skull.txt not found", 0, 0);
 		return;
 	}
 
-	UINT VertexCount = 0;
-	UINT TriangleCount = 0;
-	std::string ignore;
+	// the loader's vertex is this demo's vertex, so its arrays are uploaded as they are, straight from the mapped cache
+	static_assert(sizeof(Vertex) == sizeof(TextModelLoader::Vertex));
 
-	stream >> ignore >> VertexCount;
-	stream >> ignore >> TriangleCount;
-	stream >> ignore >> ignore >> ignore >> ignore;
+	const std::span<const TextModelLoader::Vertex> vertices = model.vertices;
+	const std::span<const std::int32_t> indices = model.indices;
 
-	const XMFLOAT3 vMinf3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity);
-	const XMFLOAT3 vMaxf3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-	std::vector<Vertex> vertices(VertexCount);
-
-	for (UINT i = 0; i < VertexCount; ++i)
-	{
-		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
-		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
-
-		const XMVECTOR P = XMLoadFloat3(&vertices[i].position);
-
-		// project point onto unit sphere and generate spherical texture coordinates
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-
-		// put in [0, 2pi]
-		if (theta < 0.0f)
-		{
-			theta += XM_2PI;
-		}
-
-		const float phi = acosf(spherePos.y);
-
-		const float u = theta / (2.0f * XM_PI);
-		const float v = phi / XM_PI;
-
-		vertices[i].TexCoord = { u, v };
-
-		const XMVECTOR N = XMLoadFloat3(&vertices[i].normal);
-
-		XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-		if (std::fabsf(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
-		{
-			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
-			XMStoreFloat3(&vertices[i].tangent, T);
-		}
-		else
-		{
-			up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
-			XMStoreFloat3(&vertices[i].tangent, T);
-		}
-
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
-	}
-
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
-
-	stream >> ignore;
-	stream >> ignore;
-	stream >> ignore;
-
-	std::vector<std::int32_t> indices(3 * TriangleCount);
-
-	for (UINT i = 0; i < TriangleCount; ++i)
-	{
-		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	stream.close();
+	const BoundingBox bounds(model.center, model.extents);
 
 	const UINT VertexBufferByteSize = vertices.size() * sizeof(Vertex);
 	const UINT IndexBufferByteSize = indices.size() * sizeof(uint32_t);
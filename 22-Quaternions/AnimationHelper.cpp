@@ -1,5 +1,7 @@
 #include "AnimationHelper.h"
 
+#include <algorithm>
+
 KeyFrame::KeyFrame() :
 	time(0.0f),
 	translation(0.0f, 0.0f, 0.0f),
@@ -21,50 +23,93 @@ float BoneAnimation::GetEndTime()const
 	return KeyFrames.back().time;
 }
 
-void BoneAnimation::interpolate(const float time, XMFLOAT4X4& world) const
+UINT BoneAnimation::FindSegment(const float time) const
+{
+	// the first key frame at or after time, which is past the first one since time is after it
+	const auto next = std::lower_bound(KeyFrames.begin() + 1, KeyFrames.end() - 1, time,
+									   [](const KeyFrame& key, float t) { return key.time < t; });
+
+	return static_cast<UINT>(next - KeyFrames.begin()) - 1;
+}
+
+UINT BoneAnimation::FindSegment(const float time, const UINT cursor) const
+{
+	// the segment of the previous call or the one after it, as long as time is inside it the way FindSegment
+	// would see it: after the first key frame and at or before the second
+	for (UINT i = cursor; i < cursor + 2 && i + 1 < KeyFrames.size(); ++i)
+	{
+		if (KeyFrames[i].time < time && time <= KeyFrames[i + 1].time)
+		{
+			return i;
+		}
+	}
+
+	return FindSegment(time);
+}
+
+void BoneAnimation::ClampToKeyFrame(const KeyFrame& key, XMFLOAT4X4& world) const
+{
+	const XMVECTOR O = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	const XMVECTOR S = XMLoadFloat3(&key.scale);
+	const XMVECTOR T = XMLoadFloat3(&key.translation);
+	const XMVECTOR R = XMLoadFloat4(&key.rotation);
+
+	XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+}
+
+void BoneAnimation::InterpolateSegment(const float time, const UINT i, XMFLOAT4X4& world) const
 {
 	const XMVECTOR O = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 
+	const float t = (time - KeyFrames[i].time) / (KeyFrames[i + 1].time - KeyFrames[i].time);
+
+	const XMVECTOR S0 = XMLoadFloat3(&KeyFrames[i].scale);
+	const XMVECTOR S1 = XMLoadFloat3(&KeyFrames[i + 1].scale);
+
+	const XMVECTOR T0 = XMLoadFloat3(&KeyFrames[i].translation);
+	const XMVECTOR T1 = XMLoadFloat3(&KeyFrames[i + 1].translation);
+
+	const XMVECTOR R0 = XMLoadFloat4(&KeyFrames[i].rotation);
+	const XMVECTOR R1 = XMLoadFloat4(&KeyFrames[i + 1].rotation);
+
+	const XMVECTOR S = XMVectorLerp(S0, S1, t);
+	const XMVECTOR T = XMVectorLerp(T0, T1, t);
+	const XMVECTOR R = XMQuaternionSlerp(R0, R1, t);
+
+	XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+}
+
+void BoneAnimation::interpolate(const float time, XMFLOAT4X4& world) const
+{
 	if (time <= KeyFrames.front().time)
 	{
-		const XMVECTOR S = XMLoadFloat3(&KeyFrames.front().scale);
-		const XMVECTOR T = XMLoadFloat3(&KeyFrames.front().translation);
-		const XMVECTOR R = XMLoadFloat4(&KeyFrames.front().rotation);
-
-		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+		ClampToKeyFrame(KeyFrames.front(), world);
 	}
 	else if (time >= KeyFrames.back().time)
 	{
-		const XMVECTOR S = XMLoadFloat3(&KeyFrames.back().scale);
-		const XMVECTOR T = XMLoadFloat3(&KeyFrames.back().translation);
-		const XMVECTOR R = XMLoadFloat4(&KeyFrames.back().rotation);
-
-		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+		ClampToKeyFrame(KeyFrames.back(), world);
 	}
 	else
 	{
-		for (UINT i = 0; i < KeyFrames.size() - 1; ++i)
-		{
-			if (time >= KeyFrames[i].time && time <= KeyFrames[i + 1].time)
-			{
-				const float t = (time - KeyFrames[i].time) / (KeyFrames[i + 1].time - KeyFrames[i].time);
-
-				const XMVECTOR S0 = XMLoadFloat3(&KeyFrames[i].scale);
-				const XMVECTOR S1 = XMLoadFloat3(&KeyFrames[i + 1].scale);
-
-				const XMVECTOR T0 = XMLoadFloat3(&KeyFrames[i].translation);
-				const XMVECTOR T1 = XMLoadFloat3(&KeyFrames[i + 1].translation);
-
-				const XMVECTOR R0 = XMLoadFloat4(&KeyFrames[i].rotation);
-				const XMVECTOR R1 = XMLoadFloat4(&KeyFrames[i + 1].rotation);
-
-				const XMVECTOR S = XMVectorLerp(S0, S1, t);
-				const XMVECTOR T = XMVectorLerp(T0, T1, t);
-				const XMVECTOR R = XMQuaternionSlerp(R0, R1, t);
+		InterpolateSegment(time, FindSegment(time), world);
+	}
+}
 
-				XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
-				break;
-			}
-		}
+void BoneAnimation::interpolate(const float time, XMFLOAT4X4& world, UINT& cursor) const
+{
+	if (time <= KeyFrames.front().time)
+	{
+		ClampToKeyFrame(KeyFrames.front(), world);
+		cursor = 0;
+	}
+	else if (time >= KeyFrames.back().time)
+	{
+		ClampToKeyFrame(KeyFrames.back(), world);
+	}
+	else
+	{
+		cursor = FindSegment(time, cursor);
+		InterpolateSegment(time, cursor, world);
 	}
 }
@@ -18,8 +18,23 @@ struct BoneAnimation
 	float GetStartTime() const;
 	float GetEndTime() const;
 
+	// the segment [KeyFrames[i], KeyFrames[i + 1]] that time falls in, for a time strictly between the first and the
+	// last key frame: i + 1 is the first key frame at or after time. a binary search, O(log keys)
+	UINT FindSegment(const float time) const;
+
+	// the same starting from cursor, the segment of the previous lookup: forward playback finds its segment there or
+	// in the next one in O(1), anything else (a jump, a loop back to the start) falls back to the binary search
+	UINT FindSegment(const float time, const UINT cursor) const;
+
 	void interpolate(const float time, XMFLOAT4X4& world) const;
 
+	// the same, keeping in cursor the segment found, for the next call of the same playing instance
+	void interpolate(const float time, XMFLOAT4X4& world, UINT& cursor) const;
+
 	// key frames sorted by time
 	std::vector<KeyFrame> KeyFrames;
+
+private:
+	void InterpolateSegment(const float time, const UINT segment, XMFLOAT4X4& world) const;
+	void ClampToKeyFrame(const KeyFrame& key, XMFLOAT4X4& world) const;
 };
@@ -1,12 +1,18 @@
 #include "ApplicationFramework.h"
+#include "AssetPipeline.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
 #include "MathHelper.h"
 #include "camera.h"
+#include "MappedFile.h"
+#include "TextModelLoader.h"
+#include "ThreadPool.h"
 #include "ShadowMap.h"
 #include "SSAO.h"
 #include "SkinnedData.h"
+#include "CrowdAnimation.h"
 #include "LoadM3D.h"
+#include "MeshOptimizer.h"
 
 #include <numeric>
 #include <sstream>
@@ -27,25 +33,21 @@ const UINT kFrameResourcesCount = 3;
 
 using samplers = std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7>;
 
-struct SkinnedModelInstance
+// a texture file read into memory by a pipeline job, created on the device once the pipeline is done
+struct TextureFile
 {
-	SkinnedData* SkinnedInfo = nullptr;
-	std::vector<XMFLOAT4X4> FinalTransforms;
-	std::string ClipName;
-	float time = 0.0f;
-
-	void UpdateSkinnedAnimation(float dt)
-	{
-		time += dt;
-
-		if (time > SkinnedInfo->GetClipEndTime(ClipName))
-		{
-			// loop animation
-			time = 0.0f;
-		}
+	std::string name;
+	std::wstring filename;
+	std::vector<uint8_t> data;
+};
 
-		SkinnedInfo->GetFinalTransforms(ClipName, time, FinalTransforms);
-	}
+// the texture files of the scene, in the order their descriptors go in the heap: the scene's own, the skinned
+// model's, which are only known once its materials are loaded, and the sky cube map last
+struct TextureFiles
+{
+	std::vector<AssetPipeline::Asset<TextureFile>> scene;
+	AssetPipeline::Asset<std::vector<AssetPipeline::Asset<TextureFile>>> skinned;
+	AssetPipeline::Asset<TextureFile> sky;
 };
 
 struct RenderItem
@@ -71,9 +73,8 @@ struct RenderItem
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
 
-	// only for skinned models
-	UINT SkinnedConstantBufferIndex = -1;
-	SkinnedModelInstance* pSkinnedModelInstance = nullptr;
+	// only for skinned models, where the bones of its instance start in the bone palette
+	UINT BonePaletteOffset = 0;
 };
 
 enum class RenderLayer : int
@@ -129,8 +130,9 @@ class ApplicationInstance : public ApplicationFramework
 	std::vector<std::string> mTextureNames;
 
 	UINT mSkinnedTextureHeapIndex = 0;
-	std::unique_ptr<SkinnedModelInstance> mSkinnedModelInstance;
 	SkinnedData mSkinnedData;
+	// every skinned instance, the soldier is instance 0
+	std::unique_ptr<CrowdAnimation> mCrowd;
 	std::vector<M3DLoader::Subset> mSkinnedSubsets;
 	std::vector<M3DLoader::M3DMaterial> mSkinnedMaterials;
 
@@ -179,7 +181,7 @@ class ApplicationInstance : public ApplicationFramework
 
 	void AnimateMaterials(const GameTimer& timer);
 	void UpdateObjectCBs(const GameTimer& timer);
-	void UpdateSkinnedCBs(const GameTimer& timer);
+	void UpdateBonePalette(const GameTimer& timer);
 	void UpdateMaterialBuffer(const GameTimer& timer);
 	void UpdateShadowTransform(const GameTimer& timer);
 	void UpdateMainPassCB(const GameTimer& timer);
@@ -191,14 +193,18 @@ class ApplicationInstance : public ApplicationFramework
 	void BuildDescriptorHeaps();
 	void BuildShadersAndInputLayout();
 	void BuildSceneGeometry();
-	void LoadSkinnedModel();
-	void BuildSkullGeometry();
+	std::unique_ptr<M3DLoader::CachedSkinnedModel> LoadSkinnedModel();
+	void UploadSkinnedModel(const M3DLoader::CachedSkinnedModel* model);
+	static std::unique_ptr<TextModelLoader::CachedModel> LoadSkullModel();
+	void BuildSkullGeometry(const TextModelLoader::CachedModel* model);
 	void BuildPipelineStateObjects();
 	void BuildFrameResources();
 	void BuildMaterials();
 	void BuildRenderItems();
 
-	void LoadTextures();
+	static TextureFile ReadTextureFile(const std::string& name);
+	TextureFiles ReadTextures(AssetPipeline& pipeline, AssetPipeline::Handle SkinnedModel);
+	void LoadTextures(const TextureFiles& files);
 	const samplers& GetStaticSamplers();
 
 	void DrawRenderItems(ID3D12GraphicsCommandList* CommandList,
@@ -254,14 +260,26 @@ bool ApplicationInstance::init()
 								   mCommandList.Get(),
 								   mMainWindowWidth, mMainWindowHeight);
 
-	LoadSkinnedModel();
-	LoadTextures();
-	BuildRootSignatures();
+	// the models and textures are read, parsed and processed by jobs on worker threads while this thread compiles the
+	// shaders, so startup waits for the slowest asset rather than for all of them in a row. what records on the
+	// command list waits for them at the barrier
+	AssetPipeline pipeline;
+
+	const auto skull = pipeline.submit([] { return LoadSkullModel(); });
+	const auto soldier = pipeline.submit([this] { return LoadSkinnedModel(); });
+	const TextureFiles textures = ReadTextures(pipeline, soldier.handle);
+
 	BuildAmbientOcclusionRootSignatures();
-	BuildDescriptorHeaps();
 	BuildShadersAndInputLayout();
 	BuildSceneGeometry();
-	BuildSkullGeometry();
+
+	pipeline.wait();
+
+	UploadSkinnedModel(soldier.get().get());
+	LoadTextures(textures);
+	BuildRootSignatures();
+	BuildDescriptorHeaps();
+	BuildSkullGeometry(skull.get().get());
 	BuildMaterials();
 	BuildRenderItems();
 	BuildFrameResources();
@@ -375,7 +393,7 @@ void ApplicationInstance::update(GameTimer& timer)
 
 	AnimateMaterials(timer);
 	UpdateObjectCBs(timer);
-	UpdateSkinnedCBs(timer);
+	UpdateBonePalette(timer);
 	UpdateMaterialBuffer(timer);
 	UpdateShadowTransform(timer);
 	UpdateMainPassCB(timer);
@@ -733,6 +751,7 @@ void ApplicationInstance::UpdateObjectCBs(const GameTimer& timer)
 			XMStoreFloat4x4(&buffer.world, XMMatrixTranspose(world));
 			XMStoreFloat4x4(&buffer.TexCoordTransform, XMMatrixTranspose(TexCoordTransform));
 			buffer.MaterialIndex = object->material->ConstantBufferIndex;
+			buffer.BonePaletteOffset = object->BonePaletteOffset;
 
 			CurrentObjectCB->CopyData(object->ConstantBufferIndex, buffer);
 
@@ -741,18 +760,12 @@ void ApplicationInstance::UpdateObjectCBs(const GameTimer& timer)
 	}
 }
 
-void ApplicationInstance::UpdateSkinnedCBs(const GameTimer& timer)
+void ApplicationInstance::UpdateBonePalette(const GameTimer& timer)
 {
-	auto CurrentSkinnedCB = mCurrentFrameResource->SkinnedCB.get();
-
-	mSkinnedModelInstance->UpdateSkinnedAnimation(timer.GetDeltaTime());
-
-	SkinnedConstants buffer;
-	std::copy(std::begin(mSkinnedModelInstance->FinalTransforms),
-			  std::end(mSkinnedModelInstance->FinalTransforms),
-			  &buffer.BoneTransform[0]);
+	// the crowd writes the palettes straight into the upload buffer and never reads them back
+	auto palette = reinterpret_cast<XMFLOAT4X4*>(mCurrentFrameResource->BonePalette->GetMappedData());
 
-	CurrentSkinnedCB->CopyData(0, buffer);
+	mCrowd->update(timer.GetDeltaTime(), palette);
 }
 
 void ApplicationInstance::UpdateMaterialBuffer(const GameTimer& timer)
@@ -924,28 +937,85 @@ void ApplicationInstance::UpdateAmbientOcclusionCB(const GameTimer& timer)
 	CurrentAmbientOcclusionCB->CopyData(0, buffer);
 }
 
-void ApplicationInstance::LoadTextures()
+TextureFile ApplicationInstance::ReadTextureFile(const std::string& name)
+{
+	TextureFile file;
+	file.name = name;
+
+	// very bad way to convert a narrow string to a wide string
+	const std::wstring wname(name.begin(), name.end());
+	file.filename = PREFIX(L"../textures/") + wname + L".dds";
+
+	// copied out of the mapping, so the disk is read here on the worker and not later by the upload.
+	// a missing file stays empty and fails in LoadTextures, as it did when the upload read it
+	const MappedFile mapped(file.filename);
+	file.data.assign(mapped.begin(), mapped.end());
+
+	return file;
+}
+
+TextureFiles ApplicationInstance::ReadTextures(AssetPipeline& pipeline, AssetPipeline::Handle SkinnedModel)
+{
+	TextureFiles files;
+
+	for (const char* name : { "bricks2", "bricks2_nmap", "tile", "tile_nmap", "white1x1", "default_nmap" })
+	{
+		files.scene.push_back(pipeline.submit([name] { return ReadTextureFile(name); }));
+	}
+
+	// the skinned model's materials name its textures, so their reads are queued once the model is loaded
+	files.skinned = pipeline.submit([this, &pipeline]
+	{
+		std::vector<std::string> names;
+
+		for (const auto& material : mSkinnedMaterials)
+		{
+			for (std::string name : { material.DiffuseMapName, material.NormalMapName })
+			{
+				name = name.substr(0, name.find_last_of("."));
+
+				if (std::find(names.begin(), names.end(), name) == names.end())
+				{
+					names.push_back(name);
+				}
+			}
+		}
+
+		std::vector<AssetPipeline::Asset<TextureFile>> SkinnedFiles;
+
+		for (const std::string& name : names)
+		{
+			SkinnedFiles.push_back(pipeline.submit([name] { return ReadTextureFile(name); }));
+		}
+
+		return SkinnedFiles;
+	}, { SkinnedModel });
+
+	files.sky = pipeline.submit([] { return ReadTextureFile("desertcube1024"); });
+
+	return files;
+}
+
+void ApplicationInstance::LoadTextures(const TextureFiles& files)
 {
-	const auto LoadTexture = [this](const std::string& name) -> bool
+	const auto LoadTexture = [this](const TextureFile& file) -> bool
 	{
-		if (mTextures.find(name) != mTextures.end())
+		if (mTextures.find(file.name) != mTextures.end())
 		{
 			// do not load same texture twice
 			return false;
 		}
 
-		// very bad way to convert a narrow string to a wide string
-		const std::wstring wname(name.begin(), name.end());
-
 		auto texture = std::make_unique<Texture>();
-		texture->name = name;
-		texture->filename = PREFIX(L"../textures/") + wname + L".dds";
+		texture->name = file.name;
+		texture->filename = file.filename;
 
-		ThrowIfFailed(CreateDDSTextureFromFile12(mDevice.Get(),
-												 mCommandList.Get(),
-												 texture->filename.c_str(),
-												 texture->resource,
-												 texture->UploadHeap));
+		ThrowIfFailed(CreateDDSTextureFromMemory12(mDevice.Get(),
+												   mCommandList.Get(),
+												   file.data.data(),
+												   file.data.size(),
+												   texture->resource,
+												   texture->UploadHeap));
 
 		ThrowIfFailed(texture->resource->SetPrivateData(WKPDID_D3DDebugObjectName,
 														texture->name.size(),
@@ -957,38 +1027,21 @@ void ApplicationInstance::LoadTextures()
 		return true;
 	};
 
-	std::vector<std::string> textures =
-	{
-		"bricks2",
-		"bricks2_nmap",
-		"tile",
-		"tile_nmap",
-		"white1x1",
-		"default_nmap"
-	};
-
-	for (const std::string& texture : textures)
+	for (const auto& file : files.scene)
 	{
-		LoadTexture(texture);
+		LoadTexture(file.get());
 	}
 
 	mSkinnedTextureHeapIndex = mTextures.size();
 
-	for (const auto& material : mSkinnedMaterials)
+	for (const auto& file : files.skinned.get())
 	{
-		std::string diffuse = material.DiffuseMapName;
-		std::string normal = material.NormalMapName;
-
-		diffuse = diffuse.substr(0, diffuse.find_last_of("."));
-		normal = normal.substr(0, normal.find_last_of("."));
-
-		LoadTexture(diffuse);
-		LoadTexture(normal);
+		LoadTexture(file.get());
 	}
 
 	// sky cube map is the last texture
 	mSkyTextureHeapIndex = mTextures.size();
-	LoadTexture("desertcube1024");
+	LoadTexture(files.sky.get());
 }
 
 void ApplicationInstance::BuildRootSignatures()
@@ -998,8 +1051,8 @@ void ApplicationInstance::BuildRootSignatures()
 
 	// object constant buffer (b0)
 	params[0].InitAsConstantBufferView(0);
-	// skinned constant buffer (b1)
-	params[1].InitAsConstantBufferView(1);
+	// bone palettes of all the skinned instances (t1, space1)
+	params[1].InitAsShaderResourceView(1, 1);
 	// main pass constant buffer (b2)
 	params[2].InitAsConstantBufferView(2);
 	// all materials (t0, space1)
@@ -1295,9 +1348,9 @@ void ApplicationInstance::BuildShadersAndInputLayout()
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "WEIGHTS",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "INDICES",  0, DXGI_FORMAT_R8G8B8A8_UINT,   0, 56, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TANGENT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "WEIGHTS",  0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "INDICES",  0, DXGI_FORMAT_R8G8B8A8_UINT,      0, 60, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 }
 
@@ -1309,7 +1362,7 @@ void ApplicationInstance::BuildSceneGeometry()
 
 	std::array<NamedMesh, 5> meshes =
 	{
-		NamedMesh("box",      generator.CreateBox(1.0f, 1.0f, 1.0f, 3)),
+		NamedMesh("box",      generator.CreateBox(1.0f, 1.0f, 1.0f)),
 		NamedMesh("grid",     generator.CreateGrid(20.0f, 30.0f, 60, 40)),
 		NamedMesh("sphere",   generator.CreateSphere(0.5f, 20, 20)),
 		NamedMesh("cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20)),
@@ -1399,93 +1452,34 @@ void ApplicationInstance::BuildSceneGeometry()
 	mMeshGeometries[geometry->name] = std::move(geometry);
 }
 
-void ApplicationInstance::BuildSkullGeometry()
+std::unique_ptr<TextModelLoader::CachedModel> ApplicationInstance::LoadSkullModel()
 {
-	std::ifstream stream(PREFIX(L"../models/skull.txt"));
+	// a pipeline job: parsed on its own thread, next to the other assets, so it does not take the thread pool
+	auto model = std::make_unique<TextModelLoader::CachedModel>();
 
-	if (!stream)
+	if (!TextModelLoader::LoadCached(PREFIX(L"../models/skull.txt"), *model))
 	{
-		MessageBox(0, L"models/skull.txt not found", 0, 0);
-		return;
+		return nullptr;
 	}
 
-	UINT VertexCount = 0;
-	UINT TriangleCount = 0;
-	std::string ignore;
-
-	stream >> ignore >> VertexCount;
-	stream >> ignore >> TriangleCount;
-	stream >> ignore >> ignore >> ignore >> ignore;
-
-	const XMFLOAT3 vMinf3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity);
-	const XMFLOAT3 vMaxf3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity);
-
-	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-	std::vector<Vertex> vertices(VertexCount);
+	return model;
+}
 
-	for (UINT i = 0; i < VertexCount; ++i)
+void ApplicationInstance::BuildSkullGeometry(const TextModelLoader::CachedModel* model)
+{
+	if (model == nullptr)
 	{
-		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
-		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
-
-		const XMVECTOR P = XMLoadFloat3(&vertices[i].position);
-
-		// project point onto unit sphere and generate spherical texture coordinates
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-
-		// put in [0, 2pi]
-		if (theta < 0.0f)
-		{
-			theta += XM_2PI;
-		}
-
-		const float phi = acosf(spherePos.y);
-
-		const float u = theta / (2.0f * XM_PI);
-		const float v = phi / XM_PI;
-
-		vertices[i].TexCoord = { u, v };
-
-		const XMVECTOR N = XMLoadFloat3(&vertices[i].normal);
-
-		XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-		if (std::fabsf(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
-		{
-			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
-			XMStoreFloat3(&vertices[i].tangent, T);
-		}
-		else
-		{
-			up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
-			XMStoreFloat3(&vertices[i].tangent, T);
-		}
-
-		vMin = XMVectorMin(vMin, P);
-		vMax = XMVectorMax(vMax, P);
+		MessageBox(0, L"models/skull.txt not found", 0, 0);
+		return;
 	}
 
-	BoundingBox bounds;
-	XMStoreFloat3(&bounds.Center, 0.5f * (vMin + vMax));
-	XMStoreFloat3(&bounds.Extents, 0.5f * (vMax - vMin));
+	// the loader's vertex is this demo's vertex, so its arrays are uploaded as they are, straight from the mapped cache
+	static_assert(sizeof(Vertex) == sizeof(TextModelLoader::Vertex));
 
-	stream >> ignore;
-	stream >> ignore;
-	stream >> ignore;
+	const std::span<const TextModelLoader::Vertex> vertices = model->vertices;
+	const std::span<const std::int32_t> indices = model->indices;
 
-	std::vector<std::int32_t> indices(3 * TriangleCount);
-
-	for (UINT i = 0; i < TriangleCount; ++i)
-	{
-		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	stream.close();
+	const BoundingBox bounds(model->center, model->extents);
 
 	const UINT VertexBufferByteSize = vertices.size() * sizeof(Vertex);
 	const UINT IndexBufferByteSize = indices.size() * sizeof(uint32_t);
@@ -1563,24 +1557,60 @@ void ApplicationInstance::BuildSkullGeometry()
 //	XMStoreFloat4(&mSkullAnimation.KeyFrames[4].rotation, q0);
 //}
 
-void ApplicationInstance::LoadSkinnedModel()
+std::unique_ptr<M3DLoader::CachedSkinnedModel> ApplicationInstance::LoadSkinnedModel()
 {
-	std::vector<M3DLoader::SkinnedVertex> vertices;
-	std::vector<std::uint16_t> indices;
+	// the exported triangle order is already cache friendly, so only the vertex fetch order of each subset is changed.
+	// the cache next to the model holds the reordered buffers, so this runs only when the model changes
+	const auto optimize = [](std::vector<M3DLoader::SkinnedVertex>& vertices, std::vector<std::uint16_t>& indices, const std::vector<M3DLoader::Subset>& subsets)
+	{
+		for (const M3DLoader::Subset& subset : subsets)
+		{
+			MeshOptimizer::Optimize(std::span<std::uint16_t>(indices).subspan(subset.FaceStart * 3, subset.FaceCount * 3),
+									std::span<M3DLoader::SkinnedVertex>(vertices).subspan(subset.VertexStart, subset.VertexCount),
+									&M3DLoader::SkinnedVertex::Pos,
+									subset.VertexStart,
+									0.0f);
+		}
+	};
+
+	// a pipeline job, the slowest of them when the cache is rebuilt, so it is the one that splits its parse across
+	// the thread pool
+	ThreadPool pool;
+	auto model = std::make_unique<M3DLoader::CachedSkinnedModel>();
 
 	M3DLoader m3dLoader;
-	m3dLoader.LoadM3d(PREFIX("../models/soldier.m3d"),
-					  vertices,
-					  indices,
-					  mSkinnedSubsets,
-					  mSkinnedMaterials,
-					  mSkinnedData);
-
-	mSkinnedModelInstance = std::make_unique<SkinnedModelInstance>();
-	mSkinnedModelInstance->SkinnedInfo = &mSkinnedData;
-	mSkinnedModelInstance->FinalTransforms.resize(mSkinnedData.GetBoneCount());
-	mSkinnedModelInstance->ClipName = "Take1";
-	mSkinnedModelInstance->time = 0.0f;
+
+	if (!m3dLoader.LoadM3dCached(PREFIX("../models/soldier.m3d"),
+								 *model,
+								 mSkinnedSubsets,
+								 mSkinnedMaterials,
+								 mSkinnedData,
+								 "MeshOptimizer vertex fetch",
+								 optimize,
+								 &pool))
+	{
+		return nullptr;
+	}
+
+	return model;
+}
+
+void ApplicationInstance::UploadSkinnedModel(const M3DLoader::CachedSkinnedModel* model)
+{
+	if (model == nullptr)
+	{
+		MessageBox(0, L"models/soldier.m3d not found", 0, 0);
+		return;
+	}
+
+	// uploaded as they are, tangent handedness included, so the two vertex layouts have to agree
+	static_assert(sizeof(SkinnedVertex) == sizeof(M3DLoader::SkinnedVertex));
+
+	const std::span<const M3DLoader::SkinnedVertex> vertices = model->vertices;
+	const std::span<const std::uint16_t> indices = model->indices;
+
+	mCrowd = std::make_unique<CrowdAnimation>(mSkinnedData);
+	mCrowd->add("Take1");
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(SkinnedVertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
@@ -1894,7 +1924,7 @@ void ApplicationInstance::BuildFrameResources()
 		mFrameResources.push_back(std::make_unique<FrameResource>(mDevice.Get(),
 																  2, // +1 shadow
 																  mRenderItems.size(),
-																  1,
+																  mCrowd->GetPaletteSize(),
 																  mMaterials.size()));
 	}
 }
@@ -2056,8 +2086,7 @@ void ApplicationInstance::BuildRenderItems()
 		item->BaseVertexLocation = item->geometry->DrawArgs[mesh].BaseVertexLocation;
 
 		// all render items share the same skinned model instance
-		item->SkinnedConstantBufferIndex = 0;
-		item->pSkinnedModelInstance = mSkinnedModelInstance.get();
+		item->BonePaletteOffset = static_cast<UINT>(mCrowd->GetPaletteOffset(0));
 		
 		mLayerRenderItems[static_cast<int>(RenderLayer::skinned)].push_back(item.get());
 		mRenderItems.push_back(std::move(item));
@@ -2067,10 +2096,11 @@ void ApplicationInstance::BuildRenderItems()
 void ApplicationInstance::DrawRenderItems(ID3D12GraphicsCommandList* CommandList, const std::vector<RenderItem*>& RenderItems)
 {
 	const UINT ObjectCBByteSize = Utils::GetConstantBufferByteSize(sizeof(ObjectConstants));
-	const UINT SkinnedCBByteSize = Utils::GetConstantBufferByteSize(sizeof(SkinnedConstants));
 
 	const auto ObjectCB = mCurrentFrameResource->ObjectCB->GetResource();
-	const auto SkinnedCB = mCurrentFrameResource->SkinnedCB->GetResource();
+
+	// one palette for every skinned item, each finds its bones at the offset in its object constants
+	CommandList->SetGraphicsRootShaderResourceView(1, mCurrentFrameResource->BonePalette->GetResource()->GetGPUVirtualAddress());
 
 	for (const auto& item : RenderItems)
 	{
@@ -2092,17 +2122,6 @@ void ApplicationInstance::DrawRenderItems(ID3D12GraphicsCommandList* CommandList
 			CommandList->SetGraphicsRootConstantBufferView(0, ObjectCBAddress);
 		}
 
-		if (item->pSkinnedModelInstance)
-		{
-			// bind skinned constant buffer
-			const D3D12_GPU_VIRTUAL_ADDRESS SkinnedCBAddress = SkinnedCB->GetGPUVirtualAddress() + item->SkinnedConstantBufferIndex * SkinnedCBByteSize;
-			CommandList->SetGraphicsRootConstantBufferView(1, SkinnedCBAddress);
-		}
-		else
-		{
-			CommandList->SetGraphicsRootConstantBufferView(1, 0);
-		}
-
 		CommandList->DrawIndexedInstanced(item->IndexCount, 1, item->StartIndexLocation, item->BaseVertexLocation, 0);
 	}
 }
@@ -0,0 +1,335 @@
+#include "CompiledClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the bones are blended with the widest float SIMD the target is compiled for (/arch:AVX2 or /arch:AVX), fall back
+// to SSE2 (always available on x64) and then to plain scalar code, all of them running the same operations in the
+// same order
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COMPILED_CLIP_AVX
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define COMPILED_CLIP_SSE
+#endif
+
+namespace
+{
+	// the bones are padded to whole blocks, each blended into a small SoA matrix block and then written out
+	const UINT kBoneBlock = 8;
+
+	enum Channel
+	{
+		kTranslationX, kTranslationY, kTranslationZ,
+		kScaleX, kScaleY, kScaleZ,
+		kRotationX, kRotationY, kRotationZ, kRotationW
+	};
+
+	// the upper 4x3 of the bone transforms of a block, row r column c in m[3 * r + c]
+	struct MatrixBlock
+	{
+		alignas(32) float m[12][kBoneBlock];
+	};
+
+	// the handful of lane operations the blend needs, for each instruction set
+#if defined(COMPILED_CLIP_AVX)
+	struct Lanes
+	{
+		using Vector = __m256;
+		static const UINT width = 8;
+
+		static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+		static void store(float* p, Vector v) { _mm256_store_ps(p, v); }
+		static Vector set(float x) { return _mm256_set1_ps(x); }
+		static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+		static Vector div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+		static Vector sqrt(Vector a) { return _mm256_sqrt_ps(a); }
+	};
+#elif defined(COMPILED_CLIP_SSE)
+	struct Lanes
+	{
+		using Vector = __m128;
+		static const UINT width = 4;
+
+		static Vector load(const float* p) { return _mm_loadu_ps(p); }
+		static void store(float* p, Vector v) { _mm_store_ps(p, v); }
+		static Vector set(float x) { return _mm_set1_ps(x); }
+		static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+		static Vector div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+		static Vector sqrt(Vector a) { return _mm_sqrt_ps(a); }
+	};
+#else
+	struct Lanes
+	{
+		using Vector = float;
+		static const UINT width = 1;
+
+		static Vector load(const float* p) { return *p; }
+		static void store(float* p, Vector v) { *p = v; }
+		static Vector set(float x) { return x; }
+		static Vector add(Vector a, Vector b) { return a + b; }
+		static Vector sub(Vector a, Vector b) { return a - b; }
+		static Vector mul(Vector a, Vector b) { return a * b; }
+		static Vector div(Vector a, Vector b) { return a / b; }
+		static Vector sqrt(Vector a) { return std::sqrt(a); }
+	};
+#endif
+
+	// the transforms of the kBoneBlock bones at first, blended from the frames a and b by weight: a + (b - a) * weight
+	// per channel, the rotation normalized, then scale * rotation * translation as XMMatrixAffineTransformation builds it
+	void BlendBlock(const float* a, const float* b, UINT stride, UINT first, float weight, MatrixBlock& block)
+	{
+		using V = Lanes::Vector;
+
+		const V w = Lanes::set(weight);
+		const V one = Lanes::set(1.0f);
+		const V two = Lanes::set(2.0f);
+
+		for (UINT lane = 0; lane < kBoneBlock; lane += Lanes::width)
+		{
+			const UINT i = first + lane;
+
+			const auto channel = [&](Channel c)
+			{
+				const V from = Lanes::load(a + c * stride + i);
+				const V to = Lanes::load(b + c * stride + i);
+
+				return Lanes::add(from, Lanes::mul(Lanes::sub(to, from), w));
+			};
+
+			const V tx = channel(kTranslationX);
+			const V ty = channel(kTranslationY);
+			const V tz = channel(kTranslationZ);
+
+			const V sx = channel(kScaleX);
+			const V sy = channel(kScaleY);
+			const V sz = channel(kScaleZ);
+
+			V qx = channel(kRotationX);
+			V qy = channel(kRotationY);
+			V qz = channel(kRotationZ);
+			V qw = channel(kRotationW);
+
+			const V length = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(qx, qx), Lanes::mul(qy, qy)),
+													Lanes::add(Lanes::mul(qz, qz), Lanes::mul(qw, qw))));
+
+			qx = Lanes::div(qx, length);
+			qy = Lanes::div(qy, length);
+			qz = Lanes::div(qz, length);
+			qw = Lanes::div(qw, length);
+
+			const V x2 = Lanes::mul(qx, two);
+			const V y2 = Lanes::mul(qy, two);
+			const V z2 = Lanes::mul(qz, two);
+
+			const V xx = Lanes::mul(qx, x2);
+			const V yy = Lanes::mul(qy, y2);
+			const V zz = Lanes::mul(qz, z2);
+			const V xy = Lanes::mul(qx, y2);
+			const V xz = Lanes::mul(qx, z2);
+			const V yz = Lanes::mul(qy, z2);
+			const V wx = Lanes::mul(qw, x2);
+			const V wy = Lanes::mul(qw, y2);
+			const V wz = Lanes::mul(qw, z2);
+
+			Lanes::store(block.m[0] + lane, Lanes::mul(Lanes::sub(one, Lanes::add(yy, zz)), sx));
+			Lanes::store(block.m[1] + lane, Lanes::mul(Lanes::add(xy, wz), sx));
+			Lanes::store(block.m[2] + lane, Lanes::mul(Lanes::sub(xz, wy), sx));
+
+			Lanes::store(block.m[3] + lane, Lanes::mul(Lanes::sub(xy, wz), sy));
+			Lanes::store(block.m[4] + lane, Lanes::mul(Lanes::sub(one, Lanes::add(xx, zz)), sy));
+			Lanes::store(block.m[5] + lane, Lanes::mul(Lanes::add(yz, wx), sy));
+
+			Lanes::store(block.m[6] + lane, Lanes::mul(Lanes::add(xz, wy), sz));
+			Lanes::store(block.m[7] + lane, Lanes::mul(Lanes::sub(yz, wx), sz));
+			Lanes::store(block.m[8] + lane, Lanes::mul(Lanes::sub(one, Lanes::add(xx, yy)), sz));
+
+			Lanes::store(block.m[9] + lane, tx);
+			Lanes::store(block.m[10] + lane, ty);
+			Lanes::store(block.m[11] + lane, tz);
+		}
+	}
+
+	// the translation, scale and rotation of a bone at time, the way BoneAnimation::interpolate blends its key frames
+	void SampleBone(const BoneAnimation& animation, float time, UINT& cursor, XMFLOAT3& translation, XMFLOAT3& scale, XMFLOAT4& rotation)
+	{
+		const std::vector<KeyFrame>& keys = animation.KeyFrames;
+
+		if (keys.empty())
+		{
+			translation = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+			return;
+		}
+
+		if (time <= keys.front().time || time >= keys.back().time)
+		{
+			const KeyFrame& key = time <= keys.front().time ? keys.front() : keys.back();
+
+			translation = key.translation;
+			scale = key.scale;
+			rotation = key.rotation;
+			return;
+		}
+
+		cursor = animation.FindSegment(time, cursor);
+
+		const KeyFrame& k0 = keys[cursor];
+		const KeyFrame& k1 = keys[cursor + 1];
+
+		const float t = (time - k0.time) / (k1.time - k0.time);
+
+		XMStoreFloat3(&translation, XMVectorLerp(XMLoadFloat3(&k0.translation), XMLoadFloat3(&k1.translation), t));
+		XMStoreFloat3(&scale, XMVectorLerp(XMLoadFloat3(&k0.scale), XMLoadFloat3(&k1.scale), t));
+		XMStoreFloat4(&rotation, XMQuaternionSlerp(XMLoadFloat4(&k0.rotation), XMLoadFloat4(&k1.rotation), t));
+	}
+}
+
+CompiledClip::CompiledClip(const AnimationClip& clip, UINT BoneCount, float SampleRate) :
+	mBoneCount(BoneCount),
+	mBoneStride((BoneCount + kBoneBlock - 1) / kBoneBlock * kBoneBlock),
+	mSampleRate(SampleRate)
+{
+	const float start = BoneCount != 0 && !clip.BoneAnimations.empty() ? clip.GetClipStartTime() : 0.0f;
+	const float end = std::max(start, clip.GetClipEndTime());
+
+	// at least two frames, so that there is always a pair to blend; a frame within a thousandth of a sample of the
+	// end is the end
+	const size_t intervals = std::max<size_t>(1, static_cast<size_t>(std::ceil((end - start) * SampleRate - 1.0e-3f)));
+
+	mFrameTimes.resize(intervals + 1);
+
+	for (size_t f = 0; f < intervals; ++f)
+	{
+		mFrameTimes[f] = start + f / SampleRate;
+	}
+
+	mFrameTimes[intervals] = end;
+
+	mSamples.assign(mFrameTimes.size() * kChannels * mBoneStride, 0.0f);
+
+	for (UINT b = 0; b < mBoneStride; ++b)
+	{
+		UINT cursor = 0;
+		XMFLOAT4 previous(0.0f, 0.0f, 0.0f, 1.0f);
+
+		for (size_t f = 0; f < mFrameTimes.size(); ++f)
+		{
+			XMFLOAT3 translation(0.0f, 0.0f, 0.0f);
+			XMFLOAT3 scale(1.0f, 1.0f, 1.0f);
+			XMFLOAT4 rotation(0.0f, 0.0f, 0.0f, 1.0f);
+
+			if (b < std::min<size_t>(BoneCount, clip.BoneAnimations.size()))
+			{
+				SampleBone(clip.BoneAnimations[b], mFrameTimes[f], cursor, translation, scale, rotation);
+			}
+
+			// q and -q are the same rotation, keep the one closer to the previous frame
+			if (f > 0 && XMVectorGetX(XMQuaternionDot(XMLoadFloat4(&rotation), XMLoadFloat4(&previous))) < 0.0f)
+			{
+				rotation = XMFLOAT4(-rotation.x, -rotation.y, -rotation.z, -rotation.w);
+			}
+
+			previous = rotation;
+
+			float* frame = mSamples.data() + f * kChannels * mBoneStride;
+
+			const float values[kChannels] = { translation.x, translation.y, translation.z, scale.x, scale.y, scale.z,
+											  rotation.x, rotation.y, rotation.z, rotation.w };
+
+			for (int c = 0; c < kChannels; ++c)
+			{
+				frame[c * mBoneStride + b] = values[c];
+			}
+		}
+	}
+}
+
+const float* CompiledClip::GetFrame(size_t frame) const
+{
+	return mSamples.data() + frame * kChannels * mBoneStride;
+}
+
+float CompiledClip::GetClipStartTime() const
+{
+	return mFrameTimes.front();
+}
+
+float CompiledClip::GetClipEndTime() const
+{
+	return mFrameTimes.back();
+}
+
+UINT CompiledClip::GetBoneCount() const
+{
+	return mBoneCount;
+}
+
+size_t CompiledClip::GetFrameCount() const
+{
+	return mFrameTimes.size();
+}
+
+size_t CompiledClip::GetSampleBytes() const
+{
+	return mSamples.size() * sizeof(float);
+}
+
+void CompiledClip::interpolate(const float time, std::vector<XMFLOAT4X4>& transforms) const
+{
+	// one lookup for every bone: the frame before time and how far time is towards the next one
+	const size_t last = mFrameTimes.size() - 1;
+
+	size_t frame = 0;
+	float weight = 0.0f;
+
+	if (time >= mFrameTimes[last])
+	{
+		frame = last - 1;
+		weight = 1.0f;
+	}
+	else if (time > mFrameTimes[0])
+	{
+		frame = std::min(static_cast<size_t>((time - mFrameTimes[0]) * mSampleRate), last - 1);
+
+		// the rounding of the division can land a frame off, and the last interval may be shorter
+		if (time < mFrameTimes[frame])
+		{
+			--frame;
+		}
+		else if (frame + 1 < last && time >= mFrameTimes[frame + 1])
+		{
+			++frame;
+		}
+
+		weight = (time - mFrameTimes[frame]) / (mFrameTimes[frame + 1] - mFrameTimes[frame]);
+	}
+
+	const float* a = GetFrame(frame);
+	const float* b = GetFrame(frame + 1);
+
+	MatrixBlock block;
+
+	for (UINT first = 0; first < mBoneCount; first += kBoneBlock)
+	{
+		BlendBlock(a, b, mBoneStride, first, weight, block);
+
+		const UINT count = std::min(kBoneBlock, mBoneCount - first);
+
+		for (UINT k = 0; k < count; ++k)
+		{
+			XMFLOAT4X4& m = transforms[first + k];
+
+			m = XMFLOAT4X4(block.m[0][k], block.m[1][k], block.m[2][k], 0.0f,
+						   block.m[3][k], block.m[4][k], block.m[5][k], 0.0f,
+						   block.m[6][k], block.m[7][k], block.m[8][k], 0.0f,
+						   block.m[9][k], block.m[10][k], block.m[11][k], 1.0f);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SkinnedData.h"
+
+// an AnimationClip resampled for playback: every bone is sampled at the same uniform rate from the start of the clip
+// to its end, and the samples are stored structure of arrays, one array per channel (translation x, y, z, scale x, y,
+// z, rotation x, y, z, w) holding all the bones of a frame. sampling a time is then one frame lookup for the whole
+// clip, and the bones are blended several at a time with SIMD, with no search and no branch per bone.
+//
+// between two samples translations and scales are interpolated linearly like the key frames, rotations with a
+// normalized lerp instead of a slerp; at the 60 Hz of the exported clips the difference is a rounding error. the
+// rotations are stored on the same hemisphere as the previous frame, so the lerp takes the short way round like
+// XMQuaternionSlerp does
+class CompiledClip
+{
+	static const int kChannels = 10;
+
+	UINT mBoneCount = 0;
+	// the bone count rounded up to whole SIMD blocks, the padding bones are at rest
+	UINT mBoneStride = 0;
+
+	float mSampleRate = 60.0f;
+
+	// the time of every frame: start + f / rate, except the last one which is the end of the clip
+	std::vector<float> mFrameTimes;
+	// frame f, channel c, bone b at (f * kChannels + c) * mBoneStride + b
+	std::vector<float> mSamples;
+
+	const float* GetFrame(size_t frame) const;
+
+public:
+	// bones past the clip's bone animations, up to BoneCount, are at rest. a rate below the one the key frames were
+	// exported at loses motion between the samples
+	CompiledClip(const AnimationClip& clip, UINT BoneCount, float SampleRate = 60.0f);
+
+	float GetClipStartTime() const;
+	float GetClipEndTime() const;
+	UINT GetBoneCount() const;
+	size_t GetFrameCount() const;
+	size_t GetSampleBytes() const;
+
+	// the to-parent transform of every bone at time, clamped to the clip, as AnimationClip::interpolate gives them
+	// within resampling and rounding
+	void interpolate(const float time, std::vector<XMFLOAT4X4>& transforms) const;
+};
@@ -0,0 +1,397 @@
+#include "CompressedClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const float kUnorm16 = 65535.0f;
+	const float kUnorm15 = 32767.0f;
+
+	// the components of a unit quaternion other than the largest one are at most 1 / sqrt(2) in magnitude
+	const float kSmallestThreeRange = 0.70710678f;
+
+	uint16_t EncodeUnorm16(float value, float minimum, float extent)
+	{
+		if (extent <= 0.0f)
+		{
+			return 0;
+		}
+
+		return static_cast<uint16_t>(std::lround(std::clamp((value - minimum) / extent, 0.0f, 1.0f) * kUnorm16));
+	}
+
+	float DecodeUnorm16(uint16_t value, float minimum, float extent)
+	{
+		return minimum + value / kUnorm16 * extent;
+	}
+
+	// a rotation in 47 of the 48 bits: the index of the dropped largest component in 2 bits, then the other three in
+	// order, 15 bits each
+	void EncodeRotation(const XMFLOAT4& rotation, uint16_t packed[3])
+	{
+		XMFLOAT4 q;
+		XMStoreFloat4(&q, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+
+		float components[4] = { q.x, q.y, q.z, q.w };
+
+		int largest = 0;
+
+		for (int i = 1; i < 4; ++i)
+		{
+			if (std::fabs(components[i]) > std::fabs(components[largest]))
+			{
+				largest = i;
+			}
+		}
+
+		// q and -q are the same rotation, keep the one whose dropped component is positive
+		const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+
+		uint64_t bits = static_cast<uint64_t>(largest);
+
+		for (int i = 0; i < 4; ++i)
+		{
+			if (i != largest)
+			{
+				const float unit = std::clamp(sign * components[i] / kSmallestThreeRange * 0.5f + 0.5f, 0.0f, 1.0f);
+				bits = (bits << 15) | static_cast<uint64_t>(std::lround(unit * kUnorm15));
+			}
+		}
+
+		packed[0] = static_cast<uint16_t>(bits >> 32);
+		packed[1] = static_cast<uint16_t>(bits >> 16);
+		packed[2] = static_cast<uint16_t>(bits);
+	}
+
+	XMFLOAT4 DecodeRotation(const uint16_t packed[3])
+	{
+		const uint64_t bits = (static_cast<uint64_t>(packed[0]) << 32) | (static_cast<uint64_t>(packed[1]) << 16) | packed[2];
+
+		const int largest = static_cast<int>((bits >> 45) & 3);
+
+		float components[4];
+		float sum = 0.0f;
+		int shift = 30;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			if (i != largest)
+			{
+				const float unit = static_cast<float>((bits >> shift) & 0x7FFF) / kUnorm15;
+
+				components[i] = (unit * 2.0f - 1.0f) * kSmallestThreeRange;
+				sum += components[i] * components[i];
+				shift -= 15;
+			}
+		}
+
+		components[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+		return XMFLOAT4(components[0], components[1], components[2], components[3]);
+	}
+
+	// a + (b - a) * t for the translations and scales, slerp for the rotations, as BoneAnimation::interpolate blends
+	KeyFrame blend(const KeyFrame& a, const KeyFrame& b, float time)
+	{
+		const float t = b.time > a.time ? (time - a.time) / (b.time - a.time) : 0.0f;
+
+		KeyFrame key;
+		key.time = time;
+
+		XMStoreFloat3(&key.translation, XMVectorLerp(XMLoadFloat3(&a.translation), XMLoadFloat3(&b.translation), t));
+		XMStoreFloat3(&key.scale, XMVectorLerp(XMLoadFloat3(&a.scale), XMLoadFloat3(&b.scale), t));
+		XMStoreFloat4(&key.rotation, XMQuaternionSlerp(XMLoadFloat4(&a.rotation), XMLoadFloat4(&b.rotation), t));
+
+		return key;
+	}
+
+	// how far a joint reach away from the bone can move when the bone's transform is b instead of a: the translation
+	// moves it as far as it differs, the rotation along an arc of the angle between the two, and the scale by reach
+	// times the change
+	float JointError(const KeyFrame& a, const KeyFrame& b, float reach)
+	{
+		const float translation = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a.translation), XMLoadFloat3(&b.translation))));
+		const float scale = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&a.scale), XMLoadFloat3(&b.scale))));
+
+		// the angle from the chord between the two on the same hemisphere, 2 sin(angle / 4) long: an acos of their dot
+		// product rounds the small angles that matter here to zero
+		const XMVECTOR qa = XMQuaternionNormalize(XMLoadFloat4(&a.rotation));
+		XMVECTOR qb = XMQuaternionNormalize(XMLoadFloat4(&b.rotation));
+
+		if (XMVectorGetX(XMQuaternionDot(qa, qb)) < 0.0f)
+		{
+			qb = -qb;
+		}
+
+		const float chord = XMVectorGetX(XMVector4Length(XMVectorSubtract(qa, qb)));
+		const float angle = 4.0f * std::asin(std::min(0.5f * chord, 1.0f));
+
+		return translation + reach * (angle + scale);
+	}
+
+	void StoreKeyFrame(const KeyFrame& key, XMFLOAT4X4& world)
+	{
+		const XMVECTOR O = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+		const XMVECTOR S = XMLoadFloat3(&key.scale);
+		const XMVECTOR T = XMLoadFloat3(&key.translation);
+		const XMVECTOR R = XMLoadFloat4(&key.rotation);
+
+		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+	}
+}
+
+CompressedClip::CompressedClip(const AnimationClip& clip, const SkinnedData& skinned, const float tolerance)
+{
+	const UINT bones = static_cast<UINT>(clip.BoneAnimations.size());
+
+	if (bones != 0)
+	{
+		mStartTime = clip.GetClipStartTime();
+		mDuration = std::max(0.0f, clip.GetClipEndTime() - mStartTime);
+	}
+
+	// the bind pose position of every joint, from the inverse of its offset, and the longest chain of bones
+	const std::vector<int>& hierarchy = skinned.GetBoneHierarchy();
+	const std::vector<XMFLOAT4X4>& offsets = skinned.GetBoneOffsets();
+
+	std::vector<XMFLOAT3> joints(offsets.size());
+
+	for (size_t b = 0; b < offsets.size(); ++b)
+	{
+		XMVECTOR determinant;
+		const XMMATRIX BindPose = XMMatrixInverse(&determinant, XMLoadFloat4x4(&offsets[b]));
+
+		XMStoreFloat3(&joints[b], BindPose.r[3]);
+	}
+
+	// how far every bone reaches to a joint below it, and how many bones the longest chain has
+	std::vector<float> reach(std::max<size_t>(bones, joints.size()), 0.0f);
+	size_t chain = 1;
+
+	for (size_t d = 0; d < joints.size(); ++d)
+	{
+		size_t length = 1;
+
+		// a parent comes before its children, a hierarchy that does not is not followed
+		for (int p = hierarchy[d]; p >= 0 && static_cast<size_t>(p) < d; p = hierarchy[p])
+		{
+			const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&joints[d]), XMLoadFloat3(&joints[p]))));
+
+			reach[p] = std::max(reach[p], distance);
+			++length;
+		}
+
+		chain = std::max(chain, length);
+	}
+
+	// the errors of the bones along a chain add up, so each gets its share
+	const float budget = tolerance / chain;
+
+	mRanges.resize(bones);
+	mFirstKeys.assign(bones + 1, 0);
+
+	for (UINT b = 0; b < bones; ++b)
+	{
+		const std::vector<KeyFrame>& keys = clip.BoneAnimations[b].KeyFrames;
+
+		mSourceKeyCount += keys.size();
+		mFirstKeys[b] = static_cast<UINT>(mKeys.size());
+
+		if (keys.empty())
+		{
+			mRanges[b] = BoneRange();
+			continue;
+		}
+
+		XMVECTOR TranslationMin = XMLoadFloat3(&keys[0].translation);
+		XMVECTOR TranslationMax = TranslationMin;
+		XMVECTOR ScaleMin = XMLoadFloat3(&keys[0].scale);
+		XMVECTOR ScaleMax = ScaleMin;
+
+		for (const KeyFrame& key : keys)
+		{
+			TranslationMin = XMVectorMin(TranslationMin, XMLoadFloat3(&key.translation));
+			TranslationMax = XMVectorMax(TranslationMax, XMLoadFloat3(&key.translation));
+			ScaleMin = XMVectorMin(ScaleMin, XMLoadFloat3(&key.scale));
+			ScaleMax = XMVectorMax(ScaleMax, XMLoadFloat3(&key.scale));
+		}
+
+		BoneRange& range = mRanges[b];
+
+		XMStoreFloat3(&range.TranslationMin, TranslationMin);
+		XMStoreFloat3(&range.TranslationExtent, XMVectorSubtract(TranslationMax, TranslationMin));
+		XMStoreFloat3(&range.ScaleMin, ScaleMin);
+		XMStoreFloat3(&range.ScaleExtent, XMVectorSubtract(ScaleMax, ScaleMin));
+
+		std::vector<PackedKey> packed(keys.size());
+		std::vector<KeyFrame> decoded(keys.size());
+
+		for (size_t k = 0; k < keys.size(); ++k)
+		{
+			packed[k] = encode(keys[k], range);
+			decoded[k] = decode(packed[k], range);
+		}
+
+		// greedily: from every kept key frame, the furthest one that the two of them, as decoded, reproduce every key
+		// frame in between from within the budget
+		size_t kept = 0;
+		mKeys.push_back(packed[0]);
+
+		while (kept + 1 < keys.size())
+		{
+			size_t next = kept + 1;
+
+			while (next + 1 < keys.size())
+			{
+				const size_t candidate = next + 1;
+				bool fits = true;
+
+				for (size_t k = kept + 1; k < candidate && fits; ++k)
+				{
+					fits = JointError(blend(decoded[kept], decoded[candidate], keys[k].time), keys[k], reach[b]) <= budget;
+				}
+
+				if (!fits)
+				{
+					break;
+				}
+
+				next = candidate;
+			}
+
+			mKeys.push_back(packed[next]);
+			kept = next;
+		}
+	}
+
+	mFirstKeys[bones] = static_cast<UINT>(mKeys.size());
+}
+
+CompressedClip::PackedKey CompressedClip::encode(const KeyFrame& key, const BoneRange& range) const
+{
+	PackedKey packed;
+
+	packed.time = EncodeUnorm16(key.time, mStartTime, mDuration);
+
+	const float* translation = &key.translation.x;
+	const float* scale = &key.scale.x;
+
+	for (int c = 0; c < 3; ++c)
+	{
+		packed.translation[c] = EncodeUnorm16(translation[c], (&range.TranslationMin.x)[c], (&range.TranslationExtent.x)[c]);
+		packed.scale[c] = EncodeUnorm16(scale[c], (&range.ScaleMin.x)[c], (&range.ScaleExtent.x)[c]);
+	}
+
+	EncodeRotation(key.rotation, packed.rotation);
+
+	return packed;
+}
+
+KeyFrame CompressedClip::decode(const PackedKey& packed, const BoneRange& range) const
+{
+	KeyFrame key;
+
+	key.time = DecodeUnorm16(packed.time, mStartTime, mDuration);
+
+	float* translation = &key.translation.x;
+	float* scale = &key.scale.x;
+
+	for (int c = 0; c < 3; ++c)
+	{
+		translation[c] = DecodeUnorm16(packed.translation[c], (&range.TranslationMin.x)[c], (&range.TranslationExtent.x)[c]);
+		scale[c] = DecodeUnorm16(packed.scale[c], (&range.ScaleMin.x)[c], (&range.ScaleExtent.x)[c]);
+	}
+
+	key.rotation = DecodeRotation(packed.rotation);
+
+	return key;
+}
+
+UINT CompressedClip::FindSegment(const PackedKey* keys, UINT count, const float time, const UINT cursor) const
+{
+	const auto KeyTime = [this](const PackedKey& key) { return DecodeUnorm16(key.time, mStartTime, mDuration); };
+
+	for (UINT i = cursor; i < cursor + 2 && i + 1 < count; ++i)
+	{
+		if (KeyTime(keys[i]) < time && time <= KeyTime(keys[i + 1]))
+		{
+			return i;
+		}
+	}
+
+	const PackedKey* next = std::lower_bound(keys + 1, keys + count - 1, time,
+											 [&](const PackedKey& key, float t) { return KeyTime(key) < t; });
+
+	return static_cast<UINT>(next - keys) - 1;
+}
+
+float CompressedClip::GetClipStartTime() const
+{
+	return mStartTime;
+}
+
+float CompressedClip::GetClipEndTime() const
+{
+	return mStartTime + mDuration;
+}
+
+size_t CompressedClip::GetSourceKeyCount() const
+{
+	return mSourceKeyCount;
+}
+
+size_t CompressedClip::GetKeyCount() const
+{
+	return mKeys.size();
+}
+
+size_t CompressedClip::GetSourceBytes() const
+{
+	return mSourceKeyCount * sizeof(KeyFrame) + mRanges.size() * sizeof(BoneAnimation) + sizeof(AnimationClip);
+}
+
+size_t CompressedClip::GetCompressedBytes() const
+{
+	return mKeys.size() * sizeof(PackedKey) + mRanges.size() * sizeof(BoneRange) + mFirstKeys.size() * sizeof(UINT) + sizeof(CompressedClip);
+}
+
+void CompressedClip::interpolate(const float time, std::vector<XMFLOAT4X4>& transforms, std::vector<UINT>& cursors) const
+{
+	const UINT bones = static_cast<UINT>(mRanges.size());
+
+	if (cursors.size() != bones)
+	{
+		cursors.assign(bones, 0);
+	}
+
+	for (UINT b = 0; b < bones; ++b)
+	{
+		const PackedKey* keys = mKeys.data() + mFirstKeys[b];
+		const UINT count = mFirstKeys[b + 1] - mFirstKeys[b];
+
+		if (count == 0)
+		{
+			XMStoreFloat4x4(&transforms[b], XMMatrixIdentity());
+			continue;
+		}
+
+		const BoneRange& range = mRanges[b];
+
+		if (time <= DecodeUnorm16(keys[0].time, mStartTime, mDuration))
+		{
+			StoreKeyFrame(decode(keys[0], range), transforms[b]);
+			cursors[b] = 0;
+		}
+		else if (time >= DecodeUnorm16(keys[count - 1].time, mStartTime, mDuration))
+		{
+			StoreKeyFrame(decode(keys[count - 1], range), transforms[b]);
+		}
+		else
+		{
+			cursors[b] = FindSegment(keys, count, time, cursors[b]);
+			StoreKeyFrame(blend(decode(keys[cursors[b]], range), decode(keys[cursors[b] + 1], range), time), transforms[b]);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SkinnedData.h"
+
+#include <cstdint>
+
+// an AnimationClip stored small: the key frames that interpolating their neighbours reproduces closely enough are
+// dropped, and the rest are quantized to 20 bytes each instead of the 44 of a KeyFrame. times are 16 bits of the clip's
+// length, translations and scales 16 bits per component of the range the bone covers in the clip, and rotations
+// smallest three, 15 bits for each of the three smallest components and 2 for which one was left out, in 48 bits.
+//
+// the error is bounded on the joint positions of the bind pose: every bone gets an equal share of the tolerance for
+// the longest chain in the skeleton, and a key frame is only dropped when, with the kept ones quantized, every dropped
+// one is reproduced within that share, its rotation and scale errors weighted by how far the bone reaches to its
+// furthest descendant joint. the quantization alone moves the joints a little (under 0.01 units on the soldier), and a
+// tolerance below that keeps every key frame but cannot get under it
+class CompressedClip
+{
+	struct PackedKey
+	{
+		uint16_t time;
+		uint16_t translation[3];
+		uint16_t scale[3];
+		uint16_t rotation[3];
+	};
+
+	// what the 16-bit translations and scales of a bone are fractions of
+	struct BoneRange
+	{
+		XMFLOAT3 TranslationMin;
+		XMFLOAT3 TranslationExtent;
+		XMFLOAT3 ScaleMin;
+		XMFLOAT3 ScaleExtent;
+	};
+
+	float mStartTime = 0.0f;
+	float mDuration = 0.0f;
+
+	std::vector<BoneRange> mRanges;
+	// the key frames of bone b are mKeys[mFirstKeys[b], mFirstKeys[b + 1])
+	std::vector<UINT> mFirstKeys;
+	std::vector<PackedKey> mKeys;
+
+	size_t mSourceKeyCount = 0;
+
+	PackedKey encode(const KeyFrame& key, const BoneRange& range) const;
+	KeyFrame decode(const PackedKey& key, const BoneRange& range) const;
+
+	// the segment of time among the count key frames at keys, as BoneAnimation::FindSegment finds it
+	UINT FindSegment(const PackedKey* keys, UINT count, const float time, const UINT cursor) const;
+
+public:
+	// tolerance is the largest joint position error allowed, in the units of the model
+	CompressedClip(const AnimationClip& clip, const SkinnedData& skinned, const float tolerance);
+
+	float GetClipStartTime() const;
+	float GetClipEndTime() const;
+
+	size_t GetSourceKeyCount() const;
+	size_t GetKeyCount() const;
+	// what the clip takes as AnimationClip key frames and compressed
+	size_t GetSourceBytes() const;
+	size_t GetCompressedBytes() const;
+
+	// the to-parent transform of every bone at time, decompressing the two key frames around it; cursors work as
+	// for AnimationClip::interpolate
+	void interpolate(const float time, std::vector<XMFLOAT4X4>& transforms, std::vector<UINT>& cursors) const;
+};
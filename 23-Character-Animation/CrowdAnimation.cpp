@@ -0,0 +1,158 @@
+#include "CrowdAnimation.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+	void Run(ThreadPool* pool, int count, const std::function<void(int)>& task)
+	{
+		if (pool != nullptr)
+		{
+			pool->ParallelFor(count, task);
+			return;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+	}
+
+	// a few chunks per thread so uneven ones even out, but none so small that the split costs more than it saves
+	int ChunkCountFor(ThreadPool* pool, size_t count)
+	{
+		return static_cast<int>(std::max<size_t>(1, std::min<size_t>(pool != nullptr ? 4 * pool->GetThreadCount() : 1, count / 16)));
+	}
+
+	// time moved back into [start, end) of a looping clip, keeping how far past the end it went
+	float Loop(float time, float start, float end)
+	{
+		const float length = end - start;
+
+		if (length <= 0.0f)
+		{
+			return start;
+		}
+
+		if (time >= start && time < end)
+		{
+			return time;
+		}
+
+		const float wrapped = std::fmod(time - start, length);
+
+		return start + (wrapped < 0.0f ? wrapped + length : wrapped);
+	}
+}
+
+CrowdAnimation::CrowdAnimation(const SkinnedData& skinned) :
+	mSkinned(&skinned)
+{
+}
+
+const CompiledClip* CrowdAnimation::GetCompiledClip(const std::string& name)
+{
+	const auto compiled = mClips.find(name);
+
+	if (compiled != mClips.end())
+	{
+		return compiled->second.get();
+	}
+
+	const AnimationClip* clip = mSkinned->FindClip(name);
+
+	if (clip == nullptr)
+	{
+		return nullptr;
+	}
+
+	return mClips.emplace(name, std::make_unique<CompiledClip>(*clip, mSkinned->GetBoneCount())).first->second.get();
+}
+
+UINT CrowdAnimation::add(const std::string& clip, const float time, const float speed)
+{
+	const CompiledClip* compiled = GetCompiledClip(clip);
+
+	if (compiled == nullptr)
+	{
+		assert(!"CrowdAnimation::add: the model has no clip with that name");
+		return kNoInstance;
+	}
+
+	Instance& instance = mInstances.emplace_back();
+	instance.clip = compiled;
+	instance.time = Loop(time, compiled->GetClipStartTime(), compiled->GetClipEndTime());
+	instance.speed = speed;
+
+	return static_cast<UINT>(mInstances.size() - 1);
+}
+
+bool CrowdAnimation::SetClip(const UINT instance, const std::string& clip, const float time)
+{
+	const CompiledClip* compiled = GetCompiledClip(clip);
+
+	if (compiled == nullptr)
+	{
+		assert(!"CrowdAnimation::SetClip: the model has no clip with that name");
+		return false;
+	}
+
+	Instance& state = mInstances[instance];
+
+	state.clip = compiled;
+	state.time = Loop(time, compiled->GetClipStartTime(), compiled->GetClipEndTime());
+
+	return true;
+}
+
+UINT CrowdAnimation::GetInstanceCount() const
+{
+	return static_cast<UINT>(mInstances.size());
+}
+
+UINT CrowdAnimation::GetBoneCount() const
+{
+	return mSkinned->GetBoneCount();
+}
+
+size_t CrowdAnimation::GetPaletteSize() const
+{
+	return mInstances.size() * mSkinned->GetBoneCount();
+}
+
+size_t CrowdAnimation::GetPaletteOffset(const UINT instance) const
+{
+	return static_cast<size_t>(instance) * mSkinned->GetBoneCount();
+}
+
+void CrowdAnimation::update(const float dt, XMFLOAT4X4* palette, ThreadPool* pool)
+{
+	const size_t count = mInstances.size();
+	const UINT bones = mSkinned->GetBoneCount();
+
+	const int chunks = ChunkCountFor(pool, count);
+
+	if (mScratch.size() < static_cast<size_t>(chunks))
+	{
+		mScratch.resize(chunks);
+	}
+
+	Run(pool, chunks, [&](int c)
+	{
+		const size_t first = count * c / chunks;
+		const size_t last = count * (c + 1) / chunks;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			Instance& instance = mInstances[i];
+
+			instance.time = Loop(instance.time + dt * instance.speed, instance.clip->GetClipStartTime(), instance.clip->GetClipEndTime());
+
+			mSkinned->GetFinalTransforms(*instance.clip, instance.time, palette + i * bones, mScratch[c]);
+		}
+	});
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CompiledClip.h"
+#include "SkinnedData.h"
+
+#include <memory>
+
+class ThreadPool;
+
+// plays many instances of one skinned model, each with its own clip, time and speed, and writes their bone palettes
+// (the final transforms, as the shaders read them) one after the other into a single buffer: the bones of instance i
+// start at GetPaletteOffset(i). a clip is compiled (see CompiledClip) the first time an instance plays it and shared
+// by every instance playing it. update() splits the instances into chunks, one task per chunk when a thread pool is
+// given; an instance only touches its own time and its own range of the palette, so the result does not depend on
+// the pool
+class CrowdAnimation
+{
+	struct Instance
+	{
+		const CompiledClip* clip = nullptr;
+		float time = 0.0f;
+		float speed = 1.0f;
+	};
+
+	const SkinnedData* mSkinned = nullptr;
+
+	std::unordered_map<std::string, std::unique_ptr<CompiledClip>> mClips;
+	std::vector<Instance> mInstances;
+
+	// one per chunk of update(), grown once to the bone count
+	std::vector<SkinningScratch> mScratch;
+
+	const CompiledClip* GetCompiledClip(const std::string& name);
+
+public:
+	explicit CrowdAnimation(const SkinnedData& skinned);
+	CrowdAnimation(const CrowdAnimation& rhs) = delete;
+	CrowdAnimation& operator=(const CrowdAnimation& rhs) = delete;
+
+	// what add() returns for a clip the model does not have
+	static constexpr UINT kNoInstance = ~0u;
+
+	// a new instance playing clip from time, speed times as fast as the clip was authored; returns its index, or
+	// kNoInstance, adding nothing, when the model has no clip called that
+	UINT add(const std::string& clip, const float time = 0.0f, const float speed = 1.0f);
+
+	// makes instance play clip from time; false, leaving the instance as it was, when the model has no clip called that
+	bool SetClip(const UINT instance, const std::string& clip, const float time = 0.0f);
+
+	UINT GetInstanceCount() const;
+	UINT GetBoneCount() const;
+
+	// the matrices update() writes, GetBoneCount() per instance
+	size_t GetPaletteSize() const;
+	size_t GetPaletteOffset(const UINT instance) const;
+
+	// advances every instance by dt times its speed, looping its clip, and writes the palettes of all of them to
+	// palette, which holds GetPaletteSize() matrices. palette may be a mapped upload buffer: it is only written to,
+	// every matrix once, in order within an instance
+	void update(const float dt, XMFLOAT4X4* palette, ThreadPool* pool = nullptr);
+};
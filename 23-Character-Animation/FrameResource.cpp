@@ -1,9 +1,11 @@
 #include "FrameResource.h"
 
+#include <algorithm>
+
 FrameResource::FrameResource(ID3D12Device* device,
 							 const UINT MainPassCount,
 							 const UINT ObjectCount,
-							 const UINT SkinnedCount,
+							 const size_t BonePaletteSize,
 							 const UINT MaterialCount)
 {
 	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -12,7 +14,7 @@ FrameResource::FrameResource(ID3D12Device* device,
 	MainPassCB = std::make_unique<UploadBuffer<MainPassConstants>>(device, MainPassCount, true);
 	MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, MaterialCount, false);
 	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, ObjectCount, true);
-	SkinnedCB = std::make_unique<UploadBuffer<SkinnedConstants>>(device, SkinnedCount, true);
+	BonePalette = std::make_unique<UploadBuffer<XMFLOAT4X4>>(device, std::max<UINT>(1, static_cast<UINT>(BonePaletteSize)), false);
 	AmbientOcclusionCB = std::make_unique<UploadBuffer<AmbientOcclusionConstants>>(device, 1, true);
 }
 
@@ -11,12 +11,9 @@ struct ObjectConstants
 	XMFLOAT4X4 world = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexCoordTransform = MathHelper::Identity4x4();
 	UINT MaterialIndex = -1;
-	XMFLOAT3 padding;
-};
-
-struct SkinnedConstants
-{
-	XMFLOAT4X4 BoneTransform[96];
+	// skinned objects only, the index of their first bone in the bone palette
+	UINT BonePaletteOffset = 0;
+	XMFLOAT2 padding;
 };
 
 struct MainPassConstants
@@ -98,7 +95,7 @@ struct SkinnedVertex
 	XMFLOAT3 position;
 	XMFLOAT3 normal;
 	XMFLOAT2 TexCoord;
-	XMFLOAT3 tangent;
+	XMFLOAT4 tangent; // w is the handedness, -1 where the texture is mirrored
 	XMFLOAT3 BoneWeights;
 	BYTE BoneIndices[4];
 };
@@ -108,7 +105,7 @@ struct FrameResource
 	FrameResource(ID3D12Device* device,
 				  const UINT MainPassCount,
 				  const UINT ObjectCount,
-				  const UINT SkinnedCount,
+				  const size_t BonePaletteSize,
 				  const UINT MaterialCount);
 	~FrameResource();
 
@@ -117,7 +114,8 @@ struct FrameResource
 	std::unique_ptr<UploadBuffer<MainPassConstants>> MainPassCB = nullptr;
 	std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
 	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
-	std::unique_ptr<UploadBuffer<SkinnedConstants>> SkinnedCB = nullptr;
+	// the bones of all skinned instances, one after the other (see CrowdAnimation)
+	std::unique_ptr<UploadBuffer<XMFLOAT4X4>> BonePalette = nullptr;
 	std::unique_ptr<UploadBuffer<AmbientOcclusionConstants>> AmbientOcclusionCB = nullptr;
 
 	UINT64 fence = 0;
@@ -1,41 +1,632 @@
 #include "LoadM3D.h"
-#include <fstream>
+#include "MappedFile.h"
+#include "TextScanner.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
  
 using namespace DirectX;
 
+namespace
+{
+	void Run(ThreadPool* pool, int count, const std::function<void(int)>& task)
+	{
+		if (pool != nullptr)
+		{
+			pool->ParallelFor(count, task);
+			return;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+	}
+
+	// the counts of the file header and the text of every "*****Name*****" section after it
+	struct M3DFile
+	{
+		UINT numMaterials = 0;
+		UINT numVertices = 0;
+		UINT numTriangles = 0;
+		UINT numBones = 0;
+		UINT numAnimationClips = 0;
+
+		struct Section
+		{
+			std::string_view name;
+			const char* begin;
+			const char* end;
+		};
+
+		std::vector<Section> sections;
+
+		const Section* find(std::string_view name) const
+		{
+			for (const Section& section : sections)
+			{
+				if (section.name == name)
+				{
+					return &section;
+				}
+			}
+
+			return nullptr;
+		}
+	};
+
+	// the header counts, then one pass that only stops at the '*' lines, which appear nowhere else, to find where
+	// each section starts, so the big ones can be cut into pieces without parsing what comes before them
+	bool ScanFile(const MappedFile& file, M3DFile& m3d)
+	{
+		TextScanner header(file.begin(), file.end());
+
+		header.skip(); // file header text
+		header.skip().read(m3d.numMaterials);
+		header.skip().read(m3d.numVertices);
+		header.skip().read(m3d.numTriangles);
+		header.skip().read(m3d.numBones);
+		header.skip().read(m3d.numAnimationClips);
+
+		if (header.failed())
+		{
+			return false;
+		}
+
+		const char* p = header.position();
+
+		while ((p = static_cast<const char*>(std::memchr(p, '*', file.end() - p))) != nullptr)
+		{
+			const char* end = TextScanner::SkipToken(p, file.end());
+
+			std::string_view name(p, end - p);
+			name.remove_prefix(std::min(name.find_first_not_of('*'), name.size()));
+			name.remove_suffix(name.size() - std::min(name.find_last_not_of('*') + 1, name.size()));
+
+			if (!m3d.sections.empty())
+			{
+				m3d.sections.back().end = p;
+			}
+
+			m3d.sections.push_back({ name, end, file.end() });
+			p = end;
+		}
+
+		return m3d.find("Materials") != nullptr && m3d.find("SubsetTable") != nullptr &&
+			   m3d.find("Vertices") != nullptr && m3d.find("Triangles") != nullptr;
+	}
+
+	bool ReadMaterials(const M3DFile& m3d, std::vector<M3DLoader::M3DMaterial>& mats)
+	{
+		const M3DFile::Section* section = m3d.find("Materials");
+		TextScanner scanner(section->begin, section->end);
+
+		mats.resize(m3d.numMaterials);
+
+		for (M3DLoader::M3DMaterial& mat : mats)
+		{
+			int AlphaClip = 0;
+
+			mat.Name = scanner.skip().token();
+			scanner.skip().read(mat.DiffuseAlbedo.x).read(mat.DiffuseAlbedo.y).read(mat.DiffuseAlbedo.z);
+			scanner.skip().read(mat.FresnelR0.x).read(mat.FresnelR0.y).read(mat.FresnelR0.z);
+			scanner.skip().read(mat.Roughness);
+			scanner.skip().read(AlphaClip);
+			mat.MaterialTypeName = scanner.skip().token();
+			mat.DiffuseMapName = scanner.skip().token();
+			mat.NormalMapName = scanner.skip().token();
+
+			mat.AlphaClip = AlphaClip != 0;
+		}
+
+		return !scanner.failed();
+	}
+
+	// one subset per material
+	bool ReadSubsetTable(const M3DFile& m3d, std::vector<M3DLoader::Subset>& subsets)
+	{
+		const M3DFile::Section* section = m3d.find("SubsetTable");
+		TextScanner scanner(section->begin, section->end);
+
+		subsets.resize(m3d.numMaterials);
+
+		for (M3DLoader::Subset& subset : subsets)
+		{
+			scanner.skip().read(subset.Id);
+			scanner.skip().read(subset.VertexStart);
+			scanner.skip().read(subset.VertexCount);
+			scanner.skip().read(subset.FaceStart);
+			scanner.skip().read(subset.FaceCount);
+		}
+
+		return !scanner.failed();
+	}
+
+	void ReadVertex(TextScanner& scanner, M3DLoader::Vertex& vertex)
+	{
+		scanner.skip().read(vertex.Pos.x).read(vertex.Pos.y).read(vertex.Pos.z);
+		scanner.skip().read(vertex.TangentU.x).read(vertex.TangentU.y).read(vertex.TangentU.z).read(vertex.TangentU.w);
+		scanner.skip().read(vertex.Normal.x).read(vertex.Normal.y).read(vertex.Normal.z);
+		scanner.skip().read(vertex.TexC.x).read(vertex.TexC.y);
+	}
+
+	// the fourth blend weight is 1 minus the other three
+	void ReadVertex(TextScanner& scanner, M3DLoader::SkinnedVertex& vertex)
+	{
+		float weights[4];
+		int BoneIndices[4];
+
+		scanner.skip().read(vertex.Pos.x).read(vertex.Pos.y).read(vertex.Pos.z);
+		scanner.skip().read(vertex.TangentU.x).read(vertex.TangentU.y).read(vertex.TangentU.z).read(vertex.TangentU.w);
+		scanner.skip().read(vertex.Normal.x).read(vertex.Normal.y).read(vertex.Normal.z);
+		scanner.skip().read(vertex.TexC.x).read(vertex.TexC.y);
+		scanner.skip().read(weights[0]).read(weights[1]).read(weights[2]).read(weights[3]);
+		scanner.skip().read(BoneIndices[0]).read(BoneIndices[1]).read(BoneIndices[2]).read(BoneIndices[3]);
+
+		vertex.BoneWeights = XMFLOAT3(weights[0], weights[1], weights[2]);
+
+		for (int b = 0; b < 4; ++b)
+		{
+			vertex.BoneIndices[b] = static_cast<BYTE>(BoneIndices[b]);
+		}
+	}
+
+	void ReadKeyFrame(TextScanner& scanner, KeyFrame& key)
+	{
+		scanner.skip().read(key.time);
+		scanner.skip().read(key.translation.x).read(key.translation.y).read(key.translation.z);
+		scanner.skip().read(key.scale.x).read(key.scale.y).read(key.scale.z);
+		scanner.skip().read(key.rotation.x).read(key.rotation.y).read(key.rotation.z).read(key.rotation.w);
+	}
+
+	// [begin, end) cut into count pieces at the starts of records, next(p) being the first record start at or after p
+	template<typename Next>
+	std::vector<const char*> Cut(const char* begin, const char* end, int count, Next&& next)
+	{
+		std::vector<const char*> cuts(count + 1, end);
+		cuts[0] = begin;
+
+		for (int c = 1; c < count; ++c)
+		{
+			cuts[c] = next(std::max(cuts[c - 1], begin + (end - begin) * c / count));
+		}
+
+		return cuts;
+	}
+
+	// the text of one bone's key frames, between its braces
+	struct Track
+	{
+		BoneAnimation* animation;
+		UINT count;
+		const char* begin;
+		const char* end;
+	};
+
+	// finds the braces of every bone of every clip, so their key frames can be parsed independently
+	bool ScanAnimationClips(const M3DFile& m3d, std::vector<std::string>& names, std::vector<AnimationClip>& clips, std::vector<Track>& tracks)
+	{
+		const M3DFile::Section* section = m3d.find("AnimationClips");
+
+		if (section == nullptr)
+		{
+			return m3d.numAnimationClips == 0;
+		}
+
+		TextScanner scanner(section->begin, section->end);
+
+		names.resize(m3d.numAnimationClips);
+		clips.resize(m3d.numAnimationClips);
+
+		for (UINT c = 0; c < m3d.numAnimationClips; ++c)
+		{
+			names[c] = scanner.skip().token();
+
+			if (scanner.token() != "{")
+			{
+				return false;
+			}
+
+			clips[c].BoneAnimations.resize(m3d.numBones);
+
+			for (BoneAnimation& animation : clips[c].BoneAnimations)
+			{
+				Track track = { &animation, 0, nullptr, nullptr };
+
+				if (scanner.skip(2).read(track.count).token() != "{")
+				{
+					return false;
+				}
+
+				track.begin = scanner.position();
+				track.end = static_cast<const char*>(std::memchr(track.begin, '}', section->end - track.begin));
+
+				if (track.end == nullptr)
+				{
+					return false;
+				}
+
+				tracks.push_back(track);
+				scanner.seek(track.end + 1);
+			}
+
+			if (scanner.token() != "}")
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// the vertices, the triangles and the key frames of every track, all of them parsed in one parallel pass: the
+	// vertex and triangle sections are cut into a few pieces per thread, and each track is a task of its own
+	template<typename VertexType>
+	bool ReadGeometry(const M3DFile& m3d, ThreadPool* pool, const std::vector<Track>& tracks,
+					  std::vector<VertexType>& vertices, std::vector<USHORT>& indices)
+	{
+		const M3DFile::Section* VertexSection = m3d.find("Vertices");
+		const M3DFile::Section* TriangleSection = m3d.find("Triangles");
+
+		// a few pieces per thread so uneven ones even out, but none so small that the split costs more than it saves
+		const auto PieceCount = [pool](const M3DFile::Section* section)
+		{
+			return std::max(1, std::min(pool != nullptr ? 4 * pool->GetThreadCount() : 1, static_cast<int>((section->end - section->begin) / (64 * 1024))));
+		};
+
+		const int VertexPieces = PieceCount(VertexSection);
+		const int TrianglePieces = PieceCount(TriangleSection);
+
+		const std::vector<const char*> VertexCuts = Cut(VertexSection->begin, VertexSection->end, VertexPieces, [end = VertexSection->end](const char* p)
+		{
+			const std::string_view rest(p, end - p);
+			const size_t next = rest.find("Position:");
+
+			return next != std::string_view::npos ? p + next : end;
+		});
+
+		const std::vector<const char*> TriangleCuts = Cut(TriangleSection->begin, TriangleSection->end, TrianglePieces, [end = TriangleSection->end](const char* p)
+		{
+			return TextScanner::SkipToken(p, end);
+		});
+
+		std::vector<std::vector<VertexType>> VertexChunks(VertexPieces);
+		std::vector<std::vector<USHORT>> TriangleChunks(TrianglePieces);
+
+		const int TaskCount = VertexPieces + TrianglePieces + static_cast<int>(tracks.size());
+		std::vector<char> parsed(TaskCount, 0);
+
+		Run(pool, TaskCount, [&](int task)
+		{
+			if (task < VertexPieces)
+			{
+				TextScanner scanner(VertexCuts[task], VertexCuts[task + 1]);
+				std::vector<VertexType>& chunk = VertexChunks[task];
+
+				while (scanner.more() && !scanner.failed())
+				{
+					ReadVertex(scanner, chunk.emplace_back());
+				}
+
+				parsed[task] = !scanner.failed();
+			}
+			else if (task < VertexPieces + TrianglePieces)
+			{
+				const int piece = task - VertexPieces;
+
+				TextScanner scanner(TriangleCuts[piece], TriangleCuts[piece + 1]);
+				std::vector<USHORT>& chunk = TriangleChunks[piece];
+
+				// about one index per 6 characters
+				chunk.reserve((TriangleCuts[piece + 1] - TriangleCuts[piece]) / 6 + 1);
+
+				while (scanner.more() && !scanner.failed())
+				{
+					scanner.read(chunk.emplace_back());
+				}
+
+				parsed[task] = !scanner.failed();
+			}
+			else
+			{
+				const Track& track = tracks[task - VertexPieces - TrianglePieces];
+				TextScanner scanner(track.begin, track.end);
+
+				track.animation->KeyFrames.resize(track.count);
+
+				for (KeyFrame& key : track.animation->KeyFrames)
+				{
+					ReadKeyFrame(scanner, key);
+				}
+
+				parsed[task] = !scanner.failed() && !scanner.more();
+			}
+		});
+
+		if (std::find(parsed.begin(), parsed.end(), 0) != parsed.end())
+		{
+			return false;
+		}
+
+		vertices.clear();
+		indices.clear();
+
+		vertices.reserve(m3d.numVertices);
+		indices.reserve(3 * static_cast<size_t>(m3d.numTriangles));
+
+		for (const std::vector<VertexType>& chunk : VertexChunks)
+		{
+			vertices.insert(vertices.end(), chunk.begin(), chunk.end());
+		}
+
+		for (const std::vector<USHORT>& chunk : TriangleChunks)
+		{
+			indices.insert(indices.end(), chunk.begin(), chunk.end());
+		}
+
+		return vertices.size() == m3d.numVertices && indices.size() == 3 * static_cast<size_t>(m3d.numTriangles);
+	}
+
+	// changes whenever LoadM3d would read something else from the same text
+	constexpr std::string_view kCacheVariant = "M3DLoader 1/";
+
+	void WriteSkinnedModel(MeshCache::Writer& writer,
+						   std::span<const M3DLoader::SkinnedVertex> vertices,
+						   std::span<const USHORT> indices,
+						   bool WideIndices,
+						   const std::vector<M3DLoader::Subset>& subsets,
+						   const std::vector<M3DLoader::M3DMaterial>& mats,
+						   const SkinnedData& skinInfo)
+	{
+		writer.add(MeshCache::VerticesId, vertices);
+
+		if (WideIndices)
+		{
+			const std::vector<uint32_t> WideCopy(indices.begin(), indices.end());
+			writer.add(MeshCache::IndicesId, std::span<const uint32_t>(WideCopy));
+		}
+		else
+		{
+			writer.add(MeshCache::IndicesId, indices);
+		}
+
+		std::vector<MeshCache::Subset> CachedSubsets;
+
+		for (const M3DLoader::Subset& subset : subsets)
+		{
+			CachedSubsets.push_back({ subset.Id, subset.VertexStart, subset.VertexCount, subset.FaceStart, subset.FaceCount });
+		}
+
+		writer.add(MeshCache::SubsetsId, std::span<const MeshCache::Subset>(CachedSubsets));
+
+		std::vector<MeshCache::Material> CachedMaterials;
+
+		for (const M3DLoader::M3DMaterial& material : mats)
+		{
+			CachedMaterials.push_back({ writer.AddString(material.Name),
+										writer.AddString(material.MaterialTypeName),
+										writer.AddString(material.DiffuseMapName),
+										writer.AddString(material.NormalMapName),
+										material.DiffuseAlbedo,
+										material.FresnelR0,
+										material.Roughness,
+										material.AlphaClip ? 1u : 0u });
+		}
+
+		writer.add(MeshCache::MaterialsId, std::span<const MeshCache::Material>(CachedMaterials));
+
+		const std::vector<int>& parents = skinInfo.GetBoneHierarchy();
+		writer.add(MeshCache::BoneOffsetsId, std::span<const XMFLOAT4X4>(skinInfo.GetBoneOffsets()));
+		writer.add(MeshCache::BoneParentsId, std::span<const int>(parents));
+
+		// in name order, so the same model always gives the same file
+		std::vector<const std::pair<const std::string, AnimationClip>*> animations;
+
+		for (const auto& animation : skinInfo.GetAnimations())
+		{
+			animations.push_back(&animation);
+		}
+
+		std::sort(animations.begin(), animations.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+		std::vector<MeshCache::Clip> clips;
+		std::vector<MeshCache::Track> tracks;
+		std::vector<MeshCache::KeyFrame> KeyFrames;
+
+		for (const auto* animation : animations)
+		{
+			clips.push_back({ writer.AddString(animation->first), static_cast<uint32_t>(tracks.size()) });
+
+			for (const BoneAnimation& bone : animation->second.BoneAnimations)
+			{
+				const size_t first = KeyFrames.size();
+
+				tracks.push_back({ static_cast<uint32_t>(first), static_cast<uint32_t>(bone.KeyFrames.size()) });
+
+				for (const KeyFrame& key : bone.KeyFrames)
+				{
+					KeyFrames.push_back({ key.time, key.translation, key.scale, key.rotation });
+				}
+
+				// interpolation looks keys up by time, so the file guarantees the order and no reader has to sort
+				std::stable_sort(KeyFrames.begin() + first, KeyFrames.end(), [](const MeshCache::KeyFrame& a, const MeshCache::KeyFrame& b) { return a.time < b.time; });
+			}
+		}
+
+		writer.add(MeshCache::ClipsId, std::span<const MeshCache::Clip>(clips));
+		writer.add(MeshCache::TracksId, std::span<const MeshCache::Track>(tracks));
+		writer.add(MeshCache::KeyFramesId, std::span<const MeshCache::KeyFrame>(KeyFrames));
+	}
+
+	template<typename Index>
+	bool IndicesInRange(std::span<const Index> indices, size_t VertexCount)
+	{
+		for (const Index index : indices)
+		{
+			if (index >= VertexCount)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// false when the file does not hold a whole model: every index, bone index, parent, subset, track and clip is
+	// checked against what it refers to, and there is a material for every subset, since the demo indexes with them
+	// unchecked. the buffers stay in the file, the rest is copied out with nothing to parse
+	bool ReadSkinnedModel(const MeshCache::Reader& file,
+						  std::span<const M3DLoader::SkinnedVertex>& OutVertices,
+						  std::span<const std::uint16_t>& OutIndices16,
+						  std::span<const std::uint32_t>& OutIndices32,
+						  std::vector<M3DLoader::Subset>& subsets,
+						  std::vector<M3DLoader::M3DMaterial>& mats,
+						  SkinnedData& skinInfo)
+	{
+		const std::span<const M3DLoader::SkinnedVertex> vertices = file.get<M3DLoader::SkinnedVertex>(MeshCache::VerticesId);
+		const std::span<const std::uint16_t> indices16 = file.get<std::uint16_t>(MeshCache::IndicesId);
+		const std::span<const std::uint32_t> indices32 = file.get<std::uint32_t>(MeshCache::IndicesId);
+		const std::span<const MeshCache::Subset> CachedSubsets = file.get<MeshCache::Subset>(MeshCache::SubsetsId);
+		const std::span<const MeshCache::Material> CachedMaterials = file.get<MeshCache::Material>(MeshCache::MaterialsId);
+		const std::span<const XMFLOAT4X4> offsets = file.get<XMFLOAT4X4>(MeshCache::BoneOffsetsId);
+		const std::span<const int> parents = file.get<int>(MeshCache::BoneParentsId);
+		const std::span<const MeshCache::Clip> clips = file.get<MeshCache::Clip>(MeshCache::ClipsId);
+		const std::span<const MeshCache::Track> tracks = file.get<MeshCache::Track>(MeshCache::TracksId);
+		const std::span<const MeshCache::KeyFrame> KeyFrames = file.get<MeshCache::KeyFrame>(MeshCache::KeyFramesId);
+
+		const size_t IndexCount = indices16.size() + indices32.size();
+		const size_t bones = offsets.size();
+
+		if (vertices.empty() || IndexCount == 0 || bones == 0 || parents.size() != bones || tracks.size() != clips.size() * bones)
+		{
+			return false;
+		}
+
+		if (!IndicesInRange(indices16, vertices.size()) || !IndicesInRange(indices32, vertices.size()))
+		{
+			return false;
+		}
+
+		for (const M3DLoader::SkinnedVertex& vertex : vertices)
+		{
+			if (*std::max_element(std::begin(vertex.BoneIndices), std::end(vertex.BoneIndices)) >= bones)
+			{
+				return false;
+			}
+		}
+
+		// a bone's transform to the root is built from its parent's, so parents come first
+		for (size_t i = 1; i < bones; ++i)
+		{
+			if (parents[i] < 0 || static_cast<size_t>(parents[i]) >= i)
+			{
+				return false;
+			}
+		}
+
+		// subset i is drawn with material i
+		if (CachedSubsets.size() > CachedMaterials.size())
+		{
+			return false;
+		}
+
+		for (const MeshCache::Subset& subset : CachedSubsets)
+		{
+			if (static_cast<uint64_t>(subset.VertexStart) + subset.VertexCount > vertices.size() ||
+				(static_cast<uint64_t>(subset.FaceStart) + subset.FaceCount) * 3 > IndexCount)
+			{
+				return false;
+			}
+		}
+
+		for (const MeshCache::Track& track : tracks)
+		{
+			if (track.KeyFrameCount == 0 || static_cast<uint64_t>(track.FirstKeyFrame) + track.KeyFrameCount > KeyFrames.size())
+			{
+				return false;
+			}
+		}
+
+		std::unordered_map<std::string, AnimationClip> animations;
+
+		for (const MeshCache::Clip& clip : clips)
+		{
+			if (static_cast<uint64_t>(clip.FirstTrack) + bones > tracks.size())
+			{
+				return false;
+			}
+
+			AnimationClip& animation = animations[std::string(file.GetString(clip.name))];
+			animation.BoneAnimations.resize(bones);
+
+			for (size_t b = 0; b < bones; ++b)
+			{
+				const MeshCache::Track& track = tracks[clip.FirstTrack + b];
+				std::vector<KeyFrame>& keys = animation.BoneAnimations[b].KeyFrames;
+
+				keys.resize(track.KeyFrameCount);
+
+				for (uint32_t k = 0; k < track.KeyFrameCount; ++k)
+				{
+					const MeshCache::KeyFrame& key = KeyFrames[track.FirstKeyFrame + k];
+
+					keys[k].time = key.time;
+					keys[k].translation = key.translation;
+					keys[k].scale = key.scale;
+					keys[k].rotation = key.rotation;
+				}
+			}
+		}
+
+		subsets.clear();
+
+		for (const MeshCache::Subset& subset : CachedSubsets)
+		{
+			subsets.push_back({ subset.id, subset.VertexStart, subset.VertexCount, subset.FaceStart, subset.FaceCount });
+		}
+
+		mats.clear();
+
+		for (const MeshCache::Material& material : CachedMaterials)
+		{
+			M3DLoader::M3DMaterial& mat = mats.emplace_back();
+
+			mat.Name = file.GetString(material.name);
+			mat.DiffuseAlbedo = material.DiffuseAlbedo;
+			mat.FresnelR0 = material.FresnelR0;
+			mat.Roughness = material.roughness;
+			mat.AlphaClip = material.AlphaClip != 0;
+			mat.MaterialTypeName = file.GetString(material.MaterialTypeName);
+			mat.DiffuseMapName = file.GetString(material.DiffuseMapName);
+			mat.NormalMapName = file.GetString(material.NormalMapName);
+		}
+
+		skinInfo.set(std::vector<int>(parents.begin(), parents.end()), std::vector<XMFLOAT4X4>(offsets.begin(), offsets.end()), animations);
+
+		OutVertices = vertices;
+		OutIndices16 = indices16;
+		OutIndices32 = indices32;
+
+		return true;
+	}
+}
+
 bool M3DLoader::LoadM3d(const std::string& filename, 
 						std::vector<Vertex>& vertices,
 						std::vector<USHORT>& indices,
 						std::vector<Subset>& subsets,
-						std::vector<M3DMaterial>& mats)
+						std::vector<M3DMaterial>& mats,
+						ThreadPool* pool)
 {
-	std::ifstream fin(filename);
-
-	UINT numMaterials = 0;
-	UINT numVertices  = 0;
-	UINT numTriangles = 0;
-	UINT numBones     = 0;
-	UINT numAnimationClips = 0;
+	const MappedFile file(filename);
+	M3DFile m3d;
 
-	std::string ignore;
-
-	if( fin )
+	if (file.empty() || !ScanFile(file, m3d))
 	{
-		fin >> ignore; // file header text
-		fin >> ignore >> numMaterials;
-		fin >> ignore >> numVertices;
-		fin >> ignore >> numTriangles;
-		fin >> ignore >> numBones;
-		fin >> ignore >> numAnimationClips;
- 
-		ReadMaterials(fin, numMaterials, mats);
-		ReadSubsetTable(fin, numMaterials, subsets);
-	    ReadVertices(fin, numVertices, vertices);
-	    ReadTriangles(fin, numTriangles, indices);
- 
-		return true;
-	 }
-    return false;
+		return false;
+	}
+
+	return ReadMaterials(m3d, mats) && ReadSubsetTable(m3d, subsets) && ReadGeometry(m3d, pool, {}, vertices, indices);
 }
 
 bool M3DLoader::LoadM3d(const std::string& filename, 
@@ -43,216 +634,145 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 						std::vector<USHORT>& indices,
 						std::vector<Subset>& subsets,
 						std::vector<M3DMaterial>& mats,
-						SkinnedData& skinInfo)
+						SkinnedData& skinInfo,
+						ThreadPool* pool)
 {
-    std::ifstream fin(filename);
+	const MappedFile file(filename);
+	M3DFile m3d;
 
-	UINT numMaterials = 0;
-	UINT numVertices  = 0;
-	UINT numTriangles = 0;
-	UINT numBones     = 0;
-	UINT numAnimationClips = 0;
+	if (file.empty() || !ScanFile(file, m3d))
+	{
+		return false;
+	}
 
-	std::string ignore;
+	const M3DFile::Section* OffsetSection = m3d.find("BoneOffsets");
+	const M3DFile::Section* HierarchySection = m3d.find("BoneHierarchy");
 
-	if( fin )
+	if (OffsetSection == nullptr || HierarchySection == nullptr)
 	{
-		fin >> ignore; // file header text
-		fin >> ignore >> numMaterials;
-		fin >> ignore >> numVertices;
-		fin >> ignore >> numTriangles;
-		fin >> ignore >> numBones;
-		fin >> ignore >> numAnimationClips;
- 
-		std::vector<XMFLOAT4X4> boneOffsets;
-		std::vector<int> boneIndexToParentIndex;
-		std::unordered_map<std::string, AnimationClip> animations;
+		return false;
+	}
 
-		ReadMaterials(fin, numMaterials, mats);
-		ReadSubsetTable(fin, numMaterials, subsets);
-	    ReadSkinnedVertices(fin, numVertices, vertices);
-	    ReadTriangles(fin, numTriangles, indices);
-		ReadBoneOffsets(fin, numBones, boneOffsets);
-	    ReadBoneHierarchy(fin, numBones, boneIndexToParentIndex);
-	    ReadAnimationClips(fin, numBones, numAnimationClips, animations);
- 
-		skinInfo.set(boneIndexToParentIndex, boneOffsets, animations);
+	std::vector<XMFLOAT4X4> boneOffsets(m3d.numBones);
+	std::vector<int> boneIndexToParentIndex(m3d.numBones);
 
-	    return true;
-	}
-    return false;
-}
+	TextScanner offsets(OffsetSection->begin, OffsetSection->end);
 
-void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3DMaterial>& mats)
-{
-	 std::string ignore;
-     mats.resize(numMaterials);
-
-	 std::string diffuseMapName;
-	 std::string normalMapName;
-
-     fin >> ignore; // materials header text
-	 for(UINT i = 0; i < numMaterials; ++i)
-	 {
-         fin >> ignore >> mats[i].Name;
-		 fin >> ignore >> mats[i].DiffuseAlbedo.x  >> mats[i].DiffuseAlbedo.y  >> mats[i].DiffuseAlbedo.z;
-		 fin >> ignore >> mats[i].FresnelR0.x >> mats[i].FresnelR0.y >> mats[i].FresnelR0.z;
-         fin >> ignore >> mats[i].Roughness;
-		 fin >> ignore >> mats[i].AlphaClip;
-		 fin >> ignore >> mats[i].MaterialTypeName;
-		 fin >> ignore >> mats[i].DiffuseMapName;
-		 fin >> ignore >> mats[i].NormalMapName;
+	for (XMFLOAT4X4& offset : boneOffsets)
+	{
+		offsets.skip();
+
+		for (int i = 0; i < 16; ++i)
+		{
+			offsets.read(offset.m[i / 4][i % 4]);
 		}
-}
+	}
 
-void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets)
-{
-    std::string ignore;
-	subsets.resize(numSubsets);
+	TextScanner hierarchy(HierarchySection->begin, HierarchySection->end);
 
-	fin >> ignore; // subset header text
-	for(UINT i = 0; i < numSubsets; ++i)
+	for (int& parent : boneIndexToParentIndex)
 	{
-        fin >> ignore >> subsets[i].Id;
-		fin >> ignore >> subsets[i].VertexStart;
-		fin >> ignore >> subsets[i].VertexCount;
-		fin >> ignore >> subsets[i].FaceStart;
-		fin >> ignore >> subsets[i].FaceCount;
-    }
-}
+		hierarchy.skip().read(parent);
+	}
 
-void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices)
-{
-	std::string ignore;
-    vertices.resize(numVertices);
-
-    fin >> ignore; // vertices header text
-    for(UINT i = 0; i < numVertices; ++i)
-    {
-	    fin >> ignore >> vertices[i].Pos.x      >> vertices[i].Pos.y      >> vertices[i].Pos.z;
-		fin >> ignore >> vertices[i].TangentU.x >> vertices[i].TangentU.y >> vertices[i].TangentU.z >> vertices[i].TangentU.w;
-	    fin >> ignore >> vertices[i].Normal.x   >> vertices[i].Normal.y   >> vertices[i].Normal.z;
-	    fin >> ignore >> vertices[i].TexC.x     >> vertices[i].TexC.y;
-    }
-}
+	std::vector<std::string> names;
+	std::vector<AnimationClip> clips;
+	std::vector<Track> tracks;
 
-void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
-{
-	std::string ignore;
-    vertices.resize(numVertices);
-
-    fin >> ignore; // vertices header text
-	int boneIndices[4];
-	float weights[4];
-    for(UINT i = 0; i < numVertices; ++i)
-    {
-        float blah;
-	    fin >> ignore >> vertices[i].Pos.x        >> vertices[i].Pos.y          >> vertices[i].Pos.z;
-		fin >> ignore >> vertices[i].TangentU.x   >> vertices[i].TangentU.y     >> vertices[i].TangentU.z >> blah /*vertices[i].TangentU.w*/;
-	    fin >> ignore >> vertices[i].Normal.x     >> vertices[i].Normal.y       >> vertices[i].Normal.z;
-	    fin >> ignore >> vertices[i].TexC.x       >> vertices[i].TexC.y;
-		fin >> ignore >> weights[0]     >> weights[1]     >> weights[2]     >> weights[3];
-		fin >> ignore >> boneIndices[0] >> boneIndices[1] >> boneIndices[2] >> boneIndices[3];
-
-		vertices[i].BoneWeights.x = weights[0];
-		vertices[i].BoneWeights.y = weights[1];
-		vertices[i].BoneWeights.z = weights[2];
-
-		vertices[i].BoneIndices[0] = (BYTE)boneIndices[0]; 
-		vertices[i].BoneIndices[1] = (BYTE)boneIndices[1]; 
-		vertices[i].BoneIndices[2] = (BYTE)boneIndices[2]; 
-		vertices[i].BoneIndices[3] = (BYTE)boneIndices[3]; 
-    }
+	if (offsets.failed() || hierarchy.failed() || !ReadMaterials(m3d, mats) || !ReadSubsetTable(m3d, subsets) ||
+		!ScanAnimationClips(m3d, names, clips, tracks) || !ReadGeometry(m3d, pool, tracks, vertices, indices))
+	{
+		return false;
+	}
+
+	// a later clip of the same name replaces an earlier one
+	std::unordered_map<std::string, AnimationClip> animations;
+
+	for (UINT c = 0; c < m3d.numAnimationClips; ++c)
+	{
+		animations[names[c]] = std::move(clips[c]);
+	}
+
+	skinInfo.set(boneIndexToParentIndex, boneOffsets, animations);
+
+	return true;
 }
 
-void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices)
+bool M3DLoader::SaveBinary(const std::filesystem::path& filename,
+						   std::span<const SkinnedVertex> vertices,
+						   std::span<const USHORT> indices,
+						   const std::vector<Subset>& subsets,
+						   const std::vector<M3DMaterial>& mats,
+						   const SkinnedData& skinInfo,
+						   bool WideIndices,
+						   uint64_t SourceHash)
 {
-	std::string ignore;
-    indices.resize(numTriangles*3);
-
-    fin >> ignore; // triangles header text
-    for(UINT i = 0; i < numTriangles; ++i)
-    {
-        fin >> indices[i*3+0] >> indices[i*3+1] >> indices[i*3+2];
-    }
+	MeshCache::Writer writer;
+	WriteSkinnedModel(writer, vertices, indices, WideIndices, subsets, mats, skinInfo);
+
+	return writer.write(filename, SourceHash);
 }
- 
-void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets)
+
+bool M3DLoader::LoadBinary(const std::filesystem::path& filename,
+						   BinarySkinnedModel& model,
+						   std::vector<Subset>& subsets,
+						   std::vector<M3DMaterial>& mats,
+						   SkinnedData& skinInfo)
 {
-	std::string ignore;
-    boneOffsets.resize(numBones);
-
-    fin >> ignore; // BoneOffsets header text
-    for(UINT i = 0; i < numBones; ++i)
-    {
-        fin >> ignore >> 
-            boneOffsets[i](0,0) >> boneOffsets[i](0,1) >> boneOffsets[i](0,2) >> boneOffsets[i](0,3) >>
-            boneOffsets[i](1,0) >> boneOffsets[i](1,1) >> boneOffsets[i](1,2) >> boneOffsets[i](1,3) >>
-            boneOffsets[i](2,0) >> boneOffsets[i](2,1) >> boneOffsets[i](2,2) >> boneOffsets[i](2,3) >>
-            boneOffsets[i](3,0) >> boneOffsets[i](3,1) >> boneOffsets[i](3,2) >> boneOffsets[i](3,3);
-    }
+	if (!model.file.open(filename) ||
+		!ReadSkinnedModel(model.file, model.vertices, model.indices16, model.indices32, subsets, mats, skinInfo))
+	{
+		model.file.close();
+		return false;
+	}
+
+	return true;
 }
 
-void M3DLoader::ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
+bool M3DLoader::LoadM3dCached(const std::string& filename,
+							  CachedSkinnedModel& model,
+							  std::vector<Subset>& subsets,
+							  std::vector<M3DMaterial>& mats,
+							  SkinnedData& skinInfo,
+							  std::string_view variant,
+							  const Process& process,
+							  ThreadPool* pool)
 {
-	std::string ignore;
-    boneIndexToParentIndex.resize(numBones);
+	const uint64_t SourceHash = MeshCache::HashFile(filename, std::string(kCacheVariant).append(variant));
 
-    fin >> ignore; // BoneHierarchy header text
-	for(UINT i = 0; i < numBones; ++i)
+	if (SourceHash == 0)
 	{
-	    fin >> ignore >> boneIndexToParentIndex[i];
+		return false;
 	}
-}
 
-void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, 
-								   std::unordered_map<std::string, AnimationClip>& animations)
-{
-	std::string ignore;
-    fin >> ignore; // AnimationClips header text
-    for(UINT clipIndex = 0; clipIndex < numAnimationClips; ++clipIndex)
-    {
-        std::string clipName;
-        fin >> ignore >> clipName;
-        fin >> ignore; // {
-
-		AnimationClip clip;
-		clip.BoneAnimations.resize(numBones);
-
-        for(UINT boneIndex = 0; boneIndex < numBones; ++boneIndex)
-        {
-            ReadBoneKeyframes(fin, numBones, clip.BoneAnimations[boneIndex]);
-        }
-        fin >> ignore; // }
-
-        animations[clipName] = clip;
-    }
-}
+	const std::filesystem::path CachePath = MeshCache::CachePath(filename);
 
-void M3DLoader::ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation)
-{
-	std::string ignore;
-    UINT numKeyframes = 0;
-    fin >> ignore >> ignore >> numKeyframes;
-    fin >> ignore; // {
-
-    boneAnimation.KeyFrames.resize(numKeyframes);
-    for(UINT i = 0; i < numKeyframes; ++i)
-    {
-        float t    = 0.0f;
-        XMFLOAT3 p(0.0f, 0.0f, 0.0f);
-        XMFLOAT3 s(1.0f, 1.0f, 1.0f);
-        XMFLOAT4 q(0.0f, 0.0f, 0.0f, 1.0f);
-        fin >> ignore >> t;
-        fin >> ignore >> p.x >> p.y >> p.z;
-        fin >> ignore >> s.x >> s.y >> s.z;
-        fin >> ignore >> q.x >> q.y >> q.z >> q.w;
-
-	    boneAnimation.KeyFrames[i].time         = t;
-        boneAnimation.KeyFrames[i].translation  = p;
-	    boneAnimation.KeyFrames[i].scale        = s;
-	    boneAnimation.KeyFrames[i].rotation     = q;
-    }
-
-    fin >> ignore; // }
-}
\ No newline at end of file
+	// the cache is always written with 16-bit indices, as the demo draws them
+	std::span<const std::uint32_t> WideIndices;
+
+	if (model.cache.open(CachePath, SourceHash) &&
+		ReadSkinnedModel(model.cache, model.vertices, model.indices, WideIndices, subsets, mats, skinInfo) && !model.indices.empty())
+	{
+		return true;
+	}
+
+	model.cache.close();
+
+	if (!LoadM3d(filename, model.ParsedVertices, model.ParsedIndices, subsets, mats, skinInfo, pool))
+	{
+		return false;
+	}
+
+	if (process)
+	{
+		process(model.ParsedVertices, model.ParsedIndices, subsets);
+	}
+
+	model.vertices = model.ParsedVertices;
+	model.indices = model.ParsedIndices;
+
+	// a cache that cannot be written, in a read only folder say, only costs the next load a parse
+	SaveBinary(CachePath, model.vertices, model.indices, subsets, mats, skinInfo, false, SourceHash);
+
+	return true;
+}
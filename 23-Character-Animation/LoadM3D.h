@@ -2,6 +2,13 @@
 #define LOADM3D_H
 
 #include "SkinnedData.h"
+#include "MeshCache.h"
+
+#include <functional>
+#include <span>
+#include <string_view>
+
+class ThreadPool;
 
 class M3DLoader
 {
@@ -19,7 +26,7 @@ public:
         DirectX::XMFLOAT3 Pos;
         DirectX::XMFLOAT3 Normal;
         DirectX::XMFLOAT2 TexC;
-        DirectX::XMFLOAT3 TangentU;
+        DirectX::XMFLOAT4 TangentU;
         DirectX::XMFLOAT3 BoneWeights;
         BYTE BoneIndices[4];
     };
@@ -47,28 +54,82 @@ public:
         std::string NormalMapName;
     };
 
+	// the file is memory mapped and scanned once for its sections; labels are skipped in place, numbers are read with
+	// std::from_chars, and the vertex, triangle and key frame sections are parsed in pieces, one per task when a thread
+	// pool is given. false when the file cannot be opened or does not hold what its header announces
 	bool LoadM3d(const std::string& filename, 
 		std::vector<Vertex>& vertices,
 		std::vector<USHORT>& indices,
 		std::vector<Subset>& subsets,
-		std::vector<M3DMaterial>& mats);
+		std::vector<M3DMaterial>& mats,
+		ThreadPool* pool = nullptr);
 	bool LoadM3d(const std::string& filename, 
 		std::vector<SkinnedVertex>& vertices,
 		std::vector<USHORT>& indices,
 		std::vector<Subset>& subsets,
 		std::vector<M3DMaterial>& mats,
+		SkinnedData& skinInfo,
+		ThreadPool* pool = nullptr);
+
+	// a skinned model written by SaveBinary, used in place in the mapped file
+	struct BinarySkinnedModel
+	{
+		std::span<const SkinnedVertex> vertices;
+
+		// the indices in the width the file stores them in, the other span is empty
+		std::span<const std::uint16_t> indices16;
+		std::span<const std::uint32_t> indices32;
+
+		MeshCache::Reader file;
+	};
+
+	// the binary skinned model (tools/m3dconvert writes one from an .m3d): a MeshCache container with the vertices,
+	// the indices in 16 bits or with WideIndices in 32, the subsets, the materials, the bone offsets and hierarchy,
+	// and the clips with the key frames of every bone sorted by time. SourceHash is what LoadM3dCached checks,
+	// a converted file leaves it 0
+	bool SaveBinary(const std::filesystem::path& filename,
+		std::span<const SkinnedVertex> vertices,
+		std::span<const USHORT> indices,
+		const std::vector<Subset>& subsets,
+		const std::vector<M3DMaterial>& mats,
+		const SkinnedData& skinInfo,
+		bool WideIndices = false,
+		uint64_t SourceHash = 0);
+
+	// nothing is parsed: the buffers are used in place, the rest is range checked and copied out.
+	// false when the file is missing or does not hold a whole skinned model
+	bool LoadBinary(const std::filesystem::path& filename,
+		BinarySkinnedModel& model,
+		std::vector<Subset>& subsets,
+		std::vector<M3DMaterial>& mats,
 		SkinnedData& skinInfo);
 
-private:
-	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3DMaterial>& mats);
-	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets);
-	void ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices);
-	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
-	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
-	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
-	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
-	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
-	void ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation);
+	// the buffers of a skinned model used in place in its cache file, or in the parsed vectors when the cache
+	// could not be written
+	struct CachedSkinnedModel
+	{
+		std::span<const SkinnedVertex> vertices;
+		std::span<const USHORT> indices;
+
+		MeshCache::Reader cache;
+		std::vector<SkinnedVertex> ParsedVertices;
+		std::vector<USHORT> ParsedIndices;
+	};
+
+	// turns the buffers read from the text into the ones to draw, reordering them for the GPU say
+	using Process = std::function<void(std::vector<SkinnedVertex>& vertices, std::vector<USHORT>& indices, const std::vector<Subset>& subsets)>;
+
+	// the skinned LoadM3d through a binary cache (MeshCache::CachePath of the file) holding the processed buffers,
+	// the subsets, the materials and the skeleton with its clips. the text is read and processed on the first load
+	// and whenever it changes; variant names what process does, so a cache built by another process is rebuilt
+	bool LoadM3dCached(const std::string& filename,
+		CachedSkinnedModel& model,
+		std::vector<Subset>& subsets,
+		std::vector<M3DMaterial>& mats,
+		SkinnedData& skinInfo,
+		std::string_view variant = {},
+		const Process& process = nullptr,
+		ThreadPool* pool = nullptr);
 };
 
 
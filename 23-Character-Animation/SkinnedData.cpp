@@ -1,4 +1,11 @@
 #include "SkinnedData.h"
+#include "CompiledClip.h"
+#include "CompressedClip.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
 
 float AnimationClip::GetClipStartTime() const
 {
@@ -34,6 +41,19 @@ void AnimationClip::interpolate(const float t, std::vector<XMFLOAT4X4>& transfor
 	}
 }
 
+void AnimationClip::interpolate(const float t, std::vector<XMFLOAT4X4>& transforms, std::vector<UINT>& cursors) const
+{
+	if (cursors.size() != BoneAnimations.size())
+	{
+		cursors.assign(BoneAnimations.size(), 0);
+	}
+
+	for (UINT i = 0; i < BoneAnimations.size(); ++i)
+	{
+		BoneAnimations[i].interpolate(t, transforms[i], cursors[i]);
+	}
+}
+
 UINT SkinnedData::GetBoneCount() const
 {
 	return mBoneHierarchy.size();
@@ -51,6 +71,21 @@ float SkinnedData::GetClipEndTime(const std::string& name) const
 	return clip->second.GetClipEndTime();
 }
 
+const std::vector<int>& SkinnedData::GetBoneHierarchy() const
+{
+	return mBoneHierarchy;
+}
+
+const std::vector<XMFLOAT4X4>& SkinnedData::GetBoneOffsets() const
+{
+	return mBoneOffsets;
+}
+
+const std::unordered_map<std::string, AnimationClip>& SkinnedData::GetAnimations() const
+{
+	return mAnimations;
+}
+
 void SkinnedData::set(const std::vector<int>& hierarchy,
 					  const std::vector<XMFLOAT4X4>& offsets,
 					  const std::unordered_map<std::string, AnimationClip>& animations)
@@ -60,21 +95,107 @@ void SkinnedData::set(const std::vector<int>& hierarchy,
 	mAnimations = animations;
 }
 
+const AnimationClip* SkinnedData::FindClip(const std::string& name) const
+{
+	const auto clip = mAnimations.find(name);
+	return clip != mAnimations.end() ? &clip->second : nullptr;
+}
+
 void SkinnedData::GetFinalTransforms(const std::string& name,
 									 const float time,
 									 std::vector<XMFLOAT4X4>& transforms) const
 {
-	const UINT bones = mBoneOffsets.size();
+	const AnimationClip* clip = FindClip(name);
 
-	std::vector<XMFLOAT4X4> ToParentTransforms(bones);
+	if (clip == nullptr)
+	{
+		assert(!"SkinnedData::GetFinalTransforms: no clip with that name");
+		return;
+	}
+
+	SkinningScratch scratch;
+	scratch.ToParentTransforms.resize(mBoneOffsets.size());
 
 	// interpolate all the bones of this clip at the given time position
-	const auto& clip = mAnimations.find(name);
-	clip->second.interpolate(time, ToParentTransforms);
+	clip->interpolate(time, scratch.ToParentTransforms);
+
+	ToFinalTransforms(scratch, transforms.data());
+}
+
+void SkinnedData::GetFinalTransforms(const std::string& name,
+									 const float time,
+									 std::vector<XMFLOAT4X4>& transforms,
+									 std::vector<UINT>& cursors) const
+{
+	const AnimationClip* clip = FindClip(name);
+
+	if (clip == nullptr)
+	{
+		assert(!"SkinnedData::GetFinalTransforms: no clip with that name");
+		return;
+	}
+
+	SkinningScratch scratch;
+
+	GetFinalTransforms(*clip, time, transforms, cursors, scratch);
+}
+
+void SkinnedData::GetFinalTransforms(const AnimationClip& clip,
+									 const float time,
+									 std::vector<XMFLOAT4X4>& transforms,
+									 std::vector<UINT>& cursors,
+									 SkinningScratch& scratch) const
+{
+	scratch.ToParentTransforms.resize(mBoneOffsets.size());
+
+	clip.interpolate(time, scratch.ToParentTransforms, cursors);
+
+	ToFinalTransforms(scratch, transforms.data());
+}
+
+void SkinnedData::GetFinalTransforms(const CompiledClip& clip,
+									 const float time,
+									 std::vector<XMFLOAT4X4>& transforms,
+									 SkinningScratch& scratch) const
+{
+	GetFinalTransforms(clip, time, transforms.data(), scratch);
+}
+
+void SkinnedData::GetFinalTransforms(const CompiledClip& clip,
+									 const float time,
+									 XMFLOAT4X4* transforms,
+									 SkinningScratch& scratch) const
+{
+	scratch.ToParentTransforms.resize(mBoneOffsets.size());
+
+	clip.interpolate(time, scratch.ToParentTransforms);
+
+	ToFinalTransforms(scratch, transforms);
+}
+
+void SkinnedData::GetFinalTransforms(const CompressedClip& clip,
+									 const float time,
+									 std::vector<XMFLOAT4X4>& transforms,
+									 std::vector<UINT>& cursors,
+									 SkinningScratch& scratch) const
+{
+	scratch.ToParentTransforms.resize(mBoneOffsets.size());
+
+	clip.interpolate(time, scratch.ToParentTransforms, cursors);
+
+	ToFinalTransforms(scratch, transforms.data());
+}
+
+void SkinnedData::ToFinalTransforms(SkinningScratch& scratch, XMFLOAT4X4* transforms) const
+{
+	const UINT bones = mBoneOffsets.size();
+
+	const std::vector<XMFLOAT4X4>& ToParentTransforms = scratch.ToParentTransforms;
 
 	// traverse the hierarchy and transform all the bones to the root space
 
-	std::vector<XMFLOAT4X4> ToRootTransforms(bones);
+	std::vector<XMFLOAT4X4>& ToRootTransforms = scratch.ToRootTransforms;
+	ToRootTransforms.resize(bones);
 
 	// the root bone has index 0, and it has no parent,
 	// so its toRootTransform is just its local bone transform
@@ -100,4 +221,72 @@ void SkinnedData::GetFinalTransforms(const std::string& name,
 		const XMMATRIX transform = XMMatrixMultiply(offset, ToRoot);
 		XMStoreFloat4x4(&transforms[i], XMMatrixTranspose(transform));
 	}
-}
\ No newline at end of file
+}
+
+PoseCache::PoseCache(const SkinnedData& skinned, size_t capacity, float SampleRate) :
+	mSkinned(&skinned),
+	mSampleRate(SampleRate),
+	mEntries(std::max<size_t>(capacity, 1)),
+	mPoses(mEntries.size() * skinned.GetBoneCount())
+{
+}
+
+void PoseCache::GetFinalTransforms(const AnimationClip& clip,
+								   const float time,
+								   std::vector<XMFLOAT4X4>& transforms,
+								   std::vector<UINT>& cursors)
+{
+	const UINT bones = mSkinned->GetBoneCount();
+	const long long frame = std::llround(time * mSampleRate);
+
+	// the skeleton was set() again without a clear(), and the poses were sized for the old one
+	if (mPoses.size() != mEntries.size() * bones)
+	{
+		clear();
+	}
+
+	// the clip's address and the frame number mixed into a slot
+	const size_t hash = std::hash<const AnimationClip*>()(&clip) ^ (static_cast<size_t>(frame) * 0x9E3779B97F4A7C15ull);
+	const size_t slot = hash % mEntries.size();
+
+	Entry& entry = mEntries[slot];
+	XMFLOAT4X4* pose = mPoses.data() + slot * bones;
+
+	if (entry.clip == &clip && entry.frame == frame)
+	{
+		++mHits;
+	}
+	else
+	{
+		++mMisses;
+
+		// computed at the rounded time, so it is the same pose whichever instance gets here first
+		mSkinned->GetFinalTransforms(clip, frame / mSampleRate, transforms, cursors, mScratch);
+		std::copy(transforms.begin(), transforms.begin() + bones, pose);
+
+		entry.clip = &clip;
+		entry.frame = frame;
+		return;
+	}
+
+	std::copy(pose, pose + bones, transforms.begin());
+}
+
+void PoseCache::clear()
+{
+	std::fill(mEntries.begin(), mEntries.end(), Entry());
+	mPoses.assign(mEntries.size() * mSkinned->GetBoneCount(), XMFLOAT4X4());
+
+	mHits = 0;
+	mMisses = 0;
+}
+
+size_t PoseCache::GetHitCount() const
+{
+	return mHits;
+}
+
+size_t PoseCache::GetMissCount() const
+{
+	return mMisses;
+}
@@ -10,9 +10,23 @@ struct AnimationClip
 
 	void interpolate(const float t, std::vector<XMFLOAT4X4>& transforms) const;
 
+	// the same with one cursor per bone (see BoneAnimation::FindSegment), kept between the calls of one playing instance
+	void interpolate(const float t, std::vector<XMFLOAT4X4>& transforms, std::vector<UINT>& cursors) const;
+
 	std::vector<BoneAnimation> BoneAnimations;
 };
 
+class CompiledClip;
+class CompressedClip;
+
+// the intermediate transforms of SkinnedData::GetFinalTransforms, kept by the caller so that sampling a pose every
+// frame allocates nothing once the vectors have grown to the bone count
+struct SkinningScratch
+{
+	std::vector<XMFLOAT4X4> ToParentTransforms;
+	std::vector<XMFLOAT4X4> ToRootTransforms;
+};
+
 class SkinnedData
 {
 	// gives parent index of i-th bone
@@ -20,18 +34,106 @@ class SkinnedData
 	std::vector<XMFLOAT4X4> mBoneOffsets;
 	std::unordered_map<std::string, AnimationClip> mAnimations;
 
+	// from the to-parent transforms of the bones in scratch to the final transforms
+	void ToFinalTransforms(SkinningScratch& scratch, XMFLOAT4X4* transforms) const;
+
 public:
 	UINT GetBoneCount() const;
 
 	float GetClipStartTime(const std::string& name) const;
 	float GetClipEndTime(const std::string& name) const;
 
+	const std::vector<int>& GetBoneHierarchy() const;
+	const std::vector<XMFLOAT4X4>& GetBoneOffsets() const;
+	const std::unordered_map<std::string, AnimationClip>& GetAnimations() const;
+
 	void set(const std::vector<int>& hierarchy,
 			 const std::vector<XMFLOAT4X4>& offsets,
 			 const std::unordered_map<std::string, AnimationClip>& animations);
 
-	// TODO: cache the result to improve performance
+	// the clip called name, or nullptr; the pointer stays valid until the next set(), so an instance looks its clip up
+	// once instead of hashing the name every frame
+	const AnimationClip* FindClip(const std::string& name) const;
+
+	// the by-name forms assert, and leave transforms untouched in a release build, when there is no clip called name
 	void GetFinalTransforms(const std::string& name,
 							const float time,
 							std::vector<XMFLOAT4X4>& transforms) const;
+
+	// the same for a playing instance that keeps cursors between calls, so that advancing time finds every bone's
+	// key frames without searching; cursors is sized on the first call and belongs to that instance and clip
+	void GetFinalTransforms(const std::string& name,
+							const float time,
+							std::vector<XMFLOAT4X4>& transforms,
+							std::vector<UINT>& cursors) const;
+
+	// the form to call every frame: the clip found with FindClip, and the intermediate transforms in scratch, so
+	// nothing is looked up by name and nothing is allocated after the first call
+	void GetFinalTransforms(const AnimationClip& clip,
+							const float time,
+							std::vector<XMFLOAT4X4>& transforms,
+							std::vector<UINT>& cursors,
+							SkinningScratch& scratch) const;
+
+	// the same from a clip resampled for playback (see CompiledClip), which needs no cursors
+	void GetFinalTransforms(const CompiledClip& clip,
+							const float time,
+							std::vector<XMFLOAT4X4>& transforms,
+							SkinningScratch& scratch) const;
+
+	// and writing to transforms, GetBoneCount() matrices anywhere in a larger buffer, such as the bone palette of a
+	// crowd
+	void GetFinalTransforms(const CompiledClip& clip,
+							const float time,
+							XMFLOAT4X4* transforms,
+							SkinningScratch& scratch) const;
+
+	// the same from a compressed clip (see CompressedClip), with cursors as for an AnimationClip
+	void GetFinalTransforms(const CompressedClip& clip,
+							const float time,
+							std::vector<XMFLOAT4X4>& transforms,
+							std::vector<UINT>& cursors,
+							SkinningScratch& scratch) const;
+};
+
+// the final transforms of recently sampled poses, for many instances playing the same clips: times are rounded to
+// SampleRate frames per second, so instances that reach the same frame of a clip compute it once and copy it after
+// that. the table is direct mapped and sized up front, so a lookup never allocates and a pose evicted by a colliding
+// one is only computed again. a pose is the same whether it was computed or copied. not thread safe, a thread that
+// samples poses needs a cache of its own
+class PoseCache
+{
+	struct Entry
+	{
+		const AnimationClip* clip = nullptr;
+		long long frame = 0;
+	};
+
+	const SkinnedData* mSkinned = nullptr;
+	float mSampleRate = 60.0f;
+
+	std::vector<Entry> mEntries;
+	// the poses of the entries, GetBoneCount() transforms each
+	std::vector<XMFLOAT4X4> mPoses;
+	SkinningScratch mScratch;
+
+	size_t mHits = 0;
+	size_t mMisses = 0;
+
+public:
+	PoseCache(const SkinnedData& skinned, size_t capacity = 256, float SampleRate = 60.0f);
+
+	// the final transforms of clip at time rounded to the sample rate. cursors are the instance's, as for
+	// SkinnedData::GetFinalTransforms, and only move when the pose is computed
+	void GetFinalTransforms(const AnimationClip& clip,
+							const float time,
+							std::vector<XMFLOAT4X4>& transforms,
+							std::vector<UINT>& cursors);
+
+	// forgets every pose and sizes the table for the skeleton's current bone count. a new SkinnedData::set() makes
+	// the cached poses stale, so call this after it; a lookup that finds the bone count changed does it as well
+	void clear();
+
+	size_t GetHitCount() const;
+	size_t GetMissCount() const;
 };
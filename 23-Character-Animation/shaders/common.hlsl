@@ -22,6 +22,8 @@ Texture2D gDiffuseTexture[6 + 8] : register(t3, space0);
 
 // material buffer, it contains all materials
 StructuredBuffer<MaterialData> gMaterialBuffer : register(t0, space1);
+// bone palette, the bone transforms of every skinned instance one after the other
+StructuredBuffer<float4x4> gBonePalette : register(t1, space1);
 
 SamplerState gSamplerPointWrap        : register(s0);
 SamplerState gSamplerPointClamp       : register(s1);
@@ -36,12 +38,8 @@ cbuffer ObjectCB : register(b0)
 	float4x4 gWorld;
 	float4x4 gTexCoordTransform;
 	uint gMaterialIndex;
-	float3 padding;
-};
-
-cbuffer SkinnedCB : register(b1)
-{
-    float4x4 gBoneTransforms[96];
+	uint gBonePaletteOffset;
+	float2 padding;
 };
 
 cbuffer MainPassCB : register(b2)
@@ -74,15 +72,15 @@ cbuffer MainPassCB : register(b2)
 	Light gLights[LIGHT_MAX_COUNT];
 };
 
-float3 NormalSampleToWorldSpace(const float3 NormalSample, const float3 UnitNormalW, const float3 TangentW)
+float3 NormalSampleToWorldSpace(const float3 NormalSample, const float3 UnitNormalW, const float4 TangentW)
 {
 	// uncompress from [0,1] to [-1,+1]
 	const float3 NormalT = 2.0f * NormalSample - 1.0f;
 
 	// build orthonormal basis
 	const float3 N = UnitNormalW;
-	const float3 T = normalize(TangentW - dot(TangentW, N) * N);
-	const float3 B = cross(N, T);
+	const float3 T = normalize(TangentW.xyz - dot(TangentW.xyz, N) * N);
+	const float3 B = TangentW.w * cross(N, T);
 
 	const float3x3 TBN = float3x3(T, B, N);
 
@@ -5,7 +5,7 @@ struct VertexIn
 	float3 PositionL : POSITION;
 	float3 NormalL : NORMAL;
 	float2 TexCoord : TEXCOORD;
-	float3 TangentL : TANGENT;
+	float4 TangentL : TANGENT; // w is the handedness; static layouts leave it at 1
 #ifdef SKINNED
     float3 BoneWeights : WEIGHTS;
     uint4 BoneIndices : INDICES;
@@ -17,7 +17,7 @@ struct VertexOut
 	float4 PositionH : SV_POSITION;
 	float3 PositionW : POSITION0;
 	float3 NormalW : NORMAL;
-	float3 TangentW : TANGENT;
+	float4 TangentW : TANGENT;
 	float2 TexCoord : TEXCOORD;
 	float4 ShadowPositionH : POSITION1;
 };
@@ -41,7 +41,7 @@ VertexOut VS(VertexIn vin)
 
     for(int i = 0; i < 4; ++i)
     {
-		const float4x4 BoneTransform = gBoneTransforms[vin.BoneIndices[i]];
+		const float4x4 BoneTransform = gBonePalette[gBonePaletteOffset + vin.BoneIndices[i]];
 
         PositionL += weights[i] * mul(float4(vin.PositionL, 1.0f), BoneTransform).xyz;
         NormalL += weights[i] * mul(vin.NormalL, (float3x3)(BoneTransform));
@@ -58,7 +58,7 @@ VertexOut VS(VertexIn vin)
 	vout.PositionH = mul(PositionW, gViewProj);
 
 	vout.NormalW = mul(vin.NormalL, (float3x3)(gWorld));
-	vout.TangentW = mul(vin.TangentL, (float3x3)(gWorld));
+	vout.TangentW = float4(mul(vin.TangentL.xyz, (float3x3)(gWorld)), vin.TangentL.w);
 
 	const float4 TexCoord = mul(float4(vin.TexCoord, 0.0f, 1.0f), gTexCoordTransform);
 	vout.TexCoord = mul(TexCoord, material.transform).xy;
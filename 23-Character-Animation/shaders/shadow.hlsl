@@ -33,7 +33,7 @@ VertexOut VS(VertexIn vin)
 
     for(int i = 0; i < 4; ++i)
     {
-		const float4x4 BoneTransform = gBoneTransforms[vin.BoneIndices[i]];
+		const float4x4 BoneTransform = gBonePalette[gBonePaletteOffset + vin.BoneIndices[i]];
 
         PositionL += weights[i] * mul(float4(vin.PositionL, 1.0f), BoneTransform).xyz;
     }
@@ -0,0 +1,39 @@
+#include "benchmarks.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// the global operator new and delete replaced by ones that count, so a suite can tell how often the code it measures
+// goes to the heap. the array and nothrow forms call these, the over-aligned ones are not counted
+namespace
+{
+	std::atomic<size_t> allocations{ 0 };
+}
+
+size_t AllocationCount()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* p = std::malloc(size != 0 ? size : 1))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
@@ -0,0 +1,637 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "AnimationReference.h"
+#include "CompiledClip.h"
+#include "CompressedClip.h"
+#include "CrowdAnimation.h"
+#include "SkinnedData.h"
+#include "LoadM3D.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// sum of every matrix entry, enough to notice when the output changes
+	double checksum(const std::vector<XMFLOAT4X4>& transforms)
+	{
+		double sum = 0.0;
+
+		for (const XMFLOAT4X4& m : transforms)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					sum += m(r, c);
+				}
+			}
+		}
+
+		return sum;
+	}
+
+	// one bone with a fixed random track of count keys spread over a second
+	BoneAnimation RandomBoneAnimation(int count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		BoneAnimation animation;
+		animation.KeyFrames.resize(count);
+
+		for (int k = 0; k < count; ++k)
+		{
+			KeyFrame& key = animation.KeyFrames[k];
+
+			key.time = static_cast<float>(k) / (count - 1);
+			key.translation = XMFLOAT3(unit(random), unit(random), unit(random));
+			key.scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+			XMStoreFloat4(&key.rotation, XMQuaternionNormalize(XMVectorSet(unit(random), unit(random), unit(random), unit(random))));
+		}
+
+		return animation;
+	}
+}
+
+void BenchmarkAnimation(BenchmarkReport& report, const std::string& models)
+{
+	// random times make every lookup start from scratch; a frame loop plays forward, which is what the cursor is for
+	std::printf("\nBoneAnimation::interpolate, ns/call\n");
+	std::printf("%10s %12s %12s %12s %12s %9s\n", "keys", "random scan", "random find", "forward scan", "cursor", "same");
+
+	std::mt19937 random(kBenchmarkSeed);
+
+	for (int keys : { 8, 64, 512 })
+	{
+		const BoneAnimation animation = RandomBoneAnimation(keys, random);
+
+		const int samples = 4096;
+		std::vector<float> times(samples);
+		std::vector<float> forward(samples);
+		std::uniform_real_distribution<float> time(0.0f, 1.0f);
+
+		for (int s = 0; s < samples; ++s)
+		{
+			times[s] = time(random);
+			forward[s] = static_cast<float>(s) / samples;
+		}
+
+		XMFLOAT4X4 world;
+		double sum = 0.0;
+
+		const double ScanMs = TimeCalls(20, [&]
+		{
+			for (float t : times)
+			{
+				InterpolateReference(animation, t, world);
+				sum += world(3, 0);
+			}
+		});
+
+		const double FindMs = TimeCalls(20, [&]
+		{
+			for (float t : times)
+			{
+				animation.interpolate(t, world);
+				sum += world(3, 0);
+			}
+		});
+
+		const double ForwardScanMs = TimeCalls(20, [&]
+		{
+			for (float t : forward)
+			{
+				InterpolateReference(animation, t, world);
+				sum += world(3, 0);
+			}
+		});
+
+		const double CursorMs = TimeCalls(20, [&]
+		{
+			UINT cursor = 0;
+
+			for (float t : forward)
+			{
+				animation.interpolate(t, world, cursor);
+				sum += world(3, 0);
+			}
+		});
+
+		// every lookup must land on the segment the scan finds, so the matrices match to the bit
+		bool same = true;
+		UINT cursor = 0;
+
+		for (int s = 0; s < samples; ++s)
+		{
+			XMFLOAT4X4 expected;
+
+			InterpolateReference(animation, times[s], expected);
+			animation.interpolate(times[s], world);
+			same &= std::memcmp(&expected, &world, sizeof(world)) == 0;
+
+			InterpolateReference(animation, forward[s], expected);
+			animation.interpolate(forward[s], world, cursor);
+			same &= std::memcmp(&expected, &world, sizeof(world)) == 0;
+		}
+
+		const double scale = 1.0e6 / samples;
+
+		std::printf("%10d %12.2f %12.2f %12.2f %12.2f %9s\n", keys, ScanMs * scale, FindMs * scale, ForwardScanMs * scale, CursorMs * scale,
+					same ? "yes" : "NO");
+
+		report.add("animation.bone_interpolate", { { "keys", keys } },
+				   { { "scan_ns", ScanMs * scale }, { "ns", FindMs * scale }, { "forward_scan_ns", ForwardScanMs * scale },
+					 { "cursor_ns", CursorMs * scale }, { "same", same ? 1.0 : 0.0 } });
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("\nSkinnedData::GetFinalTransforms skipped, %s/soldier.m3d not found\n", models.c_str());
+		return;
+	}
+
+	std::printf("\nSkinnedData::GetFinalTransforms, soldier.m3d, us/call\n");
+	std::printf("%10s %6s %6s %12s %12s %12s %9s\n", "clip", "bones", "keys", "scan", "find", "cursor", "same");
+
+	// every clip sampled at evenly spaced times, the way a 60 Hz frame loop would
+	for (const auto& [name, clip] : skinned.GetAnimations())
+	{
+		const float start = clip.GetClipStartTime();
+		const float end = clip.GetClipEndTime();
+		const int samples = 1024;
+
+		size_t keys = 0;
+
+		for (const BoneAnimation& bone : clip.BoneAnimations)
+		{
+			keys = std::max(keys, bone.KeyFrames.size());
+		}
+
+		const auto SampleTime = [&](int s) { return start + (end - start) * s / samples; };
+
+		std::vector<XMFLOAT4X4> transforms(skinned.GetBoneCount());
+		std::vector<UINT> cursors;
+
+		const double ScanMs = TimeCalls(10, [&]
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				GetFinalTransformsReference(skinned, name, SampleTime(s), transforms);
+			}
+		});
+
+		const double FindMs = TimeCalls(10, [&]
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				skinned.GetFinalTransforms(name, SampleTime(s), transforms);
+			}
+		});
+
+		const double CursorMs = TimeCalls(10, [&]
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				skinned.GetFinalTransforms(name, SampleTime(s), transforms, cursors);
+			}
+		});
+
+		std::vector<XMFLOAT4X4> expected(skinned.GetBoneCount());
+		double sum = 0.0;
+		bool same = true;
+
+		cursors.clear();
+
+		for (int s = 0; s < samples; ++s)
+		{
+			GetFinalTransformsReference(skinned, name, SampleTime(s), expected);
+			sum += checksum(expected);
+
+			skinned.GetFinalTransforms(name, SampleTime(s), transforms);
+			same &= std::memcmp(expected.data(), transforms.data(), transforms.size() * sizeof(XMFLOAT4X4)) == 0;
+
+			skinned.GetFinalTransforms(name, SampleTime(s), transforms, cursors);
+			same &= std::memcmp(expected.data(), transforms.data(), transforms.size() * sizeof(XMFLOAT4X4)) == 0;
+		}
+
+		const double scale = 1.0e3 / samples;
+
+		std::printf("%10s %6u %6zu %12.3f %12.3f %12.3f %9s\n", name.c_str(), skinned.GetBoneCount(), keys, ScanMs * scale, FindMs * scale,
+					CursorMs * scale, same ? "yes" : "NO");
+
+		report.add("animation.final_transforms." + name, { { "bones", skinned.GetBoneCount() }, { "keys", static_cast<double>(keys) }, { "samples", samples } },
+				   { { "scan_us", ScanMs * scale }, { "us", FindMs * scale }, { "cursor_us", CursorMs * scale }, { "checksum", sum },
+					 { "same", same ? 1.0 : 0.0 } });
+	}
+
+	// the to-parent transforms alone, the part CompiledClip replaces: the key frames of every bone found and blended
+	// one bone at a time, against all the bones blended at once from the resampled frames
+	std::printf("\nCompiledClip (60 Hz), soldier.m3d, us/call\n");
+	std::printf("%10s %6s %9s %9s %12s %12s %12s %12s\n", "clip", "frames", "AoS KB", "SoA KB", "key frames", "compiled", "rot err", "pos err");
+
+	for (const auto& [name, clip] : skinned.GetAnimations())
+	{
+		const CompiledClip compiled(clip, skinned.GetBoneCount());
+
+		const float start = clip.GetClipStartTime();
+		const float end = clip.GetClipEndTime();
+		const int samples = 1024;
+
+		const auto SampleTime = [&](int s) { return start + (end - start) * s / samples; };
+
+		size_t KeyBytes = 0;
+
+		for (const BoneAnimation& bone : clip.BoneAnimations)
+		{
+			KeyBytes += bone.KeyFrames.size() * sizeof(KeyFrame);
+		}
+
+		const size_t frames = compiled.GetFrameCount();
+		const size_t CompiledBytes = compiled.GetSampleBytes();
+
+		std::vector<XMFLOAT4X4> expected(skinned.GetBoneCount());
+		std::vector<XMFLOAT4X4> transforms(skinned.GetBoneCount());
+		std::vector<UINT> cursors;
+
+		const double KeyMs = TimeCalls(10, [&]
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				clip.interpolate(SampleTime(s), transforms, cursors);
+			}
+		});
+
+		const double CompiledMs = TimeCalls(10, [&]
+		{
+			for (int s = 0; s < samples; ++s)
+			{
+				compiled.interpolate(SampleTime(s), transforms);
+			}
+		});
+
+		// the largest difference from BoneAnimation::interpolate in the rotation and scale rows and in the translation,
+		// at the frame loop's times and at random ones, including before the start and after the end
+		float RotationError = 0.0f;
+		float PositionError = 0.0f;
+
+		std::uniform_real_distribution<float> time(start - 0.1f, end + 0.1f);
+
+		for (int s = 0; s < 2 * samples; ++s)
+		{
+			const float t = s < samples ? SampleTime(s) : time(random);
+
+			clip.interpolate(t, expected);
+			compiled.interpolate(t, transforms);
+
+			for (size_t b = 0; b < transforms.size(); ++b)
+			{
+				for (int r = 0; r < 4; ++r)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						float& error = r < 3 ? RotationError : PositionError;
+						error = std::max(error, std::fabs(transforms[b](r, c) - expected[b](r, c)));
+					}
+				}
+			}
+		}
+
+		const double scale = 1.0e3 / samples;
+
+		std::printf("%10s %6zu %9.1f %9.1f %12.3f %12.3f %12.2e %12.2e\n", name.c_str(), frames, KeyBytes / 1024.0, CompiledBytes / 1024.0,
+					KeyMs * scale, CompiledMs * scale, RotationError, PositionError);
+
+		report.add("animation.compiled." + name, { { "bones", skinned.GetBoneCount() }, { "frames", static_cast<double>(frames) } },
+				   { { "key_frames_us", KeyMs * scale }, { "compiled_us", CompiledMs * scale }, { "rotation_error", RotationError },
+					 { "position_error", PositionError } });
+	}
+
+	// clips compressed at a few tolerances: how many key frames survive, what the clip takes, and the largest distance
+	// between a joint as the compressed clip places it and as the original does, at the frame loop's times and at
+	// every key frame's time, where a dropped key frame is furthest from its interpolation
+	std::printf("\nCompressedClip, soldier.m3d\n");
+	std::printf("%10s %9s %13s %9s %9s %7s %12s %12s %12s\n", "clip", "tolerance", "keys", "KB", "packed KB", "saved", "joint err",
+				"key frames", "compressed");
+
+	std::vector<XMFLOAT3> joints(skinned.GetBoneCount());
+
+	for (size_t b = 0; b < joints.size(); ++b)
+	{
+		XMVECTOR determinant;
+		XMStoreFloat3(&joints[b], XMMatrixInverse(&determinant, XMLoadFloat4x4(&skinned.GetBoneOffsets()[b])).r[3]);
+	}
+
+	for (const auto& [name, clip] : skinned.GetAnimations())
+	{
+		const float start = clip.GetClipStartTime();
+		const float end = clip.GetClipEndTime();
+		const int samples = 1024;
+
+		const auto SampleTime = [&](int s) { return start + (end - start) * s / samples; };
+
+		std::vector<float> times;
+
+		for (int s = 0; s <= samples; ++s)
+		{
+			times.push_back(SampleTime(s));
+		}
+
+		for (const BoneAnimation& bone : clip.BoneAnimations)
+		{
+			for (const KeyFrame& key : bone.KeyFrames)
+			{
+				times.push_back(key.time);
+			}
+		}
+
+		for (float tolerance : { 0.01f, 0.05f, 0.2f })
+		{
+			const CompressedClip compressed(clip, skinned, tolerance);
+
+			std::vector<XMFLOAT4X4> expected(skinned.GetBoneCount());
+			std::vector<XMFLOAT4X4> transforms(skinned.GetBoneCount());
+			std::vector<UINT> ExpectedCursors;
+			std::vector<UINT> cursors;
+			SkinningScratch scratch;
+
+			const double KeyMs = TimeCalls(10, [&]
+			{
+				for (int s = 0; s < samples; ++s)
+				{
+					skinned.GetFinalTransforms(clip, SampleTime(s), transforms, cursors, scratch);
+				}
+			});
+
+			cursors.clear();
+
+			const double CompressedMs = TimeCalls(10, [&]
+			{
+				for (int s = 0; s < samples; ++s)
+				{
+					skinned.GetFinalTransforms(compressed, SampleTime(s), transforms, cursors, scratch);
+				}
+			});
+
+			float JointError = 0.0f;
+
+			cursors.clear();
+
+			for (float t : times)
+			{
+				skinned.GetFinalTransforms(clip, t, expected, ExpectedCursors, scratch);
+				skinned.GetFinalTransforms(compressed, t, transforms, cursors, scratch);
+
+				// the final transforms are stored transposed, as the shaders read them
+				for (size_t b = 0; b < joints.size(); ++b)
+				{
+					const XMVECTOR joint = XMLoadFloat3(&joints[b]);
+					const XMVECTOR ExpectedJoint = XMVector3TransformCoord(joint, XMMatrixTranspose(XMLoadFloat4x4(&expected[b])));
+					const XMVECTOR CompressedJoint = XMVector3TransformCoord(joint, XMMatrixTranspose(XMLoadFloat4x4(&transforms[b])));
+
+					JointError = std::max(JointError, XMVectorGetX(XMVector3Length(XMVectorSubtract(ExpectedJoint, CompressedJoint))));
+				}
+			}
+
+			const double SourceKB = compressed.GetSourceBytes() / 1024.0;
+			const double CompressedKB = compressed.GetCompressedBytes() / 1024.0;
+			const double saved = 1.0 - CompressedKB / SourceKB;
+			const double scale = 1.0e3 / samples;
+
+			char keys[32];
+			std::snprintf(keys, sizeof(keys), "%zu/%zu", compressed.GetKeyCount(), compressed.GetSourceKeyCount());
+
+			std::printf("%10s %9.2f %13s %9.1f %9.1f %6.1f%% %12.2e %12.3f %12.3f\n", name.c_str(), tolerance, keys, SourceKB, CompressedKB,
+						saved * 100.0, JointError, KeyMs * scale, CompressedMs * scale);
+
+			report.add("animation.compressed." + name, { { "tolerance", tolerance }, { "bones", skinned.GetBoneCount() } },
+					   { { "keys", static_cast<double>(compressed.GetKeyCount()) }, { "source_keys", static_cast<double>(compressed.GetSourceKeyCount()) },
+						 { "source_bytes", static_cast<double>(compressed.GetSourceBytes()) },
+						 { "compressed_bytes", static_cast<double>(compressed.GetCompressedBytes()) }, { "saved", saved },
+						 { "joint_error", JointError }, { "key_frames_us", KeyMs * scale }, { "compressed_us", CompressedMs * scale } });
+		}
+	}
+
+	// a crowd playing Take1 at a few different phases, stepped like the demo's frame loop: the name looked up and
+	// two vectors allocated by every call, against a clip handle with scratch kept by every instance, the compiled
+	// clip, and a pose cache shared by all of them
+	const AnimationClip* take = skinned.FindClip("Take1");
+
+	if (take == nullptr)
+	{
+		return;
+	}
+
+	struct Instance
+	{
+		float phase = 0.0f;
+		std::vector<XMFLOAT4X4> transforms;
+		std::vector<UINT> cursors;
+		SkinningScratch scratch;
+	};
+
+	const int InstanceCount = 64;
+	const int phases = 8;
+	const int frames = 120;
+	const float length = take->GetClipEndTime();
+
+	std::vector<Instance> crowd(InstanceCount);
+
+	for (int i = 0; i < InstanceCount; ++i)
+	{
+		crowd[i].phase = static_cast<float>(i % phases * 7) / 60.0f;
+		crowd[i].transforms.resize(skinned.GetBoneCount());
+	}
+
+	PoseCache cache(skinned);
+
+	// the frames keep counting across the runs, so every run samples poses the cache has not seen yet
+	int clock = 0;
+
+	const auto InstanceTime = [&](const Instance& instance, int frame) { return std::fmod((clock + frame) / 60.0f + instance.phase, length); };
+
+	const auto ByName = [&]
+	{
+		for (int f = 0; f < frames; ++f)
+		{
+			for (Instance& instance : crowd)
+			{
+				skinned.GetFinalTransforms("Take1", InstanceTime(instance, f), instance.transforms);
+			}
+		}
+
+		clock += frames;
+	};
+
+	const auto ByHandle = [&]
+	{
+		for (int f = 0; f < frames; ++f)
+		{
+			for (Instance& instance : crowd)
+			{
+				skinned.GetFinalTransforms(*take, InstanceTime(instance, f), instance.transforms, instance.cursors, instance.scratch);
+			}
+		}
+
+		clock += frames;
+	};
+
+	const CompiledClip CompiledTake(*take, skinned.GetBoneCount());
+
+	const auto ByCompiled = [&]
+	{
+		for (int f = 0; f < frames; ++f)
+		{
+			for (Instance& instance : crowd)
+			{
+				skinned.GetFinalTransforms(CompiledTake, InstanceTime(instance, f), instance.transforms, instance.scratch);
+			}
+		}
+
+		clock += frames;
+	};
+
+	const auto ByCache = [&]
+	{
+		for (int f = 0; f < frames; ++f)
+		{
+			for (Instance& instance : crowd)
+			{
+				cache.GetFinalTransforms(*take, InstanceTime(instance, f), instance.transforms, instance.cursors);
+			}
+		}
+
+		clock += frames;
+	};
+
+	std::printf("\nSkinnedData::GetFinalTransforms, %d soldiers at %d phases, %d frames\n", InstanceCount, phases, frames);
+	std::printf("%10s %12s %12s %9s %9s\n", "lookup", "us/frame", "allocs/frame", "cold hits", "warm hits");
+
+	const auto HitRate = [&](size_t hits, size_t misses)
+	{
+		const size_t lookups = cache.GetHitCount() - hits + cache.GetMissCount() - misses;
+		return lookups != 0 ? static_cast<double>(cache.GetHitCount() - hits) / lookups : 0.0;
+	};
+
+	const auto measure = [&](const char* name, const auto& run)
+	{
+		// the first run sizes the scratch and cursors, and fills the cache, the way the first frames of a game would;
+		// once every frame of the clip is in the cache the later runs only copy
+		size_t hits = cache.GetHitCount();
+		size_t misses = cache.GetMissCount();
+
+		run();
+
+		const double ColdHitRate = HitRate(hits, misses);
+
+		const size_t before = AllocationCount();
+		hits = cache.GetHitCount();
+		misses = cache.GetMissCount();
+
+		run();
+
+		const double allocs = static_cast<double>(AllocationCount() - before) / frames;
+		const double WarmHitRate = HitRate(hits, misses);
+
+		const double us = TimeCalls(5, run) * 1.0e3 / frames;
+
+		std::printf("%10s %12.2f %12.1f %9.3f %9.3f\n", name, us, allocs, ColdHitRate, WarmHitRate);
+
+		report.add(std::string("animation.crowd.") + name, { { "instances", InstanceCount }, { "phases", phases }, { "frames", frames } },
+				   { { "us", us }, { "allocs", allocs }, { "cold_hit_rate", ColdHitRate }, { "warm_hit_rate", WarmHitRate } });
+	};
+
+	measure("name", ByName);
+	measure("handle", ByHandle);
+	measure("compiled", ByCompiled);
+	measure("cache", ByCache);
+}
+
+void BenchmarkCrowd(BenchmarkReport& report, const std::string& models)
+{
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("\nCrowdAnimation skipped, %s/soldier.m3d not found\n", models.c_str());
+		return;
+	}
+
+	ThreadPool pool;
+
+	// every soldier starts somewhere else in its clip and plays at its own speed, one 60 Hz frame per update
+	std::printf("\nCrowdAnimation, soldier.m3d, ms/frame\n");
+	std::printf("%10s %9s %9s %9s %9s %12s %9s\n", "instances", "MB", "serial", "pool", "threads", "ns/instance", "same");
+
+	std::mt19937 random(kBenchmarkSeed);
+
+	for (int count : { 100, 1000, 10000 })
+	{
+		CrowdAnimation serial(skinned);
+		CrowdAnimation parallel(skinned);
+
+		const std::vector<std::string> clips = [&]
+		{
+			std::vector<std::string> names;
+
+			for (const auto& [name, clip] : skinned.GetAnimations())
+			{
+				names.push_back(name);
+			}
+
+			std::sort(names.begin(), names.end());
+
+			return names;
+		}();
+
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		for (int i = 0; i < count; ++i)
+		{
+			const std::string& clip = clips[i % clips.size()];
+			const float time = unit(random) * skinned.GetClipEndTime(clip);
+			const float speed = 0.8f + 0.4f * unit(random);
+
+			serial.add(clip, time, speed);
+			parallel.add(clip, time, speed);
+		}
+
+		std::vector<XMFLOAT4X4> SerialPalette(serial.GetPaletteSize());
+		std::vector<XMFLOAT4X4> PoolPalette(parallel.GetPaletteSize());
+
+		const float dt = 1.0f / 60.0f;
+
+		const double SerialMs = TimeCalls(5, [&] { serial.update(dt, SerialPalette.data()); });
+		const double PoolMs = TimeCalls(5, [&] { parallel.update(dt, PoolPalette.data(), &pool); });
+
+		// both played the same six frames, so the palettes match to the bit
+		const bool same = std::memcmp(SerialPalette.data(), PoolPalette.data(), SerialPalette.size() * sizeof(XMFLOAT4X4)) == 0;
+
+		const double megabytes = SerialPalette.size() * sizeof(XMFLOAT4X4) / (1024.0 * 1024.0);
+		const double ns = std::min(SerialMs, PoolMs) * 1.0e6 / count;
+
+		std::printf("%10d %9.2f %9.3f %9.3f %9d %12.1f %9s\n", count, megabytes, SerialMs, PoolMs, pool.GetThreadCount(), ns, same ? "yes" : "NO");
+
+		report.add("crowd.soldier", { { "instances", count }, { "threads", pool.GetThreadCount() } },
+				   { { "serial_ms", SerialMs }, { "pool_ms", PoolMs }, { "palette_mb", megabytes }, { "same", same ? 1.0 : 0.0 } });
+	}
+}
@@ -0,0 +1,99 @@
+#include "AnimationReference.h"
+
+void InterpolateReference(const BoneAnimation& animation, const float time, XMFLOAT4X4& world)
+{
+	const XMVECTOR O = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	if (time <= animation.KeyFrames.front().time)
+	{
+		const XMVECTOR S = XMLoadFloat3(&animation.KeyFrames.front().scale);
+		const XMVECTOR T = XMLoadFloat3(&animation.KeyFrames.front().translation);
+		const XMVECTOR R = XMLoadFloat4(&animation.KeyFrames.front().rotation);
+
+		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+	}
+	else if (time >= animation.KeyFrames.back().time)
+	{
+		const XMVECTOR S = XMLoadFloat3(&animation.KeyFrames.back().scale);
+		const XMVECTOR T = XMLoadFloat3(&animation.KeyFrames.back().translation);
+		const XMVECTOR R = XMLoadFloat4(&animation.KeyFrames.back().rotation);
+
+		XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+	}
+	else
+	{
+		for (UINT i = 0; i < animation.KeyFrames.size() - 1; ++i)
+		{
+			if (time >= animation.KeyFrames[i].time && time <= animation.KeyFrames[i + 1].time)
+			{
+				const float t = (time - animation.KeyFrames[i].time) / (animation.KeyFrames[i + 1].time - animation.KeyFrames[i].time);
+
+				const XMVECTOR S0 = XMLoadFloat3(&animation.KeyFrames[i].scale);
+				const XMVECTOR S1 = XMLoadFloat3(&animation.KeyFrames[i + 1].scale);
+
+				const XMVECTOR T0 = XMLoadFloat3(&animation.KeyFrames[i].translation);
+				const XMVECTOR T1 = XMLoadFloat3(&animation.KeyFrames[i + 1].translation);
+
+				const XMVECTOR R0 = XMLoadFloat4(&animation.KeyFrames[i].rotation);
+				const XMVECTOR R1 = XMLoadFloat4(&animation.KeyFrames[i + 1].rotation);
+
+				const XMVECTOR S = XMVectorLerp(S0, S1, t);
+				const XMVECTOR T = XMVectorLerp(T0, T1, t);
+				const XMVECTOR R = XMQuaternionSlerp(R0, R1, t);
+
+				XMStoreFloat4x4(&world, XMMatrixAffineTransformation(S, O, R, T));
+				break;
+			}
+		}
+	}
+}
+
+void GetFinalTransformsReference(const SkinnedData& skinned,
+								 const std::string& name,
+								 const float time,
+								 std::vector<XMFLOAT4X4>& transforms)
+{
+	const std::vector<XMFLOAT4X4>& mBoneOffsets = skinned.GetBoneOffsets();
+	const std::vector<int>& mBoneHierarchy = skinned.GetBoneHierarchy();
+
+	const UINT bones = mBoneOffsets.size();
+
+	std::vector<XMFLOAT4X4> ToParentTransforms(bones);
+
+	// interpolate all the bones of this clip at the given time position
+	const auto& clip = skinned.GetAnimations().find(name);
+
+	for (UINT i = 0; i < clip->second.BoneAnimations.size(); ++i)
+	{
+		InterpolateReference(clip->second.BoneAnimations[i], time, ToParentTransforms[i]);
+	}
+
+	// traverse the hierarchy and transform all the bones to the root space
+
+	std::vector<XMFLOAT4X4> ToRootTransforms(bones);
+
+	// the root bone has index 0, and it has no parent,
+	// so its toRootTransform is just its local bone transform
+	ToRootTransforms[0] = ToParentTransforms[0];
+
+	// find the toRootTransform of the children
+	for (UINT i = 1; i < bones; ++i)
+	{
+		const XMMATRIX ToParent = XMLoadFloat4x4(&ToParentTransforms[i]);
+
+		const int ParentIndex = mBoneHierarchy[i];
+		const XMMATRIX ParentToRoot = XMLoadFloat4x4(&ToRootTransforms[ParentIndex]);
+
+		const XMMATRIX ToRoot = XMMatrixMultiply(ToParent, ParentToRoot);
+		XMStoreFloat4x4(&ToRootTransforms[i], ToRoot);
+	}
+
+	// premultiply by the bone offset transform to get the final transform
+	for (UINT i = 0; i < bones; ++i)
+	{
+		const XMMATRIX offset = XMLoadFloat4x4(&mBoneOffsets[i]);
+		const XMMATRIX ToRoot = XMLoadFloat4x4(&ToRootTransforms[i]);
+		const XMMATRIX transform = XMMatrixMultiply(offset, ToRoot);
+		XMStoreFloat4x4(&transforms[i], XMMatrixTranspose(transform));
+	}
+}
\ No newline at end of file
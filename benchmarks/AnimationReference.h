@@ -0,0 +1,13 @@
+#pragma once
+
+#include "SkinnedData.h"
+
+// BoneAnimation::interpolate and SkinnedData::GetFinalTransforms as the demos shipped with them, scanning every
+// bone's key frames from the first one on each call, kept unchanged so the benchmarks can measure the lookups
+// against them
+void InterpolateReference(const BoneAnimation& animation, const float time, XMFLOAT4X4& world);
+
+void GetFinalTransformsReference(const SkinnedData& skinned,
+								 const std::string& name,
+								 const float time,
+								 std::vector<XMFLOAT4X4>& transforms);
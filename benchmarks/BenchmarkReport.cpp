@@ -0,0 +1,74 @@
+#include "BenchmarkReport.h"
+
+#include <cmath>
+
+namespace
+{
+	void WriteString(std::FILE* file, const std::string& text)
+	{
+		std::fputc('"', file);
+
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				std::fputc('\\', file);
+			}
+
+			std::fputc(c, file);
+		}
+
+		std::fputc('"', file);
+	}
+
+	void WriteFields(std::FILE* file, const BenchmarkReport::Fields& fields)
+	{
+		std::fputc('{', file);
+
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			std::fputs(i > 0 ? ", " : "", file);
+
+			WriteString(file, fields[i].first);
+
+			// JSON has no representation for inf or nan
+			if (std::isfinite(fields[i].second))
+			{
+				std::fprintf(file, ": %.9g", fields[i].second);
+			}
+			else
+			{
+				std::fputs(": null", file);
+			}
+		}
+
+		std::fputc('}', file);
+	}
+}
+
+void BenchmarkReport::add(const std::string& name, const Fields& params, const Fields& metrics)
+{
+	mResults.push_back({ name, params, metrics });
+}
+
+void BenchmarkReport::write(std::FILE* file, const Fields& context) const
+{
+	std::fputs("{\n  \"context\": ", file);
+	WriteFields(file, context);
+	std::fputs(",\n  \"results\": [", file);
+
+	for (size_t i = 0; i < mResults.size(); ++i)
+	{
+		std::fputs(i > 0 ? ",\n    " : "\n    ", file);
+
+		std::fputs("{\"name\": ", file);
+		WriteString(file, mResults[i].name);
+		std::fputs(", \"params\": ", file);
+		WriteFields(file, mResults[i].params);
+		std::fputs(", \"metrics\": ", file);
+		WriteFields(file, mResults[i].metrics);
+		std::fputc('}', file);
+	}
+
+	std::fputs("\n  ]\n}\n", file);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// collects the numbers every benchmark measures and writes them out as JSON
+class BenchmarkReport
+{
+public:
+	using Fields = std::vector<std::pair<std::string, double>>;
+
+	// params identify a measurement (grid size, thread count, ...), metrics are the numbers to track
+	void add(const std::string& name, const Fields& params, const Fields& metrics);
+
+	// context describes the run as a whole (seed, thread count, ...)
+	void write(std::FILE* file, const Fields& context) const;
+
+private:
+	struct Result
+	{
+		std::string name;
+		Fields params;
+		Fields metrics;
+	};
+
+	std::vector<Result> mResults;
+};
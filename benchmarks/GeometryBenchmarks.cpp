@@ -0,0 +1,144 @@
+#include "benchmarks.h"
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "GeometryGenerator.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	struct Shape
+	{
+		const char* name;
+		const char* size;
+		int runs;
+		std::function<GeometryGenerator::MeshData(GeometryGenerator&)> create;
+	};
+}
+
+// the shapes at the sizes the demos ask for, and a denser version of the tessellated ones
+void BenchmarkGeometry(BenchmarkReport& report)
+{
+	const Shape shapes[] =
+	{
+		{ "box", "demo", 2000, [](GeometryGenerator& g) { return g.CreateBox(1.0f, 1.0f, 1.0f); } },
+		{ "grid", "demo", 1000, [](GeometryGenerator& g) { return g.CreateGrid(160.0f, 160.0f, 50, 50); } },
+		{ "grid", "dense", 20, [](GeometryGenerator& g) { return g.CreateGrid(160.0f, 160.0f, 512, 512); } },
+		{ "sphere", "demo", 2000, [](GeometryGenerator& g) { return g.CreateSphere(0.5f, 20, 20); } },
+		{ "sphere", "dense", 20, [](GeometryGenerator& g) { return g.CreateSphere(0.5f, 256, 256); } },
+		{ "cylinder", "demo", 2000, [](GeometryGenerator& g) { return g.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20); } },
+		{ "cylinder", "dense", 20, [](GeometryGenerator& g) { return g.CreateCylinder(0.5f, 0.3f, 3.0f, 256, 256); } },
+	};
+
+	std::printf("\nGeometryGenerator::Create*\n");
+	std::printf("%10s %8s %10s %10s %12s\n", "shape", "size", "vertices", "indices", "ms/call");
+
+	GeometryGenerator generator;
+
+	for (const Shape& shape : shapes)
+	{
+		size_t vertices = 0;
+		size_t indices = 0;
+
+		const double time = TimeCalls(shape.runs, [&]
+		{
+			const GeometryGenerator::MeshData mesh = shape.create(generator);
+
+			vertices = mesh.vertices.size();
+			indices = mesh.indices32.size();
+		});
+
+		std::printf("%10s %8s %10zu %10zu %12.4f\n", shape.name, shape.size, vertices, indices, time);
+
+		report.add(std::string("geometry.") + shape.name + "." + shape.size, { { "vertices", static_cast<double>(vertices) }, { "indices", static_cast<double>(indices) } },
+				   { { "ms", time } });
+	}
+
+	// the shapes demo library: MeshData per shape plus a 16-bit copy, against one arena written in place
+	const int LibraryRuns = 2000;
+
+	const double MeshDataTime = TimeCalls(LibraryRuns, [&]
+	{
+		GeometryGenerator::MeshData box = generator.CreateBox(1.5f, 0.5f, 1.5f);
+		GeometryGenerator::MeshData grid = generator.CreateGrid(20.0f, 30.0f, 60, 40);
+		GeometryGenerator::MeshData cylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+		GeometryGenerator::MeshData sphere = generator.CreateSphere(0.5f, 20, 20);
+
+		std::vector<uint16_t> indices;
+		indices.insert(indices.end(), box.GetIndices16().begin(), box.GetIndices16().end());
+		indices.insert(indices.end(), grid.GetIndices16().begin(), grid.GetIndices16().end());
+		indices.insert(indices.end(), cylinder.GetIndices16().begin(), cylinder.GetIndices16().end());
+		indices.insert(indices.end(), sphere.GetIndices16().begin(), sphere.GetIndices16().end());
+	});
+
+	const double ArenaTime = TimeCalls(LibraryRuns, [&]
+	{
+		GeometryGenerator::MeshSize BoxSize = GeometryGenerator::BoxSize();
+		GeometryGenerator::MeshSize GridSize = GeometryGenerator::GridSize(60, 40);
+		GeometryGenerator::MeshSize CylinderSize = GeometryGenerator::CylinderSize(20, 20);
+		GeometryGenerator::MeshSize SphereSize = GeometryGenerator::SphereSize(20, 20);
+
+		GeometryGenerator::MeshSize TotalSize;
+		TotalSize += BoxSize;
+		TotalSize += GridSize;
+		TotalSize += CylinderSize;
+		TotalSize += SphereSize;
+
+		GeometryGenerator::MeshArena<uint16_t> arena(TotalSize);
+
+		generator.CreateBox(1.5f, 0.5f, 1.5f, arena.allocate(BoxSize));
+		generator.CreateGrid(20.0f, 30.0f, 60, 40, arena.allocate(GridSize));
+		generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20, arena.allocate(CylinderSize));
+		generator.CreateSphere(0.5f, 20, 20, arena.allocate(SphereSize));
+	});
+
+	std::printf("\nshape library (box, grid, cylinder, sphere) with 16-bit indices\n");
+	std::printf("%12s %12s %10s\n", "MeshData ms", "arena ms", "speedup");
+	std::printf("%12.4f %12.4f %9.2fx\n", MeshDataTime, ArenaTime, MeshDataTime / ArenaTime);
+
+	report.add("geometry.library.meshdata", {}, { { "ms", MeshDataTime } });
+	report.add("geometry.library.arena", {}, { { "ms", ArenaTime } });
+
+	// dense shapes built serially and across a pool, the grid with the hills demos' terrain applied in the same pass
+	auto hills = [](GeometryGenerator::VertexData& vertex)
+	{
+		const float x = vertex.position.x;
+		const float z = vertex.position.z;
+
+		vertex.position.y = 0.3f * (z * std::sin(0.1f * x) + x * std::cos(0.1f * z));
+
+		XMFLOAT3 n(-0.03f * z * std::cos(0.1f * x) - 0.3f * std::cos(0.1f * z), 1.0f, -0.3f * std::sin(0.1f * x) + 0.03f * x * std::sin(0.1f * z));
+		XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMLoadFloat3(&n)));
+	};
+
+	const Shape DenseShapes[] =
+	{
+		{ "terrain", "1024", 5, [&](GeometryGenerator& g) { return g.CreateGrid(160.0f, 160.0f, 1024, 1024, hills); } },
+		{ "sphere", "dense", 20, [](GeometryGenerator& g) { return g.CreateSphere(0.5f, 256, 256); } },
+		{ "cylinder", "dense", 20, [](GeometryGenerator& g) { return g.CreateCylinder(0.5f, 0.3f, 3.0f, 256, 256); } },
+	};
+
+	ThreadPool pool;
+
+	std::printf("\nGeometryGenerator::Create* across %d threads\n", pool.GetThreadCount());
+	std::printf("%10s %8s %12s %12s %10s\n", "shape", "size", "serial ms", "pool ms", "speedup");
+
+	for (const Shape& shape : DenseShapes)
+	{
+		generator.SetThreadPool(nullptr);
+		const double SerialTime = TimeCalls(shape.runs, [&] { shape.create(generator); });
+
+		generator.SetThreadPool(&pool);
+		const double PoolTime = TimeCalls(shape.runs, [&] { shape.create(generator); });
+
+		std::printf("%10s %8s %12.4f %12.4f %9.2fx\n", shape.name, shape.size, SerialTime, PoolTime, SerialTime / PoolTime);
+
+		report.add(std::string("geometry.parallel.") + shape.name + "." + shape.size, { { "threads", static_cast<double>(pool.GetThreadCount()) } },
+				   { { "serial_ms", SerialTime }, { "pool_ms", PoolTime } });
+	}
+
+	generator.SetThreadPool(nullptr);
+}
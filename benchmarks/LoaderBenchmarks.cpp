@@ -0,0 +1,317 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "AssetPipeline.h"
+#include "LoadM3D.h"
+#include "M3DReference.h"
+#include "SkullReference.h"
+#include "TextModelLoader.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// a skinned model as M3DLoader::LoadM3d returns it
+	struct SkinnedModel
+	{
+		std::vector<M3DLoader::SkinnedVertex> vertices;
+		std::vector<USHORT> indices;
+		std::vector<M3DLoader::Subset> subsets;
+		std::vector<M3DLoader::M3DMaterial> materials;
+		SkinnedData skinned;
+	};
+
+	// bit for bit, down to the last key frame
+	bool Matches(std::span<const M3DLoader::SkinnedVertex> vertices, std::span<const USHORT> indices, const std::vector<M3DLoader::Subset>& subsets,
+				 const std::vector<M3DLoader::M3DMaterial>& materials, const SkinnedData& skinned, const SkinnedModel& expected)
+	{
+		bool matches = vertices.size() == expected.vertices.size() && indices.size() == expected.indices.size() &&
+					   std::memcmp(vertices.data(), expected.vertices.data(), vertices.size_bytes()) == 0 &&
+					   std::memcmp(indices.data(), expected.indices.data(), indices.size_bytes()) == 0 &&
+					   subsets.size() == expected.subsets.size() && materials.size() == expected.materials.size() &&
+					   skinned.GetBoneHierarchy() == expected.skinned.GetBoneHierarchy() &&
+					   skinned.GetBoneOffsets().size() == expected.skinned.GetBoneOffsets().size() &&
+					   std::memcmp(skinned.GetBoneOffsets().data(), expected.skinned.GetBoneOffsets().data(), skinned.GetBoneOffsets().size() * sizeof(XMFLOAT4X4)) == 0 &&
+					   skinned.GetAnimations().size() == expected.skinned.GetAnimations().size();
+
+		for (size_t i = 0; matches && i < subsets.size(); ++i)
+		{
+			const M3DLoader::M3DMaterial& a = materials[i];
+			const M3DLoader::M3DMaterial& b = expected.materials[i];
+
+			matches = std::memcmp(&subsets[i], &expected.subsets[i], sizeof(M3DLoader::Subset)) == 0 && a.Name == b.Name &&
+					  std::memcmp(&a.DiffuseAlbedo, &b.DiffuseAlbedo, sizeof(XMFLOAT4)) == 0 && std::memcmp(&a.FresnelR0, &b.FresnelR0, sizeof(XMFLOAT3)) == 0 &&
+					  a.Roughness == b.Roughness && a.AlphaClip == b.AlphaClip && a.MaterialTypeName == b.MaterialTypeName &&
+					  a.DiffuseMapName == b.DiffuseMapName && a.NormalMapName == b.NormalMapName;
+		}
+
+		for (const auto& [name, clip] : expected.skinned.GetAnimations())
+		{
+			const auto other = skinned.GetAnimations().find(name);
+			matches = matches && other != skinned.GetAnimations().end() && other->second.BoneAnimations.size() == clip.BoneAnimations.size();
+
+			for (size_t b = 0; matches && b < clip.BoneAnimations.size(); ++b)
+			{
+				const std::vector<KeyFrame>& a = other->second.BoneAnimations[b].KeyFrames;
+				const std::vector<KeyFrame>& c = clip.BoneAnimations[b].KeyFrames;
+
+				matches = a.size() == c.size() && std::memcmp(a.data(), c.data(), a.size() * sizeof(KeyFrame)) == 0;
+			}
+		}
+
+		return matches;
+	}
+}
+
+void BenchmarkLoaders(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nmodel loaders\n");
+	std::printf("%14s %10s %10s %12s %12s %12s %9s\n", "file", "vertices", "indices", "ms/load", "mapped ms", "pool ms", "matches");
+
+	ThreadPool pool;
+
+	for (const char* name : { "skull.txt", "car.txt" })
+	{
+		std::vector<SkullVertex> vertices;
+		std::vector<std::int32_t> indices;
+
+		const std::string filename = models + "/" + name;
+
+		if (!LoadSkullReference(filename, vertices, indices))
+		{
+			std::printf("%14s not found in %s\n", name, models.c_str());
+			continue;
+		}
+
+		const double time = TimeCalls(5, [&] { LoadSkullReference(filename, vertices, indices); });
+
+		// the shared loader the demos use, on one thread and across the pool
+		TextModelLoader::Model model;
+
+		const double MappedTime = TimeCalls(5, [&] { TextModelLoader::Load(filename, model); });
+		const double PoolTime = TimeCalls(5, [&] { TextModelLoader::Load(filename, model, &pool); });
+
+		// same layout as SkullVertex, so the two loaders must agree bit for bit up to the tangent, which the shared
+		// loader takes from the texture coordinates instead of world up
+		bool matches = model.vertices.size() == vertices.size() && model.indices == indices;
+
+		for (size_t i = 0; matches && i < vertices.size(); ++i)
+		{
+			matches = std::memcmp(&model.vertices[i], &vertices[i], offsetof(SkullVertex, tangent)) == 0;
+		}
+
+		std::printf("%14s %10zu %10zu %12.3f %12.3f %12.3f %9s\n", name, vertices.size(), indices.size(), time, MappedTime, PoolTime, matches ? "yes" : "NO");
+
+		report.add(std::string("loaders.text.") + name, { { "vertices", static_cast<double>(vertices.size()) }, { "indices", static_cast<double>(indices.size()) },
+														  { "threads", pool.GetThreadCount() } },
+				   { { "ms", time }, { "mapped_ms", MappedTime }, { "pool_ms", PoolTime }, { "matches", matches ? 1.0 : 0.0 } });
+	}
+
+	// the original std::ifstream loader against the mapped one, on one thread and across the pool
+	SkinnedModel reference;
+	M3DReference ReferenceLoader;
+
+	const std::string filename = models + "/soldier.m3d";
+
+	if (!ReferenceLoader.LoadM3d(filename, reference.vertices, reference.indices, reference.subsets, reference.materials, reference.skinned))
+	{
+		std::printf("%14s not found in %s\n", "soldier.m3d", models.c_str());
+		return;
+	}
+
+	const double time = TimeCalls(3, [&]
+	{
+		SkinnedModel model;
+		ReferenceLoader.LoadM3d(filename, model.vertices, model.indices, model.subsets, model.materials, model.skinned);
+	});
+
+	M3DLoader loader;
+	SkinnedModel mapped;
+	SkinnedModel pooled;
+
+	const double MappedTime = TimeCalls(5, [&]
+	{
+		mapped = SkinnedModel();
+		loader.LoadM3d(filename, mapped.vertices, mapped.indices, mapped.subsets, mapped.materials, mapped.skinned);
+	});
+
+	const double PoolTime = TimeCalls(5, [&]
+	{
+		pooled = SkinnedModel();
+		loader.LoadM3d(filename, pooled.vertices, pooled.indices, pooled.subsets, pooled.materials, pooled.skinned, &pool);
+	});
+
+	const bool matches = Matches(mapped.vertices, mapped.indices, mapped.subsets, mapped.materials, mapped.skinned, reference) &&
+						 Matches(pooled.vertices, pooled.indices, pooled.subsets, pooled.materials, pooled.skinned, reference);
+
+	std::printf("%14s %10zu %10zu %12.3f %12.3f %12.3f %9s\n", "soldier.m3d", reference.vertices.size(), reference.indices.size(), time, MappedTime, PoolTime,
+				matches ? "yes" : "NO");
+
+	report.add("loaders.m3d.soldier", { { "vertices", static_cast<double>(reference.vertices.size()) }, { "indices", static_cast<double>(reference.indices.size()) },
+										{ "bones", reference.skinned.GetBoneCount() }, { "threads", pool.GetThreadCount() } },
+			   { { "ms", time }, { "mapped_ms", MappedTime }, { "pool_ms", PoolTime }, { "matches", matches ? 1.0 : 0.0 } });
+}
+
+// the binary caches next to the models: the first load parses the source and writes the cache, every later one maps
+// it. the models are copied to a temporary folder so the benchmark never touches the caches the demos use
+void BenchmarkMeshCache(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nmesh cache\n");
+	std::printf("%14s %12s %12s %9s %10s %9s\n", "file", "build ms", "cached ms", "speedup", "cache KB", "matches");
+
+	const std::filesystem::path folder = std::filesystem::temp_directory_path() / "mesh-cache-benchmark";
+
+	std::error_code error;
+	std::filesystem::create_directories(folder, error);
+
+	ThreadPool pool;
+
+	for (const char* name : { "skull.txt", "car.txt" })
+	{
+		const std::filesystem::path source = folder / name;
+
+		if (!std::filesystem::copy_file(std::filesystem::path(models) / name, source, std::filesystem::copy_options::overwrite_existing, error))
+		{
+			std::printf("%14s not found in %s\n", name, models.c_str());
+			continue;
+		}
+
+		const std::filesystem::path cache = MeshCache::CachePath(source);
+
+		const double BuildTime = TimeCalls(3, [&]
+		{
+			std::filesystem::remove(cache, error);
+
+			TextModelLoader::CachedModel model;
+			TextModelLoader::LoadCached(source, model, &pool);
+		});
+
+		const double CachedTime = TimeCalls(10, [&]
+		{
+			TextModelLoader::CachedModel model;
+			TextModelLoader::LoadCached(source, model, &pool);
+		});
+
+		TextModelLoader::Model parsed;
+		TextModelLoader::CachedModel cached;
+
+		const bool matches = TextModelLoader::Load(source, parsed) && TextModelLoader::LoadCached(source, cached) && cached.cache.IsOpen() &&
+							 cached.vertices.size() == parsed.vertices.size() && cached.indices.size() == parsed.indices.size() &&
+							 std::memcmp(cached.vertices.data(), parsed.vertices.data(), cached.vertices.size_bytes()) == 0 &&
+							 std::memcmp(cached.indices.data(), parsed.indices.data(), cached.indices.size_bytes()) == 0 &&
+							 std::memcmp(&cached.center, &parsed.center, sizeof(XMFLOAT3)) == 0 &&
+							 std::memcmp(&cached.extents, &parsed.extents, sizeof(XMFLOAT3)) == 0;
+
+		const double size = std::filesystem::file_size(cache, error) / 1024.0;
+
+		std::printf("%14s %12.3f %12.3f %8.1fx %10.1f %9s\n", name, BuildTime, CachedTime, BuildTime / CachedTime, size, matches ? "yes" : "NO");
+
+		report.add(std::string("cache.text.") + name, { { "vertices", static_cast<double>(parsed.vertices.size()) }, { "indices", static_cast<double>(parsed.indices.size()) } },
+				   { { "build_ms", BuildTime }, { "cached_ms", CachedTime }, { "cache_kb", size }, { "matches", matches ? 1.0 : 0.0 } });
+	}
+
+	const std::filesystem::path source = folder / "soldier.m3d";
+
+	if (!std::filesystem::copy_file(std::filesystem::path(models) / "soldier.m3d", source, std::filesystem::copy_options::overwrite_existing, error))
+	{
+		std::printf("%14s not found in %s\n", "soldier.m3d", models.c_str());
+		std::filesystem::remove_all(folder, error);
+		return;
+	}
+
+	const std::filesystem::path cache = MeshCache::CachePath(source);
+
+	M3DLoader loader;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	const double BuildTime = TimeCalls(3, [&]
+	{
+		std::filesystem::remove(cache, error);
+
+		M3DLoader::CachedSkinnedModel model;
+		loader.LoadM3dCached(source.string(), model, subsets, materials, skinned);
+	});
+
+	const double CachedTime = TimeCalls(10, [&]
+	{
+		M3DLoader::CachedSkinnedModel model;
+		loader.LoadM3dCached(source.string(), model, subsets, materials, skinned);
+	});
+
+	// the text loader's results against the cache's
+	SkinnedModel parsed;
+	M3DLoader::CachedSkinnedModel cached;
+
+	const bool matches = loader.LoadM3d(source.string(), parsed.vertices, parsed.indices, parsed.subsets, parsed.materials, parsed.skinned) &&
+						 loader.LoadM3dCached(source.string(), cached, subsets, materials, skinned) && cached.cache.IsOpen() &&
+						 Matches(cached.vertices, cached.indices, subsets, materials, skinned, parsed);
+
+	const double size = std::filesystem::file_size(cache, error) / 1024.0;
+
+	std::printf("%14s %12.3f %12.3f %8.1fx %10.1f %9s\n", "soldier.m3d", BuildTime, CachedTime, BuildTime / CachedTime, size, matches ? "yes" : "NO");
+
+	report.add("cache.m3d.soldier", { { "vertices", static_cast<double>(parsed.vertices.size()) }, { "indices", static_cast<double>(parsed.indices.size()) },
+									  { "bones", parsed.skinned.GetBoneCount() } },
+			   { { "build_ms", BuildTime }, { "cached_ms", CachedTime }, { "cache_kb", size }, { "matches", matches ? 1.0 : 0.0 } });
+
+	std::filesystem::remove_all(folder, error);
+}
+
+void BenchmarkAssetPipeline(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nasset pipeline\n");
+	std::printf("%18s %12s %12s %12s %9s\n", "assets", "serial ms", "pipeline ms", "slowest ms", "threads");
+
+	const std::filesystem::path folder(models);
+
+	// the demo's startup assets, each parsed from its text with no cache and on one thread
+	const std::function<void()> assets[] =
+	{
+		[&] { TextModelLoader::Model model; TextModelLoader::Load(folder / "skull.txt", model); },
+		[&] { TextModelLoader::Model model; TextModelLoader::Load(folder / "car.txt", model); },
+		[&] { SkinnedModel model; M3DLoader().LoadM3d((folder / "soldier.m3d").string(), model.vertices, model.indices, model.subsets, model.materials, model.skinned); },
+	};
+
+	double slowest = 0.0;
+
+	for (const auto& asset : assets)
+	{
+		slowest = std::max(slowest, TimeCalls(3, asset));
+	}
+
+	const double SerialTime = TimeCalls(3, [&]
+	{
+		for (const auto& asset : assets)
+		{
+			asset();
+		}
+	});
+
+	AssetPipeline pipeline;
+
+	const double PipelineTime = TimeCalls(3, [&]
+	{
+		for (const auto& asset : assets)
+		{
+			pipeline.submit(asset);
+		}
+
+		pipeline.wait();
+	});
+
+	const int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	std::printf("%18s %12.3f %12.3f %12.3f %9d\n", "skull car soldier", SerialTime, PipelineTime, slowest, threads);
+
+	report.add("pipeline.startup", { { "assets", static_cast<double>(std::size(assets)) }, { "threads", static_cast<double>(threads) } },
+			   { { "serial_ms", SerialTime }, { "pipeline_ms", PipelineTime }, { "slowest_ms", slowest } });
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "LoadM3D.h"
+
+#include <iosfwd>
+
+// the std::ifstream M3DLoader::LoadM3d the demos shipped with, skinned models only,
+// kept unchanged so the benchmarks can measure the current loader against it
+class M3DReference
+{
+public:
+	bool LoadM3d(const std::string& filename,
+		std::vector<M3DLoader::SkinnedVertex>& vertices,
+		std::vector<USHORT>& indices,
+		std::vector<M3DLoader::Subset>& subsets,
+		std::vector<M3DLoader::M3DMaterial>& mats,
+		SkinnedData& skinInfo);
+
+private:
+	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3DLoader::M3DMaterial>& mats);
+	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<M3DLoader::Subset>& subsets);
+	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<M3DLoader::SkinnedVertex>& vertices);
+	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
+	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
+	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
+	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
+	void ReadBoneKeyframes(std::ifstream& fin, BoneAnimation& boneAnimation);
+};
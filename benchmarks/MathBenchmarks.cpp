@@ -0,0 +1,77 @@
+#include "benchmarks.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "camera.h"
+#include "MathHelper.h"
+
+// a first person camera driven by a fixed sequence of random moves, rebuilding the view after every one
+void BenchmarkCamera(BenchmarkReport& report)
+{
+	const int moves = 4096;
+	const int runs = 200;
+
+	struct Move
+	{
+		float walk;
+		float strafe;
+		float pitch;
+		float yaw;
+	};
+
+	std::mt19937 random(kBenchmarkSeed);
+	std::uniform_real_distribution<float> distance(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> angle(-0.01f, 0.01f);
+
+	std::vector<Move> sequence(moves);
+
+	for (Move& move : sequence)
+	{
+		move = { distance(random), distance(random), angle(random), angle(random) };
+	}
+
+	Camera camera;
+	camera.SetPosition(0.0f, 2.0f, -15.0f);
+
+	const double time = TimeCalls(runs, [&]
+	{
+		for (const Move& move : sequence)
+		{
+			camera.walk(move.walk);
+			camera.strafe(move.strafe);
+			camera.pitch(move.pitch);
+			camera.RotateY(move.yaw);
+			camera.UpdateViewMatrix();
+		}
+	});
+
+	const double NanosecondsPerMove = time * 1.0e6 / moves;
+
+	std::printf("\nCamera::UpdateViewMatrix\n");
+	std::printf("%10s %12s\n", "moves", "ns/move");
+	std::printf("%10d %12.2f\n", moves, NanosecondsPerMove);
+
+	report.add("camera.update_view", { { "moves", moves } }, { { "ns_per_move", NanosecondsPerMove } });
+}
+
+// the blur demos rebuild their kernel every frame
+void BenchmarkBlur(BenchmarkReport& report)
+{
+	const int runs = 100000;
+
+	std::printf("\nBlur::CalcGaussWeights\n");
+	std::printf("%10s %8s %12s\n", "sigma", "taps", "ns/call");
+
+	for (float sigma : { 1.0f, 2.5f })
+	{
+		size_t taps = 0;
+
+		const double time = TimeCalls(runs, [&] { taps = MathHelper::GaussWeights(sigma).size(); });
+
+		std::printf("%10g %8zu %12.2f\n", sigma, taps, time * 1.0e6);
+
+		report.add("blur.gauss_weights", { { "sigma", sigma } }, { { "ns", time * 1.0e6 } });
+	}
+}
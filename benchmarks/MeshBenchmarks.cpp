@@ -0,0 +1,476 @@
+#include "benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "GeometryGenerator.h"
+#include "LoadM3D.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "SkullReference.h"
+#include "TangentSpace.h"
+#include "TextModelLoader.h"
+#include "ThreadPool.h"
+#include "VertexCompression.h"
+
+namespace
+{
+	// cache statistics of the mesh as loaded, after the vertex cache pass and after the overdraw pass on top of it
+	template<typename Vertex, typename Index>
+	void MeasureMesh(BenchmarkReport& report, const char* name, const std::vector<Vertex>& vertices, const std::vector<Index>& indices, XMFLOAT3 Vertex::* position)
+	{
+		const uint32_t VertexCount = static_cast<uint32_t>(vertices.size());
+
+		std::vector<Index> optimized = indices;
+
+		const double CacheTime = TimeCalls(5, [&]
+		{
+			optimized = indices;
+			MeshOptimizer::OptimizeVertexCache(std::span<Index>(optimized), VertexCount);
+		});
+
+		std::vector<Index> overdraw = optimized;
+
+		const double OverdrawTime = TimeCalls(5, [&]
+		{
+			overdraw = optimized;
+			MeshOptimizer::OptimizeOverdraw(std::span<Index>(overdraw), &(vertices[0].*position), sizeof(Vertex), VertexCount);
+		});
+
+		const MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(std::span<const Index>(indices), VertexCount);
+		const MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(std::span<const Index>(optimized), VertexCount);
+		const MeshOptimizer::CacheStats reordered = MeshOptimizer::AnalyzeVertexCache(std::span<const Index>(overdraw), VertexCount);
+
+		// the whole load time pass, with and without the overdraw pass, must never leave the mesh worse than it came in
+		std::vector<Vertex> PassVertices = vertices;
+		std::vector<Index> PassIndices = indices;
+
+		const MeshOptimizer::Report pass = MeshOptimizer::Optimize(std::span<Index>(PassIndices), std::span<Vertex>(PassVertices), position);
+
+		PassVertices = vertices;
+		PassIndices = indices;
+
+		const MeshOptimizer::Report CachePass = MeshOptimizer::Optimize(std::span<Index>(PassIndices), std::span<Vertex>(PassVertices), position, 0, 0.0f);
+
+		const bool kept = pass.after.ACMR <= pass.before.ACMR && CachePass.after.ACMR <= CachePass.before.ACMR;
+
+		std::printf("%12s %9zu %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f %7.3f %9.3f %9.3f %7s\n", name, indices.size() / 3,
+					before.ACMR, before.ATVR, after.ACMR, after.ATVR, reordered.ACMR, reordered.ATVR, pass.after.ACMR, CachePass.after.ACMR,
+					CacheTime, OverdrawTime, kept ? "yes" : "NO");
+
+		report.add(std::string("mesh.") + name, { { "triangles", static_cast<double>(indices.size() / 3) }, { "cache_size", 16 } },
+				   { { "acmr_before", before.ACMR }, { "atvr_before", before.ATVR },
+					 { "acmr_cache", after.ACMR }, { "atvr_cache", after.ATVR },
+					 { "acmr_overdraw", reordered.ACMR }, { "atvr_overdraw", reordered.ATVR },
+					 { "acmr_optimize", pass.after.ACMR }, { "acmr_optimize_cache", CachePass.after.ACMR },
+					 { "cache_ms", CacheTime }, { "overdraw_ms", OverdrawTime }, { "no_worse", kept ? 1.0 : 0.0 } });
+	}
+
+	// meshlets of 64 vertices / 124 triangles built from the cache optimized mesh: how full they are,
+	// how many have a normal cone tight enough to cull with and how big the serialized layout is
+	template<typename Vertex, typename Index>
+	void MeasureMeshlets(BenchmarkReport& report, const char* name, const std::vector<Vertex>& vertices, const std::vector<Index>& indices, XMFLOAT3 Vertex::* position)
+	{
+		std::vector<Index> optimized = indices;
+		MeshOptimizer::OptimizeVertexCache(std::span<Index>(optimized), static_cast<uint32_t>(vertices.size()));
+
+		MeshletBuilder::MeshletData data;
+
+		const double time = TimeCalls(3, [&]
+		{
+			data = MeshletBuilder::Build(std::span<const Vertex>(vertices), position, std::span<const Index>(optimized));
+		});
+
+		size_t cones = 0;
+
+		for (const MeshletBuilder::Bounds& bounds : data.bounds)
+		{
+			cones += bounds.ConeCutoff < 1.0f;
+		}
+
+		std::ostringstream stream;
+		data.write(stream);
+
+		const double count = static_cast<double>(data.meshlets.size());
+		const double AverageVertices = data.vertices.size() / count;
+		const double AverageTriangles = data.triangles.size() / 3 / count;
+
+		std::printf("%12s %9zu %9zu %9.1f %9.1f %9zu %9zu %9.3f\n", name, indices.size() / 3, data.meshlets.size(),
+					AverageVertices, AverageTriangles, cones, stream.str().size(), time);
+
+		report.add(std::string("meshlets.") + name, { { "triangles", static_cast<double>(indices.size() / 3) }, { "max_vertices", 64 }, { "max_triangles", 124 } },
+				   { { "meshlets", count }, { "avg_vertices", AverageVertices }, { "avg_triangles", AverageTriangles },
+					 { "cones", static_cast<double>(cones) }, { "bytes", static_cast<double>(stream.str().size()) }, { "build_ms", time } });
+	}
+
+	// the direction of a tangent, whether or not its handedness follows it
+	const XMFLOAT3* Direction(const XMFLOAT3& tangent) { return &tangent; }
+	const XMFLOAT3* Direction(const XMFLOAT4& tangent) { return reinterpret_cast<const XMFLOAT3*>(&tangent); }
+	XMFLOAT3* Direction(XMFLOAT3& tangent) { return &tangent; }
+	XMFLOAT3* Direction(XMFLOAT4& tangent) { return reinterpret_cast<XMFLOAT3*>(&tangent); }
+
+	// packed vertex size and round trip error, and the cost of encoding and decoding every attribute stream
+	template<typename Vertex, typename Packed, typename Tangent>
+	void MeasureCompression(BenchmarkReport& report, const char* name, const std::vector<Vertex>& vertices, std::vector<Packed>& packed,
+							XMFLOAT3 Vertex::* position, XMFLOAT3 Vertex::* normal, XMFLOAT2 Vertex::* TexCoord, Tangent Vertex::* tangent)
+	{
+		const size_t count = vertices.size();
+		const size_t stride = sizeof(Vertex);
+
+		VertexCompression::PositionBounds bounds;
+
+		const double EncodeTime = TimeCalls(20, [&]
+		{
+			bounds = VertexCompression::ComputeBounds(&(vertices[0].*position), stride, count);
+			VertexCompression::EncodePositions(&(vertices[0].*position), stride, count, bounds, packed[0].position, sizeof(Packed));
+			VertexCompression::EncodeDirections(&(vertices[0].*normal), stride, count, packed[0].normal, sizeof(Packed));
+			VertexCompression::EncodeDirections(Direction(vertices[0].*tangent), stride, count, packed[0].tangent, sizeof(Packed));
+			VertexCompression::EncodeTexCoords(&(vertices[0].*TexCoord), stride, count, packed[0].TexCoord, sizeof(Packed));
+		});
+
+		std::vector<Vertex> decoded(count);
+
+		const double DecodeTime = TimeCalls(20, [&]
+		{
+			VertexCompression::DecodePositions(packed[0].position, sizeof(Packed), count, bounds, &(decoded[0].*position), stride);
+			VertexCompression::DecodeDirections(packed[0].normal, sizeof(Packed), count, &(decoded[0].*normal), stride);
+			VertexCompression::DecodeDirections(packed[0].tangent, sizeof(Packed), count, Direction(decoded[0].*tangent), stride);
+			VertexCompression::DecodeTexCoords(packed[0].TexCoord, sizeof(Packed), count, &(decoded[0].*TexCoord), stride);
+		});
+
+		const VertexCompression::Error PositionError = VertexCompression::MeasureDistances(&(vertices[0].*position), stride, &(decoded[0].*position), stride, count);
+		const VertexCompression::Error NormalError = VertexCompression::MeasureAngles(&(vertices[0].*normal), stride, &(decoded[0].*normal), stride, count);
+		const VertexCompression::Error TangentError = VertexCompression::MeasureAngles(Direction(vertices[0].*tangent), stride, Direction(decoded[0].*tangent), stride, count);
+		const VertexCompression::Error TexCoordError = VertexCompression::MeasureDistances(&(vertices[0].*TexCoord), stride, &(decoded[0].*TexCoord), stride, count);
+
+		// position error relative to the size of the mesh, the unit of quantization is 1 / 65535 of it
+		const double RelativeError = PositionError.max / bounds.extent;
+
+		std::printf("%12s %9zu %6zu %6zu %9.2e %9.4f %9.4f %9.2e %9.3f %9.3f\n", name, count, sizeof(Vertex), sizeof(Packed),
+					RelativeError, NormalError.max, TangentError.max, TexCoordError.max, EncodeTime, DecodeTime);
+
+		report.add(std::string("vertices.") + name, { { "vertices", static_cast<double>(count) } },
+				   { { "bytes_before", static_cast<double>(count * sizeof(Vertex)) }, { "bytes_after", static_cast<double>(count * sizeof(Packed)) },
+					 { "position_max", PositionError.max }, { "position_rms", PositionError.rms }, { "position_relative", RelativeError },
+					 { "normal_max_deg", NormalError.max }, { "normal_rms_deg", NormalError.rms },
+					 { "tangent_max_deg", TangentError.max }, { "tangent_rms_deg", TangentError.rms },
+					 { "uv_max", TexCoordError.max }, { "uv_rms", TexCoordError.rms },
+					 { "encode_ms", EncodeTime }, { "decode_ms", DecodeTime } });
+	}
+
+	// the LOD chain of a mesh, how long it takes to build and what each level keeps
+	template<typename Vertex, typename Index>
+	void MeasureLods(BenchmarkReport& report, const char* name, const std::vector<Vertex>& vertices, const std::vector<Index>& indices, XMFLOAT3 Vertex::* position)
+	{
+		std::vector<Index> chain;
+		std::vector<MeshSimplifier::Lod> lods;
+
+		const double time = TimeCalls(3, [&]
+		{
+			chain = indices;
+			lods = MeshSimplifier::BuildLodChain(std::span<const Vertex>(vertices), position, chain);
+		});
+
+		for (size_t l = 0; l < lods.size(); ++l)
+		{
+			if (l == 0)
+			{
+				std::printf("%12s %5zu %9u %12.6f %9.3f\n", name, l, lods[l].IndexCount / 3, lods[l].error, time);
+			}
+			else
+			{
+				std::printf("%12s %5zu %9u %12.6f\n", "", l, lods[l].IndexCount / 3, lods[l].error);
+			}
+
+			report.add(std::string("lod.") + name + "." + std::to_string(l), { { "level", static_cast<double>(l) } },
+					   { { "triangles", static_cast<double>(lods[l].IndexCount / 3) }, { "error", lods[l].error }, { "build_ms", time } });
+		}
+	}
+
+	// GeometryGenerator's grid and box are flat faces with uvs affine across them, so the tangent of every triangle is
+	// the analytic one the generator writes and the generated tangents can only be off it by rounding
+	constexpr double kAnalyticToleranceDeg = 0.01;
+}
+
+// ACMR/ATVR of a 16 entry FIFO before and after MeshOptimizer, and what the passes cost at load time
+void BenchmarkMeshOptimizer(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nMeshOptimizer (16 entry FIFO)\n");
+	std::printf("%12s %9s %15s %15s %15s %15s %9s %9s %7s\n", "mesh", "triangles", "input", "vertex cache", "+ overdraw", "Optimize", "cache ms",
+				"odraw ms", "no worse");
+	std::printf("%12s %9s %7s %7s %7s %7s %7s %7s %7s %7s\n", "", "", "ACMR", "ATVR", "ACMR", "ATVR", "ACMR", "ATVR", "ACMR", "no odraw");
+
+	GeometryGenerator generator;
+
+	const GeometryGenerator::MeshData grid = generator.CreateGrid(160.0f, 160.0f, 256, 256);
+	const GeometryGenerator::MeshData sphere = generator.CreateSphere(0.5f, 64, 64);
+	const GeometryGenerator::MeshData cylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 64, 64);
+
+	MeasureMesh(report, "grid", grid.vertices, grid.indices32, &GeometryGenerator::VertexData::position);
+	MeasureMesh(report, "sphere", sphere.vertices, sphere.indices32, &GeometryGenerator::VertexData::position);
+	MeasureMesh(report, "cylinder", cylinder.vertices, cylinder.indices32, &GeometryGenerator::VertexData::position);
+
+	std::vector<SkullVertex> SkullVertices;
+	std::vector<std::int32_t> SkullIndices;
+
+	if (LoadSkullReference(models + "/skull.txt", SkullVertices, SkullIndices))
+	{
+		MeasureMesh(report, "skull", SkullVertices, SkullIndices, &SkullVertex::position);
+	}
+	else
+	{
+		std::printf("%12s not found in %s\n", "skull.txt", models.c_str());
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("%12s not found in %s\n", "soldier.m3d", models.c_str());
+		return;
+	}
+
+	MeasureMesh(report, "soldier", vertices, indices, &M3DLoader::SkinnedVertex::Pos);
+}
+
+// quadric simplification LOD chains (each level half the triangles of the one before) and their error estimates
+void BenchmarkMeshSimplifier(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nMeshSimplifier LOD chains\n");
+	std::printf("%12s %5s %9s %12s %9s\n", "mesh", "level", "triangles", "error", "build ms");
+
+	GeometryGenerator generator;
+
+	const GeometryGenerator::MeshData sphere = generator.CreateSphere(0.5f, 64, 64);
+	const GeometryGenerator::MeshData cylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 64, 64);
+
+	MeasureLods(report, "sphere", sphere.vertices, sphere.indices32, &GeometryGenerator::VertexData::position);
+	MeasureLods(report, "cylinder", cylinder.vertices, cylinder.indices32, &GeometryGenerator::VertexData::position);
+
+	std::vector<SkullVertex> SkullVertices;
+	std::vector<std::int32_t> SkullIndices;
+
+	if (!LoadSkullReference(models + "/skull.txt", SkullVertices, SkullIndices))
+	{
+		std::printf("%12s not found in %s\n", "skull.txt", models.c_str());
+		return;
+	}
+
+	MeasureLods(report, "skull", SkullVertices, SkullIndices, &SkullVertex::position);
+}
+
+// meshlet clustering of the skull and the soldier, with the culling data each cluster carries
+void BenchmarkMeshlets(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nMeshletBuilder (64 vertices / 124 triangles)\n");
+	std::printf("%12s %9s %9s %9s %9s %9s %9s %9s\n", "mesh", "triangles", "meshlets", "avg verts", "avg tris", "cones", "bytes", "build ms");
+
+	std::vector<SkullVertex> SkullVertices;
+	std::vector<std::int32_t> SkullIndices;
+
+	if (LoadSkullReference(models + "/skull.txt", SkullVertices, SkullIndices))
+	{
+		MeasureMeshlets(report, "skull", SkullVertices, SkullIndices, &SkullVertex::position);
+	}
+	else
+	{
+		std::printf("%12s not found in %s\n", "skull.txt", models.c_str());
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("%12s not found in %s\n", "soldier.m3d", models.c_str());
+		return;
+	}
+
+	MeasureMeshlets(report, "soldier", vertices, indices, &M3DLoader::SkinnedVertex::Pos);
+}
+
+// the packed vertex formats against the full float vertices of the skull, the car and the soldier
+void BenchmarkVertexCompression(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nVertexCompression (16-bit positions, octahedral normals and tangents, half uvs)\n");
+	std::printf("%12s %9s %6s %6s %9s %9s %9s %9s %9s %9s\n", "mesh", "vertices", "bytes", "packed", "pos rel", "nrm deg", "tan deg", "uv", "enc ms", "dec ms");
+
+	for (const char* name : { "skull", "car" })
+	{
+		std::vector<SkullVertex> vertices;
+		std::vector<std::int32_t> indices;
+
+		if (!LoadSkullReference(models + "/" + name + ".txt", vertices, indices))
+		{
+			std::printf("%12s.txt not found in %s\n", name, models.c_str());
+			continue;
+		}
+
+		std::vector<VertexCompression::PackedVertex> packed(vertices.size());
+		MeasureCompression(report, name, vertices, packed, &SkullVertex::position, &SkullVertex::normal, &SkullVertex::TexCoord, &SkullVertex::tangent);
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("%12s not found in %s\n", "soldier.m3d", models.c_str());
+		return;
+	}
+
+	std::vector<VertexCompression::PackedSkinnedVertex> packed(vertices.size());
+	MeasureCompression(report, "soldier", vertices, packed, &M3DLoader::SkinnedVertex::Pos, &M3DLoader::SkinnedVertex::Normal,
+					   &M3DLoader::SkinnedVertex::TexC, &M3DLoader::SkinnedVertex::TangentU);
+
+	// the skinned format also packs the bone weights, which the float pass above leaves untouched
+	VertexCompression::EncodeWeights(&vertices[0].BoneWeights, sizeof(M3DLoader::SkinnedVertex), vertices.size(), packed[0].BoneWeights, sizeof(VertexCompression::PackedSkinnedVertex));
+
+	std::vector<XMFLOAT3> weights(vertices.size());
+	VertexCompression::DecodeWeights(packed[0].BoneWeights, sizeof(VertexCompression::PackedSkinnedVertex), vertices.size(), weights.data(), sizeof(XMFLOAT3));
+
+	const VertexCompression::Error WeightError = VertexCompression::MeasureDistances(&vertices[0].BoneWeights, sizeof(M3DLoader::SkinnedVertex), weights.data(), sizeof(XMFLOAT3), vertices.size());
+
+	std::printf("%12s bone weights max %.4f rms %.4f\n", "", WeightError.max, WeightError.rms);
+
+	report.add("vertices.soldier.weights", { { "vertices", static_cast<double>(vertices.size()) } },
+			   { { "weights_max", WeightError.max }, { "weights_rms", WeightError.rms } });
+}
+
+// tangent frames on one thread and on the pool, which have to agree bit for bit. the grid and the box check them against
+// their analytic tangents; the soldier's exported tangents are only reported, since its exporter worked from data the
+// .m3d does not carry (about a third of them lie outside the spread of their vertex's triangle tangents)
+void BenchmarkTangentSpace(BenchmarkReport& report, const std::string& models)
+{
+	std::printf("\nTangentSpace\n");
+	std::printf("%12s %9s %9s %9s %9s %9s %9s %9s %9s\n", "mesh", "vertices", "serial ms", "pool ms", "threads", "same", "ref max", "ref rms", "analytic");
+
+	ThreadPool pool;
+
+	// reference is null for meshes without one, and analytic when any difference from it is an error
+	const auto measure = [&](const char* name, auto& vertices, const auto& indices, auto position, auto normal, auto TexCoord, auto tangent,
+							 const XMFLOAT3* reference, size_t ReferenceStride, bool analytic)
+	{
+		using Vertex = typename std::remove_reference_t<decltype(vertices)>::value_type;
+		using Index = typename std::remove_reference_t<decltype(indices)>::value_type;
+
+		std::vector<Vertex> serial = vertices;
+		std::vector<Vertex> parallel = vertices;
+
+		const double SerialTime = TimeCalls(5, [&]
+		{
+			TangentSpace::Generate(std::span<Vertex>(serial), std::span<const Index>(indices), position, normal, TexCoord, tangent);
+		});
+
+		const double PoolTime = TimeCalls(5, [&]
+		{
+			TangentSpace::Generate(std::span<Vertex>(parallel), std::span<const Index>(indices), position, normal, TexCoord, tangent, &pool);
+		});
+
+		const bool same = std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(Vertex)) == 0;
+
+		BenchmarkReport::Fields metrics = { { "serial_ms", SerialTime }, { "pool_ms", PoolTime }, { "same", same ? 1.0 : 0.0 } };
+
+		if (reference != nullptr)
+		{
+			const VertexCompression::Error error = VertexCompression::MeasureAngles(reference, ReferenceStride, Direction(serial[0].*tangent), sizeof(Vertex), serial.size());
+			const bool exact = error.max <= kAnalyticToleranceDeg;
+
+			std::printf("%12s %9zu %9.3f %9.3f %9d %9s %9.4f %9.4f %9s\n", name, vertices.size(), SerialTime, PoolTime, pool.GetThreadCount(), same ? "yes" : "NO",
+						error.max, error.rms, analytic ? (exact ? "yes" : "NO") : "-");
+
+			metrics.push_back({ "reference_max_deg", error.max });
+			metrics.push_back({ "reference_rms_deg", error.rms });
+
+			if (analytic)
+			{
+				metrics.push_back({ "analytic", exact ? 1.0 : 0.0 });
+			}
+		}
+		else
+		{
+			std::printf("%12s %9zu %9.3f %9.3f %9d %9s %9s %9s %9s\n", name, vertices.size(), SerialTime, PoolTime, pool.GetThreadCount(), same ? "yes" : "NO", "-", "-", "-");
+		}
+
+		report.add(std::string("tangents.") + name, { { "vertices", static_cast<double>(vertices.size()) }, { "threads", static_cast<double>(pool.GetThreadCount()) } },
+				   metrics);
+
+		return serial;
+	};
+
+	GeometryGenerator generator;
+
+	for (const auto& [name, mesh] : { std::pair("grid", generator.CreateGrid(160.0f, 160.0f, 256, 256)), std::pair("box", generator.CreateBox(1.0f, 2.0f, 3.0f)) })
+	{
+		std::vector<GeometryGenerator::VertexData> vertices = mesh.vertices;
+
+		measure(name, vertices, mesh.indices32, &GeometryGenerator::VertexData::position, &GeometryGenerator::VertexData::normal,
+				&GeometryGenerator::VertexData::TexCoord, &GeometryGenerator::VertexData::tangent, &mesh.vertices[0].tangent, sizeof(GeometryGenerator::VertexData), true);
+	}
+
+	for (const char* name : { "skull", "car" })
+	{
+		TextModelLoader::Model model;
+
+		if (!TextModelLoader::Load(models + "/" + name + ".txt", model))
+		{
+			std::printf("%12s.txt not found in %s\n", name, models.c_str());
+			continue;
+		}
+
+		measure(name, model.vertices, model.indices, &TextModelLoader::Vertex::position, &TextModelLoader::Vertex::normal,
+				&TextModelLoader::Vertex::TexCoord, &TextModelLoader::Vertex::tangent, nullptr, 0, false);
+	}
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> materials;
+	SkinnedData skinned;
+
+	M3DLoader loader;
+
+	if (!loader.LoadM3d(models + "/soldier.m3d", vertices, indices, subsets, materials, skinned))
+	{
+		std::printf("%12s not found in %s\n", "soldier.m3d", models.c_str());
+		return;
+	}
+
+	const std::vector<M3DLoader::SkinnedVertex> generated = measure("soldier", vertices, indices, &M3DLoader::SkinnedVertex::Pos, &M3DLoader::SkinnedVertex::Normal,
+																	&M3DLoader::SkinnedVertex::TexC, &M3DLoader::SkinnedVertex::TangentU,
+																	Direction(vertices[0].TangentU), sizeof(M3DLoader::SkinnedVertex), false);
+
+	// the handedness depends only on the winding of the uvs, so unlike the direction it should follow the export
+	size_t agree = 0;
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		agree += (vertices[i].TangentU.w < 0.0f) == (generated[i].TangentU.w < 0.0f);
+	}
+
+	const double AgreePercent = 100.0 * agree / vertices.size();
+
+	std::printf("%12s handedness as exported on %.2f%% of the vertices\n", "", AgreePercent);
+
+	report.add("tangents.soldier.handedness", { { "vertices", static_cast<double>(vertices.size()) } }, { { "agree_pct", AgreePercent } });
+}
@@ -0,0 +1,89 @@
+#include "SkullReference.h"
+#include "MathHelper.h"
+
+#include <cmath>
+#include <fstream>
+
+bool LoadSkullReference(const std::string& filename, std::vector<SkullVertex>& vertices, std::vector<std::int32_t>& indices)
+{
+	std::ifstream stream(filename);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	unsigned int VertexCount = 0;
+	unsigned int TriangleCount = 0;
+	std::string ignore;
+
+	stream >> ignore >> VertexCount;
+	stream >> ignore >> TriangleCount;
+	stream >> ignore >> ignore >> ignore >> ignore;
+
+	const XMFLOAT3 vMinf3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity);
+	const XMFLOAT3 vMaxf3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity);
+
+	XMVECTOR vMin = XMLoadFloat3(&vMinf3);
+	XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
+
+	vertices.assign(VertexCount, SkullVertex());
+
+	for (unsigned int i = 0; i < VertexCount; ++i)
+	{
+		stream >> vertices[i].position.x >> vertices[i].position.y >> vertices[i].position.z;
+		stream >> vertices[i].normal.x >> vertices[i].normal.y >> vertices[i].normal.z;
+
+		const XMVECTOR P = XMLoadFloat3(&vertices[i].position);
+
+		// project point onto unit sphere and generate spherical texture coordinates
+		XMFLOAT3 spherePos;
+		XMStoreFloat3(&spherePos, XMVector3Normalize(P));
+
+		float theta = std::atan2(spherePos.z, spherePos.x);
+
+		// put in [0, 2pi]
+		if (theta < 0.0f)
+		{
+			theta += XM_2PI;
+		}
+
+		const float phi = std::acos(spherePos.y);
+
+		const float u = theta / (2.0f * XM_PI);
+		const float v = phi / XM_PI;
+
+		vertices[i].TexCoord = { u, v };
+
+		const XMVECTOR N = XMLoadFloat3(&vertices[i].normal);
+
+		XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		if (std::fabs(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
+		{
+			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
+			XMStoreFloat3(&vertices[i].tangent, T);
+		}
+		else
+		{
+			up = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+			const XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, up));
+			XMStoreFloat3(&vertices[i].tangent, T);
+		}
+
+		vMin = XMVectorMin(vMin, P);
+		vMax = XMVectorMax(vMax, P);
+	}
+
+	stream >> ignore;
+	stream >> ignore;
+	stream >> ignore;
+
+	indices.assign(3 * TriangleCount, 0);
+
+	for (unsigned int i = 0; i < TriangleCount; ++i)
+	{
+		stream >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+	}
+
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// the vertex the demos build from skull.txt
+struct SkullVertex
+{
+	XMFLOAT3 position;
+	XMFLOAT3 normal;
+	XMFLOAT2 TexCoord;
+	XMFLOAT3 tangent;
+};
+
+// the skull.txt parsing loop of the demos' BuildSkullGeometry without the upload,
+// kept unchanged so the benchmarks can measure the text model loaders against it
+bool LoadSkullReference(const std::string& filename, std::vector<SkullVertex>& vertices, std::vector<std::int32_t>& indices);
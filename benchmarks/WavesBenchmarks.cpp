@@ -0,0 +1,423 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "waves.h"
+#include "WavesReference.h"
+
+namespace
+{
+	const float kTimeStep = 0.03f;
+
+	// same deterministic set of impulses for every implementation
+	template<typename W>
+	void DisturbWaves(W& waves, int n)
+	{
+		for (int k = 0; k < 64; ++k)
+		{
+			waves.disturb(2 + (k * 37) % (n - 4), 2 + (k * 91) % (n - 4), 0.5f);
+		}
+	}
+
+	// average milliseconds per simulation step
+	template<typename W>
+	double TimeWaves(W& waves, int steps)
+	{
+		return TimeCalls(steps, [&] { waves.update(kTimeStep); });
+	}
+
+	void BenchmarkWavesUpdate(BenchmarkReport& report)
+	{
+		std::printf("\nWaves::update\n");
+		std::printf("%8s %14s %14s %10s %12s\n", "grid", "reference ms", "current ms", "speedup", "max |dh|");
+
+		for (int n : { 128, 256, 512, 1024 })
+		{
+			const int steps = std::max(8, (1 << 24) / (n * n));
+
+			WavesReference reference(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			Waves waves(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			waves.SetTileTracking(0, 0.0f);
+
+			DisturbWaves(reference, n);
+			DisturbWaves(waves, n);
+
+			const double ReferenceTime = TimeWaves(reference, steps);
+			const double CurrentTime = TimeWaves(waves, steps);
+
+			float error = 0.0f;
+
+			for (int i = 0; i < waves.VertexCount(); ++i)
+			{
+				error = std::max(error, std::fabs(reference.GetPosition(i).y - waves.GetHeight(i)));
+			}
+
+			std::printf("%4dx%-4d %14.3f %14.3f %9.2fx %12g\n", n, n, ReferenceTime, CurrentTime, ReferenceTime / CurrentTime, error);
+
+			report.add("waves.update", { { "grid", n } },
+					   { { "reference_ms", ReferenceTime }, { "current_ms", CurrentTime }, { "max_dh", error } });
+		}
+	}
+
+	bool SameBits(const Waves& a, const Waves& b)
+	{
+		for (int i = 0; i < a.VertexCount(); ++i)
+		{
+			const float ha = a.GetHeight(i);
+			const float hb = b.GetHeight(i);
+
+			const XMFLOAT3 na = a.GetNormal(i);
+			const XMFLOAT3 nb = b.GetNormal(i);
+
+			if (std::memcmp(&ha, &hb, sizeof(float)) != 0 ||
+				std::memcmp(&na, &nb, sizeof(XMFLOAT3)) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void BenchmarkWavesScaling(BenchmarkReport& report)
+	{
+		const int n = 1024;
+		const int steps = 32;
+
+		std::printf("\nWaves::update thread scaling, %dx%d\n", n, n);
+		std::printf("%8s %12s %10s %10s\n", "threads", "ms/step", "speedup", "bit-exact");
+
+		Waves serial(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+		serial.SetTileTracking(0, 0.0f);
+		DisturbWaves(serial, n);
+
+		const double SerialTime = TimeWaves(serial, steps);
+
+		std::printf("%8s %12.3f %9.2fx %10s\n", "serial", SerialTime, 1.0, "-");
+
+		const int MaxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+		for (int threads = 1; threads <= MaxThreads; ++threads)
+		{
+			ThreadPool pool(threads - 1);
+
+			Waves waves(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			waves.SetTileTracking(0, 0.0f);
+			waves.SetThreadPool(&pool);
+			DisturbWaves(waves, n);
+
+			const double time = TimeWaves(waves, steps);
+
+			const bool exact = SameBits(serial, waves);
+
+			std::printf("%8d %12.3f %9.2fx %10s\n", threads, time, SerialTime / time, exact ? "yes" : "NO");
+
+			report.add("waves.update.threads", { { "grid", n }, { "threads", threads } },
+					   { { "serial_ms", SerialTime }, { "ms", time }, { "bit_exact", exact ? 1.0 : 0.0 } });
+		}
+	}
+
+	// a mostly calm 1024x1024 patch with one splash in a corner, dense update against tile tracking
+	void BenchmarkWavesTiles(BenchmarkReport& report)
+	{
+		const int n = 1024;
+		const int steps = 200;
+
+		std::printf("\nWaves::update tile tracking, %dx%d, one splash\n", n, n);
+		std::printf("%10s %12s %14s %12s\n", "mode", "ms/step", "active tiles", "max |dh|");
+
+		Waves dense(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+		Waves tiled(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+		tiled.SetTileTracking(32, 1.0e-5f);
+
+		dense.disturb(100, 100, 0.5f);
+		tiled.disturb(100, 100, 0.5f);
+
+		const double DenseTime = TimeWaves(dense, steps);
+		const double TiledTime = TimeWaves(tiled, steps);
+
+		float error = 0.0f;
+
+		for (int i = 0; i < dense.VertexCount(); ++i)
+		{
+			error = std::max(error, std::fabs(dense.GetHeight(i) - tiled.GetHeight(i)));
+		}
+
+		std::printf("%10s %12.3f %14s %12s\n", "dense", DenseTime, "-", "-");
+		std::printf("%10s %12.3f %8d/%-5d %12g\n", "tiled", TiledTime, tiled.GetActiveTileCount(), tiled.GetTileCount(), error);
+
+		report.add("waves.update.tiles", { { "grid", n }, { "steps", steps } },
+				   { { "dense_ms", DenseTime }, { "tiled_ms", TiledTime }, { "active_tiles", tiled.GetActiveTileCount() },
+					 { "tiles", tiled.GetTileCount() }, { "max_dh", error } });
+	}
+
+	// the vertex the textured demos upload
+	struct WaveVertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMFLOAT2 TexCoord;
+	};
+
+	// a frame's worth of work: one step plus filling the vertex buffer,
+	// the reference copies vertex by vertex the way the demos used to, the current one uses the fused pass
+	void BenchmarkWavesVertices(BenchmarkReport& report)
+	{
+		std::printf("\nWaves::update + vertex upload\n");
+		std::printf("%8s %14s %14s %10s %12s\n", "grid", "reference ms", "current ms", "speedup", "max |dn|");
+
+		for (int n : { 128, 256, 512, 1024 })
+		{
+			const int frames = std::max(8, (1 << 22) / (n * n));
+
+			WavesReference reference(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			Waves waves(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			waves.SetTileTracking(0, 0.0f);
+
+			DisturbWaves(reference, n);
+			DisturbWaves(waves, n);
+
+			std::vector<WaveVertex> ReferenceVertices(n * n);
+			std::vector<WaveVertex> vertices(n * n);
+
+			Waves::VertexLayout layout;
+			layout.stride = sizeof(WaveVertex);
+			layout.position = offsetof(WaveVertex, position);
+			layout.normal = offsetof(WaveVertex, normal);
+			layout.TexCoord = offsetof(WaveVertex, TexCoord);
+
+			auto start = Clock::now();
+
+			for (int f = 0; f < frames; ++f)
+			{
+				reference.update(kTimeStep);
+
+				for (int i = 0; i < reference.VertexCount(); ++i)
+				{
+					WaveVertex vertex;
+					vertex.position = reference.GetPosition(i);
+					vertex.normal = reference.GetNormal(i);
+					vertex.TexCoord.x = 0.5f + vertex.position.x / reference.GetWidth();
+					vertex.TexCoord.y = 0.5f - vertex.position.z / reference.GetDepth();
+					std::memcpy(&ReferenceVertices[i], &vertex, sizeof(WaveVertex));
+				}
+			}
+
+			const std::chrono::duration<double, std::milli> ReferenceTime = Clock::now() - start;
+
+			start = Clock::now();
+
+			for (int f = 0; f < frames; ++f)
+			{
+				waves.update(kTimeStep);
+				waves.WriteVertices(vertices.data(), layout);
+			}
+
+			const std::chrono::duration<double, std::milli> CurrentTime = Clock::now() - start;
+
+			// positions and texture coordinates are the same arithmetic, normals may differ in the last bits
+			bool exact = true;
+			float error = 0.0f;
+
+			for (int i = 0; i < n * n; ++i)
+			{
+				const WaveVertex& a = ReferenceVertices[i];
+				const WaveVertex& b = vertices[i];
+
+				exact = exact && std::memcmp(&a.position, &b.position, sizeof(XMFLOAT3)) == 0 &&
+								 std::memcmp(&a.TexCoord, &b.TexCoord, sizeof(XMFLOAT2)) == 0;
+
+				error = std::max({ error, std::fabs(a.normal.x - b.normal.x), std::fabs(a.normal.y - b.normal.y), std::fabs(a.normal.z - b.normal.z) });
+			}
+
+			std::printf("%4dx%-4d %14.3f %14.3f %9.2fx %12g%s\n", n, n, ReferenceTime.count() / frames, CurrentTime.count() / frames,
+						ReferenceTime.count() / CurrentTime.count(), error, exact ? "" : " (positions differ)");
+
+			report.add("waves.vertices", { { "grid", n } },
+					   { { "reference_ms", ReferenceTime.count() / frames }, { "current_ms", CurrentTime.count() / frames },
+						 { "max_dn", error }, { "positions_exact", exact ? 1.0 : 0.0 } });
+		}
+	}
+
+	// rain: small splashes every frame, one disturb call each against one batch per frame, serial and across a pool.
+	// a batch is only queued by disturb and added by the step's own row pass, so what counts is the whole frame, disturb
+	// and update, against the single calls with the same threads. the batch saves the cache misses of splashing into
+	// a field that no longer fits the cache, so the larger patch is where it shows
+	void BenchmarkWavesImpulses(BenchmarkReport& report)
+	{
+		struct Rain
+		{
+			int n;
+			int drops;
+			int frames;
+		};
+
+		ThreadPool pool;
+
+		for (const Rain& rain : { Rain{ 1024, 512, 64 }, Rain{ 1024, 4096, 64 }, Rain{ 2048, 16384, 32 } })
+		{
+			const int n = rain.n;
+			const int drops = rain.drops;
+			const int frames = rain.frames;
+
+			std::printf("\nWaves::disturb, %dx%d, %d impulses per frame\n", n, n, drops);
+			std::printf("%14s %12s %12s %9s %9s\n", "mode", "disturb ms", "frame ms", "speedup", "same");
+
+			std::vector<Waves::Impulse> impulses(drops);
+			std::vector<float> expected;
+
+			double SingleTime = 0.0;
+
+			for (const int mode : { 0, 1, 2, 3 })
+			{
+				const bool batched = mode == 1 || mode == 3;
+				const bool pooled = mode >= 2;
+				const char* name = mode == 0 ? "single" : mode == 1 ? "batched" : mode == 2 ? "single pool" : "batched pool";
+
+				Waves waves(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+
+				if (pooled)
+				{
+					waves.SetThreadPool(&pool);
+				}
+
+				std::mt19937 random(kBenchmarkSeed);
+
+				double DisturbTime = 0.0;
+				double FrameTime = 0.0;
+
+				for (int f = 0; f < frames; ++f)
+				{
+					for (Waves::Impulse& impulse : impulses)
+					{
+						impulse = { static_cast<int>(random() % n), static_cast<int>(random() % n), 0.05f, 1.0f };
+					}
+
+					const auto start = Clock::now();
+
+					if (batched)
+					{
+						waves.disturb(impulses);
+					}
+					else
+					{
+						for (const Waves::Impulse& impulse : impulses)
+						{
+							waves.disturb(impulse.i, impulse.j, impulse.magnitude);
+						}
+					}
+
+					const auto disturbed = Clock::now();
+
+					waves.update(kTimeStep);
+
+					const std::chrono::duration<double, std::milli> disturb = disturbed - start;
+					const std::chrono::duration<double, std::milli> frame = Clock::now() - start;
+					DisturbTime += disturb.count() / frames;
+					FrameTime += frame.count() / frames;
+				}
+
+				// the same splashes in the same order, so every mode ends on the same heights to the bit
+				std::vector<float> heights(waves.VertexCount());
+
+				for (int i = 0; i < waves.VertexCount(); ++i)
+				{
+					heights[i] = waves.GetHeight(i);
+				}
+
+				if (mode == 0)
+				{
+					expected = heights;
+				}
+
+				if (!batched)
+				{
+					SingleTime = FrameTime;
+				}
+
+				const bool same = std::memcmp(heights.data(), expected.data(), heights.size() * sizeof(float)) == 0;
+				const double speedup = SingleTime / FrameTime;
+
+				std::printf("%14s %12.3f %12.3f %8.2fx %9s\n", name, DisturbTime, FrameTime, speedup, same ? "yes" : "NO");
+
+				report.add(std::string("waves.disturb.") + (batched ? "batched" : "single") + (pooled ? "_pool." : ".") + std::to_string(n) + "." + std::to_string(drops),
+						   { { "grid", n }, { "impulses", drops }, { "threads", pooled ? pool.GetThreadCount() : 0 } },
+						   { { "disturb_ms", DisturbTime }, { "frame_ms", FrameTime }, { "speedup", speedup }, { "same", same ? 1.0 : 0.0 } });
+			}
+		}
+	}
+
+	// float against 16-bit fixed point storage: time per step and how far the fixed point field drifts from the float one,
+	// a coarser scale has more headroom before heights saturate, a finer one less rounding noise
+	void BenchmarkWavesStorage(BenchmarkReport& report)
+	{
+		const int steps = 200;
+
+		std::printf("\nWaves::update height storage, float against fixed16 after %d steps\n", steps);
+		std::printf("%10s %8s %10s %12s %10s %12s %12s %14s\n", "grid", "1/scale", "float ms", "fixed16 ms", "speedup", "max |dh|", "rms dh", "max normal deg");
+
+		for (int n : { 512, 1024, 2048 })
+		{
+			Waves reference(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+			reference.SetTileTracking(0, 0.0f);
+
+			DisturbWaves(reference, n);
+
+			const double ReferenceTime = TimeWaves(reference, steps);
+
+			for (float units : { 2048.0f, 4096.0f, 8192.0f })
+			{
+				Waves waves(n, n, kTimeStep, 1.0f, 4.0f, 0.2f);
+				waves.SetTileTracking(0, 0.0f);
+				waves.SetHeightStorage(Waves::HeightStorage::Fixed16, 1.0f / units);
+
+				DisturbWaves(waves, n);
+
+				const double FixedTime = TimeWaves(waves, steps);
+
+				float error = 0.0f;
+				double squares = 0.0;
+				float angle = 0.0f;
+
+				for (int i = 0; i < n * n; ++i)
+				{
+					const float dh = std::fabs(reference.GetHeight(i) - waves.GetHeight(i));
+
+					error = std::max(error, dh);
+					squares += static_cast<double>(dh) * dh;
+
+					const XMFLOAT3 a = reference.GetNormal(i);
+					const XMFLOAT3 b = waves.GetNormal(i);
+					const float cosine = std::min(a.x * b.x + a.y * b.y + a.z * b.z, 1.0f);
+
+					angle = std::max(angle, std::acos(cosine) * 57.2957795f);
+				}
+
+				std::printf("%4dx%-5d %8g %10.3f %12.3f %9.2fx %12g %12g %14g\n", n, n, units, ReferenceTime, FixedTime, ReferenceTime / FixedTime,
+							error, std::sqrt(squares / (static_cast<double>(n) * n)), angle);
+
+				report.add("waves.storage.fixed16", { { "grid", n }, { "units", units } },
+						   { { "float_ms", ReferenceTime }, { "fixed16_ms", FixedTime }, { "max_dh", error },
+							 { "rms_dh", std::sqrt(squares / (static_cast<double>(n) * n)) }, { "max_normal_deg", angle } });
+			}
+		}
+	}
+}
+
+void BenchmarkWaves(BenchmarkReport& report)
+{
+	BenchmarkWavesUpdate(report);
+	BenchmarkWavesScaling(report);
+	BenchmarkWavesTiles(report);
+	BenchmarkWavesVertices(report);
+	BenchmarkWavesImpulses(report);
+	BenchmarkWavesStorage(report);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// the original AoS Waves solver the demos shipped with,
+// kept unchanged so the benchmarks can measure the current implementation against it
+class WavesReference
+{
+	int mRowCount = 0;
+	int mColCount = 0;
+
+	int mVertexCount = 0;
+	int mTriangleCount = 0;
+
+	float mK1 = 0.0f;
+	float mK2 = 0.0f;
+	float mK3 = 0.0f;
+
+	float mTimeStep = 0.0f;
+	float mSpaceStep = 0.0f;
+
+	std::vector<XMFLOAT3> mPrevData;
+	std::vector<XMFLOAT3> mCurrData;
+	
+	std::vector<XMFLOAT3> mNormals;
+
+public:
+	WavesReference(int rows, int cols, float dt, float dx, float speed, float damping);
+	~WavesReference();
+
+	int RowCount() const;
+	int ColCount() const;
+	int VertexCount() const;
+	int TriangleCount() const;
+	float GetWidth() const;
+	float GetDepth() const;
+
+	const XMFLOAT3& GetPosition(int i) const;
+	const XMFLOAT3& GetNormal(int i) const;
+
+	void update(float dt);
+	void disturb(int i, int j, float magnitude);
+};
+
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "BenchmarkReport.h"
+
+using Clock = std::chrono::steady_clock;
+
+// every random input is drawn from generators seeded with this, so runs are comparable
+const unsigned int kBenchmarkSeed = 1234;
+
+// average milliseconds per call over a fixed number of runs, after one untimed warm-up call
+template<typename F>
+double TimeCalls(int runs, F&& f)
+{
+	f();
+
+	const auto start = Clock::now();
+
+	for (int r = 0; r < runs; ++r)
+	{
+		f();
+	}
+
+	const std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+
+	return elapsed.count() / runs;
+}
+
+// heap allocations made through operator new since the start of the program
+size_t AllocationCount();
+
+// one suite per subsystem, each prints a table and adds its numbers to the report
+void BenchmarkWaves(BenchmarkReport& report);
+void BenchmarkGeometry(BenchmarkReport& report);
+void BenchmarkMeshOptimizer(BenchmarkReport& report, const std::string& models);
+void BenchmarkMeshSimplifier(BenchmarkReport& report, const std::string& models);
+void BenchmarkMeshlets(BenchmarkReport& report, const std::string& models);
+void BenchmarkVertexCompression(BenchmarkReport& report, const std::string& models);
+void BenchmarkTangentSpace(BenchmarkReport& report, const std::string& models);
+void BenchmarkCamera(BenchmarkReport& report);
+void BenchmarkBlur(BenchmarkReport& report);
+void BenchmarkAnimation(BenchmarkReport& report, const std::string& models);
+void BenchmarkCrowd(BenchmarkReport& report, const std::string& models);
+void BenchmarkLoaders(BenchmarkReport& report, const std::string& models);
+void BenchmarkMeshCache(BenchmarkReport& report, const std::string& models);
+void BenchmarkAssetPipeline(BenchmarkReport& report, const std::string& models);
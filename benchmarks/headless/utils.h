@@ -0,0 +1,28 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+// stand-in for common/utils.h, found first on the benchmarks' include path so the CPU-side
+// sources that include utils.h only for these few types build without Direct3D, imgui or windows.h
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+#include "MathHelper.h"
+
+using BYTE = std::uint8_t;
+using USHORT = std::uint16_t;
+using INT = std::int32_t;
+using UINT = std::uint32_t;
+
+// the windows.h macros the sources use
+using std::min;
+using std::max;
+
+#endif // UTILS_H
@@ -0,0 +1,101 @@
+// headless CPU benchmarks for the code the demos share, no window or device required
+//
+// usage: benchmarks [--json <file>] [--models <directory>] [suite ...]
+// suites: waves geometry mesh lod meshlets vertices tangents camera blur animation crowd loaders cache pipeline (all of them by default),
+// tables go to stdout, --json also writes every measurement to file so runs can be compared
+
+#include "benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// where the demos' models live, relative to the working directory unless the build says otherwise
+#ifndef BENCHMARK_MODELS_DIR
+#define BENCHMARK_MODELS_DIR "../models"
+#endif
+
+int main(int argc, char** argv)
+{
+	std::string json;
+	std::string models = BENCHMARK_MODELS_DIR;
+	std::vector<std::string> selected;
+
+	for (int a = 1; a < argc; ++a)
+	{
+		if (std::strcmp(argv[a], "--json") == 0 && a + 1 < argc)
+		{
+			json = argv[++a];
+		}
+		else if (std::strcmp(argv[a], "--models") == 0 && a + 1 < argc)
+		{
+			models = argv[++a];
+		}
+		else
+		{
+			selected.push_back(argv[a]);
+		}
+	}
+
+	BenchmarkReport report;
+
+	const std::pair<const char*, std::function<void()>> suites[] =
+	{
+		{ "waves", [&] { BenchmarkWaves(report); } },
+		{ "geometry", [&] { BenchmarkGeometry(report); } },
+		{ "mesh", [&] { BenchmarkMeshOptimizer(report, models); } },
+		{ "lod", [&] { BenchmarkMeshSimplifier(report, models); } },
+		{ "meshlets", [&] { BenchmarkMeshlets(report, models); } },
+		{ "vertices", [&] { BenchmarkVertexCompression(report, models); } },
+		{ "tangents", [&] { BenchmarkTangentSpace(report, models); } },
+		{ "camera", [&] { BenchmarkCamera(report); } },
+		{ "blur", [&] { BenchmarkBlur(report); } },
+		{ "animation", [&] { BenchmarkAnimation(report, models); } },
+		{ "crowd", [&] { BenchmarkCrowd(report, models); } },
+		{ "loaders", [&] { BenchmarkLoaders(report, models); } },
+		{ "cache", [&] { BenchmarkMeshCache(report, models); } },
+		{ "pipeline", [&] { BenchmarkAssetPipeline(report, models); } },
+	};
+
+	for (const auto& suite : suites)
+	{
+		bool run = selected.empty();
+
+		for (const std::string& name : selected)
+		{
+			run = run || name == suite.first;
+		}
+
+		if (run)
+		{
+			suite.second();
+		}
+	}
+
+	if (json.empty())
+	{
+		return 0;
+	}
+
+	const BenchmarkReport::Fields context =
+	{
+		{ "seed", kBenchmarkSeed },
+		{ "hardware_threads", std::thread::hardware_concurrency() },
+	};
+
+	std::FILE* file = std::fopen(json.c_str(), "w");
+
+	if (file == nullptr)
+	{
+		std::fprintf(stderr, "cannot write %s\n", json.c_str());
+		return 1;
+	}
+
+	report.write(file, context);
+	std::fclose(file);
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include "AssetPipeline.h"
+
+AssetPipeline::AssetPipeline(int WorkerCount)
+{
+	for (int i = 0; i < WorkerCount; ++i)
+	{
+		mWorkers.emplace_back(&AssetPipeline::WorkerLoop, this);
+	}
+}
+
+AssetPipeline::~AssetPipeline()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mCondition.notify_all();
+
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+AssetPipeline::Handle AssetPipeline::add(std::function<void()> work, std::initializer_list<Handle> dependencies)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	const Handle handle = mJobs.size();
+
+	Job& job = mJobs.emplace_back();
+	job.work = std::move(work);
+
+	for (const Handle dependency : dependencies)
+	{
+		// a handle from this pipeline is always an earlier job, so the graph has no cycles
+		if (dependency < handle && !mJobs[dependency].done)
+		{
+			mJobs[dependency].dependents.push_back(handle);
+			++job.PendingDependencies;
+		}
+	}
+
+	++mUnfinished;
+
+	if (job.PendingDependencies == 0)
+	{
+		mReady.push_back(handle);
+
+		lock.unlock();
+		mCondition.notify_all();
+	}
+
+	return handle;
+}
+
+void AssetPipeline::run(Handle handle, std::unique_lock<std::mutex>& lock)
+{
+	std::function<void()> work = std::move(mJobs[handle].work);
+
+	lock.unlock();
+
+	// submit() wraps every job in a packaged_task, which keeps what it throws for the future
+	work();
+	work = nullptr;
+
+	lock.lock();
+
+	Job& job = mJobs[handle];
+	job.done = true;
+
+	for (const Handle dependent : job.dependents)
+	{
+		if (--mJobs[dependent].PendingDependencies == 0)
+		{
+			mReady.push_back(dependent);
+		}
+	}
+
+	job.dependents.clear();
+	--mUnfinished;
+
+	mCondition.notify_all();
+}
+
+void AssetPipeline::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	for (;;)
+	{
+		mCondition.wait(lock, [this] { return mQuit || !mReady.empty(); });
+
+		if (mReady.empty())
+		{
+			return;
+		}
+
+		const Handle handle = mReady.front();
+		mReady.pop_front();
+
+		run(handle, lock);
+	}
+}
+
+void AssetPipeline::wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	while (mUnfinished > 0)
+	{
+		if (mReady.empty())
+		{
+			mCondition.wait(lock, [this] { return mUnfinished == 0 || !mReady.empty(); });
+			continue;
+		}
+
+		const Handle handle = mReady.front();
+		mReady.pop_front();
+
+		run(handle, lock);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// loads assets as a graph of jobs on worker threads: reading a file, parsing it and processing the result (tangents,
+// bounds, reordering) are separate jobs that start as soon as the jobs they depend on are done, so independent assets
+// load side by side and startup costs about as much as the slowest asset rather than the sum of all of them.
+// wait() is the barrier before the GPU upload, which stays on the thread that owns the command list.
+//
+// a job runs on whichever thread is free, so it must only touch what no other running job touches. the ThreadPool a
+// loader takes is not shared between threads: give it to a single job, or let the jobs run their loaders serially
+class AssetPipeline
+{
+public:
+	// names a job, to make later jobs wait for it
+	using Handle = size_t;
+
+	// a job and its result; get() blocks until the job is done and rethrows what the job threw
+	template<typename T>
+	struct Asset
+	{
+		Handle handle = 0;
+		std::shared_future<T> future;
+
+		decltype(auto) get() const { return future.get(); }
+	};
+
+private:
+	struct Job
+	{
+		std::function<void()> work;
+		std::vector<Handle> dependents;
+		int PendingDependencies = 0;
+		bool done = false;
+	};
+
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+
+	// a deque, so adding a job never moves the ones being run
+	std::deque<Job> mJobs;
+	std::deque<Handle> mReady;
+	size_t mUnfinished = 0;
+	bool mQuit = false;
+
+	Handle add(std::function<void()> work, std::initializer_list<Handle> dependencies);
+
+	void WorkerLoop();
+
+	// runs job and releases its dependents; lock is held on entry and on return
+	void run(Handle job, std::unique_lock<std::mutex>& lock);
+
+public:
+	// the thread that calls wait() runs jobs too, so WorkerCount = N - 1 keeps N cores busy
+	explicit AssetPipeline(int WorkerCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+	AssetPipeline(const AssetPipeline& rhs) = delete;
+	AssetPipeline& operator=(const AssetPipeline& rhs) = delete;
+
+	// waits for every job first
+	~AssetPipeline();
+
+	// queues work to run once every job in dependencies is done. the result, or what work throws, ends up in the
+	// returned asset; a job depending on a failed one still runs, and its get() on the failed one rethrows. may be
+	// called from inside a job, to queue work that depends on what the job found out
+	template<typename Function>
+	Asset<std::invoke_result_t<Function&>> submit(Function&& work, std::initializer_list<Handle> dependencies = {})
+	{
+		using Result = std::invoke_result_t<Function&>;
+
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(work));
+
+		Asset<Result> asset;
+		asset.future = task->get_future().share();
+		asset.handle = add([task] { (*task)(); }, dependencies);
+
+		return asset;
+	}
+
+	// the completion barrier: returns once every job submitted so far, and every job they submitted, is done.
+	// the calling thread runs jobs while it waits
+	void wait();
+};
@@ -1,5 +1,9 @@
 #include "GeometryGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 GeometryGenerator::VertexData::VertexData()
 {}
@@ -18,21 +22,148 @@ std::vector<uint16_t>& GeometryGenerator::MeshData::GetIndices16()
 {
 	if (indices16.empty())
 	{
-		for (uint32_t i : indices32)
+		indices16.resize(indices32.size());
+
+		for (size_t i = 0; i < indices32.size(); ++i)
 		{
-			indices16.push_back(static_cast<uint16_t>(i));
+			indices16[i] = static_cast<uint16_t>(indices32[i]);
 		}
 	}
 
 	return indices16;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32_t subdivisions)
+namespace
+{
+	// fail early on spans smaller than the shape or on indices that would not fit the index type
+	template<typename Index>
+	void CheckSpans([[maybe_unused]] const GeometryGenerator::MeshSpans<Index>& mesh, [[maybe_unused]] GeometryGenerator::MeshSize size)
+	{
+		assert(mesh.vertices.size() >= size.VertexCount);
+		assert(mesh.indices.size() >= size.IndexCount);
+		assert(size.VertexCount == 0 || size.VertexCount - 1 <= std::numeric_limits<Index>::max());
+	}
+
+	GeometryGenerator::MeshData AllocateMesh(GeometryGenerator::MeshSize size)
+	{
+		GeometryGenerator::MeshData mesh;
+		mesh.vertices.resize(size.VertexCount);
+		mesh.indices32.resize(size.IndexCount);
+
+		return mesh;
+	}
+}
+
+void GeometryGenerator::SetThreadPool(ThreadPool* pool, int BandRows)
+{
+	mThreadPool = pool;
+	mBandRows = std::max(BandRows, 0);
+}
+
+void GeometryGenerator::ForEachBand(uint32_t first, uint32_t last, const std::function<void(uint32_t, uint32_t)>& pass) const
+{
+	uint32_t BandRows = last - first;
+
+	if (mThreadPool != nullptr)
+	{
+		// a few bands per thread to even out the load, but not so thin that the dispatch costs more than the rows
+		BandRows = mBandRows > 0 ? mBandRows : std::max((last - first) / (4 * mThreadPool->GetThreadCount()), 8u);
+	}
+
+	if (BandRows >= last - first)
+	{
+		pass(first, last);
+		return;
+	}
+
+	const uint32_t BandCount = (last - first + BandRows - 1) / BandRows;
+
+	mThreadPool->ParallelFor(static_cast<int>(BandCount), [&](int band)
+	{
+		const uint32_t RowBegin = first + band * BandRows;
+		const uint32_t RowEnd = std::min(RowBegin + BandRows, last);
+
+		pass(RowBegin, RowEnd);
+	});
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::BoxSize()
+{
+	return { 24, 36 };
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GridSize(uint32_t m, uint32_t n)
+{
+	return { m * n, (m - 1) * (n - 1) * 6 };
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::CylinderSize(uint32_t SliceCount, uint32_t StackCount)
+{
+	// side rings, then a ring and a centre vertex per cap
+	uint32_t RingVertexCount = SliceCount + 1;
+
+	return { (StackCount + 1) * RingVertexCount + 2 * (RingVertexCount + 1), StackCount * SliceCount * 6 + 2 * SliceCount * 3 };
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::SphereSize(uint32_t SliceCount, uint32_t StackCount)
+{
+	// two poles and the rings between them, a fan at each pole and quads in between
+	uint32_t RingVertexCount = SliceCount + 1;
+
+	return { 2 + (StackCount - 1) * RingVertexCount, 2 * SliceCount * 3 + (StackCount - 2) * SliceCount * 6 };
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::QuadSize()
+{
+	return { 4, 6 };
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth)
+{
+	MeshData mesh = AllocateMesh(BoxSize());
+	CreateBox<uint32_t>(width, height, depth, { mesh.vertices, mesh.indices32 });
+
+	return mesh;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32_t m, uint32_t n, const Displacement& displace)
+{
+	MeshData mesh = AllocateMesh(GridSize(m, n));
+	CreateGrid<uint32_t>(width, depth, m, n, { mesh.vertices, mesh.indices32 }, displace);
+
+	return mesh;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount, const Displacement& displace)
 {
-	MeshData mesh;
+	MeshData mesh = AllocateMesh(CylinderSize(SliceCount, StackCount));
+	CreateCylinder<uint32_t>(RadiusBottom, RadiusTop, height, SliceCount, StackCount, { mesh.vertices, mesh.indices32 }, displace);
 
-	std::vector<VertexData>& vertices = mesh.vertices;
-	vertices.resize(24);
+	return mesh;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount, const Displacement& displace)
+{
+	MeshData mesh = AllocateMesh(SphereSize(SliceCount, StackCount));
+	CreateSphere<uint32_t>(radius, SliceCount, StackCount, { mesh.vertices, mesh.indices32 }, displace);
+
+	return mesh;
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
+{
+	MeshData mesh = AllocateMesh(QuadSize());
+	CreateQuad<uint32_t>(x, y, w, h, depth, { mesh.vertices, mesh.indices32 });
+
+	return mesh;
+}
+
+template<typename Index>
+void GeometryGenerator::CreateBox(float width, float height, float depth, MeshSpans<Index> mesh)
+{
+	CheckSpans(mesh, BoxSize());
+
+	std::span<VertexData> vertices = mesh.vertices;
 
 	// half extents
 	float w = 0.5f * width;
@@ -75,44 +206,28 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	vertices[22] = VertexData(+w, +h, +d, +1,  0,  0,  0,  0, +1, +1,  0);
 	vertices[23] = VertexData(+w, -h, +d, +1,  0,  0,  0,  0, +1, +1, +1);
 
-	std::vector<uint32_t>& indices = mesh.indices32;
-	indices.resize(36);
-
-	// front
-	indices[ 0] =  0; indices[ 1] =  1; indices[ 2] =  2;
-	indices[ 3] =  0; indices[ 4] =  2; indices[ 5] =  3;
-
-	// back
-	indices[ 6] =  4; indices[ 7] =  5; indices[ 8] =  6;
-	indices[ 9] =  4; indices[10] =  6; indices[11] =  7;
-
-	// top
-	indices[12] =  8; indices[13] =  9; indices[14] = 10;
-	indices[15] =  8; indices[16] = 10; indices[17] = 11;
-
-	// bottom
-	indices[18] = 12; indices[19] = 13; indices[20] = 14;
-	indices[21] = 12; indices[22] = 14; indices[23] = 15;
+	std::span<Index> indices = mesh.indices;
 
-	// left
-	indices[24] = 16; indices[25] = 17; indices[26] = 18;
-	indices[27] = 16; indices[28] = 18; indices[29] = 19;
-
-	// right
-	indices[30] = 20; indices[31] = 21; indices[32] = 22;
-	indices[33] = 20; indices[34] = 22; indices[35] = 23;
+	// two triangles (0, 1, 2) and (0, 2, 3) per face, faces in the order above
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		Index base = static_cast<Index>(4 * face);
+		std::span<Index> quad = indices.subspan(6 * face, 6);
 
-	// TODO: subdivisions
+		quad[0] = base;
+		quad[1] = static_cast<Index>(base + 1);
+		quad[2] = static_cast<Index>(base + 2);
 
-	return mesh;
+		quad[3] = base;
+		quad[4] = static_cast<Index>(base + 2);
+		quad[5] = static_cast<Index>(base + 3);
+	}
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32_t m, uint32_t n)
+template<typename Index>
+void GeometryGenerator::CreateGrid(float width, float depth, uint32_t m, uint32_t n, MeshSpans<Index> mesh, const Displacement& displace)
 {
-	MeshData mesh;
-
-	uint32_t VertexCount = m * n;
-	uint32_t FaceCount = (m - 1) * (n - 1) * 2;
+	CheckSpans(mesh, GridSize(m, n));
 
 	float HalfWidth = 0.5f * width;
 	float HalfDepth = 0.5f * depth;
@@ -123,120 +238,137 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n - 1);
 	float dv = 1.0f / (m - 1);
 
-	mesh.vertices.resize(VertexCount);
-
-	for (uint32_t i = 0; i < m; ++i)
+	// a band writes the vertices of its rows and the quads below them
+	ForEachBand(0, m, [&](uint32_t RowBegin, uint32_t RowEnd)
 	{
-		float z = HalfDepth - i * dz;
-
-		for (uint32_t j = 0; j < n; ++j)
+		for (uint32_t i = RowBegin; i < RowEnd; ++i)
 		{
-			float x = j * dx - HalfWidth;
+			float z = HalfDepth - i * dz;
 
-			mesh.vertices[i * n + j].position = XMFLOAT3(x, 0.0f, z);
-			mesh.vertices[i * n + j].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			mesh.vertices[i * n + j].tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
-			mesh.vertices[i * n + j].TexCoord = XMFLOAT2(j * du, i * dv);
-		}
-	}
+			for (uint32_t j = 0; j < n; ++j)
+			{
+				float x = j * dx - HalfWidth;
 
-	mesh.indices32.resize(FaceCount * 3);
+				VertexData& vertex = mesh.vertices[i * n + j];
 
-	uint32_t k = 0;
+				vertex.position = XMFLOAT3(x, 0.0f, z);
+				vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				vertex.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				vertex.TexCoord = XMFLOAT2(j * du, i * dv);
 
-	for (uint32_t i = 0; i < m - 1; ++i)
-	{
-		for (uint32_t j = 0; j < n - 1; ++j)
-		{
-			mesh.indices32[k + 0] = (i + 0) * n + (j + 0);
-			mesh.indices32[k + 1] = (i + 0) * n + (j + 1);
-			mesh.indices32[k + 2] = (i + 1) * n + (j + 0);
+				if (displace)
+				{
+					displace(vertex);
+				}
+			}
 
-			mesh.indices32[k + 3] = (i + 1) * n + (j + 0);
-			mesh.indices32[k + 4] = (i + 0) * n + (j + 1);
-			mesh.indices32[k + 5] = (i + 1) * n + (j + 1);
+			if (i == m - 1)
+			{
+				continue;
+			}
 
-			k += 6;
-		}
-	}
+			uint32_t k = i * (n - 1) * 6;
 
-	return mesh;
+			for (uint32_t j = 0; j < n - 1; ++j)
+			{
+				mesh.indices[k + 0] = static_cast<Index>((i + 0) * n + (j + 0));
+				mesh.indices[k + 1] = static_cast<Index>((i + 0) * n + (j + 1));
+				mesh.indices[k + 2] = static_cast<Index>((i + 1) * n + (j + 0));
+
+				mesh.indices[k + 3] = static_cast<Index>((i + 1) * n + (j + 0));
+				mesh.indices[k + 4] = static_cast<Index>((i + 0) * n + (j + 1));
+				mesh.indices[k + 5] = static_cast<Index>((i + 1) * n + (j + 1));
+
+				k += 6;
+			}
+		}
+	});
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount)
+template<typename Index>
+void GeometryGenerator::CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount, MeshSpans<Index> mesh, const Displacement& displace)
 {
-	MeshData mesh;
+	CheckSpans(mesh, CylinderSize(SliceCount, StackCount));
 
 	float StackHeight = height / StackCount;
 
 	float RadiusStep = (RadiusTop - RadiusBottom) / StackCount;
 
 	uint32_t RingCount = StackCount + 1;
+	uint32_t RingVertexCount = SliceCount + 1;
 
 	float DeltaTheta = 2.0f * XM_PI / SliceCount;
 
-	for (uint32_t i = 0; i < RingCount; ++i)
+	// a band writes the vertices of its rings and the quads above them
+	ForEachBand(0, RingCount, [&](uint32_t RingBegin, uint32_t RingEnd)
 	{
-		float y = i * StackHeight - 0.5f * height;
-		float r = RadiusBottom + i * RadiusStep;
-
-		for (uint32_t j = 0; j <= SliceCount; ++j)
+		for (uint32_t i = RingBegin; i < RingEnd; ++i)
 		{
-			VertexData vertex;
+			float y = i * StackHeight - 0.5f * height;
+			float r = RadiusBottom + i * RadiusStep;
 
-			float c = std::cos(j * DeltaTheta);
-			float s = std::sin(j * DeltaTheta);
+			for (uint32_t j = 0; j <= SliceCount; ++j)
+			{
+				VertexData& vertex = mesh.vertices[i * RingVertexCount + j];
 
-			vertex.position = XMFLOAT3(r * c, y, r * s);
+				float c = std::cos(j * DeltaTheta);
+				float s = std::sin(j * DeltaTheta);
 
-			vertex.TexCoord.x = static_cast<float>(j) / SliceCount;
-			vertex.TexCoord.y = 1.0f - static_cast<float>(i) / StackCount;
+				vertex.position = XMFLOAT3(r * c, y, r * s);
 
-			vertex.tangent = XMFLOAT3(-s, 0.0f, +c);
+				vertex.TexCoord.x = static_cast<float>(j) / SliceCount;
+				vertex.TexCoord.y = 1.0f - static_cast<float>(i) / StackCount;
 
-			float DeltaRadius = RadiusBottom - RadiusTop;
+				vertex.tangent = XMFLOAT3(-s, 0.0f, +c);
 
-			XMFLOAT3 bitangent(DeltaRadius * c, -height, DeltaRadius * s);
+				float DeltaRadius = RadiusBottom - RadiusTop;
 
-			XMVECTOR T = XMLoadFloat3(&vertex.tangent);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.normal, N);
+				XMFLOAT3 bitangent(DeltaRadius * c, -height, DeltaRadius * s);
 
-			mesh.vertices.push_back(vertex);
-		}
-	}
+				XMVECTOR T = XMLoadFloat3(&vertex.tangent);
+				XMVECTOR B = XMLoadFloat3(&bitangent);
+				XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+				XMStoreFloat3(&vertex.normal, N);
 
-	uint32_t RingVertexCount = SliceCount + 1;
+				if (displace)
+				{
+					displace(vertex);
+				}
+			}
 
-	for (uint32_t i = 0; i < StackCount; ++i)
-	{
-		for (uint32_t j = 0; j < SliceCount; ++j)
-		{
-			mesh.indices32.push_back((i + 0) * RingVertexCount + (j + 0));
-			mesh.indices32.push_back((i + 1) * RingVertexCount + (j + 0));
-			mesh.indices32.push_back((i + 1) * RingVertexCount + (j + 1));
+			if (i == StackCount)
+			{
+				continue;
+			}
+
+			uint32_t k = i * SliceCount * 6;
+
+			for (uint32_t j = 0; j < SliceCount; ++j)
+			{
+				mesh.indices[k++] = static_cast<Index>((i + 0) * RingVertexCount + (j + 0));
+				mesh.indices[k++] = static_cast<Index>((i + 1) * RingVertexCount + (j + 0));
+				mesh.indices[k++] = static_cast<Index>((i + 1) * RingVertexCount + (j + 1));
 
-			mesh.indices32.push_back((i + 0) * RingVertexCount + (j + 0));
-			mesh.indices32.push_back((i + 1) * RingVertexCount + (j + 1));
-			mesh.indices32.push_back((i + 0) * RingVertexCount + (j + 1));
+				mesh.indices[k++] = static_cast<Index>((i + 0) * RingVertexCount + (j + 0));
+				mesh.indices[k++] = static_cast<Index>((i + 1) * RingVertexCount + (j + 1));
+				mesh.indices[k++] = static_cast<Index>((i + 0) * RingVertexCount + (j + 1));
+			}
 		}
-	}
+	});
+
+	// the caps follow the side, top first
+	uint32_t next = RingCount * RingVertexCount;
+	uint32_t k = StackCount * SliceCount * 6;
 
-	auto BuildCylinderCap = [](MeshData& mesh,
-							   float height,
-							   uint32_t SliceCount,
-							   float DeltaTheta,
-							   float sign,
-							   float radius)
+	auto BuildCylinderCap = [&](float sign, float radius)
 	{
-		uint32_t BaseIndex = mesh.vertices.size();
+		uint32_t BaseIndex = next;
 
 		float y = sign * 0.5f * height;
 
 		for (uint32_t j = 0; j <= SliceCount; ++j)
 		{
-			VertexData vertex;
+			VertexData& vertex = mesh.vertices[next++];
 
 			float x = radius * std::cos(j * DeltaTheta);
 			float z = radius * std::sin(j * DeltaTheta);
@@ -249,134 +381,154 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float RadiusBottom
 			vertex.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
 			vertex.TexCoord = XMFLOAT2(u, v);
 
-			mesh.vertices.push_back(vertex);
+			if (displace)
+			{
+				displace(vertex);
+			}
 		}
 
-		VertexData CenterVertex;
+		VertexData& CenterVertex = mesh.vertices[next++];
 
 		CenterVertex.position = XMFLOAT3(0.0f, y, 0.0f);
 		CenterVertex.normal = XMFLOAT3(0.0f, sign, 0.0f);
 		CenterVertex.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
 		CenterVertex.TexCoord = XMFLOAT2(0.5f, 0.5f);
 
-		mesh.vertices.push_back(CenterVertex);
+		if (displace)
+		{
+			displace(CenterVertex);
+		}
 
-		uint32_t CenterIndex = mesh.vertices.size() - 1;
+		uint32_t CenterIndex = next - 1;
 
 		for (uint32_t j = 0; j < SliceCount; ++j)
 		{
-			mesh.indices32.push_back(CenterIndex);
-			mesh.indices32.push_back(BaseIndex + j + (sign > 0 ? 1 : 0));
-			mesh.indices32.push_back(BaseIndex + j + (sign > 0 ? 0 : 1));
+			mesh.indices[k++] = static_cast<Index>(CenterIndex);
+			mesh.indices[k++] = static_cast<Index>(BaseIndex + j + (sign > 0 ? 1 : 0));
+			mesh.indices[k++] = static_cast<Index>(BaseIndex + j + (sign > 0 ? 0 : 1));
 		}
 	};
 
-	BuildCylinderCap(mesh, height, SliceCount, DeltaTheta, +1.0f, RadiusTop);
-	BuildCylinderCap(mesh, height, SliceCount, DeltaTheta, -1.0f, RadiusBottom);
-
-	return mesh;
+	BuildCylinderCap(+1.0f, RadiusTop);
+	BuildCylinderCap(-1.0f, RadiusBottom);
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount)
+template<typename Index>
+void GeometryGenerator::CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount, MeshSpans<Index> mesh, const Displacement& displace)
 {
-	MeshData mesh;
+	CheckSpans(mesh, SphereSize(SliceCount, StackCount));
 
-	VertexData VertexPoleTop;
+	uint32_t RingVertexCount = SliceCount + 1;
+	uint32_t VertexPoleBottomIndex = 1 + (StackCount - 1) * RingVertexCount;
+
+	VertexData& VertexPoleTop = mesh.vertices[0];
 	VertexPoleTop.position = XMFLOAT3(0.0f, +radius, 0.0f);
 	VertexPoleTop.normal   = XMFLOAT3(0.0f, +1.0f, 0.0f);
 	VertexPoleTop.tangent  = XMFLOAT3(1.0f, 0.0f, 0.0f);
 	VertexPoleTop.TexCoord = XMFLOAT2(0.0f, 0.0f);
 
-	mesh.vertices.push_back(VertexPoleTop);
-	
-	float DeltaPhi = XM_PI / StackCount;
-	float DeltaTheta = 2.0f * XM_PI / SliceCount;
-
-	for (uint32_t i = 1; i < StackCount; ++i) // <-
-	{
-		float phi = i * DeltaPhi;
-
-		for (uint32_t j = 0; j <= SliceCount; ++j)
-		{
-			float theta = j * DeltaTheta;
-
-			VertexData vertex;
-
-			// spherical to cartesian
-			vertex.position.x = radius * std::sin(phi) * std::cos(theta);
-			vertex.position.y = radius * std::cos(phi);
-			vertex.position.z = radius * std::sin(phi) * std::sin(theta);
-
-			XMVECTOR P = XMLoadFloat3(&vertex.position);
-			XMStoreFloat3(&vertex.normal, XMVector3Normalize(P));
-
-			// partial derivative of P with respect to theta
-			vertex.tangent.x = -radius * std::sin(phi) * std::sin(theta);
-			vertex.tangent.y = 0.0f;
-			vertex.tangent.z = +radius * std::sin(phi) * std::cos(theta);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.tangent);
-			XMStoreFloat3(&vertex.tangent, XMVector3Normalize(T));
-
-			vertex.TexCoord.x = theta / XM_2PI;
-			vertex.TexCoord.y = phi / XM_PI;
-
-			mesh.vertices.push_back(vertex);
-		}
-	}
-
-	VertexData VertexPoleBottom;
+	VertexData& VertexPoleBottom = mesh.vertices[VertexPoleBottomIndex];
 	VertexPoleBottom.position = XMFLOAT3(0.0f, -radius, 0.0f);
 	VertexPoleBottom.normal = XMFLOAT3(0.0f, -1.0f, 0.0f);
 	VertexPoleBottom.tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
 	VertexPoleBottom.TexCoord = XMFLOAT2(0.0f, 1.0f);
 
-	mesh.vertices.push_back(VertexPoleBottom);
-
-	for (uint32_t i = 1; i <= SliceCount; ++i)
+	if (displace)
 	{
-		mesh.indices32.push_back(0);
-		mesh.indices32.push_back(i + 1);
-		mesh.indices32.push_back(i);
+		displace(VertexPoleTop);
+		displace(VertexPoleBottom);
 	}
 
+	float DeltaPhi = XM_PI / StackCount;
+	float DeltaTheta = 2.0f * XM_PI / SliceCount;
+
 	uint32_t BaseIndex = 1;
-	uint32_t RingVertexCount = SliceCount + 1;
 
-	for (uint32_t i = 0; i < StackCount - 2; ++i)
+	// a band writes the vertices of its rings and the quads below them, the fans at the poles are done after
+	ForEachBand(1, StackCount, [&](uint32_t RingBegin, uint32_t RingEnd)
 	{
-		for (uint32_t j = 0; j < SliceCount; ++j)
+		for (uint32_t i = RingBegin; i < RingEnd; ++i)
 		{
-			mesh.indices32.push_back(BaseIndex + (i + 0) * RingVertexCount + (j + 0));
-			mesh.indices32.push_back(BaseIndex + (i + 0) * RingVertexCount + (j + 1));
-			mesh.indices32.push_back(BaseIndex + (i + 1) * RingVertexCount + (j + 0));
-
-			mesh.indices32.push_back(BaseIndex + (i + 1) * RingVertexCount + (j + 0));
-			mesh.indices32.push_back(BaseIndex + (i + 0) * RingVertexCount + (j + 1));
-			mesh.indices32.push_back(BaseIndex + (i + 1) * RingVertexCount + (j + 1));
+			float phi = i * DeltaPhi;
+
+			for (uint32_t j = 0; j <= SliceCount; ++j)
+			{
+				float theta = j * DeltaTheta;
+
+				VertexData& vertex = mesh.vertices[BaseIndex + (i - 1) * RingVertexCount + j];
+
+				// spherical to cartesian
+				vertex.position.x = radius * std::sin(phi) * std::cos(theta);
+				vertex.position.y = radius * std::cos(phi);
+				vertex.position.z = radius * std::sin(phi) * std::sin(theta);
+
+				XMVECTOR P = XMLoadFloat3(&vertex.position);
+				XMStoreFloat3(&vertex.normal, XMVector3Normalize(P));
+
+				// partial derivative of P with respect to theta
+				vertex.tangent.x = -radius * std::sin(phi) * std::sin(theta);
+				vertex.tangent.y = 0.0f;
+				vertex.tangent.z = +radius * std::sin(phi) * std::cos(theta);
+
+				XMVECTOR T = XMLoadFloat3(&vertex.tangent);
+				XMStoreFloat3(&vertex.tangent, XMVector3Normalize(T));
+
+				vertex.TexCoord.x = theta / XM_2PI;
+				vertex.TexCoord.y = phi / XM_PI;
+
+				if (displace)
+				{
+					displace(vertex);
+				}
+			}
+
+			// quads between ring i and ring i + 1
+			if (i + 1 == StackCount)
+			{
+				continue;
+			}
+
+			uint32_t row = i - 1;
+			uint32_t k = SliceCount * 3 + row * SliceCount * 6;
+
+			for (uint32_t j = 0; j < SliceCount; ++j)
+			{
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 0) * RingVertexCount + (j + 0));
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 0) * RingVertexCount + (j + 1));
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 1) * RingVertexCount + (j + 0));
+
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 1) * RingVertexCount + (j + 0));
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 0) * RingVertexCount + (j + 1));
+				mesh.indices[k++] = static_cast<Index>(BaseIndex + (row + 1) * RingVertexCount + (j + 1));
+			}
 		}
+	});
+
+	uint32_t k = 0;
+
+	for (uint32_t i = 1; i <= SliceCount; ++i)
+	{
+		mesh.indices[k++] = 0;
+		mesh.indices[k++] = static_cast<Index>(i + 1);
+		mesh.indices[k++] = static_cast<Index>(i);
 	}
 
-	uint32_t VertexPoleBottomIndex = mesh.vertices.size() - 1;
+	k = SliceCount * 3 + (StackCount - 2) * SliceCount * 6;
 
 	BaseIndex = VertexPoleBottomIndex - RingVertexCount;
 
 	for (uint32_t i = 0; i < SliceCount; ++i)
 	{
-		mesh.indices32.push_back(VertexPoleBottomIndex);
-		mesh.indices32.push_back(BaseIndex + i);
-		mesh.indices32.push_back(BaseIndex + i + 1);
+		mesh.indices[k++] = static_cast<Index>(VertexPoleBottomIndex);
+		mesh.indices[k++] = static_cast<Index>(BaseIndex + i);
+		mesh.indices[k++] = static_cast<Index>(BaseIndex + i + 1);
 	}
-
-	return mesh;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
+template<typename Index>
+void GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth, MeshSpans<Index> mesh)
 {
-	MeshData mesh;
-
-	mesh.vertices.resize(4);
-	mesh.indices32.resize(6);
+	CheckSpans(mesh, QuadSize());
 
 	// position coordinates specified in NDC space
 	mesh.vertices[0] = VertexData(x,     y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
@@ -384,13 +536,22 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 	mesh.vertices[2] = VertexData(x + w, y,     depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
 	mesh.vertices[3] = VertexData(x + w, y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
 
-	mesh.indices32[0] = 0;
-	mesh.indices32[1] = 1;
-	mesh.indices32[2] = 2;
+	mesh.indices[0] = 0;
+	mesh.indices[1] = 1;
+	mesh.indices[2] = 2;
 
-	mesh.indices32[3] = 0;
-	mesh.indices32[4] = 2;
-	mesh.indices32[5] = 3;
+	mesh.indices[3] = 0;
+	mesh.indices[4] = 2;
+	mesh.indices[5] = 3;
+}
 
-	return mesh;
-}
\ No newline at end of file
+template void GeometryGenerator::CreateBox<uint16_t>(float, float, float, MeshSpans<uint16_t>);
+template void GeometryGenerator::CreateBox<uint32_t>(float, float, float, MeshSpans<uint32_t>);
+template void GeometryGenerator::CreateGrid<uint16_t>(float, float, uint32_t, uint32_t, MeshSpans<uint16_t>, const Displacement&);
+template void GeometryGenerator::CreateGrid<uint32_t>(float, float, uint32_t, uint32_t, MeshSpans<uint32_t>, const Displacement&);
+template void GeometryGenerator::CreateCylinder<uint16_t>(float, float, float, uint32_t, uint32_t, MeshSpans<uint16_t>, const Displacement&);
+template void GeometryGenerator::CreateCylinder<uint32_t>(float, float, float, uint32_t, uint32_t, MeshSpans<uint32_t>, const Displacement&);
+template void GeometryGenerator::CreateSphere<uint16_t>(float, uint32_t, uint32_t, MeshSpans<uint16_t>, const Displacement&);
+template void GeometryGenerator::CreateSphere<uint32_t>(float, uint32_t, uint32_t, MeshSpans<uint32_t>, const Displacement&);
+template void GeometryGenerator::CreateQuad<uint16_t>(float, float, float, float, float, MeshSpans<uint16_t>);
+template void GeometryGenerator::CreateQuad<uint32_t>(float, float, float, float, float, MeshSpans<uint32_t>);
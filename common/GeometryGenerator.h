@@ -1,12 +1,25 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <span>
 #include <vector>
 
 #include <DirectXMath.h>
 using namespace DirectX;
 
+class ThreadPool;
+
 class GeometryGenerator
 {
+	// optional pool the rows of grids and the rings of spheres and cylinders are spread across
+	ThreadPool* mThreadPool = nullptr;
+	int mBandRows = 0;
+
+	// run pass(RowBegin, RowEnd) over rows [first, last), split into row bands when a thread pool is set
+	void ForEachBand(uint32_t first, uint32_t last, const std::function<void(uint32_t, uint32_t)>& pass) const;
+
 public:
 
 	struct VertexData
@@ -32,9 +45,102 @@ public:
 		std::vector<uint16_t>& GetIndices16();
 	};
 
-	MeshData CreateBox(float width, float height, float depth, uint32_t subdivisions);
-	MeshData CreateGrid(float width, float depth, uint32_t m, uint32_t n);
-	MeshData CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount);
-	MeshData CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount);
+	// exact vertex and index counts of a shape, known before any of it is generated
+	struct MeshSize
+	{
+		uint32_t VertexCount = 0;
+		uint32_t IndexCount = 0;
+
+		MeshSize& operator+=(const MeshSize& other)
+		{
+			VertexCount += other.VertexCount;
+			IndexCount += other.IndexCount;
+			return *this;
+		}
+	};
+
+	static MeshSize BoxSize();
+	static MeshSize GridSize(uint32_t m, uint32_t n);
+	static MeshSize CylinderSize(uint32_t SliceCount, uint32_t StackCount);
+	static MeshSize SphereSize(uint32_t SliceCount, uint32_t StackCount);
+	static MeshSize QuadSize();
+
+	// caller owned storage a shape is written into, at least as big as its *Size();
+	// indices are relative to the first vertex of the span (use BaseVertex as BaseVertexLocation)
+	template<typename Index>
+	struct MeshSpans
+	{
+		std::span<VertexData> vertices;
+		std::span<Index> indices;
+
+		// where the spans start inside the buffers they were carved from
+		uint32_t BaseVertex = 0;
+		uint32_t StartIndex = 0;
+	};
+
+	// bump allocator for shapes sharing one vertex and one index buffer:
+	// size it once from the sum of their MeshSize and every allocate after that only moves two offsets
+	template<typename Index>
+	class MeshArena
+	{
+		std::vector<VertexData> mVertices;
+		std::vector<Index> mIndices;
+
+		uint32_t mVertexCount = 0;
+		uint32_t mIndexCount = 0;
+
+	public:
+		explicit MeshArena(MeshSize capacity) :
+			mVertices(capacity.VertexCount),
+			mIndices(capacity.IndexCount)
+		{}
+
+		MeshSpans<Index> allocate(MeshSize size)
+		{
+			assert(mVertexCount + size.VertexCount <= mVertices.size());
+			assert(mIndexCount + size.IndexCount <= mIndices.size());
+
+			MeshSpans<Index> spans;
+			spans.vertices = std::span<VertexData>(mVertices).subspan(mVertexCount, size.VertexCount);
+			spans.indices = std::span<Index>(mIndices).subspan(mIndexCount, size.IndexCount);
+			spans.BaseVertex = mVertexCount;
+			spans.StartIndex = mIndexCount;
+
+			mVertexCount += size.VertexCount;
+			mIndexCount += size.IndexCount;
+
+			return spans;
+		}
+
+		std::span<const VertexData> vertices() const { return std::span<const VertexData>(mVertices).first(mVertexCount); }
+		std::span<const Index> indices() const { return std::span<const Index>(mIndices).first(mIndexCount); }
+	};
+
+	// called on every generated vertex before it is stored, e.g. to lift a grid onto a height field;
+	// with a thread pool set it runs on several threads at once, so it must not write shared state
+	using Displacement = std::function<void(VertexData& vertex)>;
+
+	// every vertex is computed the same way whatever band it falls in, so the output does not depend on the pool;
+	// BandRows = 0 picks a band height per shape from the pool size, a null pool goes back to serial. small shapes
+	// are not worth it: a 50x50 grid with its displacement takes well under a millisecond on one thread
+	void SetThreadPool(ThreadPool* pool, int BandRows = 0);
+
+	MeshData CreateBox(float width, float height, float depth);
+	MeshData CreateGrid(float width, float depth, uint32_t m, uint32_t n, const Displacement& displace = nullptr);
+	MeshData CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount, const Displacement& displace = nullptr);
+	MeshData CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount, const Displacement& displace = nullptr);
 	MeshData CreateQuad(float x, float y, float w, float h, float depth);
-};
\ No newline at end of file
+
+	// the same shapes written in place with 16- or 32-bit indices, nothing is allocated;
+	// 16-bit output asserts the shape has at most 65536 vertices
+	template<typename Index>
+	void CreateBox(float width, float height, float depth, MeshSpans<Index> mesh);
+	template<typename Index>
+	void CreateGrid(float width, float depth, uint32_t m, uint32_t n, MeshSpans<Index> mesh, const Displacement& displace = nullptr);
+	template<typename Index>
+	void CreateCylinder(float RadiusBottom, float RadiusTop, float height, uint32_t SliceCount, uint32_t StackCount, MeshSpans<Index> mesh, const Displacement& displace = nullptr);
+	template<typename Index>
+	void CreateSphere(float radius, uint32_t SliceCount, uint32_t StackCount, MeshSpans<Index> mesh, const Displacement& displace = nullptr);
+	template<typename Index>
+	void CreateQuad(float x, float y, float w, float h, float depth, MeshSpans<Index> mesh);
+};
@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path& filename)
+{
+	open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::filesystem::path& filename)
+{
+	close();
+
+#if defined(_WIN32)
+	mFile = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	LARGE_INTEGER size = {};
+
+	if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mMapping == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (mData == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	mSize = static_cast<size_t>(size.QuadPart);
+#else
+	mFile = ::open(filename.c_str(), O_RDONLY);
+
+	struct stat status = {};
+
+	if (mFile < 0 || fstat(mFile, &status) != 0 || status.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	mData = static_cast<const char*>(data);
+	mSize = static_cast<size_t>(status.st_size);
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#if defined(_WIN32)
+	if (mData != nullptr)
+	{
+		UnmapViewOfFile(mData);
+	}
+
+	if (mMapping != nullptr)
+	{
+		CloseHandle(mMapping);
+	}
+
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+	}
+
+	mFile = INVALID_HANDLE_VALUE;
+	mMapping = nullptr;
+#else
+	if (mData != nullptr)
+	{
+		munmap(const_cast<char*>(mData), mSize);
+	}
+
+	if (mFile >= 0)
+	{
+		::close(mFile);
+	}
+
+	mFile = -1;
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+}
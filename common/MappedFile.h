@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// a whole file mapped read only, empty when it cannot be opened. the pages are shared with the file cache, so
+// reading a file through a mapping copies nothing and only touches the pages that are actually read
+class MappedFile
+{
+#if defined(_WIN32)
+	void* mFile = reinterpret_cast<void*>(-1);
+	void* mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	const char* mData = nullptr;
+	size_t mSize = 0;
+
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path& filename);
+
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+
+	~MappedFile();
+
+	// replaces the current mapping, false (and empty) when the file cannot be opened or is empty
+	bool open(const std::filesystem::path& filename);
+	void close();
+
+	const char* data() const { return mData; }
+	size_t size() const { return mSize; }
+
+	const char* begin() const { return mData; }
+	const char* end() const { return mData + mSize; }
+	bool empty() const { return mSize == 0; }
+};
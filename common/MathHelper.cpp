@@ -30,4 +30,31 @@ XMVECTOR MathHelper::SphericalToCartesian(float radius, float theta, float phi)
                        radius * std::cos(phi),
                        radius * std::sin(phi) * std::sin(theta),
                        1.0f);
-}
\ No newline at end of file
+}
+
+std::vector<float> MathHelper::GaussWeights(float sigma)
+{
+	const float TwoSigmaSquare = 2.0f * sigma * sigma;
+
+	const int radius = static_cast<int>(std::ceil(2.0f * sigma));
+
+	std::vector<float> weights(2 * radius + 1);
+
+	float sum = 0.0f;
+
+	for (int i = -radius; i <= +radius; ++i)
+	{
+		const float x = static_cast<float>(i);
+
+		weights[i + radius] = std::exp(-x * x / TwoSigmaSquare);
+
+		sum += weights[i + radius];
+	}
+
+	for (float& weight : weights)
+	{
+		weight /= sum;
+	}
+
+	return weights;
+}
@@ -2,6 +2,7 @@
 #define MATH_HELPER_H
 
 #include <cmath>
+#include <vector>
 
 #include <DirectXMath.h>
 using namespace DirectX;
@@ -34,6 +35,9 @@ public:
 	static int RandInt(int a, int b); // random int in [a, b]
 
 	static XMVECTOR SphericalToCartesian(float radius, float theta, float phi);
+
+	// normalized 1D gaussian kernel with 2 * ceil(2 * sigma) + 1 taps
+	static std::vector<float> GaussWeights(float sigma);
 };
 
 #endif // MATH_HELPER_H
\ No newline at end of file
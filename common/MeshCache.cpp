@@ -0,0 +1,293 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace
+{
+	constexpr uint32_t kMagic = MeshCacheId("MSHC");
+	constexpr uint64_t kAlignment = 16;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t SourceHash;
+		uint64_t FileSize;
+		uint32_t SectionCount;
+		uint32_t reserved;
+	};
+
+	uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + kAlignment - 1) & ~(kAlignment - 1);
+	}
+}
+
+static_assert(sizeof(Header) == 32, "the layout is part of the file format");
+
+uint64_t MeshCache::Hash(const void* data, size_t size, uint64_t seed)
+{
+	constexpr uint64_t prime = 1099511628211ull;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t lanes[4] = { seed, seed ^ 1, seed ^ 2, seed ^ 3 };
+
+	size_t i = 0;
+
+	// four independent multiply chains keep the multiplier busy instead of waiting on one
+	for (; i + 32 <= size; i += 32)
+	{
+		for (int l = 0; l < 4; ++l)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i + 8 * l, sizeof(word));
+			lanes[l] = (lanes[l] ^ word) * prime;
+		}
+	}
+
+	uint64_t hash = seed;
+
+	for (const uint64_t lane : lanes)
+	{
+		hash = (hash ^ lane) * prime;
+	}
+
+	for (; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	return (hash ^ size) * prime;
+}
+
+uint64_t MeshCache::HashFile(const std::filesystem::path& filename, std::string_view variant)
+{
+	const MappedFile file(filename);
+
+	if (file.empty())
+	{
+		return 0;
+	}
+
+	return Hash(variant.data(), variant.size(), Hash(file.data(), file.size()));
+}
+
+std::filesystem::path MeshCache::CachePath(const std::filesystem::path& source)
+{
+	std::filesystem::path path = source;
+	path += ".mesh";
+
+	return path;
+}
+
+void MeshCache::Writer::add(uint32_t id, uint32_t ElementSize, const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	mSections.push_back({ id, ElementSize, std::vector<char>(bytes, bytes + size) });
+}
+
+uint32_t MeshCache::Writer::AddString(std::string_view string)
+{
+	const uint32_t offset = static_cast<uint32_t>(mStrings.size());
+
+	mStrings.append(string);
+	mStrings.push_back('\0');
+
+	return offset;
+}
+
+bool MeshCache::Writer::write(const std::filesystem::path& filename, uint64_t SourceHash) const
+{
+	std::vector<Entry> entries;
+
+	const size_t SectionCount = mSections.size() + (mStrings.empty() ? 0 : 1);
+
+	uint64_t offset = AlignUp(sizeof(Header) + SectionCount * sizeof(Entry));
+
+	for (const Section& section : mSections)
+	{
+		entries.push_back({ section.id, section.ElementSize, offset, section.data.size() });
+		offset = AlignUp(offset + section.data.size());
+	}
+
+	if (!mStrings.empty())
+	{
+		entries.push_back({ StringsId, 1, offset, mStrings.size() });
+		offset = AlignUp(offset + mStrings.size());
+	}
+
+	const Header header = { kMagic, version, SourceHash, offset, static_cast<uint32_t>(entries.size()), 0 };
+
+	std::filesystem::path temporary = filename;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		const auto pad = [&file]()
+		{
+			static const char zeros[kAlignment] = {};
+			const uint64_t position = static_cast<uint64_t>(static_cast<std::streamoff>(file.tellp()));
+			file.write(zeros, static_cast<std::streamsize>(AlignUp(position) - position));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+		pad();
+
+		for (const Section& section : mSections)
+		{
+			file.write(section.data.data(), static_cast<std::streamsize>(section.data.size()));
+			pad();
+		}
+
+		if (!mStrings.empty())
+		{
+			file.write(mStrings.data(), static_cast<std::streamsize>(mStrings.size()));
+			pad();
+		}
+
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(temporary);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, filename, error);
+
+	if (error)
+	{
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::Reader::open(const std::filesystem::path& filename, uint64_t SourceHash)
+{
+	if (SourceHash == 0 || !open(filename) || mSourceHash != SourceHash)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::Reader::open(const std::filesystem::path& filename)
+{
+	close();
+
+	if (!mFile.open(filename) || mFile.size() < sizeof(Header))
+	{
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, mFile.data(), sizeof(header));
+
+	const uint64_t size = mFile.size();
+
+	if (header.magic != kMagic || header.version != version || header.FileSize != size ||
+		header.SectionCount > (size - sizeof(Header)) / sizeof(Entry))
+	{
+		close();
+		return false;
+	}
+
+	mEntries = reinterpret_cast<const Entry*>(mFile.data() + sizeof(Header));
+	mEntryCount = header.SectionCount;
+	mSourceHash = header.SourceHash;
+
+	// the sections follow the table in its order without overlapping
+	uint64_t end = sizeof(Header) + static_cast<uint64_t>(mEntryCount) * sizeof(Entry);
+
+	for (uint32_t i = 0; i < mEntryCount; ++i)
+	{
+		const Entry& entry = mEntries[i];
+
+		if (entry.ElementSize == 0 || entry.offset % kAlignment != 0 || entry.offset < end || entry.offset > size ||
+			entry.size > size - entry.offset || entry.size % entry.ElementSize != 0)
+		{
+			close();
+			return false;
+		}
+
+		end = entry.offset + entry.size;
+	}
+
+	// strings are read up to their nul, so the section has to end with one
+	const std::span<const char> strings = get(StringsId, 1);
+
+	if (has(StringsId) && (strings.empty() || strings.back() != '\0'))
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCache::Reader::close()
+{
+	mFile.close();
+	mEntries = nullptr;
+	mEntryCount = 0;
+	mSourceHash = 0;
+}
+
+const MeshCache::Entry* MeshCache::Reader::find(uint32_t id) const
+{
+	for (uint32_t i = 0; i < mEntryCount; ++i)
+	{
+		if (mEntries[i].id == id)
+		{
+			return &mEntries[i];
+		}
+	}
+
+	return nullptr;
+}
+
+std::span<const char> MeshCache::Reader::get(uint32_t id, uint32_t ElementSize) const
+{
+	const Entry* entry = find(id);
+
+	if (entry == nullptr || entry->ElementSize != ElementSize)
+	{
+		return {};
+	}
+
+	return { mFile.data() + entry->offset, static_cast<size_t>(entry->size) };
+}
+
+uint32_t MeshCache::Reader::GetElementSize(uint32_t id) const
+{
+	const Entry* entry = find(id);
+
+	return entry != nullptr ? entry->ElementSize : 0;
+}
+
+std::string_view MeshCache::Reader::GetString(uint32_t offset) const
+{
+	const std::span<const char> strings = get(StringsId, 1);
+
+	if (offset >= strings.size())
+	{
+		return {};
+	}
+
+	return std::string_view(strings.data() + offset);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// a four character section id, "VERT" say, as the little endian number the file stores
+constexpr uint32_t MeshCacheId(const char (&id)[5])
+{
+	return static_cast<uint32_t>(static_cast<uint8_t>(id[0])) | static_cast<uint32_t>(static_cast<uint8_t>(id[1])) << 8 |
+		   static_cast<uint32_t>(static_cast<uint8_t>(id[2])) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(id[3])) << 24;
+}
+
+// a versioned binary container for meshes that are slow to build from their source. a file is a header, a table of
+// sections and the sections, each starting on a 16 byte boundary, so opening one is a memory mapping plus a check
+// of the table, and every section is used in place as an array of its element type: vertex and index sections go
+// to the upload as they are. the header records a hash of the source the file was built from, and a file is
+// rejected when that hash differs, when it was written by another version of this code or when its table does
+// not fit the file, in which case the caller rebuilds it from the source
+class MeshCache
+{
+	// a row of the section table
+	struct Entry
+	{
+		uint32_t id;
+		uint32_t ElementSize;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+public:
+	static constexpr uint32_t version = 1;
+
+	// the sections of a mesh; the element size of the vertex and index sections is the stride of their buffer
+	static constexpr uint32_t VerticesId = MeshCacheId("VERT");
+	static constexpr uint32_t IndicesId = MeshCacheId("INDX");
+	static constexpr uint32_t SubsetsId = MeshCacheId("SUBS");
+	static constexpr uint32_t BoundsId = MeshCacheId("BNDS");
+	static constexpr uint32_t MaterialsId = MeshCacheId("MATL");
+	static constexpr uint32_t StringsId = MeshCacheId("STRS");
+
+	// the sections of a skeleton and its animations: one track per bone and clip, the tracks of a clip in bone order
+	// starting at its first track, and the key frames of a track in a row
+	static constexpr uint32_t BoneOffsetsId = MeshCacheId("BOFS");
+	static constexpr uint32_t BoneParentsId = MeshCacheId("BPAR");
+	static constexpr uint32_t ClipsId = MeshCacheId("CLIP");
+	static constexpr uint32_t TracksId = MeshCacheId("TRAK");
+	static constexpr uint32_t KeyFramesId = MeshCacheId("KEYS");
+
+	struct Subset
+	{
+		uint32_t id;
+		uint32_t VertexStart;
+		uint32_t VertexCount;
+		uint32_t FaceStart;
+		uint32_t FaceCount;
+	};
+
+	// axis aligned, as BoundingBox takes them
+	struct Bounds
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+	};
+
+	// the names are offsets into the string section
+	struct Material
+	{
+		uint32_t name;
+		uint32_t MaterialTypeName;
+		uint32_t DiffuseMapName;
+		uint32_t NormalMapName;
+		XMFLOAT4 DiffuseAlbedo;
+		XMFLOAT3 FresnelR0;
+		float roughness;
+		uint32_t AlphaClip;
+	};
+
+	// the name is an offset into the string section
+	struct Clip
+	{
+		uint32_t name;
+		uint32_t FirstTrack;
+	};
+
+	struct Track
+	{
+		uint32_t FirstKeyFrame;
+		uint32_t KeyFrameCount;
+	};
+
+	struct KeyFrame
+	{
+		float time;
+		XMFLOAT3 translation;
+		XMFLOAT3 scale;
+		XMFLOAT4 rotation;
+	};
+
+	// FNV-1a over 64-bit words in four interleaved lanes, which hashes a source many times faster than one byte
+	// at a time; continues from seed
+	static uint64_t Hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	// the hash of a file's content followed by variant, which tells apart caches built from the same source in
+	// different ways; 0 when the file cannot be read
+	static uint64_t HashFile(const std::filesystem::path& filename, std::string_view variant = {});
+
+	// where the cache of a source lives: next to it, with ".mesh" appended to its name
+	static std::filesystem::path CachePath(const std::filesystem::path& source);
+
+	class Writer
+	{
+		struct Section
+		{
+			uint32_t id;
+			uint32_t ElementSize;
+			std::vector<char> data;
+		};
+
+		std::vector<Section> mSections;
+		std::string mStrings;
+
+	public:
+		void add(uint32_t id, uint32_t ElementSize, const void* data, size_t size);
+
+		template<typename T>
+		void add(uint32_t id, std::span<const T> elements)
+		{
+			static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 16, "sections are used in place");
+
+			add(id, sizeof(T), elements.data(), elements.size_bytes());
+		}
+
+		// the offset of a nul terminated copy of string in the string section, which write() adds when not empty
+		uint32_t AddString(std::string_view string);
+
+		// the file is written under a temporary name and then renamed, so a reader never sees half of it. SourceHash
+		// is 0 for a file that is not a cache and is only ever opened without one
+		bool write(const std::filesystem::path& filename, uint64_t SourceHash) const;
+	};
+
+	class Reader
+	{
+		MappedFile mFile;
+		const Entry* mEntries = nullptr;
+		uint32_t mEntryCount = 0;
+		uint64_t mSourceHash = 0;
+
+		const Entry* find(uint32_t id) const;
+		std::span<const char> get(uint32_t id, uint32_t ElementSize) const;
+
+	public:
+		// false (and closed) when the file is missing, was built from another source or is not a valid cache
+		bool open(const std::filesystem::path& filename, uint64_t SourceHash);
+
+		// a file shipped on its own, whatever source it was built from
+		bool open(const std::filesystem::path& filename);
+		void close();
+
+		bool IsOpen() const { return !mFile.empty(); }
+
+		// what the file was built from, 0 when the writer did not say
+		uint64_t GetSourceHash() const { return mSourceHash; }
+
+		bool has(uint32_t id) const { return find(id) != nullptr; }
+
+		// 0 when there is no such section
+		uint32_t GetElementSize(uint32_t id) const;
+
+		// the elements of a section, in place; empty when there is no such section or its elements are not Ts
+		template<typename T>
+		std::span<const T> get(uint32_t id) const
+		{
+			static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= 16, "sections are used in place");
+
+			const std::span<const char> bytes = get(id, sizeof(T));
+
+			return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+		}
+
+		// a string of the string section, empty when offset does not start one
+		std::string_view GetString(uint32_t offset) const;
+	};
+};
@@ -0,0 +1,439 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	// the triangles using each vertex, those of vertex v are triangles[offsets[v]] .. triangles[offsets[v + 1] - 1]
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	template<typename Index>
+	Adjacency BuildAdjacency(std::span<const Index> indices, uint32_t VertexCount)
+	{
+		Adjacency adjacency;
+		adjacency.offsets.assign(VertexCount + 1, 0);
+		adjacency.triangles.resize(indices.size());
+
+		for (Index index : indices)
+		{
+			adjacency.offsets[index + 1]++;
+		}
+
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+		}
+
+		std::vector<uint32_t> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		return adjacency;
+	}
+
+	// FIFO cache used to count misses, entries older than the last CacheSize misses are gone
+	class FifoCache
+	{
+		std::vector<uint32_t> mStamps;
+		uint32_t mTime;
+		uint32_t mSize;
+
+	public:
+		FifoCache(uint32_t VertexCount, uint32_t size) :
+			mStamps(VertexCount, 0),
+			mTime(size + 1),
+			mSize(size)
+		{}
+
+		// true on a miss, which also inserts the vertex
+		bool access(uint32_t vertex)
+		{
+			if (mTime - mStamps[vertex] > mSize)
+			{
+				mStamps[vertex] = mTime++;
+				return true;
+			}
+
+			return false;
+		}
+
+		// forget everything without touching the stamps
+		void flush()
+		{
+			mTime += mSize + 1;
+		}
+	};
+}
+
+template<typename Index>
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(std::span<const Index> indices, uint32_t VertexCount, uint32_t CacheSize)
+{
+	assert(indices.size() % 3 == 0);
+
+	CacheStats stats;
+
+	if (indices.empty())
+	{
+		return stats;
+	}
+
+	FifoCache cache(VertexCount, CacheSize);
+	std::vector<unsigned char> referenced(VertexCount, 0);
+
+	uint32_t misses = 0;
+	uint32_t unique = 0;
+
+	for (Index index : indices)
+	{
+		misses += cache.access(index) ? 1 : 0;
+		unique += referenced[index] ? 0 : 1;
+		referenced[index] = 1;
+	}
+
+	stats.ACMR = static_cast<float>(misses) / (indices.size() / 3);
+	stats.ATVR = static_cast<float>(misses) / unique;
+
+	return stats;
+}
+
+template<typename Index>
+void MeshOptimizer::OptimizeVertexCache(std::span<Index> indices, uint32_t VertexCount, uint32_t CacheSize)
+{
+	assert(indices.size() % 3 == 0);
+
+	const uint32_t TriangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	if (TriangleCount == 0)
+	{
+		return;
+	}
+
+	const std::vector<Index> input(indices.begin(), indices.end());
+	const Adjacency adjacency = BuildAdjacency(std::span<const Index>(input), VertexCount);
+
+	// triangles not yet emitted per vertex, and when each vertex last entered the simulated FIFO
+	std::vector<uint32_t> live(VertexCount);
+	std::vector<uint32_t> stamps(VertexCount, 0);
+
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	std::vector<unsigned char> emitted(TriangleCount, 0);
+
+	// recently used vertices to restart from when a fan runs dry, and the corners of the last fan
+	std::vector<uint32_t> DeadEnds;
+	std::vector<uint32_t> candidates;
+
+	uint32_t time = CacheSize + 1;
+	uint32_t InputCursor = 0;
+	size_t out = 0;
+
+	const uint32_t none = std::numeric_limits<uint32_t>::max();
+	uint32_t fan = 0;
+
+	while (fan != none)
+	{
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+
+		for (uint32_t a = adjacency.offsets[fan]; a < adjacency.offsets[fan + 1]; ++a)
+		{
+			const uint32_t t = adjacency.triangles[a];
+
+			if (emitted[t])
+			{
+				continue;
+			}
+
+			emitted[t] = 1;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				const uint32_t v = static_cast<uint32_t>(input[3 * t + c]);
+				indices[out++] = static_cast<Index>(v);
+
+				DeadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (time - stamps[v] > CacheSize)
+				{
+					stamps[v] = time++;
+				}
+			}
+		}
+
+		// next fan: the oldest corner that will still be in the cache once its own fan is emitted
+		// (each of its triangles adds at most two vertices); a corner that would not is no candidate,
+		// and when none is left the dead-end stack picks the next fan, as in Tipsify
+		fan = none;
+		uint32_t BestPriority = 0;
+
+		for (uint32_t v : candidates)
+		{
+			if (live[v] == 0)
+			{
+				continue;
+			}
+
+			const uint32_t age = time - stamps[v];
+
+			if (age + 2 * live[v] > CacheSize)
+			{
+				continue;
+			}
+
+			const uint32_t priority = age + 1;
+
+			if (priority > BestPriority)
+			{
+				BestPriority = priority;
+				fan = v;
+			}
+		}
+
+		// dead end: back up through recently used vertices, then fall back to input order
+		while (fan == none && !DeadEnds.empty())
+		{
+			const uint32_t v = DeadEnds.back();
+			DeadEnds.pop_back();
+
+			if (live[v] > 0)
+			{
+				fan = v;
+			}
+		}
+
+		while (fan == none && InputCursor < VertexCount)
+		{
+			if (live[InputCursor] > 0)
+			{
+				fan = InputCursor;
+			}
+
+			InputCursor++;
+		}
+	}
+}
+
+template<typename Index>
+void MeshOptimizer::OptimizeOverdraw(std::span<Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount, float threshold)
+{
+	assert(indices.size() % 3 == 0);
+
+	const uint32_t TriangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	if (TriangleCount == 0)
+	{
+		return;
+	}
+
+	const uint32_t CacheSize = 16;
+
+	auto position = [&](Index index)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const unsigned char*>(positions) + index * PositionStride));
+	};
+
+	// hard boundaries: triangles that miss on all three corners start a new run of the cache optimized order
+	std::vector<uint32_t> HardClusters;
+
+	{
+		FifoCache cache(VertexCount, CacheSize);
+
+		for (uint32_t t = 0; t < TriangleCount; ++t)
+		{
+			uint32_t misses = 0;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				misses += cache.access(indices[3 * t + c]) ? 1 : 0;
+			}
+
+			if (t == 0 || misses == 3)
+			{
+				HardClusters.push_back(t);
+			}
+		}
+
+		HardClusters.push_back(TriangleCount);
+	}
+
+	// soft boundaries: cut a run as soon as its prefix is within threshold of the whole run's ACMR
+	std::vector<uint32_t> clusters;
+
+	{
+		FifoCache cache(VertexCount, CacheSize);
+
+		for (size_t h = 0; h + 1 < HardClusters.size(); ++h)
+		{
+			const uint32_t begin = HardClusters[h];
+			const uint32_t end = HardClusters[h + 1];
+
+			cache.flush();
+
+			uint32_t RunMisses = 0;
+
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					RunMisses += cache.access(indices[3 * t + c]) ? 1 : 0;
+				}
+			}
+
+			const float RunACMR = static_cast<float>(RunMisses) / (end - begin);
+
+			cache.flush();
+
+			uint32_t ClusterBegin = begin;
+			uint32_t misses = 0;
+
+			clusters.push_back(begin);
+
+			for (uint32_t t = begin; t < end; ++t)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					misses += cache.access(indices[3 * t + c]) ? 1 : 0;
+				}
+
+				const float ACMR = static_cast<float>(misses) / (t + 1 - ClusterBegin);
+
+				if (t + 1 < end && ACMR <= threshold * RunACMR)
+				{
+					ClusterBegin = t + 1;
+					misses = 0;
+
+					clusters.push_back(ClusterBegin);
+					cache.flush();
+				}
+			}
+		}
+
+		clusters.push_back(TriangleCount);
+	}
+
+	const size_t ClusterCount = clusters.size() - 1;
+
+	// area weighted centroid of the mesh and of each cluster, and each cluster's average normal
+	std::vector<XMFLOAT3> ClusterCentroid(ClusterCount);
+	std::vector<XMFLOAT3> ClusterNormal(ClusterCount);
+
+	XMVECTOR MeshCentroid = XMVectorZero();
+	float MeshArea = 0.0f;
+
+	for (size_t k = 0; k < ClusterCount; ++k)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (uint32_t t = clusters[k]; t < clusters[k + 1]; ++t)
+		{
+			const XMVECTOR p0 = position(indices[3 * t + 0]);
+			const XMVECTOR p1 = position(indices[3 * t + 1]);
+			const XMVECTOR p2 = position(indices[3 * t + 2]);
+
+			// clockwise front faces, as everywhere else in the demos
+			const XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			const float TriangleArea = XMVectorGetX(XMVector3Length(n));
+
+			centroid += (p0 + p1 + p2) * (TriangleArea / 3.0f);
+			normal += n;
+			area += TriangleArea;
+		}
+
+		MeshCentroid += centroid;
+		MeshArea += area;
+
+		XMStoreFloat3(&ClusterCentroid[k], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&ClusterNormal[k], XMVector3Normalize(normal));
+	}
+
+	MeshCentroid = MeshArea > 0.0f ? XMVectorScale(MeshCentroid, 1.0f / MeshArea) : MeshCentroid;
+
+	// clusters farther out along their normal occlude more from most views, so they go first
+	std::vector<float> key(ClusterCount);
+
+	for (size_t k = 0; k < ClusterCount; ++k)
+	{
+		const XMVECTOR offset = XMLoadFloat3(&ClusterCentroid[k]) - MeshCentroid;
+		key[k] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&ClusterNormal[k])));
+	}
+
+	std::vector<uint32_t> order(ClusterCount);
+
+	for (size_t k = 0; k < ClusterCount; ++k)
+	{
+		order[k] = static_cast<uint32_t>(k);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key[a] > key[b]; });
+
+	const std::vector<Index> input(indices.begin(), indices.end());
+	size_t out = 0;
+
+	for (uint32_t k : order)
+	{
+		std::copy(input.begin() + 3 * clusters[k], input.begin() + 3 * clusters[k + 1], indices.begin() + out);
+		out += 3 * (clusters[k + 1] - clusters[k]);
+	}
+}
+
+template<typename Index>
+std::vector<uint32_t> MeshOptimizer::RemapVertexFetch(std::span<Index> indices, uint32_t BaseVertex, uint32_t VertexCount)
+{
+	const uint32_t unused = std::numeric_limits<uint32_t>::max();
+
+	std::vector<uint32_t> remap(VertexCount, unused);
+	uint32_t next = 0;
+
+	for (Index& index : indices)
+	{
+		const uint32_t v = static_cast<uint32_t>(index) - BaseVertex;
+		assert(v < VertexCount);
+
+		if (remap[v] == unused)
+		{
+			remap[v] = next++;
+		}
+
+		index = static_cast<Index>(BaseVertex + remap[v]);
+	}
+
+	for (uint32_t& slot : remap)
+	{
+		if (slot == unused)
+		{
+			slot = next++;
+		}
+	}
+
+	return remap;
+}
+
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<uint16_t>(std::span<const uint16_t>, uint32_t, uint32_t);
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<uint32_t>(std::span<const uint32_t>, uint32_t, uint32_t);
+template MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache<int32_t>(std::span<const int32_t>, uint32_t, uint32_t);
+template void MeshOptimizer::OptimizeVertexCache<uint16_t>(std::span<uint16_t>, uint32_t, uint32_t);
+template void MeshOptimizer::OptimizeVertexCache<uint32_t>(std::span<uint32_t>, uint32_t, uint32_t);
+template void MeshOptimizer::OptimizeVertexCache<int32_t>(std::span<int32_t>, uint32_t, uint32_t);
+template void MeshOptimizer::OptimizeOverdraw<uint16_t>(std::span<uint16_t>, const XMFLOAT3*, size_t, uint32_t, float);
+template void MeshOptimizer::OptimizeOverdraw<uint32_t>(std::span<uint32_t>, const XMFLOAT3*, size_t, uint32_t, float);
+template void MeshOptimizer::OptimizeOverdraw<int32_t>(std::span<int32_t>, const XMFLOAT3*, size_t, uint32_t, float);
+template std::vector<uint32_t> MeshOptimizer::RemapVertexFetch<uint16_t>(std::span<uint16_t>, uint32_t, uint32_t);
+template std::vector<uint32_t> MeshOptimizer::RemapVertexFetch<uint32_t>(std::span<uint32_t>, uint32_t, uint32_t);
+template std::vector<uint32_t> MeshOptimizer::RemapVertexFetch<int32_t>(std::span<int32_t>, uint32_t, uint32_t);
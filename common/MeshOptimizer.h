@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// index and vertex reordering for the post-transform vertex cache, overdraw and vertex fetch,
+// run on triangle lists at load time or offline; the usual order is
+// OptimizeVertexCache, then OptimizeOverdraw (optional), then OptimizeVertexFetch.
+// the functions work on any subrange of an index buffer, so a mesh with subsets is optimized one subset at a time
+class MeshOptimizer
+{
+public:
+	struct CacheStats
+	{
+		float ACMR = 0.0f; // average cache miss ratio, vertices transformed per triangle (0.5 is ideal for a regular grid, 3 is the worst)
+		float ATVR = 0.0f; // average transform to vertex ratio, vertices transformed per vertex referenced (1 is ideal)
+	};
+
+	// simulate a FIFO post-transform cache of CacheSize entries over the triangle list
+	template<typename Index>
+	static CacheStats AnalyzeVertexCache(std::span<const Index> indices, uint32_t VertexCount, uint32_t CacheSize = 16);
+
+	// reorder the triangles for a FIFO cache of CacheSize entries by emitting them as fans around vertices
+	// chosen to stay in the cache (Tipsify, Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw");
+	// VertexCount bounds the index values and the triangles keep their winding
+	template<typename Index>
+	static void OptimizeVertexCache(std::span<Index> indices, uint32_t VertexCount, uint32_t CacheSize = 16);
+
+	// reorder clusters of an already cache optimized list so outward facing ones are drawn first (same paper);
+	// a cluster is only cut where its ACMR stays within threshold times that of the run it was cut from,
+	// so threshold trades cache efficiency (1) for freedom to reduce overdraw (larger).
+	// PositionStride is the byte distance between the XMFLOAT3 positions of consecutive vertices
+	template<typename Index>
+	static void OptimizeOverdraw(std::span<Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount, float threshold = 1.05f);
+
+	// the vertices of [BaseVertex, BaseVertex + VertexCount) in the order the indices first reference them,
+	// followed by the unused ones in their old order; the indices are rewritten and remap[old - BaseVertex] is the new position
+	template<typename Index>
+	static std::vector<uint32_t> RemapVertexFetch(std::span<Index> indices, uint32_t BaseVertex, uint32_t VertexCount);
+
+	// reorder vertices to match RemapVertexFetch, indices refer to vertices[index - BaseVertex]
+	template<typename Vertex, typename Index>
+	static void OptimizeVertexFetch(std::span<Index> indices, std::span<Vertex> vertices, uint32_t BaseVertex = 0)
+	{
+		std::vector<uint32_t> remap = RemapVertexFetch(indices, BaseVertex, static_cast<uint32_t>(vertices.size()));
+
+		std::vector<Vertex> reordered(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			reordered[remap[i]] = vertices[i];
+		}
+
+		std::copy(reordered.begin(), reordered.end(), vertices.begin());
+	}
+
+	struct Report
+	{
+		CacheStats before;
+		CacheStats after;
+	};
+
+	// the whole pass over one mesh or subset at load time: indices refer to vertices[index - BaseVertex] and stay in that range.
+	// the incoming triangle order is kept when it already beats the cache optimized one (e.g. meshes optimized by their exporter),
+	// and then there is no overdraw pass either; the overdraw pass is dropped when it costs more than OverdrawThreshold times the
+	// cache optimized ACMR or loses to the input, so after.ACMR never exceeds before.ACMR. OverdrawThreshold = 0 skips the overdraw pass
+	template<typename Vertex, typename Index>
+	static Report Optimize(std::span<Index> indices, std::span<Vertex> vertices, XMFLOAT3 Vertex::* position, uint32_t BaseVertex = 0, float OverdrawThreshold = 1.05f)
+	{
+		const uint32_t VertexCount = static_cast<uint32_t>(vertices.size());
+
+		std::vector<uint32_t> local(indices.size());
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			local[i] = static_cast<uint32_t>(indices[i]) - BaseVertex;
+		}
+
+		Report report;
+		report.before = AnalyzeVertexCache(std::span<const uint32_t>(local), VertexCount);
+
+		if (local.empty())
+		{
+			report.after = report.before;
+			return report;
+		}
+
+		std::vector<uint32_t> optimized = local;
+		OptimizeVertexCache(std::span<uint32_t>(optimized), VertexCount);
+
+		const float CacheACMR = AnalyzeVertexCache(std::span<const uint32_t>(optimized), VertexCount).ACMR;
+
+		// the overdraw pass needs the cache optimized order, and is only kept while the result still beats the input
+		if (CacheACMR > report.before.ACMR)
+		{
+			optimized = local;
+		}
+		else if (OverdrawThreshold > 0.0f)
+		{
+			std::vector<uint32_t> reordered = optimized;
+			OptimizeOverdraw(std::span<uint32_t>(reordered), &(vertices[0].*position), sizeof(Vertex), VertexCount, OverdrawThreshold);
+
+			const float ReorderedACMR = AnalyzeVertexCache(std::span<const uint32_t>(reordered), VertexCount).ACMR;
+
+			if (ReorderedACMR <= std::min(OverdrawThreshold * CacheACMR, report.before.ACMR))
+			{
+				optimized = std::move(reordered);
+			}
+		}
+
+		OptimizeVertexFetch(std::span<uint32_t>(optimized), vertices);
+
+		report.after = AnalyzeVertexCache(std::span<const uint32_t>(optimized), VertexCount);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			indices[i] = static_cast<Index>(optimized[i] + BaseVertex);
+		}
+
+		return report;
+	}
+};
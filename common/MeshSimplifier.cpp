@@ -0,0 +1,628 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+	// what a vertex may collapse onto; vertices sharing a position are the wedges of one position class
+	enum class VertexKind : uint8_t
+	{
+		Manifold, // the only wedge of an interior position, moves onto any neighbour
+		Border,   // the only wedge of a position on an open border, moves along the border
+		Seam,     // one of two wedges of an interior position, both move along the seam together
+		Locked,   // corners, seams meeting borders, non-manifold positions
+	};
+
+	const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+	const uint32_t kMultiple = kNone - 1;
+
+	// area weighted sum of squared distances to planes, as the symmetric 4x4 matrix [A b; b c] and the total weight
+	struct Quadric
+	{
+		float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+		float a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+		float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+		float c = 0.0f;
+		float w = 0.0f;
+
+		// plane n.p + d = 0 with n normalized
+		Quadric() = default;
+		Quadric(XMFLOAT3 n, float d, float weight) :
+			a00(weight * n.x * n.x), a11(weight * n.y * n.y), a22(weight * n.z * n.z),
+			a10(weight * n.y * n.x), a20(weight * n.z * n.x), a21(weight * n.z * n.y),
+			b0(weight * n.x * d), b1(weight * n.y * d), b2(weight * n.z * d),
+			c(weight * d * d),
+			w(weight)
+		{}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a10 += q.a10; a20 += q.a20; a21 += q.a21;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+			return *this;
+		}
+
+		// mean squared distance of p to the planes
+		float error(const XMFLOAT3& p) const
+		{
+			const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+			const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+			const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+
+			const float r = p.x * rx + p.y * ry + p.z * rz + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+			return w > 0.0f ? std::fabs(r) / w : 0.0f;
+		}
+	};
+
+	// vertex from collapses onto vertex to, dragging wedge onto partner when from is a seam
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		uint32_t wedge;
+		uint32_t partner;
+		float error;
+	};
+
+	XMVECTOR Cross(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		const XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+	}
+
+	// the edges leaving each vertex, those of vertex v are ends[offsets[v]] .. ends[offsets[v + 1] - 1]
+	struct Edges
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> ends;
+
+		Edges(const std::vector<uint32_t>& indices, uint32_t VertexCount) :
+			offsets(VertexCount + 1, 0),
+			ends(indices.size())
+		{
+			for (uint32_t index : indices)
+			{
+				offsets[index + 1]++;
+			}
+
+			for (uint32_t v = 0; v < VertexCount; ++v)
+			{
+				offsets[v + 1] += offsets[v];
+			}
+
+			std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (size_t k = 0; k < 3; ++k)
+				{
+					ends[next[indices[i + k]]++] = indices[i + (k + 1) % 3];
+				}
+			}
+		}
+
+		bool contains(uint32_t a, uint32_t b) const
+		{
+			return std::find(ends.begin() + offsets[a], ends.begin() + offsets[a + 1], b) != ends.begin() + offsets[a + 1];
+		}
+	};
+}
+
+template<typename Index>
+float MeshSimplifier::Simplify(std::span<const Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+							   size_t TargetIndexCount, float TargetError, std::vector<Index>& destination)
+{
+	assert(indices.size() % 3 == 0);
+
+	std::vector<uint32_t> result(indices.size());
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		result[i] = static_cast<uint32_t>(indices[i]);
+		assert(result[i] < VertexCount);
+	}
+
+	auto position = [&](uint32_t v) -> const XMFLOAT3&
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const char*>(positions) + v * PositionStride);
+	};
+
+	// positions moved into the unit cube so the quadrics keep their precision whatever the size of the mesh
+	XMFLOAT3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		const XMFLOAT3& p = position(v);
+		minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	const float extent = std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z, FLT_MIN });
+	const float scale = 1.0f / extent;
+
+	std::vector<XMFLOAT3> points(VertexCount);
+
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		const XMFLOAT3& p = position(v);
+		points[v] = XMFLOAT3((p.x - minimum.x) * scale, (p.y - minimum.y) * scale, (p.z - minimum.z) * scale);
+	}
+
+	// classes[v] is the first vertex at the position of v, wedges[v] the next one there (back to v after the last);
+	// positions are compared on a grid of about a millionth of the mesh size, so seams of generated shapes
+	// whose two sides only differ by rounding (sin(2 pi) is not 0) still pair up
+	std::vector<uint32_t> classes(VertexCount);
+	std::vector<uint32_t> wedges(VertexCount);
+	std::vector<uint32_t> WedgeCounts(VertexCount, 0);
+
+	{
+		std::vector<uint32_t> order(VertexCount);
+		std::iota(order.begin(), order.end(), 0);
+
+		auto snap = [](float x) { return static_cast<int32_t>(std::lround(x * float(1 << 20))); };
+		auto key = [&](uint32_t v) { const XMFLOAT3& p = points[v]; return std::make_tuple(snap(p.x), snap(p.y), snap(p.z)); };
+
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return key(a) < key(b) || (key(a) == key(b) && a < b); });
+
+		for (size_t first = 0, last; first < order.size(); first = last)
+		{
+			for (last = first + 1; last < order.size() && key(order[last]) == key(order[first]); ++last) {}
+
+			for (size_t i = first; i < last; ++i)
+			{
+				classes[order[i]] = order[first];
+				wedges[order[i]] = order[i + 1 < last ? i + 1 : first];
+			}
+
+			WedgeCounts[order[first]] = static_cast<uint32_t>(last - first);
+		}
+	}
+
+	auto ClassIndices = [&]()
+	{
+		std::vector<uint32_t> ClassResult(result.size());
+
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			ClassResult[i] = classes[result[i]];
+		}
+
+		return ClassResult;
+	};
+
+	// an edge is open when no triangle runs it the other way: per wedge on uv or normal seams and on borders,
+	// per position class on borders only
+	std::vector<VertexKind> kinds(VertexCount, VertexKind::Locked);
+	std::vector<uint32_t> OpenOut(VertexCount, kNone);
+	std::vector<uint32_t> OpenIn(VertexCount, kNone);
+	std::vector<uint8_t> borders(VertexCount, 0);
+	std::vector<Quadric> quadrics(VertexCount);
+
+	{
+		const Edges WedgeEdges(result, VertexCount);
+		const Edges ClassEdges(ClassIndices(), VertexCount);
+
+		auto mark = [](uint32_t& slot, uint32_t v) { slot = (slot == kNone || slot == v) ? v : kMultiple; };
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const XMFLOAT3& p0 = points[result[i]];
+			const XMFLOAT3& p1 = points[result[i + 1]];
+			const XMFLOAT3& p2 = points[result[i + 2]];
+
+			const XMVECTOR cross = Cross(p0, p1, p2);
+			const float length = XMVectorGetX(XMVector3Length(cross));
+
+			// degenerate triangles still count for the topology, they only add no planes
+			XMFLOAT3 normal(0.0f, 0.0f, 0.0f);
+
+			if (length > 0.0f)
+			{
+				XMStoreFloat3(&normal, XMVectorScale(cross, 1.0f / length));
+			}
+
+			const Quadric plane(normal, -(normal.x * p0.x + normal.y * p0.y + normal.z * p0.z), 0.5f * length);
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = result[i + k];
+				const uint32_t b = result[i + (k + 1) % 3];
+
+				quadrics[classes[a]] += plane;
+
+				if (WedgeEdges.contains(b, a))
+				{
+					continue;
+				}
+
+				mark(OpenOut[a], b);
+				mark(OpenIn[b], a);
+
+				// planes through open edges, perpendicular to the triangle, keep borders and seams from wandering off
+				const bool border = !ClassEdges.contains(classes[b], classes[a]);
+
+				if (border)
+				{
+					borders[classes[a]] = 1;
+					borders[classes[b]] = 1;
+				}
+
+				const XMVECTOR edge = XMVectorSubtract(XMLoadFloat3(&points[b]), XMLoadFloat3(&points[a]));
+				const float EdgeLength = XMVectorGetX(XMVector3Length(edge));
+
+				if (EdgeLength <= 0.0f || length <= 0.0f)
+				{
+					continue;
+				}
+
+				XMFLOAT3 side;
+				XMStoreFloat3(&side, XMVector3Normalize(XMVector3Cross(edge, XMLoadFloat3(&normal))));
+
+				const XMFLOAT3& pa = points[a];
+				Quadric fence(side, -(side.x * pa.x + side.y * pa.y + side.z * pa.z), EdgeLength * EdgeLength * (border ? 10.0f : 1.0f));
+
+				// the fence only resists sliding off the edge, the error stays a mean over the surface planes
+				fence.w = 0.0f;
+
+				quadrics[classes[a]] += fence;
+				quadrics[classes[b]] += fence;
+			}
+		}
+
+		auto single = [](uint32_t v) { return v != kNone && v != kMultiple; };
+
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			const uint32_t c = classes[v];
+
+			if (WedgeCounts[c] == 1)
+			{
+				if (!borders[c])
+				{
+					kinds[v] = VertexKind::Manifold;
+				}
+				else if (single(OpenOut[v]) && single(OpenIn[v]))
+				{
+					kinds[v] = VertexKind::Border;
+				}
+			}
+			else if (WedgeCounts[c] == 2 && !borders[c])
+			{
+				const uint32_t w = wedges[v];
+
+				if (single(OpenOut[v]) && single(OpenIn[v]) && single(OpenOut[w]) && single(OpenIn[w]))
+				{
+					kinds[v] = VertexKind::Seam;
+				}
+			}
+		}
+	}
+
+	// whether from may collapse onto to, and which wedge pair has to follow for seams
+	auto allowed = [&](uint32_t from, uint32_t to, Collapse& collapse) -> bool
+	{
+		collapse.from = from;
+		collapse.to = to;
+		collapse.wedge = kNone;
+		collapse.partner = kNone;
+
+		switch (kinds[from])
+		{
+		case VertexKind::Manifold:
+			return true;
+
+		case VertexKind::Border:
+			return (kinds[to] == VertexKind::Border || kinds[to] == VertexKind::Locked) && (OpenOut[from] == to || OpenIn[from] == to);
+
+		case VertexKind::Seam:
+		{
+			if ((kinds[to] != VertexKind::Seam && kinds[to] != VertexKind::Locked) || (OpenOut[from] != to && OpenIn[from] != to))
+			{
+				return false;
+			}
+
+			// the other side of the seam runs the same edge the other way
+			const uint32_t wedge = wedges[from];
+			const uint32_t partner = OpenOut[from] == to ? OpenIn[wedge] : OpenOut[wedge];
+
+			if (partner >= VertexCount || partner == to || classes[partner] != classes[to])
+			{
+				return false;
+			}
+
+			collapse.wedge = wedge;
+			collapse.partner = partner;
+			return true;
+		}
+
+		default:
+			return false;
+		}
+	};
+
+	std::vector<uint32_t> remap(VertexCount);
+	std::iota(remap.begin(), remap.end(), 0);
+
+	std::vector<uint8_t> locked(VertexCount, 0);
+	std::vector<Collapse> collapses;
+
+	const float ErrorLimit = TargetError < FLT_MAX ? (TargetError * scale) * (TargetError * scale) : FLT_MAX;
+	float ResultError = 0.0f;
+
+	while (result.size() > TargetIndexCount)
+	{
+		const std::vector<uint32_t> ClassResult = ClassIndices();
+		const Edges ClassEdges(ClassResult, VertexCount);
+
+		// the triangles around each position class, for the flip test
+		std::vector<uint32_t> offsets(VertexCount + 1, 0);
+		std::vector<uint32_t> triangles(result.size());
+
+		for (uint32_t c : ClassResult)
+		{
+			offsets[c + 1]++;
+		}
+
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			offsets[v + 1] += offsets[v];
+		}
+
+		{
+			std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+
+			for (size_t i = 0; i < ClassResult.size(); ++i)
+			{
+				triangles[next[ClassResult[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// the cheaper allowed direction of every edge, interior edges are seen from both triangles and only kept once
+		collapses.clear();
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = result[i + k];
+				const uint32_t b = result[i + (k + 1) % 3];
+
+				if (classes[a] > classes[b] && ClassEdges.contains(classes[b], classes[a]))
+				{
+					continue;
+				}
+
+				Collapse ab, ba;
+				ab.error = allowed(a, b, ab) ? quadrics[classes[a]].error(points[b]) : FLT_MAX;
+				ba.error = allowed(b, a, ba) ? quadrics[classes[b]].error(points[a]) : FLT_MAX;
+
+				const Collapse& cheaper = ab.error <= ba.error ? ab : ba;
+
+				if (cheaper.error < FLT_MAX)
+				{
+					collapses.push_back(cheaper);
+				}
+			}
+		}
+
+		if (collapses.empty())
+		{
+			break;
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// an edge collapse removes two triangles inside the mesh, so aim for half as many collapses as triangles to go,
+		// and leave collapses far above the cost of the last one needed for a later pass with fresher quadrics
+		const size_t TriangleGoal = (result.size() - TargetIndexCount) / 3;
+		const size_t CollapseGoal = std::max<size_t>(TriangleGoal / 2, 1);
+
+		const float PassLimit = std::min(ErrorLimit, collapses[std::min(CollapseGoal, collapses.size()) - 1].error * 1.5f);
+
+		// a triangle around the moving class must not turn over (or nearly) once its corner sits on to
+		auto flips = [&](uint32_t from, uint32_t to) -> bool
+		{
+			const uint32_t FromClass = classes[from];
+			const uint32_t ToClass = classes[to];
+
+			for (uint32_t t = offsets[FromClass]; t < offsets[FromClass + 1]; ++t)
+			{
+				const size_t i = triangles[t] * size_t(3);
+
+				XMFLOAT3 corners[3];
+				XMFLOAT3 moved[3];
+				bool shared = false;
+
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = remap[result[i + k]];
+
+					shared |= classes[v] == ToClass;
+					corners[k] = points[v];
+					moved[k] = classes[v] == FromClass ? points[to] : points[v];
+				}
+
+				if (shared)
+				{
+					continue;
+				}
+
+				const XMVECTOR before = Cross(corners[0], corners[1], corners[2]);
+				const XMVECTOR after = Cross(moved[0], moved[1], moved[2]);
+
+				const float dot = XMVectorGetX(XMVector3Dot(before, after));
+
+				if (dot <= 0.25f * XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after)))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		// an interior vertex touching both sides of a seam would drag the triangles of one side onto the wedge of the other
+		auto straddles = [&](uint32_t from, uint32_t to) -> bool
+		{
+			const uint32_t FromClass = classes[from];
+			const uint32_t ToClass = classes[to];
+
+			if (kinds[from] != VertexKind::Manifold || WedgeCounts[ToClass] == 1)
+			{
+				return false;
+			}
+
+			for (uint32_t t = offsets[FromClass]; t < offsets[FromClass + 1]; ++t)
+			{
+				const size_t i = triangles[t] * size_t(3);
+
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const uint32_t v = remap[result[i + k]];
+
+					if (classes[v] == ToClass && v != to)
+					{
+						return true;
+					}
+				}
+			}
+
+			return false;
+		};
+
+		size_t removed = 0;
+		size_t performed = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > PassLimit || removed >= TriangleGoal)
+			{
+				break;
+			}
+
+			const uint32_t FromClass = classes[collapse.from];
+			const uint32_t ToClass = classes[collapse.to];
+
+			if (locked[FromClass] || locked[ToClass] || straddles(collapse.from, collapse.to) || flips(collapse.from, collapse.to))
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+
+			if (collapse.wedge != kNone)
+			{
+				remap[collapse.wedge] = collapse.partner;
+			}
+
+			quadrics[ToClass] += quadrics[FromClass];
+
+			// both ends stay put for the rest of the pass, which keeps remap one level deep
+			locked[FromClass] = 1;
+			locked[ToClass] = 1;
+
+			ResultError = std::max(ResultError, collapse.error);
+			removed += kinds[collapse.from] == VertexKind::Border ? 1 : 2;
+			performed++;
+		}
+
+		if (performed == 0)
+		{
+			break;
+		}
+
+		// triangles with two corners at one position are gone
+		size_t count = 0;
+
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const uint32_t a = remap[result[i]];
+			const uint32_t b = remap[result[i + 1]];
+			const uint32_t c = remap[result[i + 2]];
+
+			if (classes[a] != classes[b] && classes[b] != classes[c] && classes[c] != classes[a])
+			{
+				result[count++] = a;
+				result[count++] = b;
+				result[count++] = c;
+			}
+		}
+
+		result.resize(count);
+
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(locked.begin(), locked.end(), uint8_t(0));
+	}
+
+	destination.resize(result.size());
+
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		destination[i] = static_cast<Index>(result[i]);
+	}
+
+	return std::sqrt(ResultError) * extent;
+}
+
+template<typename Index>
+std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain(std::vector<Index>& indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+															   uint32_t MaxLevels, float ratio)
+{
+	std::vector<Lod> lods;
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	std::vector<Index> previous(indices);
+	std::vector<Index> level;
+
+	for (uint32_t l = 1; l < MaxLevels; ++l)
+	{
+		const size_t target = static_cast<size_t>(previous.size() / 3 * ratio) * 3;
+		const float error = Simplify(std::span<const Index>(previous), positions, PositionStride, VertexCount, target, FLT_MAX, level);
+
+		// done once the mesh is down to its locked skeleton
+		if (level.empty() || level.size() * 10 > previous.size() * 9)
+		{
+			break;
+		}
+
+		// each level is simplified from the one before, so their errors add up
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.size()), lods.back().error + error });
+
+		indices.insert(indices.end(), level.begin(), level.end());
+		previous.swap(level);
+	}
+
+	return lods;
+}
+
+size_t MeshSimplifier::SelectLod(std::span<const Lod> lods, float distance, float PixelsPerUnit, float scale, float MaxPixelError)
+{
+	const float PixelsPerError = PixelsPerUnit * scale / std::max(distance, 1e-4f);
+
+	size_t selected = 0;
+
+	for (size_t i = 1; i < lods.size() && lods[i].error * PixelsPerError <= MaxPixelError; ++i)
+	{
+		selected = i;
+	}
+
+	return selected;
+}
+
+template float MeshSimplifier::Simplify<uint16_t>(std::span<const uint16_t>, const XMFLOAT3*, size_t, uint32_t, size_t, float, std::vector<uint16_t>&);
+template float MeshSimplifier::Simplify<uint32_t>(std::span<const uint32_t>, const XMFLOAT3*, size_t, uint32_t, size_t, float, std::vector<uint32_t>&);
+template float MeshSimplifier::Simplify<int32_t>(std::span<const int32_t>, const XMFLOAT3*, size_t, uint32_t, size_t, float, std::vector<int32_t>&);
+template std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain<uint16_t>(std::vector<uint16_t>&, const XMFLOAT3*, size_t, uint32_t, uint32_t, float);
+template std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain<uint32_t>(std::vector<uint32_t>&, const XMFLOAT3*, size_t, uint32_t, uint32_t, float);
+template std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain<int32_t>(std::vector<int32_t>&, const XMFLOAT3*, size_t, uint32_t, uint32_t, float);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// quadric error metric simplification (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+// by collapsing a vertex onto one of its neighbours, so a simplified index buffer still addresses the original,
+// unchanged vertices and a whole LOD chain shares one vertex buffer.
+// vertices that share a position but differ in other attributes (normal or uv seams) only collapse together,
+// along the seam, and vertices on open borders only slide along the border, so seams and outlines are kept
+class MeshSimplifier
+{
+public:
+	// simplify towards TargetIndexCount indices without moving the surface more than TargetError (in position units);
+	// PositionStride is the byte distance between the XMFLOAT3 positions of consecutive vertices.
+	// returns how far the result strays from the input, estimated as the root mean square distance of each moved vertex
+	// to the planes of the triangles it gathered, in position units
+	template<typename Index>
+	static float Simplify(std::span<const Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+						  size_t TargetIndexCount, float TargetError, std::vector<Index>& destination);
+
+	// one level of a chain, addressable as a SubMeshGeometry with BaseVertexLocation 0
+	struct Lod
+	{
+		uint32_t StartIndex = 0;
+		uint32_t IndexCount = 0;
+		float error = 0.0f; // estimated distance from level 0, in position units
+	};
+
+	// appends up to MaxLevels - 1 coarser levels after the input in indices, each aiming for ratio times the triangles
+	// of the one before, and stops early once a level no longer shrinks; level 0 is the input with error 0
+	template<typename Index>
+	static std::vector<Lod> BuildLodChain(std::vector<Index>& indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+										  uint32_t MaxLevels = 5, float ratio = 0.5f);
+
+	template<typename Vertex, typename Index>
+	static std::vector<Lod> BuildLodChain(std::span<const Vertex> vertices, XMFLOAT3 Vertex::* position, std::vector<Index>& indices,
+										  uint32_t MaxLevels = 5, float ratio = 0.5f)
+	{
+		return BuildLodChain(indices, &(vertices[0].*position), sizeof(Vertex), static_cast<uint32_t>(vertices.size()), MaxLevels, ratio);
+	}
+
+	// the coarsest level whose error covers at most MaxPixelError pixels at the given distance from the camera,
+	// with PixelsPerUnit = ScreenHeight / (2 * tan(FovY / 2)) the size in pixels of one unit at distance 1;
+	// scale is the largest scale factor of the instance's world matrix
+	static size_t SelectLod(std::span<const Lod> lods, float distance, float PixelsPerUnit, float scale = 1.0f, float MaxPixelError = 1.0f);
+};
@@ -0,0 +1,450 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+namespace
+{
+	const uint8_t kNotInMeshlet = 0xff;
+
+	// the triangles using each vertex, those of vertex v are triangles[offsets[v]] .. triangles[offsets[v + 1] - 1]
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	template<typename Index>
+	Adjacency BuildAdjacency(std::span<const Index> indices, uint32_t VertexCount)
+	{
+		Adjacency adjacency;
+		adjacency.offsets.assign(VertexCount + 1, 0);
+		adjacency.triangles.resize(indices.size());
+
+		for (Index index : indices)
+		{
+			adjacency.offsets[index + 1]++;
+		}
+
+		for (uint32_t v = 0; v < VertexCount; ++v)
+		{
+			adjacency.offsets[v + 1] += adjacency.offsets[v];
+		}
+
+		std::vector<uint32_t> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.triangles[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		return adjacency;
+	}
+
+	// sphere around the points grown from the two of them farthest apart (Ritter, "An Efficient Bounding Sphere")
+	void EnclosingSphere(std::span<const XMFLOAT3> points, XMFLOAT3& center, float& radius)
+	{
+		auto farthest = [&](XMVECTOR from)
+		{
+			size_t best = 0;
+			float distance = -1.0f;
+
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				const float d = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&points[i]), from)));
+
+				if (d > distance)
+				{
+					distance = d;
+					best = i;
+				}
+			}
+
+			return XMLoadFloat3(&points[best]);
+		};
+
+		const XMVECTOR a = farthest(XMLoadFloat3(&points[0]));
+		const XMVECTOR b = farthest(a);
+
+		XMVECTOR c = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+		float r = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(b, a)));
+
+		for (const XMFLOAT3& point : points)
+		{
+			const XMVECTOR p = XMLoadFloat3(&point);
+			const float d = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, c)));
+
+			// move towards the point by half the overshoot and grow by the same
+			if (d > r)
+			{
+				const float grow = 0.5f * (d - r);
+				c = XMVectorAdd(c, XMVectorScale(XMVectorSubtract(p, c), grow / d));
+				r += grow;
+			}
+		}
+
+		XMStoreFloat3(&center, c);
+		radius = r;
+	}
+
+	template<typename T>
+	void WriteArray(std::ostream& stream, const std::vector<T>& values)
+	{
+		stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadArray(std::istream& stream, std::vector<T>& values, uint32_t count)
+	{
+		values.resize(count);
+		return static_cast<bool>(stream.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T)));
+	}
+
+	const char kMagic[4] = { 'M', 'S', 'H', 'L' };
+	const uint32_t kVersion = 1;
+}
+
+template<typename Index>
+MeshletBuilder::MeshletData MeshletBuilder::Build(std::span<const Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+												  uint32_t MaxVertices, uint32_t MaxTriangles, float ConeWeight)
+{
+	assert(indices.size() % 3 == 0);
+	assert(MaxVertices >= 3 && MaxVertices < kNotInMeshlet && MaxTriangles >= 1);
+
+	auto position = [&](uint32_t v) -> const XMFLOAT3&
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const char*>(positions) + v * PositionStride);
+	};
+
+	const uint32_t TriangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	// centroid and unit normal of every triangle (zero for degenerate ones)
+	std::vector<XMFLOAT3> centroids(TriangleCount);
+	std::vector<XMFLOAT3> normals(TriangleCount);
+
+	for (uint32_t t = 0; t < TriangleCount; ++t)
+	{
+		const XMVECTOR p0 = XMLoadFloat3(&position(indices[3 * t + 0]));
+		const XMVECTOR p1 = XMLoadFloat3(&position(indices[3 * t + 1]));
+		const XMVECTOR p2 = XMLoadFloat3(&position(indices[3 * t + 2]));
+
+		const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		const float length = XMVectorGetX(XMVector3Length(normal));
+
+		XMStoreFloat3(&centroids[t], XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.0f / 3.0f));
+		XMStoreFloat3(&normals[t], length > 0.0f ? XMVectorScale(normal, 1.0f / length) : XMVectorZero());
+	}
+
+	const Adjacency adjacency = BuildAdjacency(indices, VertexCount);
+
+	MeshletData data;
+
+	std::vector<uint8_t> used(TriangleCount, 0);
+	std::vector<uint8_t> local(VertexCount, kNotInMeshlet);
+	std::vector<uint32_t> queued(TriangleCount, 0);
+	std::vector<uint32_t> candidates;
+
+	// source triangle of every meshlet triangle, for the normal cones
+	std::vector<uint32_t> sources;
+	sources.reserve(TriangleCount);
+
+	// the unused triangles left around each vertex; the next meshlet starts next to the last one where the fewest are left,
+	// along the edge of what is still unclustered, so the leftovers do not break up into small islands
+	std::vector<uint32_t> live(VertexCount);
+
+	for (uint32_t v = 0; v < VertexCount; ++v)
+	{
+		live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+
+	Meshlet meshlet;
+	XMVECTOR CentroidSum = XMVectorZero();
+	XMVECTOR NormalSum = XMVectorZero();
+
+	auto NewVertices = [&](uint32_t t)
+	{
+		return (local[indices[3 * t + 0]] == kNotInMeshlet) + (local[indices[3 * t + 1]] == kNotInMeshlet) + (local[indices[3 * t + 2]] == kNotInMeshlet);
+	};
+
+	auto add = [&](uint32_t t)
+	{
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const uint32_t v = static_cast<uint32_t>(indices[3 * t + k]);
+
+			if (local[v] == kNotInMeshlet)
+			{
+				local[v] = static_cast<uint8_t>(meshlet.VertexCount++);
+				data.vertices.push_back(v);
+
+				// the unused triangles around a new vertex are the ones the meshlet can grow into
+				for (uint32_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; ++a)
+				{
+					const uint32_t neighbour = adjacency.triangles[a];
+
+					if (!used[neighbour] && queued[neighbour] != data.meshlets.size() + 1)
+					{
+						queued[neighbour] = static_cast<uint32_t>(data.meshlets.size() + 1);
+						candidates.push_back(neighbour);
+					}
+				}
+			}
+
+			data.triangles.push_back(local[v]);
+			live[v]--;
+		}
+
+		used[t] = 1;
+		sources.push_back(t);
+		meshlet.TriangleCount++;
+
+		CentroidSum = XMVectorAdd(CentroidSum, XMLoadFloat3(&centroids[t]));
+		NormalSum = XMVectorAdd(NormalSum, XMLoadFloat3(&normals[t]));
+	};
+
+	auto finish = [&]()
+	{
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			local[data.vertices[meshlet.VertexOffset + i]] = kNotInMeshlet;
+		}
+
+		data.meshlets.push_back(meshlet);
+
+		meshlet.VertexOffset = static_cast<uint32_t>(data.vertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(data.triangles.size() / 3);
+		meshlet.VertexCount = 0;
+		meshlet.TriangleCount = 0;
+
+		CentroidSum = XMVectorZero();
+		NormalSum = XMVectorZero();
+		candidates.clear();
+	};
+
+	const uint32_t kNoSeed = std::numeric_limits<uint32_t>::max();
+
+	uint32_t scan = 0;
+	uint32_t seed = kNoSeed;
+
+	for (;;)
+	{
+		if (seed == kNoSeed)
+		{
+			while (scan < TriangleCount && used[scan])
+			{
+				++scan;
+			}
+
+			if (scan == TriangleCount)
+			{
+				break;
+			}
+
+			seed = scan;
+		}
+
+		add(seed);
+
+		while (meshlet.TriangleCount < MaxTriangles)
+		{
+			const XMVECTOR center = XMVectorScale(CentroidSum, 1.0f / meshlet.TriangleCount);
+			const XMVECTOR axis = XMVector3Normalize(NormalSum);
+
+			uint32_t best = std::numeric_limits<uint32_t>::max();
+			uint32_t BestPriority = std::numeric_limits<uint32_t>::max();
+			float BestScore = std::numeric_limits<float>::max();
+
+			size_t kept = 0;
+
+			for (uint32_t t : candidates)
+			{
+				if (used[t])
+				{
+					continue;
+				}
+
+				candidates[kept++] = t;
+
+				const uint32_t added = NewVertices(t);
+
+				if (meshlet.VertexCount + added > MaxVertices)
+				{
+					continue;
+				}
+
+				// triangles adding no vertex come first, then the last triangle of a vertex (left over it would
+				// start an island of its own), then the ones adding fewer vertices
+				const bool dangling = live[indices[3 * t + 0]] == 1 || live[indices[3 * t + 1]] == 1 || live[indices[3 * t + 2]] == 1;
+				const uint32_t priority = added == 0 ? 0 : (dangling ? 1 : added + 1);
+
+				const float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&centroids[t]), center)));
+				const float spread = 1.0f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[t]), axis));
+				const float score = distance * (1.0f + ConeWeight * spread);
+
+				if (priority < BestPriority || (priority == BestPriority && score < BestScore))
+				{
+					best = t;
+					BestPriority = priority;
+					BestScore = score;
+				}
+			}
+
+			candidates.resize(kept);
+
+			if (best == std::numeric_limits<uint32_t>::max())
+			{
+				break;
+			}
+
+			add(best);
+		}
+
+		seed = kNoSeed;
+		uint32_t SeedLive = std::numeric_limits<uint32_t>::max();
+
+		for (uint32_t t : candidates)
+		{
+			const uint32_t remaining = live[indices[3 * t + 0]] + live[indices[3 * t + 1]] + live[indices[3 * t + 2]];
+
+			if (!used[t] && remaining < SeedLive)
+			{
+				seed = t;
+				SeedLive = remaining;
+			}
+		}
+
+		finish();
+	}
+
+	// sphere around the vertices and the cone of the triangle normals
+	data.bounds.resize(data.meshlets.size());
+
+	std::vector<XMFLOAT3> points;
+
+	for (size_t m = 0; m < data.meshlets.size(); ++m)
+	{
+		const Meshlet& current = data.meshlets[m];
+		Bounds& bounds = data.bounds[m];
+
+		points.clear();
+
+		for (uint32_t i = 0; i < current.VertexCount; ++i)
+		{
+			points.push_back(position(data.vertices[current.VertexOffset + i]));
+		}
+
+		EnclosingSphere(points, bounds.center, bounds.radius);
+
+		XMVECTOR sum = XMVectorZero();
+
+		for (uint32_t t = 0; t < current.TriangleCount; ++t)
+		{
+			sum = XMVectorAdd(sum, XMLoadFloat3(&normals[sources[current.TriangleOffset + t]]));
+		}
+
+		const float length = XMVectorGetX(XMVector3Length(sum));
+
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+
+		const XMVECTOR axis = XMVectorScale(sum, 1.0f / length);
+
+		float MinDot = 1.0f;
+
+		for (uint32_t t = 0; t < current.TriangleCount; ++t)
+		{
+			MinDot = std::min(MinDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[sources[current.TriangleOffset + t]]), axis)));
+		}
+
+		// a cone much wider than a half space never culls anything
+		if (MinDot <= 0.1f)
+		{
+			continue;
+		}
+
+		XMStoreFloat3(&bounds.ConeAxis, axis);
+		bounds.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot);
+	}
+
+	return data;
+}
+
+template<typename Index>
+std::vector<Index> MeshletBuilder::Unpack(const MeshletData& data)
+{
+	std::vector<Index> indices(data.triangles.size());
+
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		const size_t first = size_t(3) * meshlet.TriangleOffset;
+
+		for (size_t i = first; i < first + size_t(3) * meshlet.TriangleCount; ++i)
+		{
+			indices[i] = static_cast<Index>(data.vertices[meshlet.VertexOffset + data.triangles[i]]);
+		}
+	}
+
+	return indices;
+}
+
+bool MeshletBuilder::IsBackfacing(const Bounds& bounds, const XMFLOAT3& eye)
+{
+	// the sphere lies inside the cone behind the cluster: every view direction into it is more than
+	// 90 degrees plus the cone's half angle away from the normals
+	const XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&bounds.center), XMLoadFloat3(&eye));
+	const float distance = XMVectorGetX(XMVector3Length(offset));
+
+	return XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&bounds.ConeAxis))) >= bounds.ConeCutoff * distance + bounds.radius;
+}
+
+// a fixed header (magic, version and the four counts) followed by the arrays as they are in memory
+void MeshletBuilder::MeshletData::write(std::ostream& stream) const
+{
+	const uint32_t header[5] =
+	{
+		kVersion,
+		static_cast<uint32_t>(meshlets.size()),
+		static_cast<uint32_t>(bounds.size()),
+		static_cast<uint32_t>(vertices.size()),
+		static_cast<uint32_t>(triangles.size())
+	};
+
+	stream.write(kMagic, sizeof(kMagic));
+	stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	WriteArray(stream, meshlets);
+	WriteArray(stream, bounds);
+	WriteArray(stream, vertices);
+	WriteArray(stream, triangles);
+}
+
+bool MeshletBuilder::MeshletData::read(std::istream& stream)
+{
+	char magic[sizeof(kMagic)];
+	uint32_t header[5];
+
+	if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+		!stream.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != kVersion)
+	{
+		return false;
+	}
+
+	return ReadArray(stream, meshlets, header[1]) &&
+		   ReadArray(stream, bounds, header[2]) &&
+		   ReadArray(stream, vertices, header[3]) &&
+		   ReadArray(stream, triangles, header[4]);
+}
+
+template MeshletBuilder::MeshletData MeshletBuilder::Build<uint16_t>(std::span<const uint16_t>, const XMFLOAT3*, size_t, uint32_t, uint32_t, uint32_t, float);
+template MeshletBuilder::MeshletData MeshletBuilder::Build<uint32_t>(std::span<const uint32_t>, const XMFLOAT3*, size_t, uint32_t, uint32_t, uint32_t, float);
+template MeshletBuilder::MeshletData MeshletBuilder::Build<int32_t>(std::span<const int32_t>, const XMFLOAT3*, size_t, uint32_t, uint32_t, uint32_t, float);
+template std::vector<uint16_t> MeshletBuilder::Unpack<uint16_t>(const MeshletData&);
+template std::vector<uint32_t> MeshletBuilder::Unpack<uint32_t>(const MeshletData&);
+template std::vector<int32_t> MeshletBuilder::Unpack<int32_t>(const MeshletData&);
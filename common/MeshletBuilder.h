@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// splits a triangle list into meshlets (clusters) of at most MaxVertices vertices and MaxTriangles triangles,
+// each with a bounding sphere and a normal cone so whole clusters can be culled before they are submitted
+class MeshletBuilder
+{
+public:
+	struct Meshlet
+	{
+		uint32_t VertexOffset = 0;   // first entry in MeshletData::vertices
+		uint32_t TriangleOffset = 0; // first triangle in MeshletData::triangles (3 entries each)
+		uint32_t VertexCount = 0;
+		uint32_t TriangleCount = 0;
+	};
+
+	// culling data in the space of the positions the meshlets were built from
+	struct Bounds
+	{
+		XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		float radius = 0.0f;
+
+		// every triangle faces away from eyes inside the cone around -ConeAxis, see IsBackfacing;
+		// ConeCutoff = 1 when the normals spread too much for the cone to cull anything
+		XMFLOAT3 ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		float ConeCutoff = 1.0f;
+	};
+
+	// flat arrays of plain structs, written and read as they are
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<Bounds> bounds;
+		std::vector<uint32_t> vertices; // mesh vertex of each meshlet vertex
+		std::vector<uint8_t> triangles; // meshlet local vertex of each triangle corner
+
+		void write(std::ostream& stream) const;
+		bool read(std::istream& stream);
+	};
+
+	// meshlets grow over shared edges, preferring triangles that add no vertex, then the ones closest to the
+	// meshlet and facing its way (ConeWeight = 0 ignores the facing); a cache optimized order gives the best clusters.
+	// PositionStride is the byte distance between the XMFLOAT3 positions of consecutive vertices
+	template<typename Index>
+	static MeshletData Build(std::span<const Index> indices, const XMFLOAT3* positions, size_t PositionStride, uint32_t VertexCount,
+							 uint32_t MaxVertices = 64, uint32_t MaxTriangles = 124, float ConeWeight = 0.5f);
+
+	template<typename Vertex, typename Index>
+	static MeshletData Build(std::span<const Vertex> vertices, XMFLOAT3 Vertex::* position, std::span<const Index> indices,
+							 uint32_t MaxVertices = 64, uint32_t MaxTriangles = 124, float ConeWeight = 0.5f)
+	{
+		return Build(indices, &(vertices[0].*position), sizeof(Vertex), static_cast<uint32_t>(vertices.size()), MaxVertices, MaxTriangles, ConeWeight);
+	}
+
+	// the meshlet triangles as a plain triangle list in meshlet order, so meshlet m is the index range
+	// [3 * TriangleOffset, 3 * (TriangleOffset + TriangleCount)) for pipelines without mesh shaders
+	template<typename Index>
+	static std::vector<Index> Unpack(const MeshletData& data);
+
+	// true when the camera at eye (in the same space as the bounds) can only see the back of the cluster
+	static bool IsBackfacing(const Bounds& bounds, const XMFLOAT3& eye);
+};
@@ -0,0 +1,221 @@
+#include "TangentSpace.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+	void Run(ThreadPool* pool, int count, const std::function<void(int)>& task)
+	{
+		if (pool != nullptr)
+		{
+			pool->ParallelFor(count, task);
+			return;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+	}
+
+	template<typename T>
+	const T& At(const T* base, size_t stride, size_t i)
+	{
+		return *reinterpret_cast<const T*>(reinterpret_cast<const char*>(base) + stride * i);
+	}
+
+	template<typename T>
+	T& At(T* base, size_t stride, size_t i)
+	{
+		return *reinterpret_cast<T*>(reinterpret_cast<char*>(base) + stride * i);
+	}
+
+	// a few chunks per thread so uneven ones even out, but none so small that the split costs more than it saves
+	int ChunkCountFor(ThreadPool* pool, size_t count)
+	{
+		return static_cast<int>(std::max<size_t>(1, std::min<size_t>(pool != nullptr ? 4 * pool->GetThreadCount() : 1, count / 4096)));
+	}
+
+	// any unit vector orthogonal to N, for vertices whose texture coordinates do not say which way u goes
+	XMVECTOR AnyOrthogonal(FXMVECTOR N)
+	{
+		const XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+		if (std::fabs(XMVectorGetX(XMVector3Dot(N, up))) < 1.0f - 0.001f)
+		{
+			return XMVector3Normalize(XMVector3Cross(up, N));
+		}
+
+		return XMVector3Normalize(XMVector3Cross(N, XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)));
+	}
+}
+
+template<typename Index>
+void TangentSpace::Generate(const XMFLOAT3* positions, size_t PositionStride,
+							const XMFLOAT3* normals, size_t NormalStride,
+							const XMFLOAT2* TexCoords, size_t TexCoordStride,
+							size_t VertexCount,
+							std::span<const Index> indices,
+							XMFLOAT4* tangents, size_t TangentStride,
+							ThreadPool* pool)
+{
+	if (VertexCount == 0)
+	{
+		return;
+	}
+
+	const size_t TriangleCount = indices.size() / 3;
+
+	const auto IsValid = [&](size_t t)
+	{
+		return static_cast<size_t>(indices[3 * t + 0]) < VertexCount && static_cast<size_t>(indices[3 * t + 1]) < VertexCount &&
+			   static_cast<size_t>(indices[3 * t + 2]) < VertexCount;
+	};
+
+	// the directions of +u and +v across every triangle, scaled by its area so small slivers count for little
+	std::vector<XMFLOAT3> TriangleTangents(TriangleCount);
+	std::vector<XMFLOAT3> TriangleBitangents(TriangleCount);
+
+	const int TriangleChunks = ChunkCountFor(pool, TriangleCount);
+
+	Run(pool, TriangleChunks, [&](int c)
+	{
+		const size_t first = TriangleCount * c / TriangleChunks;
+		const size_t last = TriangleCount * (c + 1) / TriangleChunks;
+
+		for (size_t t = first; t < last; ++t)
+		{
+			TriangleTangents[t] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			TriangleBitangents[t] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+			if (!IsValid(t))
+			{
+				continue;
+			}
+
+			const size_t i0 = static_cast<size_t>(indices[3 * t + 0]);
+			const size_t i1 = static_cast<size_t>(indices[3 * t + 1]);
+			const size_t i2 = static_cast<size_t>(indices[3 * t + 2]);
+
+			const XMVECTOR P0 = XMLoadFloat3(&At(positions, PositionStride, i0));
+			const XMVECTOR E1 = XMVectorSubtract(XMLoadFloat3(&At(positions, PositionStride, i1)), P0);
+			const XMVECTOR E2 = XMVectorSubtract(XMLoadFloat3(&At(positions, PositionStride, i2)), P0);
+
+			const XMFLOAT2& uv0 = At(TexCoords, TexCoordStride, i0);
+			const XMFLOAT2& uv1 = At(TexCoords, TexCoordStride, i1);
+			const XMFLOAT2& uv2 = At(TexCoords, TexCoordStride, i2);
+
+			const float du1 = uv1.x - uv0.x;
+			const float dv1 = uv1.y - uv0.y;
+			const float du2 = uv2.x - uv0.x;
+			const float dv2 = uv2.y - uv0.y;
+
+			const float determinant = du1 * dv2 - du2 * dv1;
+
+			// no area in texture space, so no direction for u or v
+			if (std::fabs(determinant) < 1e-12f)
+			{
+				continue;
+			}
+
+			const float sign = determinant < 0.0f ? -1.0f : 1.0f;
+			const float area = 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(E1, E2)));
+
+			const XMVECTOR T = XMVectorScale(XMVectorSubtract(XMVectorScale(E1, dv2), XMVectorScale(E2, dv1)), sign);
+			const XMVECTOR B = XMVectorScale(XMVectorSubtract(XMVectorScale(E2, du1), XMVectorScale(E1, du2)), sign);
+
+			XMStoreFloat3(&TriangleTangents[t], XMVectorScale(XMVector3Normalize(T), area));
+			XMStoreFloat3(&TriangleBitangents[t], XMVectorScale(XMVector3Normalize(B), area));
+		}
+	});
+
+	// the triangles of every vertex in index order, so each vertex sums the same numbers in the same order whatever
+	// the chunks are
+	std::vector<uint32_t> offsets(VertexCount + 1, 0);
+
+	for (size_t t = 0; t < TriangleCount; ++t)
+	{
+		if (IsValid(t))
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				++offsets[static_cast<size_t>(indices[3 * t + k]) + 1];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < VertexCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<uint32_t> VertexTriangles(offsets[VertexCount]);
+	std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+
+	for (size_t t = 0; t < TriangleCount; ++t)
+	{
+		if (IsValid(t))
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				VertexTriangles[cursors[static_cast<size_t>(indices[3 * t + k])]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	const int VertexChunks = ChunkCountFor(pool, VertexCount);
+
+	Run(pool, VertexChunks, [&](int c)
+	{
+		const size_t first = VertexCount * c / VertexChunks;
+		const size_t last = VertexCount * (c + 1) / VertexChunks;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			XMVECTOR T = XMVectorZero();
+			XMVECTOR B = XMVectorZero();
+
+			for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k)
+			{
+				T = XMVectorAdd(T, XMLoadFloat3(&TriangleTangents[VertexTriangles[k]]));
+				B = XMVectorAdd(B, XMLoadFloat3(&TriangleBitangents[VertexTriangles[k]]));
+			}
+
+			const XMVECTOR N = XMVector3Normalize(XMLoadFloat3(&At(normals, NormalStride, i)));
+
+			// Gram-Schmidt: the part of the summed tangent that is orthogonal to the normal
+			T = XMVectorSubtract(T, XMVectorScale(N, XMVectorGetX(XMVector3Dot(N, T))));
+
+			float handedness = 1.0f;
+
+			if (XMVectorGetX(XMVector3LengthSq(T)) > 1e-20f)
+			{
+				T = XMVector3Normalize(T);
+
+				if (XMVectorGetX(XMVector3Dot(XMVector3Cross(N, T), B)) < 0.0f)
+				{
+					handedness = -1.0f;
+				}
+			}
+			else
+			{
+				T = AnyOrthogonal(N);
+			}
+
+			XMFLOAT4& tangent = At(tangents, TangentStride, i);
+
+			XMStoreFloat4(&tangent, T);
+			tangent.w = handedness;
+		}
+	});
+}
+
+template void TangentSpace::Generate<uint16_t>(const XMFLOAT3*, size_t, const XMFLOAT3*, size_t, const XMFLOAT2*, size_t, size_t,
+											   std::span<const uint16_t>, XMFLOAT4*, size_t, ThreadPool*);
+template void TangentSpace::Generate<uint32_t>(const XMFLOAT3*, size_t, const XMFLOAT3*, size_t, const XMFLOAT2*, size_t, size_t,
+											   std::span<const uint32_t>, XMFLOAT4*, size_t, ThreadPool*);
+template void TangentSpace::Generate<int32_t>(const XMFLOAT3*, size_t, const XMFLOAT3*, size_t, const XMFLOAT2*, size_t, size_t,
+											  std::span<const int32_t>, XMFLOAT4*, size_t, ThreadPool*);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class ThreadPool;
+
+// per vertex tangent frames for normal mapping, derived from the texture coordinates of indexed triangle lists
+// (Lengyel, "Computing Tangent Space Basis Vectors for an Arbitrary Mesh"): every triangle gets the directions in
+// which u and v grow across it, weighted by its area, each vertex sums those of its triangles, and the sum is made
+// orthogonal to the vertex normal. the triangles and the vertices are processed in chunks, one per task when a thread
+// pool is given, and a vertex always sums its triangles in index order, so the result does not depend on the pool.
+// strides are in bytes, so any interleaved layout can be read and written
+class TangentSpace
+{
+public:
+	// tangents[i] is the unit tangent of vertex i, along +u and orthogonal to its normal, with w the handedness:
+	// +1 when v grows along cross(normal, tangent), -1 when the texture is mirrored. a vertex whose triangles have no
+	// usable texture coordinates gets a tangent that is only orthogonal to its normal, with w = +1. triangles
+	// referring to vertices at or past VertexCount are skipped
+	template<typename Index>
+	static void Generate(const XMFLOAT3* positions, size_t PositionStride,
+						 const XMFLOAT3* normals, size_t NormalStride,
+						 const XMFLOAT2* TexCoords, size_t TexCoordStride,
+						 size_t VertexCount,
+						 std::span<const Index> indices,
+						 XMFLOAT4* tangents, size_t TangentStride,
+						 ThreadPool* pool = nullptr);
+
+	// the same over the members of a vertex array, with the handedness kept in an XMFLOAT4 tangent
+	template<typename Vertex, typename Index>
+	static void Generate(std::span<Vertex> vertices, std::span<const Index> indices,
+						 XMFLOAT3 Vertex::* position, XMFLOAT3 Vertex::* normal, XMFLOAT2 Vertex::* TexCoord, XMFLOAT4 Vertex::* tangent,
+						 ThreadPool* pool = nullptr)
+	{
+		if (vertices.empty())
+		{
+			return;
+		}
+
+		Generate(&(vertices[0].*position), sizeof(Vertex), &(vertices[0].*normal), sizeof(Vertex), &(vertices[0].*TexCoord), sizeof(Vertex),
+				 vertices.size(), indices, &(vertices[0].*tangent), sizeof(Vertex), pool);
+	}
+
+	// and with an XMFLOAT3 tangent, for the layouts whose shaders rebuild the bitangent as cross(normal, tangent)
+	// and so have no room for the handedness
+	template<typename Vertex, typename Index>
+	static void Generate(std::span<Vertex> vertices, std::span<const Index> indices,
+						 XMFLOAT3 Vertex::* position, XMFLOAT3 Vertex::* normal, XMFLOAT2 Vertex::* TexCoord, XMFLOAT3 Vertex::* tangent,
+						 ThreadPool* pool = nullptr)
+	{
+		if (vertices.empty())
+		{
+			return;
+		}
+
+		std::vector<XMFLOAT4> tangents(vertices.size());
+
+		Generate(&(vertices[0].*position), sizeof(Vertex), &(vertices[0].*normal), sizeof(Vertex), &(vertices[0].*TexCoord), sizeof(Vertex),
+				 vertices.size(), indices, tangents.data(), sizeof(XMFLOAT4), pool);
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			vertices[i].*tangent = XMFLOAT3(tangents[i].x, tangents[i].y, tangents[i].z);
+		}
+	}
+};
@@ -0,0 +1,335 @@
+#include "TextModelLoader.h"
+#include "MappedFile.h"
+#include "MathHelper.h"
+#include "TangentSpace.h"
+#include "TextScanner.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+	// the header is "VertexCount: <n>", read the number after the label
+	bool ReadCount(const char*& p, const char* end, uint32_t& count)
+	{
+		TextScanner scanner(p, end);
+		scanner.skip().read(count);
+		p = scanner.position();
+
+		return !scanner.failed();
+	}
+
+	// the text between the next '{' and the '}' after it
+	bool FindBlock(const char*& p, const char* end, const char*& BlockBegin, const char*& BlockEnd)
+	{
+		const char* open = static_cast<const char*>(std::memchr(p, '{', end - p));
+
+		if (open == nullptr)
+		{
+			return false;
+		}
+
+		const char* close = static_cast<const char*>(std::memchr(open + 1, '}', end - open - 1));
+
+		if (close == nullptr)
+		{
+			return false;
+		}
+
+		BlockBegin = open + 1;
+		BlockEnd = close;
+		p = close + 1;
+
+		return true;
+	}
+
+	void Run(ThreadPool* pool, int count, const std::function<void(int)>& task)
+	{
+		if (pool != nullptr)
+		{
+			pool->ParallelFor(count, task);
+			return;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+	}
+
+	// every number of a block in order. the block is cut into ChunkCount pieces at whitespace, so no number is split,
+	// each piece is parsed on its own and the pieces are concatenated; false if anything is not a number
+	template<typename T>
+	bool ParseBlock(const char* begin, const char* end, int ChunkCount, ThreadPool* pool, std::vector<T>& values)
+	{
+		std::vector<const char*> cuts(ChunkCount + 1, end);
+		cuts[0] = begin;
+
+		for (int c = 1; c < ChunkCount; ++c)
+		{
+			const char* cut = std::max(cuts[c - 1], begin + (end - begin) * c / ChunkCount);
+
+			cuts[c] = TextScanner::SkipToken(cut, end);
+		}
+
+		std::vector<std::vector<T>> chunks(ChunkCount);
+		std::vector<char> parsed(ChunkCount, 0);
+
+		Run(pool, ChunkCount, [&](int c)
+		{
+			std::vector<T>& chunk = chunks[c];
+			const char* p = TextScanner::SkipSpace(cuts[c], cuts[c + 1]);
+
+			// about one number per 8 characters in both blocks of the book's models
+			chunk.reserve((cuts[c + 1] - p) / 8 + 1);
+
+			while (p < cuts[c + 1])
+			{
+				T value;
+				const auto [next, error] = std::from_chars(p, cuts[c + 1], value);
+
+				if (error != std::errc())
+				{
+					return;
+				}
+
+				chunk.push_back(value);
+				p = TextScanner::SkipSpace(next, cuts[c + 1]);
+			}
+
+			parsed[c] = 1;
+		});
+
+		if (std::find(parsed.begin(), parsed.end(), 0) != parsed.end())
+		{
+			return false;
+		}
+
+		std::vector<size_t> offsets(ChunkCount + 1, 0);
+
+		for (int c = 0; c < ChunkCount; ++c)
+		{
+			offsets[c + 1] = offsets[c] + chunks[c].size();
+		}
+
+		if (offsets[ChunkCount] != values.size())
+		{
+			return false;
+		}
+
+		Run(pool, ChunkCount, [&](int c)
+		{
+			std::copy(chunks[c].begin(), chunks[c].end(), values.begin() + offsets[c]);
+		});
+
+		return true;
+	}
+
+	// the texture coordinates the demos derive from the position, computed exactly as they did
+	void DeriveTexCoord(TextModelLoader::Vertex& vertex)
+	{
+		const XMVECTOR P = XMLoadFloat3(&vertex.position);
+
+		// project point onto unit sphere and generate spherical texture coordinates
+		XMFLOAT3 SpherePosition;
+		XMStoreFloat3(&SpherePosition, XMVector3Normalize(P));
+
+		float theta = std::atan2(SpherePosition.z, SpherePosition.x);
+
+		// put in [0, 2pi]
+		if (theta < 0.0f)
+		{
+			theta += XM_2PI;
+		}
+
+		const float phi = std::acos(SpherePosition.y);
+
+		vertex.TexCoord = { theta / (2.0f * XM_PI), phi / XM_PI };
+	}
+
+	// changes whenever Load would build something else from the same text
+	constexpr std::string_view kCacheVariant = "TextModelLoader 2";
+
+	// false when the cache does not hold a whole model, including triangles past its vertices
+	bool ReadCache(TextModelLoader::CachedModel& model)
+	{
+		const std::span<const TextModelLoader::Vertex> vertices = model.cache.get<TextModelLoader::Vertex>(MeshCache::VerticesId);
+		const std::span<const std::int32_t> indices = model.cache.get<std::int32_t>(MeshCache::IndicesId);
+		const std::span<const MeshCache::Bounds> bounds = model.cache.get<MeshCache::Bounds>(MeshCache::BoundsId);
+
+		if (vertices.empty() || indices.empty() || bounds.size() != 1)
+		{
+			return false;
+		}
+
+		for (const std::int32_t index : indices)
+		{
+			if (index < 0 || static_cast<size_t>(index) >= vertices.size())
+			{
+				return false;
+			}
+		}
+
+		model.vertices = vertices;
+		model.indices = indices;
+		model.center = bounds[0].center;
+		model.extents = bounds[0].extents;
+
+		return true;
+	}
+}
+
+bool TextModelLoader::Load(const std::filesystem::path& filename, Model& model, ThreadPool* pool)
+{
+	const MappedFile file(filename);
+
+	if (file.empty())
+	{
+		return false;
+	}
+
+	const char* p = file.begin();
+
+	uint32_t VertexCount = 0;
+	uint32_t TriangleCount = 0;
+
+	const char* VertexBegin = nullptr;
+	const char* VertexEnd = nullptr;
+	const char* TriangleBegin = nullptr;
+	const char* TriangleEnd = nullptr;
+
+	if (!ReadCount(p, file.end(), VertexCount) || !ReadCount(p, file.end(), TriangleCount) ||
+		!FindBlock(p, file.end(), VertexBegin, VertexEnd) || !FindBlock(p, file.end(), TriangleBegin, TriangleEnd))
+	{
+		return false;
+	}
+
+	// a few chunks per thread so uneven ones even out, but none so small that the split costs more than it saves
+	const int ChunksPerBlock = std::max(1, std::min(pool != nullptr ? 4 * pool->GetThreadCount() : 1,
+													static_cast<int>((file.end() - file.begin()) / (64 * 1024))));
+
+	std::vector<float> values(6 * static_cast<size_t>(VertexCount));
+	model.indices.resize(3 * static_cast<size_t>(TriangleCount));
+
+	if (!ParseBlock(VertexBegin, VertexEnd, ChunksPerBlock, pool, values) ||
+		!ParseBlock(TriangleBegin, TriangleEnd, ChunksPerBlock, pool, model.indices))
+	{
+		return false;
+	}
+
+	model.vertices.resize(VertexCount);
+
+	const int ChunkCount = static_cast<int>(std::min<size_t>(ChunksPerBlock, std::max<size_t>(VertexCount, 1)));
+
+	std::vector<XMFLOAT3> minimums(ChunkCount, XMFLOAT3(+MathHelper::infinity, +MathHelper::infinity, +MathHelper::infinity));
+	std::vector<XMFLOAT3> maximums(ChunkCount, XMFLOAT3(-MathHelper::infinity, -MathHelper::infinity, -MathHelper::infinity));
+	std::vector<char> valid(ChunkCount, 1);
+
+	Run(pool, ChunkCount, [&](int c)
+	{
+		XMVECTOR vMin = XMLoadFloat3(&minimums[c]);
+		XMVECTOR vMax = XMLoadFloat3(&maximums[c]);
+
+		const size_t first = static_cast<size_t>(VertexCount) * c / ChunkCount;
+		const size_t last = static_cast<size_t>(VertexCount) * (c + 1) / ChunkCount;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			Vertex& vertex = model.vertices[i];
+			const float* v = &values[6 * i];
+
+			vertex.position = XMFLOAT3(v[0], v[1], v[2]);
+			vertex.normal = XMFLOAT3(v[3], v[4], v[5]);
+
+			DeriveTexCoord(vertex);
+
+			const XMVECTOR P = XMLoadFloat3(&vertex.position);
+			vMin = XMVectorMin(vMin, P);
+			vMax = XMVectorMax(vMax, P);
+		}
+
+		XMStoreFloat3(&minimums[c], vMin);
+		XMStoreFloat3(&maximums[c], vMax);
+
+		// the triangles are checked in as many pieces alongside
+		const size_t FirstIndex = model.indices.size() * c / ChunkCount;
+		const size_t LastIndex = model.indices.size() * (c + 1) / ChunkCount;
+
+		for (size_t i = FirstIndex; i < LastIndex; ++i)
+		{
+			if (model.indices[i] < 0 || static_cast<uint32_t>(model.indices[i]) >= VertexCount)
+			{
+				valid[c] = 0;
+				break;
+			}
+		}
+	});
+
+	if (std::find(valid.begin(), valid.end(), 0) != valid.end())
+	{
+		return false;
+	}
+
+	// along the texture's u, as normal mapping needs, rather than across world up
+	TangentSpace::Generate(std::span<Vertex>(model.vertices), std::span<const std::int32_t>(model.indices),
+						   &Vertex::position, &Vertex::normal, &Vertex::TexCoord, &Vertex::tangent, pool);
+
+	XMVECTOR vMin = XMLoadFloat3(&minimums[0]);
+	XMVECTOR vMax = XMLoadFloat3(&maximums[0]);
+
+	for (int c = 1; c < ChunkCount; ++c)
+	{
+		vMin = XMVectorMin(vMin, XMLoadFloat3(&minimums[c]));
+		vMax = XMVectorMax(vMax, XMLoadFloat3(&maximums[c]));
+	}
+
+	XMStoreFloat3(&model.center, XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f));
+	XMStoreFloat3(&model.extents, XMVectorScale(XMVectorSubtract(vMax, vMin), 0.5f));
+
+	return true;
+}
+
+bool TextModelLoader::LoadCached(const std::filesystem::path& filename, CachedModel& model, ThreadPool* pool)
+{
+	const uint64_t SourceHash = MeshCache::HashFile(filename, kCacheVariant);
+
+	if (SourceHash == 0)
+	{
+		return false;
+	}
+
+	const std::filesystem::path CachePath = MeshCache::CachePath(filename);
+
+	if (model.cache.open(CachePath, SourceHash) && ReadCache(model))
+	{
+		return true;
+	}
+
+	model.cache.close();
+
+	if (!Load(filename, model.parsed, pool))
+	{
+		return false;
+	}
+
+	model.vertices = model.parsed.vertices;
+	model.indices = model.parsed.indices;
+	model.center = model.parsed.center;
+	model.extents = model.parsed.extents;
+
+	const MeshCache::Bounds bounds = { model.center, model.extents };
+
+	MeshCache::Writer writer;
+	writer.add(MeshCache::VerticesId, model.vertices);
+	writer.add(MeshCache::IndicesId, model.indices);
+	writer.add(MeshCache::BoundsId, std::span<const MeshCache::Bounds>(&bounds, 1));
+
+	// a cache that cannot be written, in a read only folder say, only costs the next load a parse
+	writer.write(CachePath, SourceHash);
+
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MeshCache.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+class ThreadPool;
+
+// loads the text models of the book (skull.txt, car.txt): a vertex count, a triangle count, a block of
+// "px py pz nx ny nz" vertices and a block of "i0 i1 i2" triangles. the file is memory mapped and its blocks are
+// parsed with std::from_chars in chunks, one chunk per task when a thread pool is given, and the spherical texture
+// coordinates and bounds the demos derive from each vertex are computed in the same pass. the tangents follow the
+// texture coordinates, from TangentSpace
+class TextModelLoader
+{
+public:
+	// the vertex layout of the demos with normal mapping, ready to upload as it is
+	struct Vertex
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+		XMFLOAT2 TexCoord;
+		XMFLOAT3 tangent;
+	};
+
+	struct Model
+	{
+		std::vector<Vertex> vertices;
+		std::vector<std::int32_t> indices;
+
+		// axis aligned bounds of the positions, as BoundingBox takes them
+		XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	};
+
+	// false when the file cannot be opened or does not hold the counts it announces,
+	// including triangles that refer to vertices past the vertex count
+	static bool Load(const std::filesystem::path& filename, Model& model, ThreadPool* pool = nullptr);
+
+	// a model whose arrays are used in place in its cache file, or in parsed when the cache could not be written
+	struct CachedModel
+	{
+		std::span<const Vertex> vertices;
+		std::span<const std::int32_t> indices;
+
+		XMFLOAT3 center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		XMFLOAT3 extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		MeshCache::Reader cache;
+		Model parsed;
+	};
+
+	// the model from its binary cache (MeshCache::CachePath of the file), which is built with Load on the first
+	// load and again whenever the text changes; false when the text cannot be loaded
+	static bool LoadCached(const std::filesystem::path& filename, CachedModel& model, ThreadPool* pool = nullptr);
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+// a cursor over whitespace separated text in memory, for the loaders of the book's text formats. nothing is
+// allocated: labels such as "Position:" are stepped over in place and numbers are read with std::from_chars. once
+// a token is missing or is not the number asked for, the scanner fails and every later read does nothing, so a
+// whole record is read before failed() is checked once
+class TextScanner
+{
+	const char* mCurrent;
+	const char* mEnd;
+	bool mFailed = false;
+
+public:
+	TextScanner(const char* begin, const char* end) : mCurrent(begin), mEnd(end) {}
+
+	static bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	static const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			++p;
+		}
+
+		return p;
+	}
+
+	static const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsSpace(*p))
+		{
+			++p;
+		}
+
+		return p;
+	}
+
+	// the next token in place, empty once failed
+	std::string_view token()
+	{
+		if (mFailed)
+		{
+			return {};
+		}
+
+		const char* begin = SkipSpace(mCurrent, mEnd);
+
+		mCurrent = SkipToken(begin, mEnd);
+		mFailed = begin == mEnd;
+
+		return std::string_view(begin, mCurrent - begin);
+	}
+
+	// steps over the next count tokens
+	TextScanner& skip(int count = 1)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			token();
+		}
+
+		return *this;
+	}
+
+	// the next token, which has to be a number of type T and nothing else
+	template<typename T>
+	TextScanner& read(T& value)
+	{
+		if (!mFailed)
+		{
+			mCurrent = SkipSpace(mCurrent, mEnd);
+
+			const auto [next, error] = std::from_chars(mCurrent, mEnd, value);
+
+			mFailed = error != std::errc() || (next < mEnd && !IsSpace(*next));
+			mCurrent = next;
+		}
+
+		return *this;
+	}
+
+	// false once the rest is only whitespace
+	bool more()
+	{
+		mCurrent = SkipSpace(mCurrent, mEnd);
+		return mCurrent < mEnd;
+	}
+
+	bool failed() const { return mFailed; }
+	const char* position() const { return mCurrent; }
+
+	void seek(const char* position) { mCurrent = position; }
+	void fail() { mFailed = true; }
+};
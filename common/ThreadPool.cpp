@@ -0,0 +1,149 @@
+#include "ThreadPool.h"
+
+namespace
+{
+	// the pool whose tasks this thread is running, if any
+	thread_local const ThreadPool* tRunningPool = nullptr;
+}
+
+ThreadPool::ThreadPool(int WorkerCount)
+{
+	for (int i = 0; i < WorkerCount; ++i)
+	{
+		mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mWakeCondition.notify_all();
+
+	for (std::thread& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+int ThreadPool::GetWorkerCount() const
+{
+	return static_cast<int>(mWorkers.size());
+}
+
+int ThreadPool::GetThreadCount() const
+{
+	return static_cast<int>(mWorkers.size()) + 1;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (mWorkers.empty() || count == 1 || tRunningPool == this)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			task(i);
+		}
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> dispatch(mDispatchMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mTask = &task;
+		mTaskCount = count;
+		mNextTask = 0;
+		mActiveWorkers = static_cast<int>(mWorkers.size());
+		++mGeneration;
+	}
+
+	mWakeCondition.notify_all();
+
+	RunTasks();
+
+	// every worker has to check out of this dispatch before the task can go out of scope
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDoneCondition.wait(lock, [this] { return mActiveWorkers == 0; });
+
+	mTask = nullptr;
+	mTaskCount = 0;
+
+	if (mException)
+	{
+		std::exception_ptr exception = std::move(mException);
+		mException = nullptr;
+
+		lock.unlock();
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned long long generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWakeCondition.wait(lock, [&] { return mQuit || mGeneration != generation; });
+
+			if (mQuit)
+			{
+				return;
+			}
+
+			generation = mGeneration;
+		}
+
+		RunTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if (--mActiveWorkers == 0)
+			{
+				mDoneCondition.notify_one();
+			}
+		}
+	}
+}
+
+void ThreadPool::RunTasks()
+{
+	const ThreadPool* outer = tRunningPool;
+	tRunningPool = this;
+
+	for (int i = mNextTask++; i < mTaskCount; i = mNextTask++)
+	{
+		try
+		{
+			(*mTask)(i);
+		}
+		catch (...)
+		{
+			// keep the first one and hand out no more indices; the thread still checks out of the dispatch
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if (!mException)
+			{
+				mException = std::current_exception();
+			}
+
+			mNextTask = mTaskCount;
+		}
+	}
+
+	tRunningPool = outer;
+}
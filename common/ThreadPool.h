@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// persistent set of worker threads, created once and reused by every ParallelFor call
+class ThreadPool
+{
+	std::vector<std::thread> mWorkers;
+
+	std::mutex mMutex;
+	// held for a whole dispatch, so dispatches from different threads take turns
+	std::mutex mDispatchMutex;
+	std::condition_variable mWakeCondition;
+	std::condition_variable mDoneCondition;
+
+	const std::function<void(int)>* mTask = nullptr;
+	int mTaskCount = 0;
+	std::atomic<int> mNextTask = 0;
+	// the first exception a task of the current dispatch threw, rethrown by ParallelFor
+	std::exception_ptr mException;
+
+	// workers that have not yet finished the current dispatch
+	int mActiveWorkers = 0;
+	unsigned long long mGeneration = 0;
+	bool mQuit = false;
+
+	void WorkerLoop();
+	void RunTasks();
+
+public:
+	// the calling thread takes part in every dispatch, so WorkerCount = N - 1 keeps N cores busy
+	explicit ThreadPool(int WorkerCount = static_cast<int>(std::thread::hardware_concurrency()) - 1);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	int GetWorkerCount() const;
+	int GetThreadCount() const; // workers plus the calling thread
+
+	// run task(i) for every i in [0, count) and return once all of them are done,
+	// indices are handed out dynamically, so a task must not depend on which thread runs it.
+	// any thread may call it: calls from different threads run one after the other, and a call made by a task of
+	// this pool runs all of its indices on the calling thread, since the other threads are busy with the outer call.
+	// when a task throws, the indices not yet started are skipped and the first exception is rethrown on the calling
+	// thread once every running task has returned
+	void ParallelFor(int count, const std::function<void(int)>& task);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,432 @@
+#include "VertexCompression.h"
+
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <type_traits>
+
+// the position and direction kernels work on four vertices at a time with SSE2 (always available on x64)
+// and fall back to scalar code that rounds exactly like them, so both produce the same bits
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VERTEX_COMPRESSION_SSE
+#endif
+
+namespace
+{
+	const float kUnorm16 = 65535.0f;
+	const float kSnorm16 = 32767.0f;
+
+	// element i of a stream whose elements are stride bytes apart
+	template<typename T>
+	T& Element(T* base, size_t stride, size_t i)
+	{
+		using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+		return *reinterpret_cast<T*>(reinterpret_cast<Byte*>(base) + stride * i);
+	}
+
+	// round to nearest even, like _mm_cvtps_epi32 under the default rounding mode
+	int32_t Round(float value)
+	{
+		return static_cast<int32_t>(std::nearbyint(value));
+	}
+
+	void EncodePosition(const XMFLOAT3& position, const XMFLOAT3& offset, float scale, uint16_t* encoded)
+	{
+		const float p[3] = { position.x - offset.x, position.y - offset.y, position.z - offset.z };
+
+		for (int c = 0; c < 3; ++c)
+		{
+			encoded[c] = static_cast<uint16_t>(Round(std::clamp(p[c] * scale, 0.0f, kUnorm16)));
+		}
+
+		encoded[3] = 0;
+	}
+
+	XMFLOAT3 DecodePosition(const uint16_t* encoded, const XMFLOAT3& offset, float extent)
+	{
+		return XMFLOAT3(offset.x + extent * (encoded[0] / kUnorm16),
+						offset.y + extent * (encoded[1] / kUnorm16),
+						offset.z + extent * (encoded[2] / kUnorm16));
+	}
+
+	// project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one
+	void EncodeDirection(const XMFLOAT3& direction, int16_t* encoded)
+	{
+		const float inverse = 1.0f / std::max(std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z), FLT_MIN);
+
+		float x = direction.x * inverse;
+		float y = direction.y * inverse;
+		const float z = direction.z * inverse;
+
+		if (z < 0.0f)
+		{
+			const float FoldedX = (1.0f - std::fabs(y)) * std::copysign(1.0f, x);
+			const float FoldedY = (1.0f - std::fabs(x)) * std::copysign(1.0f, y);
+
+			x = FoldedX;
+			y = FoldedY;
+		}
+
+		encoded[0] = static_cast<int16_t>(Round(std::clamp(x, -1.0f, 1.0f) * kSnorm16));
+		encoded[1] = static_cast<int16_t>(Round(std::clamp(y, -1.0f, 1.0f) * kSnorm16));
+	}
+
+	XMFLOAT3 DecodeDirection(const int16_t* encoded)
+	{
+		float x = std::max(encoded[0] / kSnorm16, -1.0f);
+		float y = std::max(encoded[1] / kSnorm16, -1.0f);
+		const float z = 1.0f - std::fabs(x) - std::fabs(y);
+		const float t = std::max(-z, 0.0f);
+
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		const float length = std::sqrt(x * x + y * y + z * z);
+
+		return XMFLOAT3(x / length, y / length, z / length);
+	}
+
+#if defined(VERTEX_COMPRESSION_SSE)
+	// the floats at base in four consecutive stream elements, one per lane
+	__m128 Gather(const float* base, size_t stride, size_t i)
+	{
+		return _mm_setr_ps(Element(base, stride, i), Element(base, stride, i + 1), Element(base, stride, i + 2), Element(base, stride, i + 3));
+	}
+
+	// x >= 0 ? a : b per lane
+	__m128 SelectNonNegative(__m128 x, __m128 a, __m128 b)
+	{
+		const __m128 mask = _mm_cmpge_ps(x, _mm_setzero_ps());
+
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+#endif
+}
+
+VertexCompression::PositionBounds VertexCompression::ComputeBounds(const XMFLOAT3* positions, size_t stride, size_t count)
+{
+	PositionBounds bounds;
+
+	if (count == 0)
+	{
+		return bounds;
+	}
+
+	XMFLOAT3 minimum = positions[0];
+	XMFLOAT3 maximum = positions[0];
+
+	for (size_t i = 1; i < count; ++i)
+	{
+		const XMFLOAT3& p = Element(positions, stride, i);
+
+		minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	const float extent = std::max({ maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z });
+
+	bounds.offset = minimum;
+	bounds.extent = extent > 0.0f ? extent : 1.0f;
+
+	return bounds;
+}
+
+void VertexCompression::EncodePositions(const XMFLOAT3* positions, size_t stride, size_t count, const PositionBounds& bounds, uint16_t* encoded, size_t EncodedStride)
+{
+	const float scale = kUnorm16 / bounds.extent;
+
+	size_t i = 0;
+
+#if defined(VERTEX_COMPRESSION_SSE)
+	const __m128 offset[3] = { _mm_set1_ps(bounds.offset.x), _mm_set1_ps(bounds.offset.y), _mm_set1_ps(bounds.offset.z) };
+	const __m128 vScale = _mm_set1_ps(scale);
+	const __m128 vMax = _mm_set1_ps(kUnorm16);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		alignas(16) int32_t units[3][4];
+
+		for (int c = 0; c < 3; ++c)
+		{
+			const __m128 p = _mm_mul_ps(_mm_sub_ps(Gather(&positions->x + c, stride, i), offset[c]), vScale);
+			_mm_store_si128(reinterpret_cast<__m128i*>(units[c]), _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(p, _mm_setzero_ps()), vMax)));
+		}
+
+		for (int v = 0; v < 4; ++v)
+		{
+			uint16_t* e = &Element(encoded, EncodedStride, i + v);
+
+			e[0] = static_cast<uint16_t>(units[0][v]);
+			e[1] = static_cast<uint16_t>(units[1][v]);
+			e[2] = static_cast<uint16_t>(units[2][v]);
+			e[3] = 0;
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		EncodePosition(Element(positions, stride, i), bounds.offset, scale, &Element(encoded, EncodedStride, i));
+	}
+}
+
+void VertexCompression::DecodePositions(const uint16_t* encoded, size_t EncodedStride, size_t count, const PositionBounds& bounds, XMFLOAT3* positions, size_t stride)
+{
+	size_t i = 0;
+
+#if defined(VERTEX_COMPRESSION_SSE)
+	const __m128 offset[3] = { _mm_set1_ps(bounds.offset.x), _mm_set1_ps(bounds.offset.y), _mm_set1_ps(bounds.offset.z) };
+	const __m128 extent = _mm_set1_ps(bounds.extent);
+	const __m128 vMax = _mm_set1_ps(kUnorm16);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const uint16_t* e[4] = { &Element(encoded, EncodedStride, i), &Element(encoded, EncodedStride, i + 1),
+								 &Element(encoded, EncodedStride, i + 2), &Element(encoded, EncodedStride, i + 3) };
+
+		alignas(16) float p[3][4];
+
+		for (int c = 0; c < 3; ++c)
+		{
+			const __m128i units = _mm_setr_epi32(e[0][c], e[1][c], e[2][c], e[3][c]);
+
+			_mm_store_ps(p[c], _mm_add_ps(offset[c], _mm_mul_ps(extent, _mm_div_ps(_mm_cvtepi32_ps(units), vMax))));
+		}
+
+		for (int v = 0; v < 4; ++v)
+		{
+			Element(positions, stride, i + v) = XMFLOAT3(p[0][v], p[1][v], p[2][v]);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		Element(positions, stride, i) = DecodePosition(&Element(encoded, EncodedStride, i), bounds.offset, bounds.extent);
+	}
+}
+
+void VertexCompression::EncodeDirections(const XMFLOAT3* directions, size_t stride, size_t count, int16_t* encoded, size_t EncodedStride)
+{
+	size_t i = 0;
+
+#if defined(VERTEX_COMPRESSION_SSE)
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 MinusOne = _mm_set1_ps(-1.0f);
+	const __m128 vMin = _mm_set1_ps(FLT_MIN);
+	const __m128 vSnorm = _mm_set1_ps(kSnorm16);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = Gather(&directions->x, stride, i);
+		__m128 y = Gather(&directions->y, stride, i);
+		__m128 z = Gather(&directions->z, stride, i);
+
+		const __m128 AbsX = _mm_andnot_ps(SignMask, x);
+		const __m128 AbsY = _mm_andnot_ps(SignMask, y);
+		const __m128 AbsZ = _mm_andnot_ps(SignMask, z);
+		const __m128 inverse = _mm_div_ps(one, _mm_max_ps(_mm_add_ps(_mm_add_ps(AbsX, AbsY), AbsZ), vMin));
+
+		x = _mm_mul_ps(x, inverse);
+		y = _mm_mul_ps(y, inverse);
+		z = _mm_mul_ps(z, inverse);
+
+		const __m128 FoldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(SignMask, y)), _mm_or_ps(one, _mm_and_ps(x, SignMask)));
+		const __m128 FoldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(SignMask, x)), _mm_or_ps(one, _mm_and_ps(y, SignMask)));
+		const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+
+		x = _mm_or_ps(_mm_and_ps(lower, FoldedX), _mm_andnot_ps(lower, x));
+		y = _mm_or_ps(_mm_and_ps(lower, FoldedY), _mm_andnot_ps(lower, y));
+
+		alignas(16) int32_t e[2][4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(e[0]), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(x, MinusOne), one), vSnorm)));
+		_mm_store_si128(reinterpret_cast<__m128i*>(e[1]), _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(y, MinusOne), one), vSnorm)));
+
+		for (int v = 0; v < 4; ++v)
+		{
+			int16_t* out = &Element(encoded, EncodedStride, i + v);
+
+			out[0] = static_cast<int16_t>(e[0][v]);
+			out[1] = static_cast<int16_t>(e[1][v]);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		EncodeDirection(Element(directions, stride, i), &Element(encoded, EncodedStride, i));
+	}
+}
+
+void VertexCompression::DecodeDirections(const int16_t* encoded, size_t EncodedStride, size_t count, XMFLOAT3* directions, size_t stride)
+{
+	size_t i = 0;
+
+#if defined(VERTEX_COMPRESSION_SSE)
+	const __m128 SignMask = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 MinusOne = _mm_set1_ps(-1.0f);
+	const __m128 vSnorm = _mm_set1_ps(kSnorm16);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const int16_t* e[4] = { &Element(encoded, EncodedStride, i), &Element(encoded, EncodedStride, i + 1),
+								&Element(encoded, EncodedStride, i + 2), &Element(encoded, EncodedStride, i + 3) };
+
+		__m128 x = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_setr_epi32(e[0][0], e[1][0], e[2][0], e[3][0])), vSnorm), MinusOne);
+		__m128 y = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_setr_epi32(e[0][1], e[1][1], e[2][1], e[3][1])), vSnorm), MinusOne);
+		const __m128 z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(SignMask, x)), _mm_andnot_ps(SignMask, y));
+		const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+		const __m128 MinusT = _mm_sub_ps(_mm_setzero_ps(), t);
+
+		x = _mm_add_ps(x, SelectNonNegative(x, MinusT, t));
+		y = _mm_add_ps(y, SelectNonNegative(y, MinusT, t));
+
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+
+		alignas(16) float d[3][4];
+		_mm_store_ps(d[0], _mm_div_ps(x, length));
+		_mm_store_ps(d[1], _mm_div_ps(y, length));
+		_mm_store_ps(d[2], _mm_div_ps(z, length));
+
+		for (int v = 0; v < 4; ++v)
+		{
+			Element(directions, stride, i + v) = XMFLOAT3(d[0][v], d[1][v], d[2][v]);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		Element(directions, stride, i) = DecodeDirection(&Element(encoded, EncodedStride, i));
+	}
+}
+
+// DirectXMath converts whole streams, with F16C when the build enables it
+void VertexCompression::EncodeTexCoords(const XMFLOAT2* TexCoords, size_t stride, size_t count, uint16_t* encoded, size_t EncodedStride)
+{
+	PackedVector::XMConvertFloatToHalfStream(encoded, EncodedStride, &TexCoords->x, stride, count);
+	PackedVector::XMConvertFloatToHalfStream(encoded + 1, EncodedStride, &TexCoords->y, stride, count);
+}
+
+void VertexCompression::DecodeTexCoords(const uint16_t* encoded, size_t EncodedStride, size_t count, XMFLOAT2* TexCoords, size_t stride)
+{
+	PackedVector::XMConvertHalfToFloatStream(&TexCoords->x, stride, encoded, EncodedStride, count);
+	PackedVector::XMConvertHalfToFloatStream(&TexCoords->y, stride, encoded + 1, EncodedStride, count);
+}
+
+void VertexCompression::EncodeWeights(const XMFLOAT3* weights, size_t stride, size_t count, uint8_t* encoded, size_t EncodedStride)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& w = Element(weights, stride, i);
+		uint8_t* e = &Element(encoded, EncodedStride, i);
+
+		int32_t q[3] =
+		{
+			Round(std::clamp(w.x, 0.0f, 1.0f) * 255.0f),
+			Round(std::clamp(w.y, 0.0f, 1.0f) * 255.0f),
+			Round(std::clamp(w.z, 0.0f, 1.0f) * 255.0f),
+		};
+
+		// rounding up may overshoot 1 in total, take the excess from the largest weight
+		const int32_t excess = q[0] + q[1] + q[2] - 255;
+
+		if (excess > 0)
+		{
+			*std::max_element(q, q + 3) -= excess;
+		}
+
+		e[0] = static_cast<uint8_t>(q[0]);
+		e[1] = static_cast<uint8_t>(q[1]);
+		e[2] = static_cast<uint8_t>(q[2]);
+		e[3] = static_cast<uint8_t>(255 - q[0] - q[1] - q[2]);
+	}
+}
+
+void VertexCompression::DecodeWeights(const uint8_t* encoded, size_t EncodedStride, size_t count, XMFLOAT3* weights, size_t stride)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint8_t* e = &Element(encoded, EncodedStride, i);
+
+		Element(weights, stride, i) = XMFLOAT3(e[0] / 255.0f, e[1] / 255.0f, e[2] / 255.0f);
+	}
+}
+
+VertexCompression::Error VertexCompression::MeasureDistances(const XMFLOAT3* a, size_t aStride, const XMFLOAT3* b, size_t bStride, size_t count)
+{
+	Error error;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& p = Element(a, aStride, i);
+		const XMFLOAT3& q = Element(b, bStride, i);
+
+		const double dx = p.x - q.x;
+		const double dy = p.y - q.y;
+		const double dz = p.z - q.z;
+		const double squared = dx * dx + dy * dy + dz * dz;
+
+		error.max = std::max(error.max, static_cast<float>(std::sqrt(squared)));
+		sum += squared;
+	}
+
+	error.rms = count > 0 ? static_cast<float>(std::sqrt(sum / count)) : 0.0f;
+
+	return error;
+}
+
+VertexCompression::Error VertexCompression::MeasureDistances(const XMFLOAT2* a, size_t aStride, const XMFLOAT2* b, size_t bStride, size_t count)
+{
+	Error error;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT2& p = Element(a, aStride, i);
+		const XMFLOAT2& q = Element(b, bStride, i);
+
+		const double dx = p.x - q.x;
+		const double dy = p.y - q.y;
+		const double squared = dx * dx + dy * dy;
+
+		error.max = std::max(error.max, static_cast<float>(std::sqrt(squared)));
+		sum += squared;
+	}
+
+	error.rms = count > 0 ? static_cast<float>(std::sqrt(sum / count)) : 0.0f;
+
+	return error;
+}
+
+VertexCompression::Error VertexCompression::MeasureAngles(const XMFLOAT3* a, size_t aStride, const XMFLOAT3* b, size_t bStride, size_t count)
+{
+	Error error;
+	double sum = 0.0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const XMFLOAT3& p = Element(a, aStride, i);
+		const XMFLOAT3& q = Element(b, bStride, i);
+
+		// atan2 of |p x q| and p.q stays accurate for the tiny angles quantization leaves
+		const double cx = double(p.y) * q.z - double(p.z) * q.y;
+		const double cy = double(p.z) * q.x - double(p.x) * q.z;
+		const double cz = double(p.x) * q.y - double(p.y) * q.x;
+		const double dot = double(p.x) * q.x + double(p.y) * q.y + double(p.z) * q.z;
+		const double degrees = std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / XM_PI;
+
+		error.max = std::max(error.max, static_cast<float>(degrees));
+		sum += degrees * degrees;
+	}
+
+	error.rms = count > 0 ? static_cast<float>(std::sqrt(sum / count)) : 0.0f;
+
+	return error;
+}
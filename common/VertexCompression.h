@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <DirectXMath.h>
+using namespace DirectX;
+
+// optional compact vertex formats for static and skinned meshes: positions as 16-bit units of the mesh bounds,
+// normals and tangents folded onto an octahedron (Cigolle et al., "A Survey of Efficient Representations for
+// Independent Unit Vectors") in two 16-bit snorms, texture coordinates as half floats and bone weights as unorm8.
+// every attribute maps to a DXGI format the input assembler expands by itself, so only the normal needs decoding
+// in the shader. strides are in bytes, so the kernels read and write any interleaved layout
+class VertexCompression
+{
+public:
+	// position = offset + extent * unorm with the same extent on all three axes, so Dequantization() is a uniform
+	// scale that can be folded into the world matrix without skewing normals transformed by it
+	struct PositionBounds
+	{
+		XMFLOAT3 offset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		float extent = 1.0f;
+
+		XMMATRIX Dequantization() const
+		{
+			return XMMatrixScaling(extent, extent, extent) * XMMatrixTranslation(offset.x, offset.y, offset.z);
+		}
+	};
+
+	// 20 bytes instead of the 44 of a position / normal / uv / tangent vertex
+	struct PackedVertex
+	{
+		uint16_t position[4];  // DXGI_FORMAT_R16G16B16A16_UNORM, w = 0
+		int16_t normal[2];     // DXGI_FORMAT_R16G16_SNORM
+		int16_t tangent[2];    // DXGI_FORMAT_R16G16_SNORM
+		uint16_t TexCoord[2];  // DXGI_FORMAT_R16G16_FLOAT
+	};
+
+	// 28 bytes instead of the 64 of M3DLoader::SkinnedVertex
+	struct PackedSkinnedVertex
+	{
+		uint16_t position[4];   // DXGI_FORMAT_R16G16B16A16_UNORM, w = 0, or 1 where the tangent's handedness is -1
+		int16_t normal[2];      // DXGI_FORMAT_R16G16_SNORM
+		int16_t tangent[2];     // DXGI_FORMAT_R16G16_SNORM
+		uint16_t TexCoord[2];   // DXGI_FORMAT_R16G16_FLOAT
+		uint8_t BoneWeights[4]; // DXGI_FORMAT_R8G8B8A8_UNORM, the four weights sum to exactly 1
+		uint8_t BoneIndices[4]; // DXGI_FORMAT_R8G8B8A8_UINT
+	};
+
+	// the smallest cube around the positions
+	static PositionBounds ComputeBounds(const XMFLOAT3* positions, size_t stride, size_t count);
+
+	// positions as four uint16 each (w = 0), rounded to the nearest unit of extent / 65535
+	static void EncodePositions(const XMFLOAT3* positions, size_t stride, size_t count, const PositionBounds& bounds, uint16_t* encoded, size_t EncodedStride);
+	static void DecodePositions(const uint16_t* encoded, size_t EncodedStride, size_t count, const PositionBounds& bounds, XMFLOAT3* positions, size_t stride);
+
+	// unit vectors as two int16 each; zero vectors encode as +z. decoding matches the shader side DecodeOctahedral
+	static void EncodeDirections(const XMFLOAT3* directions, size_t stride, size_t count, int16_t* encoded, size_t EncodedStride);
+	static void DecodeDirections(const int16_t* encoded, size_t EncodedStride, size_t count, XMFLOAT3* directions, size_t stride);
+
+	// texture coordinates as two half floats each
+	static void EncodeTexCoords(const XMFLOAT2* TexCoords, size_t stride, size_t count, uint16_t* encoded, size_t EncodedStride);
+	static void DecodeTexCoords(const uint16_t* encoded, size_t EncodedStride, size_t count, XMFLOAT2* TexCoords, size_t stride);
+
+	// the first three bone weights (the fourth is whatever is left of 1) as four unorm8 summing to 255
+	static void EncodeWeights(const XMFLOAT3* weights, size_t stride, size_t count, uint8_t* encoded, size_t EncodedStride);
+	static void DecodeWeights(const uint8_t* encoded, size_t EncodedStride, size_t count, XMFLOAT3* weights, size_t stride);
+
+	struct Error
+	{
+		float max = 0.0f;
+		float rms = 0.0f;
+	};
+
+	// distances between the points of two streams, e.g. the input of an encoder and the output of its decoder
+	static Error MeasureDistances(const XMFLOAT3* a, size_t aStride, const XMFLOAT3* b, size_t bStride, size_t count);
+	static Error MeasureDistances(const XMFLOAT2* a, size_t aStride, const XMFLOAT2* b, size_t bStride, size_t count);
+
+	// angles in degrees between the directions of two streams
+	static Error MeasureAngles(const XMFLOAT3* a, size_t aStride, const XMFLOAT3* b, size_t bStride, size_t count);
+
+	// whole vertices, returning the bounds the positions were quantized to
+	template<typename Vertex>
+	static PositionBounds Pack(std::span<const Vertex> vertices, XMFLOAT3 Vertex::* position, XMFLOAT3 Vertex::* normal, XMFLOAT2 Vertex::* TexCoord,
+							   XMFLOAT3 Vertex::* tangent, std::span<PackedVertex> packed)
+	{
+		const PositionBounds bounds = ComputeBounds(&(vertices[0].*position), sizeof(Vertex), vertices.size());
+
+		EncodePositions(&(vertices[0].*position), sizeof(Vertex), vertices.size(), bounds, packed[0].position, sizeof(PackedVertex));
+		EncodeDirections(&(vertices[0].*normal), sizeof(Vertex), vertices.size(), packed[0].normal, sizeof(PackedVertex));
+		EncodeDirections(&(vertices[0].*tangent), sizeof(Vertex), vertices.size(), packed[0].tangent, sizeof(PackedVertex));
+		EncodeTexCoords(&(vertices[0].*TexCoord), sizeof(Vertex), vertices.size(), packed[0].TexCoord, sizeof(PackedVertex));
+
+		return bounds;
+	}
+
+	template<typename Vertex>
+	static PositionBounds Pack(std::span<const Vertex> vertices, XMFLOAT3 Vertex::* position, XMFLOAT3 Vertex::* normal, XMFLOAT2 Vertex::* TexCoord,
+							   XMFLOAT4 Vertex::* tangent, XMFLOAT3 Vertex::* BoneWeights, uint8_t (Vertex::* BoneIndices)[4], std::span<PackedSkinnedVertex> packed)
+	{
+		const PositionBounds bounds = ComputeBounds(&(vertices[0].*position), sizeof(Vertex), vertices.size());
+
+		EncodePositions(&(vertices[0].*position), sizeof(Vertex), vertices.size(), bounds, packed[0].position, sizeof(PackedSkinnedVertex));
+		EncodeDirections(&(vertices[0].*normal), sizeof(Vertex), vertices.size(), packed[0].normal, sizeof(PackedSkinnedVertex));
+		EncodeDirections(reinterpret_cast<const XMFLOAT3*>(&(vertices[0].*tangent)), sizeof(Vertex), vertices.size(), packed[0].tangent, sizeof(PackedSkinnedVertex));
+		EncodeTexCoords(&(vertices[0].*TexCoord), sizeof(Vertex), vertices.size(), packed[0].TexCoord, sizeof(PackedSkinnedVertex));
+		EncodeWeights(&(vertices[0].*BoneWeights), sizeof(Vertex), vertices.size(), packed[0].BoneWeights, sizeof(PackedSkinnedVertex));
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			packed[i].position[3] = (vertices[i].*tangent).w < 0.0f ? 0xFFFF : 0;
+
+			for (int b = 0; b < 4; ++b)
+			{
+				packed[i].BoneIndices[b] = (vertices[i].*BoneIndices)[b];
+			}
+		}
+
+		return bounds;
+	}
+};
@@ -1,5 +1,7 @@
 #include "camera.h"
 
+#include <cassert>
+
 Camera::Camera()
 {
 	SetLens(0.25f * XM_PI, 1.0f, 1.0f, 1000.0f);
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "utils.h"
+#include "MathHelper.h"
 
 class Camera
 {
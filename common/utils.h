@@ -180,6 +180,12 @@ public:
     {
         std::memcpy(&mMappedData[index * mElementByteSize], &data, sizeof(T));
     }
+
+    // raw mapped memory, elements are tightly packed unless this is a constant buffer
+    BYTE* GetMappedData() const
+    {
+        return mMappedData;
+    }
 };
 
 struct Material
@@ -0,0 +1,190 @@
+// converts a text .m3d skinned model into the binary file M3DLoader::LoadBinary maps at run time, so a character
+// ships without any text to parse
+//
+// usage: m3dconvert [--index32] [--verify] <input.m3d> [output]
+// the output defaults to the input with the extension .m3db. --index32 stores the indices in 32 bits instead of 16,
+// --verify loads the written file back and checks it holds exactly what the text loader read, exiting with 1 if not
+
+#include "LoadM3D.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+	template<typename T>
+	bool SameBytes(const T& a, const T& b)
+	{
+		return std::memcmp(&a, &b, sizeof(T)) == 0;
+	}
+
+	bool SameKeyFrame(const KeyFrame& a, const KeyFrame& b)
+	{
+		return SameBytes(a.time, b.time) && SameBytes(a.translation, b.translation) && SameBytes(a.scale, b.scale) && SameBytes(a.rotation, b.rotation);
+	}
+
+	// what the binary file holds against what the text loader read, field by field; the key frames of the text are
+	// compared once sorted by time, as the binary file stores them
+	bool Verify(const std::filesystem::path& output,
+				const std::vector<M3DLoader::SkinnedVertex>& vertices,
+				const std::vector<USHORT>& indices,
+				const std::vector<M3DLoader::Subset>& subsets,
+				const std::vector<M3DLoader::M3DMaterial>& mats,
+				const SkinnedData& skinInfo)
+	{
+		M3DLoader loader;
+		M3DLoader::BinarySkinnedModel model;
+		std::vector<M3DLoader::Subset> BinarySubsets;
+		std::vector<M3DLoader::M3DMaterial> BinaryMats;
+		SkinnedData BinarySkinInfo;
+
+		if (!loader.LoadBinary(output, model, BinarySubsets, BinaryMats, BinarySkinInfo))
+		{
+			std::printf("%s cannot be loaded\n", output.string().c_str());
+			return false;
+		}
+
+		const auto check = [](bool same, const char* what)
+		{
+			if (!same)
+			{
+				std::printf("the %s differ\n", what);
+			}
+
+			return same;
+		};
+
+		bool same = check(model.vertices.size() == vertices.size() &&
+						  std::memcmp(model.vertices.data(), vertices.data(), model.vertices.size_bytes()) == 0, "vertices");
+
+		std::vector<uint32_t> BinaryIndices(model.indices16.begin(), model.indices16.end());
+		BinaryIndices.insert(BinaryIndices.end(), model.indices32.begin(), model.indices32.end());
+
+		same &= check(std::equal(BinaryIndices.begin(), BinaryIndices.end(), indices.begin(), indices.end()), "indices");
+
+		same &= check(std::equal(BinarySubsets.begin(), BinarySubsets.end(), subsets.begin(), subsets.end(),
+								 [](const M3DLoader::Subset& a, const M3DLoader::Subset& b)
+								 {
+									 return a.Id == b.Id && a.VertexStart == b.VertexStart && a.VertexCount == b.VertexCount &&
+											a.FaceStart == b.FaceStart && a.FaceCount == b.FaceCount;
+								 }), "subsets");
+
+		same &= check(std::equal(BinaryMats.begin(), BinaryMats.end(), mats.begin(), mats.end(),
+								 [](const M3DLoader::M3DMaterial& a, const M3DLoader::M3DMaterial& b)
+								 {
+									 return a.Name == b.Name && SameBytes(a.DiffuseAlbedo, b.DiffuseAlbedo) && SameBytes(a.FresnelR0, b.FresnelR0) &&
+											SameBytes(a.Roughness, b.Roughness) && a.AlphaClip == b.AlphaClip && a.MaterialTypeName == b.MaterialTypeName &&
+											a.DiffuseMapName == b.DiffuseMapName && a.NormalMapName == b.NormalMapName;
+								 }), "materials");
+
+		same &= check(BinarySkinInfo.GetBoneHierarchy() == skinInfo.GetBoneHierarchy(), "bone hierarchies");
+
+		same &= check(std::equal(BinarySkinInfo.GetBoneOffsets().begin(), BinarySkinInfo.GetBoneOffsets().end(),
+								 skinInfo.GetBoneOffsets().begin(), skinInfo.GetBoneOffsets().end(), SameBytes<XMFLOAT4X4>), "bone offsets");
+
+		const auto& animations = skinInfo.GetAnimations();
+		const auto& BinaryAnimations = BinarySkinInfo.GetAnimations();
+
+		bool SameClips = animations.size() == BinaryAnimations.size();
+
+		for (const auto& [name, clip] : animations)
+		{
+			const auto found = BinaryAnimations.find(name);
+
+			if (!SameClips || found == BinaryAnimations.end() || found->second.BoneAnimations.size() != clip.BoneAnimations.size())
+			{
+				SameClips = false;
+				break;
+			}
+
+			for (size_t b = 0; b < clip.BoneAnimations.size(); ++b)
+			{
+				std::vector<KeyFrame> keys = clip.BoneAnimations[b].KeyFrames;
+				std::stable_sort(keys.begin(), keys.end(), [](const KeyFrame& x, const KeyFrame& y) { return x.time < y.time; });
+
+				const std::vector<KeyFrame>& BinaryKeys = found->second.BoneAnimations[b].KeyFrames;
+
+				SameClips &= std::equal(keys.begin(), keys.end(), BinaryKeys.begin(), BinaryKeys.end(), SameKeyFrame);
+			}
+		}
+
+		same &= check(SameClips, "animation clips");
+
+		return same;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool WideIndices = false;
+	bool verify = false;
+	std::vector<std::filesystem::path> paths;
+
+	for (int a = 1; a < argc; ++a)
+	{
+		if (std::strcmp(argv[a], "--index32") == 0)
+		{
+			WideIndices = true;
+		}
+		else if (std::strcmp(argv[a], "--verify") == 0)
+		{
+			verify = true;
+		}
+		else
+		{
+			paths.push_back(argv[a]);
+		}
+	}
+
+	if (paths.empty() || paths.size() > 2)
+	{
+		std::printf("usage: m3dconvert [--index32] [--verify] <input.m3d> [output]\n");
+		return 2;
+	}
+
+	const std::filesystem::path& input = paths[0];
+	const std::filesystem::path output = paths.size() > 1 ? paths[1] : std::filesystem::path(input).replace_extension(".m3db");
+
+	M3DLoader loader;
+	ThreadPool pool;
+
+	std::vector<M3DLoader::SkinnedVertex> vertices;
+	std::vector<USHORT> indices;
+	std::vector<M3DLoader::Subset> subsets;
+	std::vector<M3DLoader::M3DMaterial> mats;
+	SkinnedData skinInfo;
+
+	if (!loader.LoadM3d(input.string(), vertices, indices, subsets, mats, skinInfo, &pool))
+	{
+		std::printf("%s is not a skinned .m3d model\n", input.string().c_str());
+		return 1;
+	}
+
+	// the source hash is only recorded, a shipped file is loaded whatever it was built from
+	if (!loader.SaveBinary(output, vertices, indices, subsets, mats, skinInfo, WideIndices, MeshCache::HashFile(input)))
+	{
+		std::printf("%s cannot be written\n", output.string().c_str());
+		return 1;
+	}
+
+	std::printf("%s: %zu vertices, %zu indices, %zu subsets, %u bones, %zu clips, %ju bytes\n", output.string().c_str(), vertices.size(),
+				indices.size(), subsets.size(), skinInfo.GetBoneCount(), skinInfo.GetAnimations().size(),
+				static_cast<uintmax_t>(std::filesystem::file_size(output)));
+
+	if (verify)
+	{
+		if (!Verify(output, vertices, indices, subsets, mats, skinInfo))
+		{
+			return 1;
+		}
+
+		std::printf("verified against the text loader\n");
+	}
+
+	return 0;
+}